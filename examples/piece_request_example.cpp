@@ -93,12 +93,12 @@ void example_piece_request_workflow() {
     std::cout << "Selected piece #" << next_piece << " for download\n";
 
     std::cout << "\n=== Step 6: Split piece into blocks ===\n";
-    std::vector<Block> blocks = piece_manager.getBlocksForPiece(next_piece);
+    BlockList blocks = piece_manager.getBlocksForPiece(next_piece);
     std::cout << "Piece split into " << blocks.size() << " blocks (16KB each)\n";
 
     for (size_t i = 0; i < blocks.size(); ++i) {
-        std::cout << "  Block " << i << ": offset=" << blocks[i].offset
-                  << " length=" << blocks[i].length << "\n";
+        std::cout << "  Block " << i << ": offset=" << blocks.offsets[i]
+                  << " length=" << blocks.lengths[i] << "\n";
     }
 
     std::cout << "\n=== Step 7: Request all blocks ===\n";
@@ -110,7 +110,7 @@ void example_piece_request_workflow() {
     std::cout << "\n=== Step 8: Receive PIECE messages ===\n";
     int blocks_received = 0;
 
-    while (blocks_received < blocks.size()) {
+    while (static_cast<size_t>(blocks_received) < blocks.size()) {
         message = peer.receiveMessage();
         if (!message) break;
 
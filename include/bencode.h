@@ -1,82 +1,346 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <new>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <memory>
-#include <variant>
+#include <memory_resource>
 #include <stdexcept>
 
 namespace torrent {
 
-// Bencode value types: integer, string, list, dictionary
+class BencodeError : public std::runtime_error {
+public:
+    explicit BencodeError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// String node: by default a zero-copy view into the buffer handed to the
+// parser, so .torrent metadata, tracker responses and the multi-hundred-KB
+// "pieces" blob are never duplicated into the tree. Trees built
+// programmatically (for encoding) construct from std::string and own their
+// bytes (copied to a heap block). toOwned() copies a view out when the
+// caller needs the string to outlive the parsed buffer. Pointer plus
+// size-with-ownership-bit: 16 bytes, so the containing value node stays
+// compact.
+class BencodeString {
+public:
+    BencodeString() : data_(nullptr), size_(0), owned_(0) {}
+    BencodeString(std::string_view view)
+        : data_(view.data()), size_(view.size()), owned_(0) {}
+    BencodeString(const std::string& owned) { copyBytes(owned.data(), owned.size()); }
+
+    BencodeString(const BencodeString& other) {
+        if (other.owned_) {
+            copyBytes(other.data_, other.size_);
+        } else {
+            data_ = other.data_;
+            size_ = other.size_;
+            owned_ = 0;
+        }
+    }
+
+    BencodeString(BencodeString&& other) noexcept
+        : data_(other.data_), size_(other.size_), owned_(other.owned_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.owned_ = 0;
+    }
+
+    BencodeString& operator=(const BencodeString& other) {
+        if (this != &other) {
+            BencodeString tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    BencodeString& operator=(BencodeString&& other) noexcept {
+        if (this != &other) {
+            if (owned_) {
+                delete[] data_;
+            }
+            data_ = other.data_;
+            size_ = other.size_;
+            owned_ = other.owned_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.owned_ = 0;
+        }
+        return *this;
+    }
+
+    ~BencodeString() {
+        if (owned_) {
+            delete[] data_;
+        }
+    }
+
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+    operator std::string_view() const { return view(); }
+
+    size_t size() const { return view().size(); }
+    size_t length() const { return view().size(); }
+    bool empty() const { return view().empty(); }
+    char operator[](size_t i) const { return view()[i]; }
+
+    // Copy into an owned std::string (the only place a string is copied)
+    std::string toOwned() const { return std::string(view()); }
+
+    friend bool operator==(const BencodeString& a, std::string_view b) {
+        return a.view() == b;
+    }
+    friend bool operator==(std::string_view a, const BencodeString& b) {
+        return a == b.view();
+    }
+    friend bool operator!=(const BencodeString& a, std::string_view b) {
+        return a.view() != b;
+    }
+    friend bool operator!=(std::string_view a, const BencodeString& b) {
+        return a != b.view();
+    }
+
+private:
+    void copyBytes(const char* src, size_t n) {
+        char* buf = new char[n];
+        std::memcpy(buf, src, n);
+        data_ = buf;
+        size_ = n;
+        owned_ = 1;
+    }
+
+    const char* data_;
+    size_t size_ : 63;
+    size_t owned_ : 1;
+};
+
+class BencodeValue;
+
+// Dictionary node: a flat vector of key/value pairs kept sorted by key.
+// Bencoded dicts are tiny (a handful to ~20 keys) and the spec requires
+// keys in sorted order, so the parser appends in place and lookups
+// binary-search one contiguous allocation instead of chasing red-black
+// tree nodes. The sorted invariant also keeps encode() canonical (the
+// info dict hash depends on it) without a sort pass.
+class BencodeDict {
+public:
+    using value_type = std::pair<std::string, BencodeValue>;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    // Trees built programmatically allocate from the global heap; the
+    // parser threads its arena through so every node array in a parsed
+    // tree comes from one bump allocator
+    BencodeDict() = default;
+    explicit BencodeDict(std::pmr::memory_resource* arena) : entries_(arena) {}
+    BencodeDict(const BencodeDict& other) = default;
+    BencodeDict(const BencodeDict& other, std::pmr::memory_resource* arena)
+        : entries_(other.entries_, arena) {}
+    BencodeDict(BencodeDict&&) = default;
+    BencodeDict& operator=(const BencodeDict&) = default;
+    BencodeDict& operator=(BencodeDict&&) = default;
+
+    // The resource backing the entry array (the parse arena for parsed
+    // trees, the default resource otherwise)
+    std::pmr::memory_resource* resource() const {
+        return entries_.get_allocator().resource();
+    }
+
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    // Binary search; O(log n) over contiguous keys
+    const_iterator find(std::string_view key) const;
+    iterator find(std::string_view key);
+
+    // Insert-or-assign keeping the sorted invariant
+    BencodeValue& operator[](std::string_view key);
+
+    // Checked lookup; throws std::out_of_range like std::map::at
+    const BencodeValue& at(std::string_view key) const;
+    BencodeValue& at(std::string_view key);
+
+private:
+    iterator lowerBound(std::string_view key);
+    const_iterator lowerBound(std::string_view key) const;
+
+    std::pmr::vector<value_type> entries_;
+};
+
+// Bencode value node: integer, string, list, dictionary.
+//
+// Compact tagged union instead of std::variant: lists and dicts live
+// behind a pointer, so the node is 24 bytes (tag + 16-byte payload)
+// rather than being padded out to the largest alternative. Lists of
+// integers and strings — the common shape in metainfo and tracker
+// replies — pack about twice as dense, and getters are one tag compare
+// instead of variant index machinery. List/dict nodes are allocated
+// from the same memory resource as their contents (the parse arena for
+// parsed trees, the global heap otherwise), so copies of arena-backed
+// values share the arena and must not outlive it — the same lifetime
+// contract the string views already impose.
 class BencodeValue {
 public:
     using Integer = int64_t;
-    using String = std::string;
-    using List = std::vector<BencodeValue>;
-    using Dictionary = std::map<std::string, BencodeValue>;
+    using String = BencodeString;
+    using List = std::pmr::vector<BencodeValue>;
+    using Dictionary = BencodeDict;
+
+    BencodeValue() : tag_(Tag::Integer), integer_(0) {}
+    BencodeValue(Integer i) : tag_(Tag::Integer), integer_(i) {}
+    BencodeValue(const String& s) : tag_(Tag::String) { new (&string_) String(s); }
+    BencodeValue(String&& s) : tag_(Tag::String) { new (&string_) String(std::move(s)); }
+    BencodeValue(const List& l) : tag_(Tag::List), list_(cloneList(l)) {}
+    BencodeValue(List&& l) : tag_(Tag::List), list_(adoptList(std::move(l))) {}
+    BencodeValue(const Dictionary& d) : tag_(Tag::Dictionary), dict_(cloneDict(d)) {}
+    BencodeValue(Dictionary&& d) : tag_(Tag::Dictionary), dict_(adoptDict(std::move(d))) {}
 
-    using Value = std::variant<Integer, String, List, Dictionary>;
+    BencodeValue(const BencodeValue& other) { copyFrom(other); }
+    BencodeValue(BencodeValue&& other) noexcept { moveFrom(std::move(other)); }
 
-    BencodeValue() = default;
-    BencodeValue(Integer i) : value_(i) {}
-    BencodeValue(const String& s) : value_(s) {}
-    BencodeValue(String&& s) : value_(std::move(s)) {}
-    BencodeValue(const List& l) : value_(l) {}
-    BencodeValue(List&& l) : value_(std::move(l)) {}
-    BencodeValue(const Dictionary& d) : value_(d) {}
-    BencodeValue(Dictionary&& d) : value_(std::move(d)) {}
+    BencodeValue& operator=(const BencodeValue& other) {
+        if (this != &other) {
+            BencodeValue tmp(other);
+            destroy();
+            moveFrom(std::move(tmp));
+        }
+        return *this;
+    }
+
+    BencodeValue& operator=(BencodeValue&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            moveFrom(std::move(other));
+        }
+        return *this;
+    }
+
+    ~BencodeValue() { destroy(); }
 
     // Type checkers
-    bool isInteger() const { return std::holds_alternative<Integer>(value_); }
-    bool isString() const { return std::holds_alternative<String>(value_); }
-    bool isList() const { return std::holds_alternative<List>(value_); }
-    bool isDictionary() const { return std::holds_alternative<Dictionary>(value_); }
+    bool isInteger() const { return tag_ == Tag::Integer; }
+    bool isString() const { return tag_ == Tag::String; }
+    bool isList() const { return tag_ == Tag::List; }
+    bool isDictionary() const { return tag_ == Tag::Dictionary; }
 
     // Getters
-    Integer getInteger() const { return std::get<Integer>(value_); }
-    const String& getString() const { return std::get<String>(value_); }
-    const List& getList() const { return std::get<List>(value_); }
-    const Dictionary& getDictionary() const { return std::get<Dictionary>(value_); }
+    Integer getInteger() const { requireTag(Tag::Integer); return integer_; }
+    const String& getString() const { requireTag(Tag::String); return string_; }
+    const List& getList() const { requireTag(Tag::List); return *list_; }
+    const Dictionary& getDictionary() const { requireTag(Tag::Dictionary); return *dict_; }
 
     // Mutable getters
-    String& getString() { return std::get<String>(value_); }
-    List& getList() { return std::get<List>(value_); }
-    Dictionary& getDictionary() { return std::get<Dictionary>(value_); }
+    String& getString() { requireTag(Tag::String); return string_; }
+    List& getList() { requireTag(Tag::List); return *list_; }
+    Dictionary& getDictionary() { requireTag(Tag::Dictionary); return *dict_; }
 
 private:
-    Value value_;
+    enum class Tag : uint8_t { Integer, String, List, Dictionary };
+
+    // List/dict node storage comes from the container's own memory
+    // resource; see the class comment for the lifetime implications
+    static List* adoptList(List&& l);
+    static List* cloneList(const List& l);
+    static Dictionary* adoptDict(Dictionary&& d);
+    static Dictionary* cloneDict(const Dictionary& d);
+
+    void destroy();
+    void copyFrom(const BencodeValue& other);
+    void moveFrom(BencodeValue&& other) noexcept;
+
+    void requireTag(Tag expected) const {
+        if (tag_ != expected) {
+            throw BencodeError("Bencode value accessed as wrong type");
+        }
+    }
+
+    Tag tag_;
+    union {
+        Integer integer_;
+        String string_;
+        List* list_;
+        Dictionary* dict_;
+    };
 };
 
-// Bencode parser
+// Bencode parser. parse() works in place over the caller's buffer: string
+// nodes are views into it, so the buffer must stay alive for as long as the
+// returned tree is used (wrap it in a BencodeDoc when that is not naturally
+// the case). Passing an arena routes every list/dict node array through a
+// single bump allocator instead of O(nodes) global-allocator calls — the
+// arena must then outlive the tree, which BencodeDoc arranges.
 class BencodeParser {
 public:
-    static BencodeValue parse(const std::string& data);
-    static BencodeValue parse(const std::vector<uint8_t>& data);
+    static BencodeValue parse(std::string_view data,
+                              std::pmr::memory_resource* arena =
+                                  std::pmr::get_default_resource());
+    static BencodeValue parse(const std::vector<uint8_t>& data,
+                              std::pmr::memory_resource* arena =
+                                  std::pmr::get_default_resource());
 
     static std::string encode(const BencodeValue& value);
 
 private:
-    BencodeParser(const std::string& data) : data_(data), pos_(0) {}
+    BencodeParser(std::string_view data, std::pmr::memory_resource* arena)
+        : p_(data.data()), end_(data.data() + data.size()), arena_(arena) {}
 
-    BencodeValue parseValue();
-    BencodeValue parseInteger();
-    BencodeValue parseString();
-    BencodeValue parseList();
-    BencodeValue parseDictionary();
+    // The productions share one signature so parseValue can dispatch
+    // through a byte-indexed table; integer and string ignore depth
+    BencodeValue parseValue(int depth);
+    BencodeValue parseInteger(int depth);
+    BencodeValue parseString(int depth);
+    BencodeValue parseList(int depth);
+    BencodeValue parseDictionary(int depth);
 
-    char peek() const;
-    char consume();
-    bool hasMore() const { return pos_ < data_.size(); }
+    // encode() = exact-size pre-pass + append pass into one string
+    static size_t encodedSize(const BencodeValue& value);
+    static void encodeInto(const BencodeValue& value, std::string& out);
 
-    std::string data_;
-    size_t pos_;
+    // Caps recursion on adversarial input; real metainfo nests 3-4 deep
+    static constexpr int kMaxDepth = 64;
+
+    // Flat cursor over the input: tokens advance p_ directly, so there
+    // is no per-character call or bounds check on the hot path
+    const char* p_;
+    const char* end_;
+    std::pmr::memory_resource* arena_;
 };
 
-class BencodeError : public std::runtime_error {
+// Couples a bencoded buffer with the tree parsed from it, for callers that
+// keep the parsed result beyond the scope that produced the bytes. Owns the
+// parse arena too: all node arrays live in one monotonic resource and are
+// released in O(1) when the doc is destroyed. Not movable: string nodes
+// point into data_, the tree points into arena_, and moving a small
+// std::string relocates its SSO storage.
+class BencodeDoc {
 public:
-    explicit BencodeError(const std::string& msg) : std::runtime_error(msg) {}
+    explicit BencodeDoc(std::string data)
+        : data_(std::move(data)), root_(BencodeParser::parse(data_, &arena_)) {}
+    explicit BencodeDoc(const std::vector<uint8_t>& data)
+        : data_(data.begin(), data.end()),
+          root_(BencodeParser::parse(data_, &arena_)) {}
+
+    BencodeDoc(const BencodeDoc&) = delete;
+    BencodeDoc& operator=(const BencodeDoc&) = delete;
+    BencodeDoc(BencodeDoc&&) = delete;
+    BencodeDoc& operator=(BencodeDoc&&) = delete;
+
+    const BencodeValue& root() const { return root_; }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+    // Declared before root_ so the tree is destroyed before its arena
+    std::pmr::monotonic_buffer_resource arena_;
+    BencodeValue root_;
 };
 
 } // namespace torrent
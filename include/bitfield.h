@@ -0,0 +1,240 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "cpu.h"
+
+namespace torrent {
+
+// Pop the lowest set bit of a word: returns its index and clears it.
+// Compiles to tzcnt + blsr on x86 — two branchless instructions — so
+// iterating a candidate word costs O(popcount) with no per-bit test.
+inline unsigned popNextBit(uint64_t& word) {
+    unsigned bit = static_cast<unsigned>(__builtin_ctzll(word));
+    word &= word - 1;
+    return bit;
+}
+
+// Reverse the bit order within each byte of a word (SWAR, three
+// mask/shift rounds). Wire-format bitfields are MSB-first per byte while
+// the packed words index LSB-first, so converting a whole 8-byte group
+// is one load, nine ALU ops and one store instead of 64 bit tests.
+inline uint64_t reverseBitsInBytes(uint64_t v) {
+    v = ((v & 0xF0F0F0F0F0F0F0F0ULL) >> 4) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    v = ((v & 0xCCCCCCCCCCCCCCCCULL) >> 2) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v & 0xAAAAAAAAAAAAAAAAULL) >> 1) | ((v & 0x5555555555555555ULL) << 1);
+    return v;
+}
+
+// Packed bitfield backed by 64-bit words.
+//
+// Replaces std::vector<bool> for peer/piece bitfields: queries touch one
+// word per 64 bits and counts use a single popcount per word instead of
+// bit-by-bit proxy access. A std::vector<bool> view is still available at
+// the API boundary (toBools/fromBools) for wire parsing and older callers.
+class Bitfield {
+public:
+    Bitfield() : nbits_(0) {}
+
+    explicit Bitfield(size_t nbits, bool value = false)
+        : words_(wordCount(nbits), value ? ~uint64_t(0) : 0), nbits_(nbits) {
+        maskTail();
+    }
+
+    // Number of bits in the bitfield
+    size_t size() const { return nbits_; }
+    bool empty() const { return nbits_ == 0; }
+
+    // Resize, preserving existing bits; new bits are set to `value`
+    void resize(size_t nbits, bool value = false) {
+        words_.resize(wordCount(nbits), value ? ~uint64_t(0) : 0);
+        if (value && nbits > nbits_ && (nbits_ & 63) != 0) {
+            // Set the freshly exposed bits in the old tail word
+            words_[nbits_ >> 6] |= ~uint64_t(0) << (nbits_ & 63);
+        }
+        nbits_ = nbits;
+        maskTail();
+    }
+
+    void clear() {
+        words_.clear();
+        nbits_ = 0;
+    }
+
+    // Single-bit access
+    bool test(size_t i) const {
+        return i < nbits_ && ((words_[i >> 6] >> (i & 63)) & 1) != 0;
+    }
+
+    void set(size_t i) {
+        if (i < nbits_) {
+            words_[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+
+    void reset(size_t i) {
+        if (i < nbits_) {
+            words_[i >> 6] &= ~(uint64_t(1) << (i & 63));
+        }
+    }
+
+    // Whole-field operations
+    void setAll() {
+        for (auto& w : words_) {
+            w = ~uint64_t(0);
+        }
+        maskTail();
+    }
+
+    void resetAll() {
+        for (auto& w : words_) {
+            w = 0;
+        }
+    }
+
+    // Number of set bits (runtime-dispatched popcount kernel)
+    size_t count() const {
+        return cpu::bitmapPopcount(words_.data(), words_.size());
+    }
+
+    // True if every bit is set. Branchless SWAR AND-reduction: fold all
+    // full words, then merge the tail word with its padding forced to ones.
+    bool all() const {
+        if (nbits_ == 0) {
+            return false;
+        }
+        uint64_t acc = ~uint64_t(0);
+        size_t full_words = nbits_ >> 6;
+        for (size_t i = 0; i < full_words; ++i) {
+            acc &= words_[i];
+        }
+        size_t tail_bits = nbits_ & 63;
+        if (tail_bits != 0) {
+            uint64_t tail_mask = (uint64_t(1) << tail_bits) - 1;
+            acc &= words_[full_words] | ~tail_mask;
+        }
+        return acc == ~uint64_t(0);
+    }
+
+    bool none() const {
+        for (uint64_t w : words_) {
+            if (w != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Raw word access for callers that operate on packed data directly
+    const std::vector<uint64_t>& words() const { return words_; }
+    std::vector<uint64_t>& words() { return words_; }
+
+    // Compatibility view: expand to std::vector<bool>
+    std::vector<bool> toBools() const {
+        std::vector<bool> bits(nbits_, false);
+        for (size_t wi = 0; wi < words_.size(); ++wi) {
+            uint64_t w = words_[wi];
+            while (w != 0) {
+                bits[(wi << 6) + popNextBit(w)] = true;
+            }
+        }
+        return bits;
+    }
+
+    // Parse a BitTorrent wire bitfield (BEP 3: byte 0 bit 7 is piece 0).
+    // The result spans nbytes*8 bits including any trailing padding,
+    // matching what a per-bit decode of the payload produced.
+    static Bitfield fromWire(const uint8_t* bytes, size_t nbytes) {
+        Bitfield bf(nbytes * 8);
+        size_t full_words = nbytes >> 3;
+        for (size_t wi = 0; wi < full_words; ++wi) {
+            uint64_t w;
+            std::memcpy(&w, bytes + (wi << 3), 8);
+            bf.words_[wi] = reverseBitsInBytes(w);
+        }
+        if (size_t tail = nbytes & 7) {
+            uint64_t w = 0;
+            std::memcpy(&w, bytes + (full_words << 3), tail);
+            bf.words_[full_words] = reverseBitsInBytes(w);
+        }
+        return bf;
+    }
+
+    // Serialize to the wire form; (nbits+7)/8 bytes, padding bits zero
+    std::vector<uint8_t> toWire() const {
+        std::vector<uint8_t> bytes((nbits_ + 7) / 8, 0);
+        size_t full_words = bytes.size() >> 3;
+        for (size_t wi = 0; wi < full_words; ++wi) {
+            uint64_t w = reverseBitsInBytes(words_[wi]);
+            std::memcpy(bytes.data() + (wi << 3), &w, 8);
+        }
+        if (size_t tail = bytes.size() & 7) {
+            uint64_t w = reverseBitsInBytes(words_[full_words]);
+            std::memcpy(bytes.data() + (full_words << 3), &w, tail);
+        }
+        return bytes;
+    }
+
+    // Compatibility view: pack from std::vector<bool>
+    static Bitfield fromBools(const std::vector<bool>& bits) {
+        Bitfield bf(bits.size());
+        for (size_t i = 0; i < bits.size(); ++i) {
+            if (bits[i]) {
+                bf.words_[i >> 6] |= uint64_t(1) << (i & 63);
+            }
+        }
+        return bf;
+    }
+
+private:
+    static size_t wordCount(size_t nbits) { return (nbits + 63) / 64; }
+
+    // Keep bits past nbits_ zero so count()/all() stay exact
+    void maskTail() {
+        size_t tail_bits = nbits_ & 63;
+        if (tail_bits != 0 && !words_.empty()) {
+            words_.back() &= (uint64_t(1) << tail_bits) - 1;
+        }
+    }
+
+    std::vector<uint64_t> words_;
+    size_t nbits_;
+};
+
+// True if `peer` advertises any piece missing from `ours`: OR-reduce
+// (~ours & peer) across words via the runtime-dispatched kernel.
+inline bool hasAnyInteresting(const uint64_t* ours, const uint64_t* peer, size_t num_words) {
+    return cpu::bitmapAndMissingAny(ours, peer, num_words) != 0;
+}
+
+// Number of pieces `peer` advertises that are missing from `ours`:
+// fused AND+popcount over the packed words
+inline size_t countInteresting(const std::vector<uint64_t>& ours,
+                               const std::vector<uint64_t>& peer) {
+    size_t common = ours.size() < peer.size() ? ours.size() : peer.size();
+    size_t count = cpu::bitmapAndMissingCount(ours.data(), peer.data(), common);
+    for (size_t i = common; i < peer.size(); ++i) {
+        count += static_cast<size_t>(__builtin_popcountll(peer[i]));
+    }
+    return count;
+}
+
+inline bool hasAnyInteresting(const std::vector<uint64_t>& ours,
+                              const std::vector<uint64_t>& peer) {
+    size_t common = ours.size() < peer.size() ? ours.size() : peer.size();
+    if (hasAnyInteresting(ours.data(), peer.data(), common)) {
+        return true;
+    }
+    // Pieces the peer advertises past the end of our bitfield are missing
+    // from ours by definition
+    for (size_t i = common; i < peer.size(); ++i) {
+        if (peer[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace torrent
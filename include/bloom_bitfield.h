@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace torrent {
+
+// 128-bit Bloom summary of piece availability.
+//
+// A full bitfield for the torrents this library targets runs to several
+// KB per peer; for tracker/PEX/DHT gossip, where an approximate answer
+// is acceptable, a 4-hash Bloom filter over piece indices compresses
+// the exchange to 16 bytes (~3% false positives at typical gossip
+// set sizes). Membership answers "possibly has" — local peer state
+// (peerHasPiece, piece selection) stays exact on the packed Bitfield.
+class BloomBitfield {
+public:
+    BloomBitfield() = default;
+
+    void insert(uint32_t piece_index) {
+        uint64_t h = hashPiece(piece_index);
+        uint32_t h1 = static_cast<uint32_t>(h);
+        uint32_t h2 = static_cast<uint32_t>(h >> 32);
+        for (int i = 0; i < kNumHashes; ++i) {
+            uint32_t bit = (h1 + static_cast<uint32_t>(i) * h2) & 127;
+            bits_[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+    }
+
+    // True if the piece may be in the set; false answers are exact
+    bool possiblyContains(uint32_t piece_index) const {
+        uint64_t h = hashPiece(piece_index);
+        uint32_t h1 = static_cast<uint32_t>(h);
+        uint32_t h2 = static_cast<uint32_t>(h >> 32);
+        for (int i = 0; i < kNumHashes; ++i) {
+            uint32_t bit = (h1 + static_cast<uint32_t>(i) * h2) & 127;
+            if ((bits_[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear() {
+        bits_[0] = 0;
+        bits_[1] = 0;
+    }
+
+    bool empty() const { return bits_[0] == 0 && bits_[1] == 0; }
+
+    // Merge another summary (union of the underlying sets)
+    void merge(const BloomBitfield& other) {
+        bits_[0] |= other.bits_[0];
+        bits_[1] |= other.bits_[1];
+    }
+
+    // Raw words for wire encoding (little end first)
+    uint64_t low() const { return bits_[0]; }
+    uint64_t high() const { return bits_[1]; }
+
+    static BloomBitfield fromWords(uint64_t low, uint64_t high) {
+        BloomBitfield bf;
+        bf.bits_[0] = low;
+        bf.bits_[1] = high;
+        return bf;
+    }
+
+private:
+    static constexpr int kNumHashes = 4;
+
+    // 64-bit hash of a piece index: CRC32C folded with a multiplicative
+    // mix where SSE4.2 is available, pure mix otherwise. Dispatched like
+    // the SHA-1 kernel (cached cpuid check in the translation unit)
+    // because target_clones cannot express the intrinsic-only variant.
+    static uint64_t hashPiece(uint32_t piece_index);
+
+    uint64_t bits_[2] = {0, 0};
+};
+
+} // namespace torrent
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace torrent {
+namespace cpu {
+
+// Runtime-dispatched bitmap kernels.
+//
+// The packed-bitfield hot paths (seeder checks, interest checks, piece
+// counting) reduce over arrays of 64-bit words. These entry points are
+// compiled with GCC target_clones, so the dynamic loader's ifunc resolver
+// picks the best variant (AVX2, POPCNT, scalar) once at startup and every
+// call site then jumps straight to it — no per-call feature test, and the
+// same binary runs on hosts with and without the extensions. SHA-1 keeps
+// its own dispatch in sha1_hw.h because the SHA-NI kernel needs a shape
+// target_clones cannot express.
+
+// Total number of set bits across `num_words` words
+size_t bitmapPopcount(const uint64_t* words, size_t num_words);
+
+// OR-reduction of (~ours & peer): non-zero iff the peer advertises a
+// piece that is missing from ours
+uint64_t bitmapAndMissingAny(const uint64_t* ours, const uint64_t* peer,
+                             size_t num_words);
+
+// Number of set bits in (~ours & peer): how many of the peer's pieces
+// are missing from ours
+size_t bitmapAndMissingCount(const uint64_t* ours, const uint64_t* peer,
+                             size_t num_words);
+
+// Positional popcount: counts[b] = number of words with bit b set, for
+// all 64 bit positions in one pass. Used by rarest-first to turn a
+// column of per-peer words into per-piece availability counts.
+void bitmapPositionalCount(const uint64_t* words, size_t num_words,
+                           uint32_t counts[64]);
+
+} // namespace cpu
+} // namespace torrent
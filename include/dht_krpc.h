@@ -50,7 +50,7 @@ struct KRPCQuery : public KRPCMessage {
 
     // Query-specific arguments
     std::optional<NodeID> target;        // For find_node
-    std::optional<std::vector<uint8_t>> info_hash;  // For get_peers, announce_peer
+    std::optional<InfoHash> info_hash;   // For get_peers, announce_peer
     std::optional<uint16_t> port;        // For announce_peer
     std::optional<std::string> token;    // For announce_peer
     std::optional<int> implied_port;     // For announce_peer
@@ -96,7 +96,11 @@ struct KRPCError : public KRPCMessage {
 // KRPC Message factory and parser
 class KRPCMessageFactory {
 public:
-    // Parse raw bencode data into appropriate message type
+    // Parse raw bencode data into appropriate message type. The
+    // pointer form works straight off the receive buffer; the vector
+    // overload delegates to it.
+    static std::variant<KRPCQuery, KRPCResponse, KRPCError> parse(
+        const uint8_t* data, size_t length);
     static std::variant<KRPCQuery, KRPCResponse, KRPCError> parse(
         const std::vector<uint8_t>& data);
 
@@ -110,12 +114,12 @@ public:
 
     // Create get_peers query
     static KRPCQuery createGetPeers(const NodeID& sender_id,
-                                    const std::vector<uint8_t>& info_hash,
+                                    const InfoHash& info_hash,
                                     const std::string& tid);
 
     // Create announce_peer query
     static KRPCQuery createAnnouncePeer(const NodeID& sender_id,
-                                        const std::vector<uint8_t>& info_hash,
+                                        const InfoHash& info_hash,
                                         uint16_t port,
                                         const std::string& token,
                                         const std::string& tid,
@@ -147,9 +151,18 @@ public:
                                  const std::string& message,
                                  const std::string& tid);
 
+    // Upper bound for a serialized KRPC datagram: BEP 5 messages fit
+    // comfortably in one MTU
+    static constexpr size_t MAX_PACKET_SIZE = 1500;
+
     // Serialize message to bencode bytes
     static std::vector<uint8_t> serialize(const KRPCMessage& message);
 
+    // Serialize into a caller-provided buffer (stack array or the UDP
+    // batcher's send slab) with no heap allocation; returns bytes
+    // written, or 0 if the message does not fit
+    static size_t serialize(const KRPCMessage& message, uint8_t* out, size_t capacity);
+
     // Generate random transaction ID
     static std::string generateTransactionId();
 
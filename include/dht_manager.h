@@ -3,10 +3,14 @@
 #include "dht_node.h"
 #include "dht_routing_table.h"
 #include "dht_krpc.h"
+#include "dht_udp_batcher.h"
+#include "inplace_function.h"
 #include <string>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <memory>
+#include <deque>
+#include <queue>
 #include <thread>
 #include <mutex>
 #include <atomic>
@@ -24,17 +28,27 @@ struct BootstrapNode {
     BootstrapNode(const std::string& h, uint16_t p) : host(h), port(p) {}
 };
 
-// Pending transaction
+// Continuations for in-flight queries. Inline-storage callables instead
+// of std::function: the largest capture (announce's node + info hash)
+// fits in 128 bytes, so queries at lookup fan-out rates allocate
+// nothing. Oversized captures fail to compile rather than silently
+// spilling to the heap.
+using ResponseCallback = InplaceFunction<void(const KRPCResponse&), 128>;
+using TimeoutCallback = InplaceFunction<void(), 64>;
+
+// Pending transaction. Our transaction IDs are always the 2 big-endian
+// bytes of a uint16 (see generateTransactionId), so they are tracked as
+// that integer — responses carrying any other TID shape are not ours.
 struct Transaction {
-    std::string id;
+    uint16_t id;
     QueryType type;
     NodeID target_node;
     std::chrono::steady_clock::time_point sent_time;
     int retry_count = 0;
 
     // Callback for response
-    std::function<void(const KRPCResponse&)> on_response;
-    std::function<void()> on_timeout;
+    ResponseCallback on_response;
+    TimeoutCallback on_timeout;
 };
 
 // Peer info from get_peers
@@ -43,6 +57,17 @@ struct DHTpeer {
     uint16_t port;
 };
 
+// BEP 5 compact peer as stored for serving get_peers: IPv4 and port in
+// network byte order, exactly the 6 bytes that go on the wire
+struct CompactPeer6 {
+    uint32_t ip;    // network byte order
+    uint16_t port;  // network byte order
+
+    bool operator==(const CompactPeer6& other) const {
+        return ip == other.ip && port == other.port;
+    }
+};
+
 // DHT Manager
 class DHTManager {
 public:
@@ -58,11 +83,11 @@ public:
     void bootstrap(const std::vector<BootstrapNode>& bootstrap_nodes);
 
     // Find peers for info_hash
-    std::vector<DHTpeer> getPeers(const std::vector<uint8_t>& info_hash,
+    std::vector<DHTpeer> getPeers(const InfoHash& info_hash,
                                   int timeout_seconds = 30);
 
     // Announce ourselves as a peer for info_hash
-    void announcePeer(const std::vector<uint8_t>& info_hash, uint16_t port);
+    void announcePeer(const InfoHash& info_hash, uint16_t port);
 
     // Statistics
     size_t getNodeCount() const;
@@ -75,7 +100,9 @@ private:
     // Network operations
     void networkLoop();
     bool sendMessage(const KRPCMessage& message, const std::string& ip, uint16_t port);
-    void handleIncomingMessage(const std::vector<uint8_t>& data,
+    // `data` points into the batcher's receive slab; it is consumed
+    // before the next receiveBatch reuses the slot
+    void handleIncomingMessage(const uint8_t* data, size_t length,
                               const std::string& from_ip,
                               uint16_t from_port);
 
@@ -102,53 +129,82 @@ private:
 
     // DHT operations
     void ping(const Node& node,
-             std::function<void(const KRPCResponse&)> on_response = nullptr,
-             std::function<void()> on_timeout = nullptr);
+             ResponseCallback on_response = nullptr,
+             TimeoutCallback on_timeout = nullptr);
 
     void findNode(const Node& node,
                  const NodeID& target,
-                 std::function<void(const KRPCResponse&)> on_response = nullptr,
-                 std::function<void()> on_timeout = nullptr);
+                 ResponseCallback on_response = nullptr,
+                 TimeoutCallback on_timeout = nullptr);
 
     void getPeersFromNode(const Node& node,
-                         const std::vector<uint8_t>& info_hash,
-                         std::function<void(const KRPCResponse&)> on_response = nullptr,
-                         std::function<void()> on_timeout = nullptr);
+                         const InfoHash& info_hash,
+                         ResponseCallback on_response = nullptr,
+                         TimeoutCallback on_timeout = nullptr);
 
     void announcePeerToNode(const Node& node,
-                           const std::vector<uint8_t>& info_hash,
+                           const InfoHash& info_hash,
                            uint16_t port,
                            const std::string& token,
-                           std::function<void(const KRPCResponse&)> on_response = nullptr,
-                           std::function<void()> on_timeout = nullptr);
+                           ResponseCallback on_response = nullptr,
+                           TimeoutCallback on_timeout = nullptr);
 
-    // Transaction management
-    void addTransaction(const std::string& tid,
+    // Transaction management (keyed by the TID as a uint16)
+    void addTransaction(uint16_t tid,
                        QueryType type,
                        const NodeID& target_node,
-                       std::function<void(const KRPCResponse&)> on_response,
-                       std::function<void()> on_timeout);
-    void removeTransaction(const std::string& tid);
+                       ResponseCallback on_response,
+                       TimeoutCallback on_timeout);
+    void removeTransaction(uint16_t tid);
     void checkTransactionTimeouts();
 
     // Token management (for announce_peer)
-    std::string generateToken(const std::string& ip, const std::vector<uint8_t>& info_hash);
+    std::string generateToken(const std::string& ip, const InfoHash& info_hash);
     bool verifyToken(const std::string& token,
                     const std::string& ip,
-                    const std::vector<uint8_t>& info_hash);
+                    const InfoHash& info_hash);
 
-    // Maintenance
-    void maintenanceLoop();
+    // Maintenance, run from the network thread on a 60s deadline
+    void runMaintenance();
     void refreshBuckets();
+
+    // Bucket-refresh queries queued by refreshBuckets and dripped out a
+    // few per network-loop tick, so a full-table refresh is spread over
+    // seconds instead of bursting ~3 packets per stale bucket (and as
+    // many transaction inserts) in one pass. Touched only from the
+    // network thread, hence no lock.
+    struct PendingRefresh {
+        Node node;
+        NodeID target;
+    };
+    std::deque<PendingRefresh> refresh_queue_;
+    static constexpr size_t kRefreshQueriesPerTick = 2;
     void cleanupBadNodes();
 
-    // Peer storage (for serving get_peers)
+    // Peer storage (for serving get_peers). Keyed by the fixed-size
+    // InfoHash with a one-load hasher; peers are kept in the compact
+    // wire format so a get_peers response copies 6 bytes per peer with
+    // no string round trip. Sharded by the top bits of the info hash so
+    // announce/get_peers traffic on different torrents does not
+    // serialize on a single lock.
     struct PeerStorage {
-        std::map<std::vector<uint8_t>, std::vector<DHTpeer>> peers;
-        std::mutex mutex;
-
-        void addPeer(const std::vector<uint8_t>& info_hash, const DHTpeer& peer);
-        std::vector<DHTpeer> getPeers(const std::vector<uint8_t>& info_hash) const;
+        static constexpr size_t kShards = 4;
+
+        struct Shard {
+            std::unordered_map<InfoHash, std::vector<CompactPeer6>, InfoHashHasher> peers;
+            mutable std::mutex mutex;
+        };
+        std::array<Shard, kShards> shards;
+
+        Shard& shardFor(const InfoHash& info_hash) {
+            return shards[info_hash[0] >> 6];
+        }
+        const Shard& shardFor(const InfoHash& info_hash) const {
+            return shards[info_hash[0] >> 6];
+        }
+
+        void addPeer(const InfoHash& info_hash, const CompactPeer6& peer);
+        std::vector<CompactPeer6> getPeers(const InfoHash& info_hash) const;
     };
 
     // State
@@ -156,22 +212,45 @@ private:
     uint16_t port_;
     int socket_fd_;
 
+    // Batches outgoing KRPC datagrams (sendmmsg) and drains incoming ones
+    // (recvmmsg); queued sends are flushed every network-loop tick
+    std::unique_ptr<UdpBatcher> udp_batcher_;
+
     std::unique_ptr<RoutingTable> routing_table_;
     PeerStorage peer_storage_;
 
-    // Transaction tracking
-    std::map<std::string, Transaction> pending_transactions_;
+    // Transaction tracking, keyed by the 2-byte KRPC TID as a uint16:
+    // response matching on the network path is one integer hash probe
+    // instead of an O(log N) string-compare tree walk, and outgoing
+    // queries key without allocating
+    std::unordered_map<uint16_t, Transaction> pending_transactions_;
+
+    // Expiry deadlines as a min-heap with lazy deletion: the sweep pops
+    // only entries whose deadline passed instead of walking every
+    // pending transaction (O(P) per sweep grows quadratic during
+    // bootstrap fan-out). Entries for answered or reissued TIDs are
+    // recognized and dropped at pop time.
+    using TimeoutEntry = std::pair<std::chrono::steady_clock::time_point, uint16_t>;
+    std::priority_queue<TimeoutEntry,
+                        std::vector<TimeoutEntry>,
+                        std::greater<TimeoutEntry>> timeout_heap_;
+    static constexpr std::chrono::seconds kTransactionTimeout{15};
+
     std::mutex transactions_mutex_;
 
-    // Token secret (rotated periodically)
-    std::string token_secret_;
-    std::string old_token_secret_;
+    // SipHash keys for announce tokens (rotated periodically; the
+    // previous key stays valid so a token handed out just before a
+    // rotation still verifies)
+    uint64_t token_key_[2] = {0, 0};
+    uint64_t old_token_key_[2] = {0, 0};
+    bool has_old_token_key_ = false;
     std::chrono::steady_clock::time_point last_token_rotation_;
 
-    // Threading
+    // Threading. One thread: the network loop also runs the periodic
+    // maintenance on deadlines, so routing-table and transaction state
+    // is never contended by a second thread waking out of a sleep.
     std::atomic<bool> running_;
     std::thread network_thread_;
-    std::thread maintenance_thread_;
 
     // Statistics
     std::atomic<int64_t> queries_sent_;
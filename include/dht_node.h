@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <array>
 #include <chrono>
 
@@ -13,6 +14,34 @@ namespace dht {
 constexpr size_t NODE_ID_SIZE = 20;
 using NodeID = std::array<uint8_t, NODE_ID_SIZE>;
 
+// Torrent info hash. Same 160-bit keyspace as node IDs (DHT lookups use
+// the info hash as a target ID directly), but fixed-size instead of a
+// heap vector: passing one is 20 bytes on the stack, no allocation, and
+// equality is a flat memcmp.
+using InfoHash = std::array<uint8_t, NODE_ID_SIZE>;
+
+// Hasher for unordered containers keyed by InfoHash. The hash IS a
+// SHA-1 digest, already uniformly distributed, so the first 8 bytes
+// loaded as an integer are the whole hash function.
+struct InfoHashHasher {
+    size_t operator()(const InfoHash& h) const {
+        uint64_t v;
+        std::memcpy(&v, h.data(), sizeof(v));
+        return static_cast<size_t>(v);
+    }
+};
+
+// Build an InfoHash from a runtime byte buffer (torrent file, magnet
+// URI, wire). Input that is not exactly 20 bytes yields a zeroed hash,
+// mirroring the old vector-based path's fallback.
+inline InfoHash toInfoHash(const std::vector<uint8_t>& bytes) {
+    InfoHash hash{};
+    if (bytes.size() == NODE_ID_SIZE) {
+        std::memcpy(hash.data(), bytes.data(), NODE_ID_SIZE);
+    }
+    return hash;
+}
+
 // Node status based on BEP 5
 enum class NodeStatus {
     GOOD,         // Responded to our query within last 15 minutes
@@ -20,17 +49,57 @@ enum class NodeStatus {
     BAD           // Failed to respond to multiple queries
 };
 
+// Node liveness packed into a single word: the low 2 bits hold the
+// NodeStatus, the rest is the steady-clock last-seen time in nanoseconds
+// with those bits cleared (~4ns of precision nobody misses). The
+// good/questionable predicates run for every slot of every bucket scan;
+// on the packed form each is one load, a mask and two compares combined
+// with `&`/`|` — no branch on the enum for the CPU to mispredict, and
+// the loop over a bucket's liveness column vectorizes.
+constexpr uint64_t NODE_STATUS_MASK = 0x3;
+constexpr uint64_t NODE_GOOD_WINDOW_NS = 15ull * 60 * 1000000000ull;
+
+inline uint64_t steadyNowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline uint64_t packStatusSeen(NodeStatus status, uint64_t seen_ns) {
+    return (seen_ns & ~NODE_STATUS_MASK) | static_cast<uint64_t>(status);
+}
+
+inline bool packedGood(uint64_t packed, uint64_t now_ns) {
+    return ((now_ns - (packed & ~NODE_STATUS_MASK)) < NODE_GOOD_WINDOW_NS) &
+           ((packed & NODE_STATUS_MASK) ==
+            static_cast<uint64_t>(NodeStatus::GOOD));
+}
+
+inline bool packedQuestionable(uint64_t packed, uint64_t now_ns) {
+    uint64_t status = packed & NODE_STATUS_MASK;
+    bool fresh = (now_ns - (packed & ~NODE_STATUS_MASK)) < NODE_GOOD_WINDOW_NS;
+    return (status == static_cast<uint64_t>(NodeStatus::QUESTIONABLE)) |
+           ((status == static_cast<uint64_t>(NodeStatus::GOOD)) & !fresh);
+}
+
 // DHT Node representation
 class Node {
 public:
     Node(const NodeID& id, const std::string& ip, uint16_t port);
+    // IPv4 already in network byte order (compact wire format, bucket
+    // columns) — no dotted-string round trip
+    Node(const NodeID& id, uint32_t ip_be, uint16_t port);
     Node(const std::vector<uint8_t>& id_bytes, const std::string& ip, uint16_t port);
 
     // Getters
     const NodeID& id() const { return id_; }
-    const std::string& ip() const { return ip_; }
+    // Dotted form, built on demand (logging, sendto paths that want text)
+    std::string ip() const;
+    uint32_t ipNetworkOrder() const { return ip_be_; }
     uint16_t port() const { return port_; }
-    NodeStatus status() const { return status_; }
+    NodeStatus status() const {
+        return static_cast<NodeStatus>(status_and_seen_ & NODE_STATUS_MASK);
+    }
 
     // Status management
     void markGood();
@@ -41,28 +110,46 @@ public:
 
     // Activity tracking
     void updateLastSeen();
-    std::chrono::steady_clock::time_point lastSeen() const { return last_seen_; }
-    bool isGood() const;
-    bool isQuestionable() const;
-    bool isBad() const;
+    std::chrono::steady_clock::time_point lastSeen() const {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(status_and_seen_ & ~NODE_STATUS_MASK)));
+    }
+    bool isGood() const { return packedGood(status_and_seen_, steadyNowNs()); }
+    bool isQuestionable() const {
+        return packedQuestionable(status_and_seen_, steadyNowNs());
+    }
+    bool isBad() const {
+        return status() == NodeStatus::BAD || consecutive_failures_ >= 3;
+    }
 
     // Comparison for sorting
     bool operator==(const Node& other) const;
     bool operator!=(const Node& other) const;
 
-    // Convert to compact format (26 bytes: 20 bytes ID + 4 bytes IP + 2 bytes port)
-    std::vector<uint8_t> toCompact() const;
+    // Convert to compact format (26 bytes: 20 bytes ID + 4 bytes IP + 2
+    // bytes port); fixed-size, so it lives on the caller's stack
+    std::array<uint8_t, 26> toCompact() const;
+    // Same, written into a caller-provided 26-byte slot — lets
+    // encodeCompactNodes fill one preallocated buffer per reply
+    void writeCompact(uint8_t* out) const;
     static Node fromCompact(const std::vector<uint8_t>& compact);
+    // Same, reading 26 bytes straight from a wire buffer — no per-node
+    // vector for callers iterating a concatenated nodes string
+    static Node fromCompact(const uint8_t* compact);
 
     // String representation for debugging
     std::string toString() const;
 
 private:
+    // Buckets store node fields column-wise and materialize Nodes on the
+    // way out, preserving status/last-seen/failure state
+    friend class Bucket;
+
     NodeID id_;
-    std::string ip_;
+    uint32_t ip_be_;  // IPv4, network byte order; 0 for unparseable input
     uint16_t port_;
-    NodeStatus status_;
-    std::chrono::steady_clock::time_point last_seen_;
+    uint64_t status_and_seen_;  // see packStatusSeen
     int consecutive_failures_;
 };
 
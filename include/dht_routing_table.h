@@ -2,7 +2,7 @@
 
 #include "dht_node.h"
 #include <vector>
-#include <list>
+#include <array>
 #include <mutex>
 #include <optional>
 
@@ -14,7 +14,15 @@ constexpr size_t BUCKET_SIZE = 8;         // K value (max nodes per bucket)
 constexpr size_t NUM_BUCKETS = 160;       // 160 bits in Node ID
 constexpr int BUCKET_REFRESH_INTERVAL = 15 * 60; // 15 minutes in seconds
 
-// Single K-bucket
+// Single K-bucket. Node fields live in parallel fixed-capacity columns
+// (struct-of-arrays): distance scans touch only the contiguous id
+// column, status checks only the packed liveness column, and the IP
+// is a 4-byte network-order word instead of a heap string (DHT here is
+// IPv4-only, as is the compact node wire format). Slots 0..size_-1 are
+// dense but unordered; recency lives in the order_ permutation
+// (order_[0] = least recently seen), so an LRU refresh rotates a few
+// bytes of indices instead of every column. Nodes are materialized on
+// the way out with their status/last-seen/failure state intact.
 class Bucket {
 public:
     Bucket() = default;
@@ -33,19 +41,41 @@ public:
     std::optional<Node> findNode(const NodeID& id) const;
 
     // Check if bucket is full
-    bool isFull() const { return nodes_.size() >= BUCKET_SIZE; }
+    bool isFull() const { return size_ >= BUCKET_SIZE; }
 
     // Get all nodes in bucket
     std::vector<Node> getNodes() const;
 
-    // Get good nodes in bucket
-    std::vector<Node> getGoodNodes() const;
+    // Column access for in-place scans (findClosestNodes), avoiding the
+    // per-call Node materialization of getNodes/getGoodNodes. The
+    // now_ns overloads take a hoisted steadyNowNs() so a scan reads the
+    // clock once, not once per slot; the liveness column is the packed
+    // status+last-seen word, so each check is branchless (see dht_node.h).
+    const NodeID& idAt(size_t i) const { return ids_[i]; }
+    bool goodAt(size_t i) const { return goodAt(i, steadyNowNs()); }
+    bool goodAt(size_t i, uint64_t now_ns) const {
+        return packedGood(status_and_seen_[i], now_ns);
+    }
+    bool questionableAt(size_t i) const {
+        return questionableAt(i, steadyNowNs());
+    }
+    bool questionableAt(size_t i, uint64_t now_ns) const {
+        return packedQuestionable(status_and_seen_[i], now_ns);
+    }
+    bool badAt(size_t i) const {
+        return static_cast<NodeStatus>(status_and_seen_[i] & NODE_STATUS_MASK) ==
+                   NodeStatus::BAD ||
+               failures_[i] >= 3;
+    }
+
+    // Build a full Node from slot i (status/last-seen/failures preserved)
+    Node materialize(size_t i) const;
 
     // Get the least recently seen node (for replacement)
     std::optional<Node> getLeastRecentlySeen() const;
 
     // Get bucket size
-    size_t size() const { return nodes_.size(); }
+    size_t size() const { return size_; }
 
     // Check if bucket needs refresh
     bool needsRefresh() const;
@@ -54,8 +84,21 @@ public:
     void markAsRefreshed();
 
 private:
-    // List maintains least-recently-seen order (front = oldest)
-    std::list<Node> nodes_;
+    int indexOf(const NodeID& id) const;
+    void storeSlot(size_t i, const Node& node);
+    void moveToBack(size_t slot);
+
+    std::array<NodeID, BUCKET_SIZE> ids_{};
+    // First 8 bytes of each id, mirrored from ids_: membership lookup
+    // compares this dense column (two AVX2 compares for the whole
+    // bucket) and touches the full 20 bytes only on a prefix hit
+    alignas(32) std::array<uint64_t, BUCKET_SIZE> id_prefix_{};
+    std::array<uint32_t, BUCKET_SIZE> ips_{};    // IPv4, network byte order
+    std::array<uint16_t, BUCKET_SIZE> ports_{};
+    std::array<uint64_t, BUCKET_SIZE> status_and_seen_{};  // packStatusSeen
+    std::array<uint8_t, BUCKET_SIZE> failures_{};
+    std::array<uint8_t, BUCKET_SIZE> order_{};   // slot indices, LRU first
+    uint8_t size_ = 0;
     std::chrono::steady_clock::time_point last_changed_;
 };
 
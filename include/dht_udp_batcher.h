@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+namespace torrent {
+namespace dht {
+
+// Batches small UDP datagrams through sendmmsg/recvmmsg so a KRPC fan-out
+// (bootstrap pings, lookup rounds to dozens of nodes) costs one syscall per
+// batch instead of one per packet. Outgoing datagrams go through a
+// lock-free multi-producer ring drained by the network loop in sendmmsg
+// batches; the receive side drains everything the kernel has buffered in
+// one recvmmsg. On platforms without the mmsg calls this degrades to
+// per-datagram sendto/recvfrom with identical semantics.
+class UdpBatcher {
+public:
+    // Datagrams per syscall
+    static constexpr size_t kBatchSize = 64;
+    // Per-slot buffer; KRPC messages are a few hundred bytes, larger
+    // datagrams bypass the slab and are sent immediately
+    static constexpr size_t kSlotSize = 2048;
+    // Send ring capacity (power of two). Sized above kBatchSize so
+    // producers keep queueing while the network thread drains a batch.
+    static constexpr size_t kQueueSize = 256;
+
+    explicit UdpBatcher(int socket_fd);
+
+    // Queue one datagram for the next flush(). Lock-free and callable
+    // from any thread: a slot is claimed with one CAS and published with
+    // one release store, no mutex on the send path. Sends immediately
+    // (sendto) when the ring is full or the payload exceeds a slot.
+    bool queueSend(const uint8_t* data, size_t length,
+                   const struct sockaddr_in& addr);
+
+    // Drain published slots in sendmmsg batches; returns datagrams sent.
+    // Single-consumer: only the network loop (and stop(), after that
+    // thread has joined) may call this.
+    size_t flush();
+
+    // View into the receive slab — no per-packet copy or allocation.
+    // Valid until the next receiveBatch call, which reuses the slots;
+    // the network loop finishes dispatching a batch before draining the
+    // next one, so that window is always respected.
+    struct Datagram {
+        const uint8_t* data;
+        size_t length;
+        struct sockaddr_in from;
+    };
+
+    // Wait up to timeout_ms for traffic, then drain up to kBatchSize
+    // datagrams in one recvmmsg. Returns the number received.
+    size_t receiveBatch(std::vector<Datagram>& out, int timeout_ms);
+
+private:
+    int socket_fd_;
+
+    // Bounded MPSC ring (per-slot sequence numbers, Vyukov scheme): a
+    // producer claims slot head_ with a CAS, fills it, then publishes by
+    // storing seq = pos + 1; the consumer drains slots whose sequence
+    // matches, then recycles them with seq = pos + kQueueSize. Producers
+    // never block and never touch a mutex.
+    std::vector<uint8_t> send_slab_;          // kQueueSize * kSlotSize
+    std::vector<size_t> send_lengths_;
+    std::vector<struct sockaddr_in> send_addrs_;
+    std::unique_ptr<std::atomic<uint32_t>[]> send_seq_;
+    std::atomic<uint32_t> send_head_{0};      // next slot producers claim
+    uint32_t send_tail_ = 0;                  // next slot to drain (consumer only)
+
+    std::vector<uint8_t> recv_slab_;          // kBatchSize * kSlotSize
+
+#if defined(__linux__)
+    // recvmmsg scatter arrays, wired to the slab once in the constructor
+    // and reused every tick (the kernel only rewrites msg_len/msg_namelen)
+    std::vector<struct mmsghdr> recv_msgs_;
+    std::vector<struct iovec> recv_iovs_;
+    std::vector<struct sockaddr_in> recv_addrs_;
+#endif
+};
+
+} // namespace dht
+} // namespace torrent
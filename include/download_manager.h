@@ -21,16 +21,14 @@ namespace torrent {
 
 // Peer performance tracking
 struct PeerInfo {
-    std::unique_ptr<PeerConnection> connection;
-    Peer peer_data;
-
-    // Performance metrics
+    // Hot fields first: the periodic scans (staleness sweep, piece
+    // assignment, speed ranking) read only this leading block, so
+    // walking the peer vector touches one cache line per peer instead
+    // of striding over the connection and address state below
+    std::chrono::steady_clock::time_point last_activity;
+    std::chrono::steady_clock::time_point connect_time;
     int64_t bytes_downloaded = 0;
     int64_t bytes_uploaded = 0;
-    std::chrono::steady_clock::time_point connect_time;
-    std::chrono::steady_clock::time_point last_activity;
-
-    // Current state
     uint32_t current_piece = UINT32_MAX;  // UINT32_MAX means not downloading
     bool is_choking = true;
     bool is_interested = false;
@@ -39,10 +37,14 @@ struct PeerInfo {
     int pieces_completed = 0;
     int failed_requests = 0;
 
+    // Cold: only touched on connect/disconnect and actual I/O dispatch
+    std::unique_ptr<PeerConnection> connection;
+    Peer peer_data;
+
     PeerInfo(std::unique_ptr<PeerConnection> conn, const Peer& peer)
-        : connection(std::move(conn)), peer_data(peer),
-          connect_time(std::chrono::steady_clock::now()),
-          last_activity(std::chrono::steady_clock::now()) {}
+        : last_activity(std::chrono::steady_clock::now()),
+          connect_time(last_activity),
+          connection(std::move(conn)), peer_data(peer) {}
 
     double downloadSpeed() const {
         auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
@@ -52,10 +54,13 @@ struct PeerInfo {
     }
 
     bool isStale(int timeout_seconds = 60) const {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::steady_clock::now() - last_activity
-        ).count();
-        return elapsed >= timeout_seconds;
+        return isStale(std::chrono::steady_clock::now(), timeout_seconds);
+    }
+
+    // Variant for sweeps over many peers: the caller reads the clock once
+    bool isStale(std::chrono::steady_clock::time_point now,
+                 int timeout_seconds) const {
+        return now - last_activity >= std::chrono::seconds(timeout_seconds);
     }
 };
 
@@ -122,6 +127,12 @@ private:
     void updateWebSeeds();  // Download from web seeds
     void broadcastHave(uint32_t piece_index);
 
+    // Endgame: a block arrived, retract its duplicate requests from
+    // every other peer with one shared pre-serialized CANCEL frame
+    void broadcastCancel(uint32_t piece_index, uint32_t offset,
+                         uint32_t length, PeerConnection* source);
+    void flushPendingHaves(const std::vector<uint32_t>& pieces);
+
     // Resume capability
     std::string getResumeFilePath() const;
     void loadResumeState();
@@ -152,10 +163,19 @@ private:
     std::vector<PeerInfo> active_peers_;
     std::mutex peers_mutex_;
 
-    // Piece tracking
-    std::set<uint32_t> pieces_in_download_;  // Pieces currently being downloaded
+    // Piece tracking: packed bitmap of pieces currently being downloaded,
+    // word-layout-compatible with the piece bitfield so selection fuses
+    // it into the candidate mask instead of probing a tree per piece
+    Bitfield pieces_in_download_;
     std::mutex pieces_mutex_;
 
+    // HAVE coalescing: pieces completing within the same ~1ms window are
+    // announced with one concatenated send per peer instead of one send
+    // per piece
+    std::vector<uint32_t> pending_haves_;
+    std::mutex pending_haves_mutex_;
+    bool have_flush_in_progress_ = false;
+
     std::atomic<bool> running_;
     std::atomic<bool> paused_;
     std::atomic<bool> endgame_mode_;
@@ -176,6 +196,14 @@ private:
     std::atomic<int64_t> total_downloaded_;
     std::atomic<int64_t> total_uploaded_;
 
+    // Mirrors of the peer vector kept for the 1Hz status line: reading
+    // two relaxed atomics beats locking peers_mutex_ and dragging every
+    // PeerInfo's cache lines through just to count current_piece fields.
+    // Updated under peers_mutex_ at connect/disconnect and at every
+    // piece-assignment transition
+    std::atomic<size_t> active_peer_count_{0};
+    std::atomic<size_t> downloading_peer_count_{0};
+
     // Tracker state
     bool first_announce_ = true;
     int tracker_failures_ = 0;
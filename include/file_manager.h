@@ -3,8 +3,7 @@
 #include "torrent_file.h"
 #include <string>
 #include <vector>
-#include <fstream>
-#include <mutex>
+#include <cstdint>
 
 namespace torrent {
 
@@ -18,18 +17,47 @@ public:
 
     // Write piece data to file(s)
     bool writePiece(uint32_t piece_index, const std::vector<uint8_t>& data);
+    bool writePiece(uint32_t piece_index, const uint8_t* data, size_t length);
+
+    // Write a sub-range of a piece (offset is relative to the piece start).
+    // Used by the verify-while-write path to commit the piece in tiles.
+    bool writePieceRange(uint32_t piece_index, size_t offset,
+                         const uint8_t* data, size_t length);
 
     // Read piece data from file(s)
     std::vector<uint8_t> readPiece(uint32_t piece_index);
 
-    // Verification
+    // Read one block (offset/length relative to the piece start) into a
+    // caller-provided buffer, touching only the requested range — the
+    // upload fallback for blocks that span a file boundary, which would
+    // otherwise read the whole piece to serve 16 KiB. Unwritten sparse
+    // regions read as zeros, matching readPiece. Returns false on an
+    // out-of-range request or read failure.
+    bool readBlock(uint32_t piece_index, size_t offset, size_t length,
+                   uint8_t* dst);
+
+    // Locate one block (offset/length relative to the piece start) on
+    // disk. Succeeds only when the block lies entirely inside a single
+    // file, filling fd and the absolute offset within it — the upload
+    // path hands that range to sendfile(2) so the block goes page cache
+    // to socket without a userspace read. Blocks spanning a file
+    // boundary return false and go through readPiece().
+    bool locateBlock(uint32_t piece_index, size_t offset, size_t length,
+                     int& fd, int64_t& file_off) const;
+
+    // Verification. verifyExistingFiles hashes every piece straight out
+    // of the mappings with worker threads splitting the piece range;
+    // returns true only if all pieces match the torrent's hashes.
     bool verifyExistingFiles();
     bool verifyPiece(uint32_t piece_index, const std::vector<uint8_t>& expected_hash);
 
 private:
     struct FileHandle {
         std::string path;
-        std::fstream stream;
+        int fd = -1;     // O_RDWR descriptor; also the pwritev/pread fallback
+        // MAP_SHARED view of the whole file, or nullptr when mmap failed
+        // and the fd fallback is in use
+        uint8_t* mapping = nullptr;
         int64_t offset;  // Offset in the combined file space
         int64_t length;
     };
@@ -37,11 +65,15 @@ private:
     void openFiles();
     void closeFiles();
 
+    // SHA-1 of one piece, streamed across the file spans it touches
+    // (zero-copy from mapped files). Returns false on read failure.
+    bool hashPiece(uint32_t piece_index, uint8_t digest[20]) const;
+
     const TorrentFile& torrent_;
     std::string download_dir_;
+    // Immutable after initialize(); pieces touch disjoint byte ranges, so
+    // reads and writes need no lock
     std::vector<FileHandle> file_handles_;
-
-    mutable std::mutex mutex_;
 };
 
 } // namespace torrent
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace torrent {
+
+// Open-addressing hash map for the packed block keys (piece<<32|offset)
+// that track per-peer in-flight requests and uploads.
+//
+// std::unordered_map spends the per-block hot path on a node allocation
+// and a bucket pointer chase. Block sets are small (tens of entries) and
+// keyed by plain integers, so a flat slot array with linear probing gets
+// a hit down to one hash mix and usually one cache-line touch, and
+// insert/erase never call malloc after the table has grown once.
+//
+// Deletion uses tombstones; the table rehashes in place when live plus
+// dead slots pass 3/4 of capacity, which also sweeps the tombstones out.
+template <typename V>
+class FlatBlockMap {
+public:
+    FlatBlockMap() = default;
+
+    FlatBlockMap(const FlatBlockMap&) = delete;
+    FlatBlockMap& operator=(const FlatBlockMap&) = delete;
+
+    FlatBlockMap(FlatBlockMap&& other) noexcept
+        : slots_(std::move(other.slots_)), states_(std::move(other.states_)),
+          size_(other.size_), used_(other.used_) {
+        other.size_ = 0;
+        other.used_ = 0;
+    }
+
+    FlatBlockMap& operator=(FlatBlockMap&& other) noexcept {
+        if (this != &other) {
+            destroyAll();
+            slots_ = std::move(other.slots_);
+            states_ = std::move(other.states_);
+            size_ = other.size_;
+            used_ = other.used_;
+            other.size_ = 0;
+            other.used_ = 0;
+        }
+        return *this;
+    }
+
+    ~FlatBlockMap() { destroyAll(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    V* find(uint64_t key) {
+        if (states_.empty()) {
+            return nullptr;
+        }
+        size_t mask = states_.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (states_[i] == kEmpty) {
+                return nullptr;
+            }
+            if (states_[i] == kFull && slots_[i].key == key) {
+                return slots_[i].get();
+            }
+        }
+    }
+
+    const V* find(uint64_t key) const {
+        return const_cast<FlatBlockMap*>(this)->find(key);
+    }
+
+    bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+    // Insert a value constructed from `args` under `key`; returns false
+    // (and constructs nothing) if the key is already present.
+    template <typename... Args>
+    bool emplace(uint64_t key, Args&&... args) {
+        if (used_ + 1 > (states_.size() * 3) / 4) {
+            grow();
+        }
+        size_t mask = states_.size() - 1;
+        size_t slot = states_.size();
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (states_[i] == kFull) {
+                if (slots_[i].key == key) {
+                    return false;
+                }
+                continue;
+            }
+            if (slot == states_.size()) {
+                slot = i;  // First reusable slot on the probe path
+            }
+            if (states_[i] == kEmpty) {
+                break;
+            }
+        }
+        if (states_[slot] == kEmpty) {
+            ++used_;
+        }
+        slots_[slot].key = key;
+        new (slots_[slot].get()) V(std::forward<Args>(args)...);
+        states_[slot] = kFull;
+        ++size_;
+        return true;
+    }
+
+    bool erase(uint64_t key) {
+        if (states_.empty()) {
+            return false;
+        }
+        size_t mask = states_.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (states_[i] == kEmpty) {
+                return false;
+            }
+            if (states_[i] == kFull && slots_[i].key == key) {
+                slots_[i].get()->~V();
+                states_[i] = kDead;
+                --size_;
+                return true;
+            }
+        }
+    }
+
+    // Erase every entry for which pred(value) returns true
+    template <typename Pred>
+    void eraseIf(Pred&& pred) {
+        for (size_t i = 0; i < states_.size(); ++i) {
+            if (states_[i] == kFull && pred(*slots_[i].get())) {
+                slots_[i].get()->~V();
+                states_[i] = kDead;
+                --size_;
+            }
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < states_.size(); ++i) {
+            if (states_[i] == kFull) {
+                fn(*slots_[i].get());
+            }
+        }
+    }
+
+    void clear() {
+        destroyAll();
+        for (auto& s : states_) {
+            s = kEmpty;
+        }
+        size_ = 0;
+        used_ = 0;
+    }
+
+private:
+    enum : uint8_t { kEmpty = 0, kFull = 1, kDead = 2 };
+
+    struct Slot {
+        uint64_t key;
+        alignas(V) unsigned char buf[sizeof(V)];
+
+        V* get() { return reinterpret_cast<V*>(buf); }
+        const V* get() const { return reinterpret_cast<const V*>(buf); }
+    };
+
+    // Block offsets are 16 KiB-aligned, so the raw key's low bits carry
+    // almost no entropy; mix the whole word (splitmix64 finalizer) before
+    // masking down to a table index.
+    static size_t mix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return static_cast<size_t>(k);
+    }
+
+    void destroyAll() {
+        for (size_t i = 0; i < states_.size(); ++i) {
+            if (states_[i] == kFull) {
+                slots_[i].get()->~V();
+            }
+        }
+    }
+
+    void grow() {
+        size_t new_cap = states_.empty() ? 16 : states_.size() * 2;
+        // Rehash without doubling if tombstones alone pushed us over
+        if (size_ * 4 < states_.size()) {
+            new_cap = states_.size();
+        }
+        std::vector<Slot> old_slots = std::move(slots_);
+        std::vector<uint8_t> old_states = std::move(states_);
+        slots_.assign(new_cap, Slot{});
+        states_.assign(new_cap, kEmpty);
+        size_ = 0;
+        used_ = 0;
+        for (size_t i = 0; i < old_states.size(); ++i) {
+            if (old_states[i] == kFull) {
+                emplace(old_slots[i].key, std::move(*old_slots[i].get()));
+                old_slots[i].get()->~V();
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> states_;
+    size_t size_ = 0;   // Live entries
+    size_t used_ = 0;   // Live + tombstoned slots
+};
+
+} // namespace torrent
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace torrent {
+
+// Move-only callable wrapper with fixed inline storage: a drop-in for
+// std::function on paths where the capture must never heap-allocate.
+// Captures larger than Capacity fail at compile time instead of silently
+// spilling to the heap the way std::function does.
+template <typename Signature, size_t Capacity>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+    InplaceFunction() = default;
+    InplaceFunction(std::nullptr_t) {}
+
+    template <typename F,
+              typename = std::enable_if_t<
+                  !std::is_same<std::decay_t<F>, InplaceFunction>::value &&
+                  !std::is_same<std::decay_t<F>, std::nullptr_t>::value>>
+    InplaceFunction(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity,
+                      "callback capture exceeds inline storage");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                      "callback capture over-aligned for inline storage");
+        new (storage_) Fn(std::forward<F>(f));
+        ops_ = opsFor<Fn>();
+    }
+
+    InplaceFunction(InplaceFunction&& other) noexcept {
+        if (other.ops_) {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_) {
+                other.ops_->relocate(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator()(Args... args) const {
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    // One static table per callable type; relocate is move-construct into
+    // dst followed by destroying src
+    struct Ops {
+        void (*relocate)(unsigned char* dst, unsigned char* src);
+        void (*destroy)(unsigned char* obj);
+        R (*invoke)(unsigned char* obj, Args&&... args);
+    };
+
+    template <typename Fn>
+    static const Ops* opsFor() {
+        static const Ops ops = {
+            [](unsigned char* dst, unsigned char* src) {
+                Fn* from = reinterpret_cast<Fn*>(src);
+                new (dst) Fn(std::move(*from));
+                from->~Fn();
+            },
+            [](unsigned char* obj) { reinterpret_cast<Fn*>(obj)->~Fn(); },
+            [](unsigned char* obj, Args&&... args) -> R {
+                return (*reinterpret_cast<Fn*>(obj))(std::forward<Args>(args)...);
+            },
+        };
+        return &ops;
+    }
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) mutable unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace torrent
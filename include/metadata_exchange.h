@@ -2,9 +2,11 @@
 
 #include "extension_protocol.h"
 #include "bencode.h"
+#include "bitfield.h"
 #include <vector>
 #include <set>
 #include <mutex>
+#include <atomic>
 #include <functional>
 #include <cstdint>
 
@@ -56,22 +58,24 @@ public:
     // Mark piece as requested
     void markPieceRequested(size_t piece_index);
 
-    // Set full metadata (for sharing)
-    void setMetadata(const std::vector<uint8_t>& metadata);
+    // Set full metadata (for sharing); takes the buffer by value so the
+    // caller's copy can be moved straight in
+    void setMetadata(std::vector<uint8_t> metadata);
 
-    // Get current metadata (may be incomplete)
-    std::vector<uint8_t> getMetadata() const;
+    // Get current metadata (may be incomplete). A reference into the
+    // single buffer; callers that need ownership copy at the boundary.
+    const std::vector<uint8_t>& getMetadata() const;
 
 private:
     // Handle request message
-    void handleRequest(const bencode::BencodeDict& dict);
+    void handleRequest(size_t piece_index);
 
-    // Handle data message
-    void handleData(const bencode::BencodeDict& dict,
-                   const std::vector<uint8_t>& piece_data);
+    // Handle data message; piece_data points into the wire payload
+    void handleData(size_t piece_index,
+                    const uint8_t* piece_data, size_t data_len);
 
     // Handle reject message
-    void handleReject(const bencode::BencodeDict& dict);
+    void handleReject(size_t piece_index);
 
     // Check if all pieces are received and assemble metadata
     void checkCompletion();
@@ -79,15 +83,23 @@ private:
     int64_t metadata_size_;
     size_t num_pieces_;
 
-    std::vector<std::vector<uint8_t>> pieces_;
-    std::vector<bool> have_pieces_;
+    // Pieces land directly at index*METADATA_PIECE_SIZE in one buffer
+    // sized from metadata_size_ up front: no per-piece 16K heap block and
+    // no assembly pass at the end. The same buffer serves both roles —
+    // assembly target while downloading, source of truth once complete —
+    // so the bytes are never held twice.
+    std::vector<uint8_t> buffer_;
+    Bitfield have_pieces_;
     std::set<size_t> requested_pieces_;
 
-    std::vector<uint8_t> full_metadata_; // For sharing
-
     MetadataCompleteCallback on_complete_;
+
+    // The mutex guards the piece buffer and bookkeeping writes; the two
+    // counters below are published atomically so the per-peer scheduling
+    // loops polling isComplete()/progress() never take the lock at all
     mutable std::mutex mutex_;
-    bool complete_;
+    std::atomic<size_t> received_count_{0};
+    std::atomic<bool> complete_{false};
 };
 
 } // namespace torrent
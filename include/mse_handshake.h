@@ -24,10 +24,14 @@ public:
         REQUIRE_ENCRYPTED      // Only RC4, reject plaintext peers
     };
 
-    // Encryption method flags (can be ORed together in crypto_provide)
+    // Encryption method flags (can be ORed together in crypto_provide).
+    // AES_CTR is a local extension bit beyond BEP 8: only advertised when
+    // AES-NI is present, and only selected when both sides provide it, so
+    // stock clients negotiate RC4/plaintext exactly as before.
     enum CryptoMethod : uint32_t {
         PLAINTEXT = 0x01,
-        RC4 = 0x02
+        RC4 = 0x02,
+        AES_CTR = 0x04
     };
 
     // Handshake result
@@ -99,11 +103,13 @@ private:
     // Compute HASH("req3", S)
     std::vector<uint8_t> computeReq3() const;
 
-    // Search for synchronization pattern in stream
-    // Returns position if found, -1 otherwise
-    int findSyncPattern(const std::vector<uint8_t>& data,
-                        const std::vector<uint8_t>& pattern,
-                        size_t max_search = 65536);
+    // Search [start, len) of a stream buffer for a synchronization
+    // pattern. The first 8 pattern bytes act as a single uint64 filter,
+    // so each candidate position costs one unaligned load and compare
+    // instead of a memcmp call. Returns position if found, -1 otherwise.
+    static int findSyncPattern(const uint8_t* data, size_t len,
+                               const std::vector<uint8_t>& pattern,
+                               size_t start = 0);
 
     // Determine crypto_provide flags based on mode
     uint32_t getCryptoProvide() const;
@@ -134,15 +140,24 @@ private:
     // Encryption keys
     crypto::MSEKeys keys_;
 
-    // RC4 ciphers (initialized after key derivation)
+    // RC4 ciphers (initialized after key derivation). The handshake packets
+    // themselves are always RC4-encrypted per BEP 8; the AES ciphers below
+    // only take over for the payload stream when AES_CTR is negotiated.
     std::unique_ptr<crypto::RC4> outgoing_cipher_;
     std::unique_ptr<crypto::RC4> incoming_cipher_;
 
+    // AES-CTR ciphers (only created when AES-NI is available)
+    std::unique_ptr<crypto::AesCtrStream> aes_outgoing_cipher_;
+    std::unique_ptr<crypto::AesCtrStream> aes_incoming_cipher_;
+
     // Selected encryption method
     CryptoMethod selected_method_ = PLAINTEXT;
 
     // Verification constant (8 zero bytes)
     static const std::vector<uint8_t> VC;
+
+    // PeerConnection hands the negotiated ciphers off to its EncryptedStream
+    friend class PeerConnection;
 };
 
 // ============================================================================
@@ -154,10 +169,13 @@ public:
     EncryptedStream();
     ~EncryptedStream();
 
-    // Initialize with encryption method and ciphers
+    // Initialize with encryption method and ciphers. The AES pair may be
+    // null unless method is AES_CTR.
     void init(MSEHandshake::CryptoMethod method,
              std::unique_ptr<crypto::RC4> outgoing_cipher,
-             std::unique_ptr<crypto::RC4> incoming_cipher);
+             std::unique_ptr<crypto::RC4> incoming_cipher,
+             std::unique_ptr<crypto::AesCtrStream> aes_outgoing_cipher = nullptr,
+             std::unique_ptr<crypto::AesCtrStream> aes_incoming_cipher = nullptr);
 
     // Encrypt data before sending
     void encrypt(uint8_t* data, size_t length);
@@ -168,7 +186,7 @@ public:
     void decrypt(std::vector<uint8_t>& data);
 
     // Check if encryption is active
-    bool isEncrypted() const { return method_ == MSEHandshake::CryptoMethod::RC4; }
+    bool isEncrypted() const { return method_ != MSEHandshake::CryptoMethod::PLAINTEXT; }
 
     // Get current method
     MSEHandshake::CryptoMethod getMethod() const { return method_; }
@@ -177,6 +195,8 @@ private:
     MSEHandshake::CryptoMethod method_;
     std::unique_ptr<crypto::RC4> outgoing_cipher_;
     std::unique_ptr<crypto::RC4> incoming_cipher_;
+    std::unique_ptr<crypto::AesCtrStream> aes_outgoing_cipher_;
+    std::unique_ptr<crypto::AesCtrStream> aes_incoming_cipher_;
 };
 
 } // namespace torrent
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bitfield.h"
+
+namespace torrent {
+
+// Dense peer x piece bitmap in column-major (struct-of-arrays) layout:
+// data_[word_index * stride_ + peer_index]. Every peer's word for the same
+// 64-piece column sits contiguously, so a rarity scan streams one cache
+// line per 8 peers instead of chasing a vector<vector<bool>> heap pointer
+// per peer per piece. Rebuilt per selection pass from the packed peer
+// bitfields; capacity is fixed at construction.
+class PeerBitfieldMatrix {
+public:
+    PeerBitfieldMatrix(size_t num_pieces, size_t max_peers)
+        : words_per_peer_((num_pieces + 63) / 64),
+          stride_((max_peers + 3) & ~size_t(3)),  // pad for vector loads
+          num_peers_(0),
+          data_(words_per_peer_ * stride_, 0) {}
+
+    void addPeer(const Bitfield& bits) {
+        if (num_peers_ >= stride_) {
+            return;
+        }
+        const auto& words = bits.words();
+        size_t n = words.size() < words_per_peer_ ? words.size() : words_per_peer_;
+        for (size_t w = 0; w < n; ++w) {
+            data_[w * stride_ + num_peers_] = words[w];
+        }
+        ++num_peers_;
+    }
+
+    size_t numPeers() const { return num_peers_; }
+    size_t wordsPerPeer() const { return words_per_peer_; }
+
+    // Contiguous run of numPeers() words covering 64-piece column
+    // `word_index`
+    const uint64_t* column(size_t word_index) const {
+        return data_.data() + word_index * stride_;
+    }
+
+private:
+    size_t words_per_peer_;
+    size_t stride_;
+    size_t num_peers_;
+    std::vector<uint64_t> data_;
+};
+
+} // namespace torrent
@@ -4,16 +4,20 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <functional>
-#include <queue>
 #include <chrono>
-#include <map>
+#include "bitfield.h"
+#include "flat_block_map.h"
+#include "small_buf.h"
+#include "spsc_ring.h"
 #include "utp_socket.h"
 
 namespace torrent {
 
 // Forward declarations
 struct Block;
+class PieceManager;
 class ExtensionProtocol;
 class MSEHandshake;
 class EncryptedStream;
@@ -50,12 +54,24 @@ enum class MessageType : uint8_t {
 
 struct PeerMessage {
     MessageType type;
-    std::vector<uint8_t> payload;
+    // Inline up to 16 bytes: control messages (HAVE, REQUEST, CANCEL,
+    // the choke/interest family) never touch the heap
+    SmallBuf payload;
+    // For PIECE messages whose data bytes did not travel in payload:
+    // this is the number of data bytes taken off the wire — either
+    // written straight into the in-progress piece buffer (zero-copy
+    // receive) or drained into the connection's scratch buffer
+    // (duplicate/unwanted block). payload stays empty; the parsed
+    // index/offset header rides in the fields below, so a sustained
+    // download allocates no per-block payload vector at all.
+    uint32_t zero_copy_length = 0;
+    uint32_t piece_index = 0;
+    uint32_t block_offset = 0;
 };
 
 // Parsed message structures for specific message types
 struct BitfieldMessage {
-    std::vector<bool> bitfield;
+    Bitfield bitfield;
 };
 
 struct HaveMessage {
@@ -65,6 +81,7 @@ struct HaveMessage {
 struct PieceMessage {
     uint32_t piece_index;
     uint32_t offset;
+    uint32_t length = 0;  // Block length; data is empty on zero-copy receive
     std::vector<uint8_t> data;
 };
 
@@ -140,7 +157,10 @@ public:
 
     // Handshake
     bool performHandshake();
-    bool performHandshake(const std::vector<bool>& our_bitfield);
+    bool performHandshake(const Bitfield& our_bitfield);
+    // Handshake followed by a pre-framed BITFIELD message (see
+    // PieceManager::bitfieldMessage); an empty frame means no pieces yet
+    bool performHandshake(const std::vector<uint8_t>& bitfield_frame);
 
     // Message sending
     bool sendKeepAlive();
@@ -149,9 +169,20 @@ public:
     bool sendInterested();
     bool sendNotInterested();
     bool sendHave(uint32_t piece_index);
-    bool sendBitfield(const std::vector<bool>& bitfield);
+    bool sendBitfield(const Bitfield& bitfield);
     bool sendRequest(uint32_t piece_index, uint32_t offset, uint32_t length);
+    // Format all REQUESTs into one contiguous buffer and emit them with a
+    // single send, so a piece's worth of requests costs one syscall and
+    // leaves the pipe full instead of one block per round trip
+    bool sendRequests(const BlockList& blocks);
     bool sendPiece(uint32_t piece_index, uint32_t offset, const std::vector<uint8_t>& data);
+    // Zero-copy upload: writes the 13-byte PIECE header, then streams the
+    // block straight from fd's page cache to the socket with sendfile(2)
+    // — the data never enters userspace. TCP/Linux only; other transports
+    // pread into a buffer and take the in-memory overload. file_off is
+    // absolute within fd (see FileManager::locateBlock).
+    bool sendPiece(uint32_t piece_index, uint32_t offset,
+                   int fd, int64_t file_off, size_t length);
     bool sendCancel(uint32_t piece_index, uint32_t offset, uint32_t length);
 
     // Fast Extension messages (BEP 6)
@@ -165,14 +196,36 @@ public:
     bool sendExtendedMessage(uint8_t ext_id, const std::vector<uint8_t>& payload);
     bool sendExtendedHandshake();
 
+    // Send an already-framed message (<length><id><payload>). Lets broadcast
+    // paths compose a frame once and reuse it for every connection instead
+    // of re-serializing per peer.
+    bool sendSerializedMessage(const uint8_t* frame, size_t length);
+
+    // Cork/uncork the TCP stream around a burst of small frames (the
+    // post-handshake HAVE_ALL/allowed-fast/extended-handshake sequence)
+    // so they leave in one segment instead of one apiece. No-op on uTP
+    // and on platforms without TCP_CORK.
+    void corkOutput(bool enable);
+
+    // Zero-copy receive: when attached, PIECE payloads are read straight
+    // into the in-progress piece buffer instead of a PeerMessage allocation
+    void attachPieceManager(PieceManager* piece_manager) { piece_manager_ = piece_manager; }
+
     // Message receiving
-    std::unique_ptr<PeerMessage> receiveMessage();
+    std::optional<PeerMessage> receiveMessage();
+
+    // Park until receiveMessage has something to work with: returns true
+    // when parsed messages are queued, bytes remain from the last bulk
+    // recv, or the socket turns readable within timeout_ms; false on a
+    // quiet timeout so the caller can service keep-alive/idle deadlines
+    // and come back
+    bool waitForMessage(int timeout_ms);
 
     // Check if there are messages in the queue
     bool hasMessages() const { return !message_queue_.empty(); }
 
     // Get the next message from the queue
-    std::unique_ptr<PeerMessage> popMessage();
+    std::optional<PeerMessage> popMessage();
 
     // Parse specific message types
     bool parseBitfield(const PeerMessage& message, BitfieldMessage& result);
@@ -192,7 +245,8 @@ public:
     bool peerChoking() const { return peer_choking_; }
     bool peerInterested() const { return peer_interested_; }
 
-    const std::vector<bool>& peerBitfield() const { return peer_bitfield_; }
+    const Bitfield& peerBitfieldPacked() const { return peer_bitfield_; }
+    const std::vector<uint64_t>& peerBitfieldWords() const { return peer_bitfield_.words(); }
     const std::string& remotePeerId() const { return remote_peer_id_; }
 
     // Bitfield management
@@ -203,7 +257,7 @@ public:
     bool isPeerSeeder() const;
 
     // Piece request management
-    bool requestPiece(uint32_t piece_index, const std::vector<Block>& blocks);
+    bool requestPiece(uint32_t piece_index, const BlockList& blocks);
     bool requestBlock(uint32_t piece_index, uint32_t offset, uint32_t length);
     bool hasPendingRequests() const { return !pending_requests_.empty(); }
     size_t numPendingRequests() const { return pending_requests_.size(); }
@@ -252,7 +306,11 @@ private:
     // Friend class for MSE handshake access to low-level methods
     friend class MSEHandshake;
     bool sendMessage(const PeerMessage& message);
-    std::vector<uint8_t> serializeMessage(const PeerMessage& message);
+    // Gather-write a frame header plus payload (one writev on TCP);
+    // lets senders keep the header on the stack and ship payloads from
+    // where they already live instead of assembling a heap frame
+    bool sendFrameVec(const uint8_t* header, size_t header_len,
+                      const uint8_t* payload, size_t payload_len);
 
     // Low-level socket operations
     bool sendData(const void* data, size_t length);
@@ -281,16 +339,27 @@ private:
     bool peer_choking_;
     bool peer_interested_;
 
-    std::vector<bool> peer_bitfield_;
+    Bitfield peer_bitfield_;  // Packed 64-bit-word bitmap
 
-    // Message queue for processing messages in order
-    std::queue<std::unique_ptr<PeerMessage>> message_queue_;
+    // Message queue for processing messages in order. Lock-free SPSC ring:
+    // the receive thread produces, the download-manager thread consumes.
+    // Inline message slots: enqueue/dequeue move the message in place,
+    // no per-message heap object alongside the ring
+    SpscRing<PeerMessage, 256> message_queue_;
 
-    // Pending request tracking (key: "piece_index:offset")
-    std::map<std::string, PendingRequest> pending_requests_;
+    // Userspace receive buffer. receiveData() drains the socket in large
+    // recv() calls and serves the 4-byte length prefixes and message
+    // headers from here, so a burst of 16KB PIECE frames costs one or two
+    // syscalls instead of one per read.
+    std::vector<uint8_t> recv_buffer_;
+    size_t recv_buffer_pos_ = 0;
 
-    // Pending upload tracking (key: "piece_index:offset")
-    std::map<std::string, PendingUpload> pending_uploads_;
+    // In-flight block tracking, keyed by piece<<32|offset: a lookup on
+    // the per-block hot path is one integer hash probe into a flat
+    // open-addressed table — no string formatting, no per-node malloc,
+    // no bucket pointer chase
+    FlatBlockMap<PendingRequest> pending_requests_;
+    FlatBlockMap<PendingUpload> pending_uploads_;
 
     // Extension protocol support (optional, for magnet links)
     std::unique_ptr<ExtensionProtocol> extension_protocol_;
@@ -301,6 +370,14 @@ private:
     // PEX support (optional, for peer discovery)
     std::unique_ptr<PexManager> pex_manager_;
 
+    // Destination for zero-copy PIECE receives (not owned, optional)
+    PieceManager* piece_manager_ = nullptr;
+
+    // Reusable sink for block data the piece manager declines (duplicate
+    // or unwanted): sized to the largest block seen once, then reused, so
+    // a burst of duplicate 16KB blocks costs no per-message allocation
+    std::vector<uint8_t> drain_buffer_;
+
     // Fast Extension support (BEP 6)
     bool supports_fast_extension_;        // We support Fast Extension
     bool peer_supports_fast_extension_;   // Peer supports Fast Extension
@@ -1,10 +1,9 @@
 #pragma once
 
 #include "bencode.h"
+#include "flat_block_map.h"
 #include <string>
 #include <vector>
-#include <set>
-#include <map>
 #include <cstdint>
 #include <chrono>
 
@@ -71,11 +70,12 @@ public:
     int parsePexMessage(const bencode::BencodeValue& data,
                         std::vector<PexPeer>& new_peers_out);
 
-    // Get list of all known peers
-    const std::set<PexPeer>& getKnownPeers() const { return known_peers_; }
+    // Materialize the known-peer list (stringifies IPs on demand; the
+    // internal store is packed)
+    std::vector<PexPeer> getKnownPeers() const;
 
     // Get number of known peers
-    size_t getKnownPeerCount() const { return known_peers_.size(); }
+    size_t getKnownPeerCount() const { return ips_.size(); }
 
     // Clear all state (useful for testing or reset)
     void clear();
@@ -94,27 +94,43 @@ public:
     static constexpr int PEX_INTERVAL_SECONDS = 60;
 
 private:
-    // Currently known peers
-    std::set<PexPeer> known_peers_;
+    // A peer is keyed by its packed endpoint: network-order IPv4 word
+    // shifted over the port. The gossip cycle calls addPeer once per
+    // (connection, known peer) pair, so membership tests run against a
+    // flat integer table and the per-peer std::string/tree-node churn of
+    // the old std::set<PexPeer> store is gone entirely. IPv6 peers are
+    // not stored (ut_pex added6 is not implemented).
+    static uint64_t endpointKey(uint32_t ip_be, uint16_t port) {
+        return (static_cast<uint64_t>(ip_be) << 16) | port;
+    }
 
-    // Peers added since last PEX message
-    std::set<PexPeer> added_peers_;
+    // Change-log entry for the next PEX message
+    struct PendingChange {
+        uint32_t ip_be;
+        uint16_t port;
+        uint8_t flags;
+    };
 
-    // Peers dropped since last PEX message
-    std::set<PexPeer> dropped_peers_;
+    bool addPeerPacked(uint32_t ip_be, uint16_t port, uint8_t flags);
+    bool removePeerPacked(uint32_t ip_be, uint16_t port);
 
-    // Last time we sent a PEX message
-    std::chrono::steady_clock::time_point last_pex_sent_;
+    // Pack up to `limit` change entries as <4-byte IP><2-byte port>
+    static std::string changesToCompact(const std::vector<PendingChange>& changes,
+                                        size_t limit);
 
-    // Convert peer set to compact binary format
-    std::vector<uint8_t> peersToCompact(const std::set<PexPeer>& peers) const;
+    // Known peers, struct-of-arrays; index_ maps endpointKey -> slot.
+    // Removal swap-pops, patching the moved peer's index.
+    std::vector<uint32_t> ips_;     // Network byte order
+    std::vector<uint16_t> ports_;   // Host byte order
+    std::vector<uint8_t> flags_;
+    FlatBlockMap<uint32_t> index_;
 
-    // Convert peer set to flags binary format
-    std::vector<uint8_t> peersToFlags(const std::set<PexPeer>& peers) const;
+    // Peers added/dropped since the last PEX message
+    std::vector<PendingChange> added_peers_;
+    std::vector<PendingChange> dropped_peers_;
 
-    // Parse compact peer format to peer list
-    std::vector<PexPeer> compactToPeers(const std::vector<uint8_t>& compact,
-                                        const std::vector<uint8_t>& flags) const;
+    // Last time we sent a PEX message
+    std::chrono::steady_clock::time_point last_pex_sent_;
 };
 
 } // namespace torrent
@@ -4,9 +4,12 @@
 #include <cstdint>
 #include <mutex>
 #include <bitset>
-#include <map>
 #include <memory>
 #include <set>
+#include "bitfield.h"
+#include "bloom_bitfield.h"
+#include "peer_bitfield_matrix.h"
+#include "sha1_hw.h"
 
 namespace torrent {
 
@@ -16,32 +19,42 @@ class FileManager;
 // Block size (typically 16KB)
 constexpr size_t BLOCK_SIZE = 16384;
 
-struct Block {
-    uint32_t piece_index;
-    uint32_t offset;
-    uint32_t length;
-    std::vector<uint8_t> data;
-    bool downloaded;
+// Blocks of one piece in struct-of-arrays form: offsets and lengths are
+// dense uint32 arrays, so request batching walks two contiguous streams
+// instead of an array of padded structs with unused payload vectors.
+struct BlockList {
+    uint32_t piece_index = 0;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
 
-    Block(uint32_t pi, uint32_t off, uint32_t len)
-        : piece_index(pi), offset(off), length(len), downloaded(false) {}
+    size_t size() const { return offsets.size(); }
+    bool empty() const { return offsets.empty(); }
 };
 
 // In-progress piece assembly
 struct PieceInProgress {
     uint32_t piece_index;
     size_t piece_size;
-    std::vector<uint8_t> data;  // Full piece data buffer
-    std::vector<bool> blocks_received;  // Track which blocks received
+    std::unique_ptr<uint8_t[]> data;  // Single preallocated piece buffer (not zero-filled)
+    Bitfield blocks_received;  // Packed per-block received bitmap
     size_t blocks_downloaded;
     size_t total_blocks;
 
+    // Streaming SHA-1 over the assembled prefix: blocks are folded into
+    // the digest while their bytes are still hot from the socket read,
+    // so completion only finalizes instead of re-reading the whole
+    // (by then cache-cold) piece buffer. hashed_bytes is the low
+    // watermark of contiguously hashed data; out-of-order blocks wait in
+    // the buffer until the watermark reaches them.
+    utils::Sha1Stream hash;
+    size_t hashed_bytes = 0;
+
     PieceInProgress(uint32_t index, size_t size, size_t num_blocks)
-        : piece_index(index), piece_size(size), data(size, 0),
-          blocks_received(num_blocks, false), blocks_downloaded(0),
+        : piece_index(index), piece_size(size), data(new uint8_t[size]),
+          blocks_received(num_blocks), blocks_downloaded(0),
           total_blocks(num_blocks) {}
 
-    bool isComplete() const { return blocks_downloaded == total_blocks; }
+    bool isComplete() const { return blocks_received.all(); }
     float progress() const { return total_blocks > 0 ?
         static_cast<float>(blocks_downloaded) / total_blocks : 0.0f; }
 };
@@ -59,22 +72,62 @@ public:
 
     // Piece selection strategies
     int32_t getNextPiece(const std::vector<bool>& peer_has_pieces);
+    int32_t getNextPiece(const Bitfield& peer_has_pieces);
     int32_t getNextPieceRarestFirst(const std::vector<std::vector<bool>>& all_peer_bitfields,
                                     const std::vector<bool>& peer_has_pieces,
                                     const std::set<uint32_t>& in_download);
+    int32_t getNextPieceRarestFirst(const std::vector<std::vector<bool>>& all_peer_bitfields,
+                                    const Bitfield& peer_has_pieces,
+                                    const std::set<uint32_t>& in_download);
+    int32_t getNextPieceRarestFirst(const PeerBitfieldMatrix& all_peers,
+                                    const Bitfield& peer_has_pieces,
+                                    const std::set<uint32_t>& in_download);
     int32_t getNextPieceRandomFirst(const std::vector<bool>& peer_has_pieces,
                                     const std::set<uint32_t>& in_download);
+    int32_t getNextPieceRandomFirst(const Bitfield& peer_has_pieces,
+                                    const std::set<uint32_t>& in_download);
     int32_t getNextPieceSequential(const std::vector<bool>& peer_has_pieces,
                                    const std::set<uint32_t>& in_download);
+    int32_t getNextPieceSequential(const Bitfield& peer_has_pieces,
+                                   const std::set<uint32_t>& in_download);
+
+    // Preferred in-download representation: a packed Bitfield in the same
+    // word layout as the piece bitfield, so the selection cores fuse it
+    // into the candidate mask (~ours & peer & ~in_download) word-wise
+    // instead of a tree lookup per candidate. The std::set overloads
+    // above pack into this form and delegate.
+    int32_t getNextPieceRarestFirst(const std::vector<std::vector<bool>>& all_peer_bitfields,
+                                    const Bitfield& peer_has_pieces,
+                                    const Bitfield& in_download);
+    int32_t getNextPieceRarestFirst(const PeerBitfieldMatrix& all_peers,
+                                    const Bitfield& peer_has_pieces,
+                                    const Bitfield& in_download);
+    // Rarest-first from the incrementally maintained availability counts
+    // (see addPeerAvailability): rarity is a table lookup per candidate,
+    // so selection is one linear word scan with no per-call rescan of
+    // every peer's bitfield.
+    int32_t getNextPieceRarestFirst(const Bitfield& peer_has_pieces,
+                                    const Bitfield& in_download);
+    int32_t getNextPieceRandomFirst(const Bitfield& peer_has_pieces,
+                                    const Bitfield& in_download);
+    int32_t getNextPieceSequential(const Bitfield& peer_has_pieces,
+                                   const Bitfield& in_download);
 
     // Configuration
     void setSequentialMode(bool sequential) { sequential_mode_ = sequential; }
     bool isSequentialMode() const { return sequential_mode_; }
 
     // Block management
-    std::vector<Block> getBlocksForPiece(uint32_t piece_index);
+    BlockList getBlocksForPiece(uint32_t piece_index);
     bool addBlock(uint32_t piece_index, uint32_t offset, const std::vector<uint8_t>& data);
 
+    // Zero-copy receive support: the network layer asks for the in-progress
+    // buffer location of a block, reads the payload straight into it, then
+    // commits. blockReceiveBuffer returns nullptr if the block is not
+    // wanted (bad index, piece already complete, duplicate block).
+    uint8_t* blockReceiveBuffer(uint32_t piece_index, uint32_t offset, uint32_t length);
+    bool commitReceivedBlock(uint32_t piece_index, uint32_t offset, uint32_t length);
+
     // Piece assembly
     bool isPieceInProgress(uint32_t piece_index) const;
     PieceInProgress* getPieceInProgress(uint32_t piece_index);
@@ -82,17 +135,45 @@ public:
 
     // Verification
     bool verifyPiece(uint32_t piece_index, const std::vector<uint8_t>& data) const;
+    bool verifyPiece(uint32_t piece_index, const uint8_t* data, size_t length) const;
+
+    // Availability bookkeeping: counts are maintained incrementally as
+    // peer bitfields and HAVE messages arrive, and released on disconnect,
+    // so rarest-first selection never rescans every peer.
+    void addPeerAvailability(const Bitfield& peer_has_pieces);
+    void removePeerAvailability(const Bitfield& peer_has_pieces);
+    void incrementPieceAvailability(uint32_t piece_index);
 
     // Progress
     size_t numPiecesDownloaded() const { return pieces_downloaded_; }
     double percentComplete() const;
-    std::vector<bool> getBitfield() const { return bitfield_; }
+    std::vector<bool> getBitfield() const;
+    Bitfield getBitfieldPacked() const;
+    const std::vector<uint64_t>& getBitfieldWords() const { return bitfield_.words(); }
+
+    // Ready-to-send BITFIELD frame (<length><id=5><MSB-first payload>).
+    // Cached and patched one bit at a time as pieces complete, so each
+    // connect copies raw bytes instead of re-packing the whole bitfield.
+    // Empty until the first piece is downloaded.
+    std::vector<uint8_t> bitfieldMessage() const;
+
+    // Just the MSB-first packed payload (BEP 3 wire order), without the
+    // message framing. Same cache as bitfieldMessage, so no per-call
+    // packing loop. getBitfield() remains as a vector<bool> adapter for
+    // cold callers (resume verification, web-seed gap scan).
+    std::vector<uint8_t> getBitfieldWire() const;
     size_t numPiecesInProgress() const;
 
+    // 16-byte Bloom summary of our pieces for tracker/PEX/DHT gossip,
+    // where the exact multi-KB bitfield is overkill. Approximate by
+    // design (false positives only); local peer bookkeeping stays exact.
+    BloomBitfield getBloomSummary() const;
+
     // Resume capability
     bool saveStateToDisk(const std::string& resume_file_path) const;
     bool loadStateFromDisk(const std::string& resume_file_path);
     void setBitfield(const std::vector<bool>& bitfield);
+    void setBitfield(const Bitfield& bitfield);
 
 private:
     size_t num_pieces_;
@@ -100,11 +181,19 @@ private:
     size_t total_length_;
     std::vector<uint8_t> piece_hashes_;  // SHA1 hashes
 
-    std::vector<bool> bitfield_;  // Which pieces we have
+    Bitfield bitfield_;  // Which pieces we have (packed 64-bit words)
     size_t pieces_downloaded_;
 
-    // Pieces in progress (being assembled)
-    std::map<uint32_t, std::unique_ptr<PieceInProgress>> pieces_in_progress_;
+    // Pre-framed BITFIELD message, kept in sync with bitfield_
+    std::vector<uint8_t> bitfield_msg_cache_;
+
+    // How many peers advertise each piece (SoA, updated as HAVE/bitfields arrive)
+    std::vector<uint16_t> piece_availability_;
+
+    // Pieces in progress (being assembled). Dense: indexed by piece, so
+    // the per-block lookup is one load instead of a tree/hash walk.
+    std::vector<std::unique_ptr<PieceInProgress>> pieces_in_progress_;
+    size_t num_in_progress_ = 0;
 
     // Piece selection configuration
     bool sequential_mode_ = false;
@@ -115,6 +204,14 @@ private:
 private:
     // Helper methods
     std::vector<int> calculatePieceRarity(const std::vector<std::vector<bool>>& all_peer_bitfields) const;
+    std::vector<int> calculatePieceRarity(const PeerBitfieldMatrix& all_peers) const;
+    double percentCompleteLocked() const;
+    PieceInProgress* getOrCreatePieceLocked(uint32_t piece_index);
+    void rebuildBitfieldMessageLocked();
+    void patchBitfieldMessageLocked(uint32_t piece_index);
+    void scanWantedWord(size_t word_index, uint64_t wanted,
+                        int32_t& best_piece, uint32_t& best_availability) const;
+    void advancePieceHashLocked(PieceInProgress* piece);
 };
 
 } // namespace torrent
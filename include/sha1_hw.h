@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace torrent {
+namespace utils {
+
+// Hardware-accelerated SHA-1 (Intel SHA-NI).
+//
+// Piece verification hashes every finished piece (typically 256KB+) before
+// it is committed to disk; the SHA-NI round instructions process a round
+// quartet per instruction and bring this from ~5 cycles/byte down to
+// ~1 cycle/byte. Detection is done once at runtime; when the extension is
+// not available callers fall back to the OpenSSL implementation.
+
+// True if the CPU supports the SHA extensions (cached after first call)
+bool sha1HardwareAvailable();
+
+// Compute the SHA-1 digest of `data` into `digest` (20 bytes).
+// Only valid to call when sha1HardwareAvailable() returns true.
+void sha1Hardware(const uint8_t* data, size_t length, uint8_t digest[20]);
+
+// Incremental SHA-1 with the same hardware dispatch. Lets piece
+// verification consume the buffer in cache-sized tiles interleaved with
+// the disk write instead of making two full passes over the piece.
+class Sha1Stream {
+public:
+    Sha1Stream();
+
+    void update(const uint8_t* data, size_t length);
+    void finish(uint8_t digest[20]);
+
+private:
+    uint32_t state_[5];
+    uint8_t buffer_[64];   // Partial trailing block between update calls
+    size_t buffered_;
+    uint64_t total_;       // Total bytes consumed, for the length padding
+};
+
+} // namespace utils
+} // namespace torrent
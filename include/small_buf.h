@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+namespace torrent {
+
+// Byte buffer with a 16-byte inline store, spilling to the heap only
+// beyond that.
+//
+// Replaces std::vector<uint8_t> where the common case is tiny: peer wire
+// messages are mostly control traffic (HAVE is 4 bytes, REQUEST/CANCEL
+// are 12, the choke/interest family is empty), and a vector heap-allocates
+// for every one of them. Small payloads live entirely inside the object;
+// large ones (BITFIELD, EXTENDED) take one allocation exactly as a vector
+// would. The surface is the slice of the vector API the message paths
+// use — data/size/iteration/resize — not a general-purpose container.
+class SmallBuf {
+public:
+    static constexpr size_t INLINE_CAPACITY = 16;
+
+    SmallBuf() = default;
+
+    SmallBuf(const uint8_t* data, size_t size) { assign(data, size); }
+
+    SmallBuf(std::initializer_list<uint8_t> init) {
+        assign(init.begin(), init.size());
+    }
+
+    // Implicit on purpose: lets existing call sites hand over a vector
+    // they built (small ones land inline with no allocation)
+    SmallBuf(const std::vector<uint8_t>& v) { assign(v.data(), v.size()); }
+
+    SmallBuf(const SmallBuf& other) { assign(other.data(), other.size_); }
+
+    SmallBuf(SmallBuf&& other) noexcept {
+        steal(other);
+    }
+
+    SmallBuf& operator=(const SmallBuf& other) {
+        if (this != &other) {
+            assign(other.data(), other.size_);
+        }
+        return *this;
+    }
+
+    SmallBuf& operator=(SmallBuf&& other) noexcept {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~SmallBuf() { release(); }
+
+    void assign(const uint8_t* data, size_t size) {
+        reserve(size);
+        if (size > 0) {
+            std::memcpy(this->data(), data, size);
+        }
+        size_ = size;
+    }
+
+    // Grown bytes are zeroed, matching vector::resize
+    void resize(size_t size) {
+        reserve(size);
+        if (size > size_) {
+            std::memset(data() + size_, 0, size - size_);
+        }
+        size_ = size;
+    }
+
+    void clear() { size_ = 0; }
+
+    uint8_t* data() { return heap_ ? heap_ : inline_; }
+    const uint8_t* data() const { return heap_ ? heap_ : inline_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    uint8_t& operator[](size_t i) { return data()[i]; }
+    const uint8_t& operator[](size_t i) const { return data()[i]; }
+
+    uint8_t* begin() { return data(); }
+    uint8_t* end() { return data() + size_; }
+    const uint8_t* begin() const { return data(); }
+    const uint8_t* end() const { return data() + size_; }
+
+private:
+    void reserve(size_t capacity) {
+        if (capacity <= cap_) {
+            return;
+        }
+        uint8_t* grown = new uint8_t[capacity];
+        if (size_ > 0) {
+            std::memcpy(grown, data(), size_);
+        }
+        release();
+        heap_ = grown;
+        cap_ = capacity;
+    }
+
+    void release() {
+        delete[] heap_;
+        heap_ = nullptr;
+        cap_ = INLINE_CAPACITY;
+    }
+
+    // Take other's storage (heap pointer or inline bytes); leaves other empty
+    void steal(SmallBuf& other) noexcept {
+        if (other.heap_) {
+            heap_ = other.heap_;
+            cap_ = other.cap_;
+            other.heap_ = nullptr;
+            other.cap_ = INLINE_CAPACITY;
+        } else if (other.size_ > 0) {
+            std::memcpy(inline_, other.inline_, other.size_);
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+
+    uint8_t* heap_ = nullptr;
+    size_t size_ = 0;
+    size_t cap_ = INLINE_CAPACITY;
+    uint8_t inline_[INLINE_CAPACITY];
+};
+
+} // namespace torrent
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace torrent {
+
+// Lock-free single-producer/single-consumer ring buffer.
+//
+// Replaces mutex-guarded queues on the peer message path: the receive
+// thread pushes, the download-manager thread pops, and neither ever
+// blocks or takes a lock. Capacity must be a power of two; head and tail
+// live on separate cache lines to avoid false sharing.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    // Producer side. Returns false if the ring is full.
+    bool push(T&& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t next = head + 1;
+        if (next - tail_.load(std::memory_order_acquire) > N) {
+            return false;  // Full
+        }
+        slots_[head & (N - 1)] = std::move(value);
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T& out) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return false;  // Empty
+        }
+        out = std::move(slots_[tail & (N - 1)]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+    // Approximate size (exact when called from producer or consumer thread)
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head_;  // Written by producer
+    alignas(64) std::atomic<size_t> tail_;  // Written by consumer
+    std::array<T, N> slots_;
+};
+
+} // namespace torrent
@@ -16,6 +16,11 @@ struct Peer {
         : ip(ip_), port(port_),
           is_ipv6(utils::detectIPVersion(ip_) == utils::IPVersion::IPv6) {}
 
+    // For callers that already know the address family (compact
+    // parsers): skips the per-peer detectIPVersion string scan
+    Peer(std::string ip_, uint16_t port_, bool is_ipv6_)
+        : ip(std::move(ip_)), port(port_), is_ipv6(is_ipv6_) {}
+
     // Static factory methods
     static Peer fromCompactIPv4(const uint8_t* data);
     static Peer fromCompactIPv6(const uint8_t* data);
@@ -80,6 +85,12 @@ private:
     std::vector<uint8_t> info_hash_;
     std::string peer_id_;
     bool is_udp_;
+
+    // Invariant prefix of every announce URL, through "...&port=".
+    // info_hash and peer_id never change for the lifetime of the
+    // client, so their percent-encoding is paid once here instead of
+    // on every announce
+    std::string announce_base_;
 };
 
 } // namespace torrent
@@ -1,10 +1,10 @@
 #pragma once
 
 #include "tracker_client.h"
+#include <array>
 #include <string>
 #include <vector>
 #include <cstdint>
-#include <random>
 
 namespace torrent {
 
@@ -37,7 +37,10 @@ struct UDPConnectRequest {
         , action(UDP_ACTION_CONNECT)
         , transaction_id(tid) {}
 
-    std::vector<uint8_t> serialize() const;
+    // Fixed-size wire format written into a caller-provided buffer
+    // (typically a stack array) — no allocation per packet
+    static constexpr size_t SIZE = 16;
+    void serialize(uint8_t out[SIZE]) const;
 };
 
 // Connect response (16 bytes)
@@ -46,7 +49,7 @@ struct UDPConnectResponse {
     int32_t transaction_id;
     int64_t connection_id;
 
-    static UDPConnectResponse deserialize(const std::vector<uint8_t>& data);
+    static UDPConnectResponse deserialize(const uint8_t* data, size_t length);
 };
 
 // Announce request (98 bytes)
@@ -54,8 +57,10 @@ struct UDPAnnounceRequest {
     int64_t connection_id;
     int32_t action;
     int32_t transaction_id;
-    std::vector<uint8_t> info_hash;  // 20 bytes
-    std::vector<uint8_t> peer_id;    // 20 bytes
+    // Fixed 20-byte fields held inline — a request is built on the
+    // stack per announce and should not touch the heap
+    std::array<uint8_t, 20> info_hash;
+    std::array<uint8_t, 20> peer_id;
     int64_t downloaded;
     int64_t left;
     int64_t uploaded;
@@ -75,7 +80,8 @@ struct UDPAnnounceRequest {
                        UDPEvent evt,
                        uint16_t prt);
 
-    std::vector<uint8_t> serialize() const;
+    static constexpr size_t SIZE = 98;
+    void serialize(uint8_t out[SIZE]) const;
 };
 
 // Announce response (20+ bytes)
@@ -87,7 +93,7 @@ struct UDPAnnounceResponse {
     int32_t seeders;
     std::vector<PeerInfo> peers;
 
-    static UDPAnnounceResponse deserialize(const std::vector<uint8_t>& data);
+    static UDPAnnounceResponse deserialize(const uint8_t* data, size_t length);
 };
 
 // Error response
@@ -96,7 +102,7 @@ struct UDPErrorResponse {
     int32_t transaction_id;
     std::string message;
 
-    static UDPErrorResponse deserialize(const std::vector<uint8_t>& data);
+    static UDPErrorResponse deserialize(const uint8_t* data, size_t length);
 };
 
 class UDPTrackerClient {
@@ -118,10 +124,16 @@ private:
     // Connect to tracker (get connection_id)
     bool connect();
 
-    // Send UDP request and wait for response
-    bool sendRequest(const std::vector<uint8_t>& request,
-                    std::vector<uint8_t>& response,
-                    int timeout_seconds = 15);
+    // Send UDP request and receive the reply into a caller-provided
+    // buffer; returns bytes received, or -1 on error/timeout
+    long sendRequest(const uint8_t* request, size_t request_length,
+                     uint8_t* response, size_t response_capacity,
+                     int timeout_seconds = 15);
+
+    // Lazily resolve the tracker and open a connected UDP socket,
+    // reused across the connect/announce exchanges of this client so
+    // each round trip is a bare send + recv
+    bool ensureSocket(int timeout_seconds);
 
     // Parse tracker URL to get host and port
     bool parseURL(const std::string& url, std::string& host, uint16_t& port);
@@ -134,11 +146,9 @@ private:
     std::string peer_id_;
 
     int socket_fd_;
+    int socket_timeout_seconds_;
     int64_t connection_id_;
     bool connected_;
-
-    std::random_device rd_;
-    std::mt19937 rng_;
 };
 
 } // namespace torrent
@@ -6,8 +6,8 @@
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <atomic>
 #include <mutex>
-#include <deque>
 
 namespace torrent {
 namespace utils {
@@ -15,23 +15,75 @@ namespace utils {
 // SHA1 hash
 std::vector<uint8_t> sha1(const std::string& data);
 std::vector<uint8_t> sha1(const std::vector<uint8_t>& data);
+std::vector<uint8_t> sha1(const uint8_t* data, size_t length);
+
+// No-allocation variant for callers with a digest buffer on the stack
+// (piece verification hashes thousands of times per download)
+void sha1Into(uint8_t out[20], const uint8_t* data, size_t length);
 
 // URL encoding
 std::string urlEncode(const std::string& str);
 std::string urlEncode(const std::vector<uint8_t>& data);
 
 // Hex conversion
+std::string toHex(const uint8_t* data, size_t length);
 std::string toHex(const std::vector<uint8_t>& data);
 std::vector<uint8_t> fromHex(const std::string& hex);
 
 // Random generation
 std::string generatePeerId();
 
-// Network byte order conversion
-uint32_t htonl(uint32_t hostlong);
-uint16_t htons(uint16_t hostshort);
-uint32_t ntohl(uint32_t netlong);
-uint16_t ntohs(uint16_t netshort);
+// Fast non-cryptographic random word (xoshiro256**, thread-local state
+// seeded once from random_device). For transaction ids, announce keys
+// and similar protocol nonces — not for anything security-sensitive.
+uint32_t fastRand32();
+
+// Network byte order conversion. Defined inline as compiler byte-swaps
+// (a no-op on big-endian targets) so serialize/parse paths fold them
+// into the surrounding loads and stores instead of calling into libc.
+constexpr uint32_t byteSwap32(uint32_t value) {
+#ifdef __GNUC__
+    return __builtin_bswap32(value);
+#else
+    // Compilers recognize the shift idiom and emit a single bswap
+    return (value >> 24) | ((value >> 8) & 0x0000FF00u) |
+           ((value << 8) & 0x00FF0000u) | (value << 24);
+#endif
+}
+
+constexpr uint16_t byteSwap16(uint16_t value) {
+#ifdef __GNUC__
+    return __builtin_bswap16(value);
+#else
+    return static_cast<uint16_t>((value >> 8) | (value << 8));
+#endif
+}
+
+// Endianness comes from the predefined macros (GCC and Clang both set
+// them), matching the builtin path byteSwap32/byteSwap16 already assume
+constexpr uint32_t htonl(uint32_t hostlong) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return hostlong;
+#else
+    return byteSwap32(hostlong);
+#endif
+}
+
+constexpr uint16_t htons(uint16_t hostshort) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return hostshort;
+#else
+    return byteSwap16(hostshort);
+#endif
+}
+
+constexpr uint32_t ntohl(uint32_t netlong) {
+    return htonl(netlong);
+}
+
+constexpr uint16_t ntohs(uint16_t netshort) {
+    return htons(netshort);
+}
 
 // Formatting
 std::string formatBytes(int64_t bytes);
@@ -54,6 +106,12 @@ std::vector<uint8_t> ipv6ToCompact(const std::string& ipv6);
 // Convert compact binary format to IPv6 string
 std::string compactToIPv6(const uint8_t* data);
 
+// Format 4 network-order octets as dotted decimal. Direct digit
+// emission into a stack buffer: the result fits in SSO, so parsing a
+// multi-thousand-peer compact list does no per-peer heap work and
+// skips the locale machinery of inet_ntop/ostringstream.
+std::string ipv4ToString(const uint8_t* octets);
+
 // Normalize IPv6 address (expand :: notation)
 std::string normalizeIPv6(const std::string& ipv6);
 
@@ -74,19 +132,27 @@ public:
     void waitAndConsume(size_t bytes);
 
     // Get current rate limit
-    int64_t getRate() const { return rate_; }
+    int64_t getRate() const { return rate_.load(std::memory_order_relaxed); }
 
     // Update rate limit (0 = unlimited)
     void setRate(int64_t rate_bytes_per_sec);
 
 private:
-    int64_t rate_;        // Bytes per second (0 = unlimited)
-    double tokens_;       // Available tokens
-    int64_t capacity_;    // Maximum tokens
-    std::chrono::steady_clock::time_point last_update_;
-    std::mutex mutex_;
-
-    void refill();
+    // Token state is atomic so the per-send fast path never takes a
+    // lock (every peer thread consults the shared limiter): refill
+    // claims the elapsed wall-clock interval with one CAS on
+    // last_refill_ns_, consumption is a CAS loop on the token count.
+    // Tokens are scaled by kTokenScale so refill amounts from
+    // back-to-back calls are not rounded away.
+    static constexpr int64_t kTokenScale = 1024;
+
+    std::atomic<int64_t> rate_;           // Bytes per second (0 = unlimited)
+    std::atomic<int64_t> tokens_scaled_;  // Available tokens * kTokenScale
+    std::atomic<int64_t> last_refill_ns_;
+    std::mutex mutex_;                    // Serializes setRate only
+
+    static int64_t nowNs();
+    void refill(int64_t rate);
 };
 
 // Speed tracking with sliding window
@@ -104,16 +170,20 @@ public:
     void reset();
 
 private:
-    struct Sample {
-        std::chrono::steady_clock::time_point timestamp;
-        int64_t bytes;
-    };
-
     int window_seconds_;
-    std::deque<Sample> samples_;
+
+    // Sliding window as parallel arrays (timestamps in steady_clock
+    // nanoseconds, byte counts). head_ marks the oldest live sample;
+    // expiry just advances it, and the dead prefix is compacted away
+    // once it dominates, so getSpeed sums one contiguous range instead
+    // of walking deque chunks.
+    std::vector<int64_t> ts_ns_;
+    std::vector<int64_t> bytes_;
+    size_t head_ = 0;
     mutable std::mutex mutex_;
 
-    void removeOldSamples();
+    static int64_t nowNs();
+    void removeOldSamples(int64_t now_ns);
 };
 
 } // namespace utils
@@ -1,58 +1,223 @@
 #include "bencode.h"
-#include <cctype>
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
 
 namespace torrent {
 
-// Parse from string
-BencodeValue BencodeParser::parse(const std::string& data) {
-    BencodeParser parser(data);
-    return parser.parseValue();
+// ============================================================================
+// BencodeDict
+// ============================================================================
+
+BencodeDict::iterator BencodeDict::lowerBound(std::string_view key) {
+    return std::lower_bound(
+        entries_.begin(), entries_.end(), key,
+        [](const value_type& entry, std::string_view k) {
+            return entry.first < k;
+        });
 }
 
-// Parse from binary data
-BencodeValue BencodeParser::parse(const std::vector<uint8_t>& data) {
-    std::string str(data.begin(), data.end());
-    return parse(str);
+BencodeDict::const_iterator BencodeDict::lowerBound(std::string_view key) const {
+    return std::lower_bound(
+        entries_.begin(), entries_.end(), key,
+        [](const value_type& entry, std::string_view k) {
+            return entry.first < k;
+        });
 }
 
-char BencodeParser::peek() const {
-    if (!hasMore()) {
-        throw BencodeError("Unexpected end of data");
+BencodeDict::iterator BencodeDict::find(std::string_view key) {
+    auto it = lowerBound(key);
+    return (it != entries_.end() && it->first == key) ? it : entries_.end();
+}
+
+BencodeDict::const_iterator BencodeDict::find(std::string_view key) const {
+    auto it = lowerBound(key);
+    return (it != entries_.end() && it->first == key) ? it : entries_.end();
+}
+
+const BencodeValue& BencodeDict::at(std::string_view key) const {
+    auto it = find(key);
+    if (it == entries_.end()) {
+        throw std::out_of_range("BencodeDict::at: key not found: " +
+                                std::string(key));
     }
-    return data_[pos_];
+    return it->second;
 }
 
-char BencodeParser::consume() {
-    char c = peek();
-    pos_++;
-    return c;
+BencodeValue& BencodeDict::at(std::string_view key) {
+    auto it = find(key);
+    if (it == entries_.end()) {
+        throw std::out_of_range("BencodeDict::at: key not found: " +
+                                std::string(key));
+    }
+    return it->second;
 }
 
-BencodeValue BencodeParser::parseValue() {
-    char c = peek();
+BencodeValue& BencodeDict::operator[](std::string_view key) {
+    auto it = lowerBound(key);
+    if (it == entries_.end() || it->first != key) {
+        // Keys normally arrive in bencode's required sorted order, so this
+        // insert lands at end() and degenerates to an append
+        it = entries_.insert(it, {std::string(key), BencodeValue()});
+    }
+    return it->second;
+}
 
-    if (c == 'i') {
-        return parseInteger();
-    } else if (c == 'l') {
-        return parseList();
-    } else if (c == 'd') {
-        return parseDictionary();
-    } else if (std::isdigit(c)) {
-        return parseString();
-    } else {
-        throw BencodeError(std::string("Unexpected character: ") + c);
+// ============================================================================
+// BencodeValue node management
+// ============================================================================
+//
+// List/dict payloads live behind a pointer in the tagged union; the node
+// object itself is carved from the same memory resource as the container's
+// contents, so a parsed tree stays entirely inside its arena and a
+// programmatic tree stays on the global heap.
+
+BencodeValue::List* BencodeValue::adoptList(List&& l) {
+    std::pmr::memory_resource* mr = l.get_allocator().resource();
+    void* mem = mr->allocate(sizeof(List), alignof(List));
+    return new (mem) List(std::move(l));
+}
+
+BencodeValue::List* BencodeValue::cloneList(const List& l) {
+    std::pmr::memory_resource* mr = l.get_allocator().resource();
+    void* mem = mr->allocate(sizeof(List), alignof(List));
+    return new (mem) List(l, mr);
+}
+
+BencodeValue::Dictionary* BencodeValue::adoptDict(Dictionary&& d) {
+    std::pmr::memory_resource* mr = d.resource();
+    void* mem = mr->allocate(sizeof(Dictionary), alignof(Dictionary));
+    return new (mem) Dictionary(std::move(d));
+}
+
+BencodeValue::Dictionary* BencodeValue::cloneDict(const Dictionary& d) {
+    std::pmr::memory_resource* mr = d.resource();
+    void* mem = mr->allocate(sizeof(Dictionary), alignof(Dictionary));
+    return new (mem) Dictionary(d, mr);
+}
+
+void BencodeValue::destroy() {
+    switch (tag_) {
+        case Tag::Integer:
+            break;
+        case Tag::String:
+            string_.~String();
+            break;
+        case Tag::List: {
+            std::pmr::memory_resource* mr = list_->get_allocator().resource();
+            list_->~List();
+            mr->deallocate(list_, sizeof(List), alignof(List));
+            break;
+        }
+        case Tag::Dictionary: {
+            std::pmr::memory_resource* mr = dict_->resource();
+            dict_->~Dictionary();
+            mr->deallocate(dict_, sizeof(Dictionary), alignof(Dictionary));
+            break;
+        }
     }
 }
 
-BencodeValue BencodeParser::parseInteger() {
-    consume(); // 'i'
+void BencodeValue::copyFrom(const BencodeValue& other) {
+    tag_ = other.tag_;
+    switch (tag_) {
+        case Tag::Integer:
+            integer_ = other.integer_;
+            break;
+        case Tag::String:
+            new (&string_) String(other.string_);
+            break;
+        case Tag::List:
+            list_ = cloneList(*other.list_);
+            break;
+        case Tag::Dictionary:
+            dict_ = cloneDict(*other.dict_);
+            break;
+    }
+}
 
-    std::string num_str;
-    while (peek() != 'e') {
-        num_str += consume();
+void BencodeValue::moveFrom(BencodeValue&& other) noexcept {
+    tag_ = other.tag_;
+    switch (tag_) {
+        case Tag::Integer:
+            integer_ = other.integer_;
+            break;
+        case Tag::String:
+            new (&string_) String(std::move(other.string_));
+            other.string_.~String();
+            break;
+        case Tag::List:
+            list_ = other.list_;
+            break;
+        case Tag::Dictionary:
+            dict_ = other.dict_;
+            break;
     }
-    consume(); // 'e'
+    // Leave the source holding a plain integer so its destructor is a no-op
+    other.tag_ = Tag::Integer;
+    other.integer_ = 0;
+}
+
+// Parse from string
+BencodeValue BencodeParser::parse(std::string_view data,
+                                  std::pmr::memory_resource* arena) {
+    BencodeParser parser(data, arena);
+    return parser.parseValue(0);
+}
+
+// Parse from binary data
+BencodeValue BencodeParser::parse(const std::vector<uint8_t>& data,
+                                  std::pmr::memory_resource* arena) {
+    return parse(std::string_view(
+        reinterpret_cast<const char*>(data.data()), data.size()), arena);
+}
+
+// The tokenizer is a raw cursor over [p_, end_): each production checks
+// bounds once, locates its terminator ('e', ':') with memchr/from_chars,
+// and bumps p_ past the whole token — no per-character peek/consume calls.
+// List/dict recursion is bounded by kMaxDepth, so adversarial nesting like
+// "lllll..." cannot blow the native stack.
+
+BencodeValue BencodeParser::parseValue(int depth) {
+    if (p_ == end_) {
+        throw BencodeError("Unexpected end of data");
+    }
+    if (depth > kMaxDepth) {
+        throw BencodeError("Bencode nesting too deep");
+    }
+
+    // One byte-indexed table lookup replaces the compare chain over
+    // 'i'/'l'/'d'/digits; a null slot doubles as the validity check
+    using ParseFn = BencodeValue (BencodeParser::*)(int);
+    static constexpr std::array<ParseFn, 256> kDispatch = [] {
+        std::array<ParseFn, 256> table{};
+        for (int c = '0'; c <= '9'; ++c) {
+            table[c] = &BencodeParser::parseString;
+        }
+        table['i'] = &BencodeParser::parseInteger;
+        table['l'] = &BencodeParser::parseList;
+        table['d'] = &BencodeParser::parseDictionary;
+        return table;
+    }();
+
+    ParseFn fn = kDispatch[static_cast<uint8_t>(*p_)];
+    if (fn == nullptr) {
+        throw BencodeError(std::string("Unexpected character: ") + *p_);
+    }
+    return (this->*fn)(depth);
+}
+
+BencodeValue BencodeParser::parseInteger(int) {
+    ++p_; // 'i'
+
+    const char* term = static_cast<const char*>(
+        std::memchr(p_, 'e', static_cast<size_t>(end_ - p_)));
+    if (term == nullptr) {
+        throw BencodeError("Unexpected end of data");
+    }
+    std::string_view num_str(p_, static_cast<size_t>(term - p_));
+    p_ = term + 1; // past 'e'
 
     if (num_str.empty()) {
         throw BencodeError("Empty integer");
@@ -62,101 +227,169 @@ BencodeValue BencodeParser::parseInteger() {
     if (num_str.size() > 1 && num_str[0] == '0') {
         throw BencodeError("Invalid integer format (leading zero)");
     }
-    if (num_str.size() > 2 && num_str[0] == '-' && num_str[1] == '0') {
+    if (num_str.size() >= 2 && num_str[0] == '-' && num_str[1] == '0') {
         throw BencodeError("Invalid integer format (-0)");
     }
 
-    try {
-        int64_t value = std::stoll(num_str);
-        return BencodeValue(value);
-    } catch (const std::exception&) {
-        throw BencodeError("Invalid integer: " + num_str);
+    // from_chars converts straight from the view, no temporary string
+    int64_t value = 0;
+    auto [ptr, ec] = std::from_chars(num_str.data(),
+                                     num_str.data() + num_str.size(), value);
+    if (ec != std::errc() || ptr != num_str.data() + num_str.size()) {
+        throw BencodeError("Invalid integer: " + std::string(num_str));
     }
+
+    return BencodeValue(value);
 }
 
-BencodeValue BencodeParser::parseString() {
-    std::string length_str;
-    while (peek() != ':') {
-        length_str += consume();
+BencodeValue BencodeParser::parseString(int) {
+    // from_chars doubles as the digit scanner: it stops at the first
+    // non-digit, which must be the ':' separator
+    size_t length = 0;
+    auto [ptr, ec] = std::from_chars(p_, end_, length);
+    if (ec != std::errc() || ptr == p_) {
+        throw BencodeError("Invalid string length: " +
+                           std::string(p_, static_cast<size_t>(ptr - p_)));
     }
-    consume(); // ':'
-
-    size_t length;
-    try {
-        length = std::stoull(length_str);
-    } catch (const std::exception&) {
-        throw BencodeError("Invalid string length: " + length_str);
+    if (ptr == end_ || *ptr != ':') {
+        throw BencodeError("Invalid string length: " +
+                           std::string(p_, static_cast<size_t>(ptr - p_)));
     }
+    p_ = ptr + 1; // past ':'
 
-    if (pos_ + length > data_.size()) {
+    if (length > static_cast<size_t>(end_ - p_)) {
         throw BencodeError("String length exceeds available data");
     }
 
-    std::string value = data_.substr(pos_, length);
-    pos_ += length;
+    // Zero-copy: the node is a view into the caller's buffer
+    std::string_view value(p_, length);
+    p_ += length;
 
-    return BencodeValue(std::move(value));
+    return BencodeValue(BencodeValue::String(value));
 }
 
-BencodeValue BencodeParser::parseList() {
-    consume(); // 'l'
+BencodeValue BencodeParser::parseList(int depth) {
+    ++p_; // 'l'
 
-    BencodeValue::List list;
-    while (peek() != 'e') {
-        list.push_back(parseValue());
+    BencodeValue::List list(arena_);
+    while (p_ != end_ && *p_ != 'e') {
+        list.push_back(parseValue(depth + 1));
     }
-    consume(); // 'e'
+    if (p_ == end_) {
+        throw BencodeError("Unexpected end of data");
+    }
+    ++p_; // 'e'
 
     return BencodeValue(std::move(list));
 }
 
-BencodeValue BencodeParser::parseDictionary() {
-    consume(); // 'd'
+BencodeValue BencodeParser::parseDictionary(int depth) {
+    ++p_; // 'd'
 
-    BencodeValue::Dictionary dict;
-    while (peek() != 'e') {
+    BencodeValue::Dictionary dict(arena_);
+    while (p_ != end_ && *p_ != 'e') {
         // Key must be a string
-        BencodeValue key_value = parseString();
+        BencodeValue key_value = parseString(depth);
         if (!key_value.isString()) {
             throw BencodeError("Dictionary key must be a string");
         }
-        std::string key = key_value.getString();
-
         // Value can be any type
-        BencodeValue value = parseValue();
+        BencodeValue value = parseValue(depth + 1);
 
-        dict[key] = std::move(value);
+        // Keys are short protocol identifiers; SSO keeps the stored copy
+        // off the heap, and spec-sorted input makes this an append
+        dict[key_value.getString()] = std::move(value);
+    }
+    if (p_ == end_) {
+        throw BencodeError("Unexpected end of data");
     }
-    consume(); // 'e'
+    ++p_; // 'e'
 
     return BencodeValue(std::move(dict));
 }
 
-// Encoding
-std::string BencodeParser::encode(const BencodeValue& value) {
-    std::ostringstream oss;
+// Encoding: a sizing pre-pass reserves the output exactly, then a single
+// append pass writes into it with to_chars for the numbers — no stream
+// locale machinery and no per-nested-value temporary strings.
+
+namespace {
 
+size_t decimalDigits(uint64_t v) {
+    size_t digits = 1;
+    while (v >= 10) {
+        v /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+void appendDecimal(std::string& out, int64_t value) {
+    char buf[24];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    (void)ec; // 24 bytes always fit an int64_t
+    out.append(buf, ptr);
+}
+
+} // namespace
+
+size_t BencodeParser::encodedSize(const BencodeValue& value) {
+    if (value.isInteger()) {
+        int64_t i = value.getInteger();
+        uint64_t magnitude = i < 0 ? ~static_cast<uint64_t>(i) + 1
+                                   : static_cast<uint64_t>(i);
+        return 2 + (i < 0 ? 1 : 0) + decimalDigits(magnitude); // i...e
+    } else if (value.isString()) {
+        size_t n = value.getString().size();
+        return decimalDigits(n) + 1 + n; // len:bytes
+    } else if (value.isList()) {
+        size_t total = 2; // l...e
+        for (const auto& item : value.getList()) {
+            total += encodedSize(item);
+        }
+        return total;
+    } else {
+        size_t total = 2; // d...e
+        for (const auto& [key, val] : value.getDictionary()) {
+            total += decimalDigits(key.size()) + 1 + key.size();
+            total += encodedSize(val);
+        }
+        return total;
+    }
+}
+
+void BencodeParser::encodeInto(const BencodeValue& value, std::string& out) {
     if (value.isInteger()) {
-        oss << "i" << value.getInteger() << "e";
+        out += 'i';
+        appendDecimal(out, value.getInteger());
+        out += 'e';
     } else if (value.isString()) {
-        const std::string& str = value.getString();
-        oss << str.length() << ":" << str;
+        std::string_view str = value.getString();
+        appendDecimal(out, static_cast<int64_t>(str.size()));
+        out += ':';
+        out.append(str);
     } else if (value.isList()) {
-        oss << "l";
+        out += 'l';
         for (const auto& item : value.getList()) {
-            oss << encode(item);
+            encodeInto(item, out);
         }
-        oss << "e";
-    } else if (value.isDictionary()) {
-        oss << "d";
+        out += 'e';
+    } else {
+        out += 'd';
         for (const auto& [key, val] : value.getDictionary()) {
-            oss << key.length() << ":" << key;
-            oss << encode(val);
+            appendDecimal(out, static_cast<int64_t>(key.size()));
+            out += ':';
+            out.append(key);
+            encodeInto(val, out);
         }
-        oss << "e";
+        out += 'e';
     }
+}
 
-    return oss.str();
+std::string BencodeParser::encode(const BencodeValue& value) {
+    std::string out;
+    out.reserve(encodedSize(value));
+    encodeInto(value, out);
+    return out;
 }
 
 } // namespace torrent
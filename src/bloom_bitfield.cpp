@@ -0,0 +1,45 @@
+#include "bloom_bitfield.h"
+
+// Hardware CRC32C is gated the same way as the AES and SHA kernels:
+// compiled in on x86-64 GCC/clang builds, selected at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TORRENT_BLOOM_CRC32 1
+#endif
+
+namespace torrent {
+
+namespace {
+
+// splitmix64 finalizer: full-avalanche multiplicative mix, used as the
+// portable hash and as the second word beside the hardware CRC
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+#if defined(TORRENT_BLOOM_CRC32)
+
+__attribute__((target("sse4.2")))
+uint64_t hashPieceCrc32(uint32_t piece_index) {
+    uint32_t crc = __builtin_ia32_crc32si(0xffffffffu, piece_index);
+    return (static_cast<uint64_t>(crc) << 32) |
+           static_cast<uint32_t>(mix64(piece_index));
+}
+
+#endif // TORRENT_BLOOM_CRC32
+
+} // namespace
+
+uint64_t BloomBitfield::hashPiece(uint32_t piece_index) {
+#if defined(TORRENT_BLOOM_CRC32)
+    static const bool has_crc32 = __builtin_cpu_supports("sse4.2");
+    if (has_crc32) {
+        return hashPieceCrc32(piece_index);
+    }
+#endif
+    return mix64(piece_index);
+}
+
+} // namespace torrent
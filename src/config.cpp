@@ -1,13 +1,69 @@
 #include "config.h"
 #include "logger.h"
 #include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <fstream>
-#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <string_view>
 
 using json = nlohmann::json;
 
 namespace torrent {
 
+namespace {
+
+// Assign a field only if the key is present, with a single find() —
+// contains() followed by operator[] walks the object's keys twice
+template <typename T>
+void loadField(const json& j, const std::string& key, T& out) {
+    auto it = j.find(key);
+    if (it != j.end()) {
+        it->get_to(out);
+    }
+}
+
+// Keys as std::string once per process: nlohmann's object is keyed on
+// std::string, so passing literals would rebuild each key (the longer
+// ones on the heap) on every load and save
+const std::string kListenPort = "listen_port";
+const std::string kMaxPeers = "max_peers";
+const std::string kMaxConnections = "max_connections";
+const std::string kMaxDownloadSpeed = "max_download_speed";
+const std::string kMaxUploadSpeed = "max_upload_speed";
+const std::string kDownloadDir = "download_dir";
+const std::string kSequentialDownload = "sequential_download";
+const std::string kPieceTimeoutSeconds = "piece_timeout_seconds";
+const std::string kSeedAfterDownload = "seed_after_download";
+const std::string kSeedRatioLimit = "seed_ratio_limit";
+const std::string kSeedTimeLimitHours = "seed_time_limit_hours";
+const std::string kTrackerAnnounceInterval = "tracker_announce_interval";
+const std::string kTrackerTimeoutSeconds = "tracker_timeout_seconds";
+const std::string kTrackerMaxRetries = "tracker_max_retries";
+const std::string kLogLevel = "log_level";
+const std::string kLogFile = "log_file";
+const std::string kLogMaxSize = "log_max_size";
+const std::string kLogMaxFiles = "log_max_files";
+const std::string kEnableResume = "enable_resume";
+const std::string kResumeDir = "resume_dir";
+const std::string kEnableDht = "enable_dht";
+const std::string kDhtPort = "dht_port";
+const std::string kEnablePex = "enable_pex";
+const std::string kEnableEncryption = "enable_encryption";
+const std::string kEncryptionMode = "encryption_mode";
+const std::string kAllowLegacyPeers = "allow_legacy_peers";
+const std::string kEnableIpv6 = "enable_ipv6";
+const std::string kIpVersion = "ip_version";
+const std::string kEnableLsd = "enable_lsd";
+const std::string kEnableWebseeds = "enable_webseeds";
+const std::string kEnableUtp = "enable_utp";
+const std::string kPreferUtp = "prefer_utp";
+
+} // namespace
+
 bool Config::loadFromFile(const std::string& filepath) {
     try {
         std::ifstream file(filepath);
@@ -22,84 +78,64 @@ bool Config::loadFromFile(const std::string& filepath) {
         LOG_INFO("Loading configuration from: {}", filepath);
 
         // Network settings
-        if (j.contains("listen_port")) listen_port = j["listen_port"].get<uint16_t>();
-        if (j.contains("max_peers")) max_peers = j["max_peers"].get<int>();
-        if (j.contains("max_connections")) max_connections = j["max_connections"].get<int>();
+        loadField(j, kListenPort, listen_port);
+        loadField(j, kMaxPeers, max_peers);
+        loadField(j, kMaxConnections, max_connections);
 
         // Speed limits
-        if (j.contains("max_download_speed")) {
-            max_download_speed = j["max_download_speed"].get<int64_t>();
-        }
-        if (j.contains("max_upload_speed")) {
-            max_upload_speed = j["max_upload_speed"].get<int64_t>();
-        }
+        loadField(j, kMaxDownloadSpeed, max_download_speed);
+        loadField(j, kMaxUploadSpeed, max_upload_speed);
 
         // Download settings
-        if (j.contains("download_dir")) download_dir = j["download_dir"].get<std::string>();
-        if (j.contains("sequential_download")) {
-            sequential_download = j["sequential_download"].get<bool>();
-        }
-        if (j.contains("piece_timeout_seconds")) {
-            piece_timeout_seconds = j["piece_timeout_seconds"].get<int>();
-        }
+        loadField(j, kDownloadDir, download_dir);
+        loadField(j, kSequentialDownload, sequential_download);
+        loadField(j, kPieceTimeoutSeconds, piece_timeout_seconds);
 
         // Upload/Seeding settings
-        if (j.contains("seed_after_download")) {
-            seed_after_download = j["seed_after_download"].get<bool>();
-        }
-        if (j.contains("seed_ratio_limit")) {
-            seed_ratio_limit = j["seed_ratio_limit"].get<double>();
-        }
-        if (j.contains("seed_time_limit_hours")) {
-            seed_time_limit_hours = j["seed_time_limit_hours"].get<int>();
-        }
+        loadField(j, kSeedAfterDownload, seed_after_download);
+        loadField(j, kSeedRatioLimit, seed_ratio_limit);
+        loadField(j, kSeedTimeLimitHours, seed_time_limit_hours);
 
         // Tracker settings
-        if (j.contains("tracker_announce_interval")) {
-            tracker_announce_interval = j["tracker_announce_interval"].get<int>();
-        }
-        if (j.contains("tracker_timeout_seconds")) {
-            tracker_timeout_seconds = j["tracker_timeout_seconds"].get<int>();
-        }
-        if (j.contains("tracker_max_retries")) {
-            tracker_max_retries = j["tracker_max_retries"].get<int>();
-        }
+        loadField(j, kTrackerAnnounceInterval, tracker_announce_interval);
+        loadField(j, kTrackerTimeoutSeconds, tracker_timeout_seconds);
+        loadField(j, kTrackerMaxRetries, tracker_max_retries);
 
         // Logging settings
-        if (j.contains("log_level")) log_level = j["log_level"].get<std::string>();
-        if (j.contains("log_file")) log_file = j["log_file"].get<std::string>();
-        if (j.contains("log_max_size")) log_max_size = j["log_max_size"].get<int64_t>();
-        if (j.contains("log_max_files")) log_max_files = j["log_max_files"].get<int>();
+        loadField(j, kLogLevel, log_level);
+        loadField(j, kLogFile, log_file);
+        loadField(j, kLogMaxSize, log_max_size);
+        loadField(j, kLogMaxFiles, log_max_files);
 
         // Resume capability
-        if (j.contains("enable_resume")) enable_resume = j["enable_resume"].get<bool>();
-        if (j.contains("resume_dir")) resume_dir = j["resume_dir"].get<std::string>();
+        loadField(j, kEnableResume, enable_resume);
+        loadField(j, kResumeDir, resume_dir);
 
         // DHT settings
-        if (j.contains("enable_dht")) enable_dht = j["enable_dht"].get<bool>();
-        if (j.contains("dht_port")) dht_port = j["dht_port"].get<uint16_t>();
+        loadField(j, kEnableDht, enable_dht);
+        loadField(j, kDhtPort, dht_port);
 
         // PEX settings
-        if (j.contains("enable_pex")) enable_pex = j["enable_pex"].get<bool>();
+        loadField(j, kEnablePex, enable_pex);
 
         // Encryption settings
-        if (j.contains("enable_encryption")) enable_encryption = j["enable_encryption"].get<bool>();
-        if (j.contains("encryption_mode")) encryption_mode = j["encryption_mode"].get<std::string>();
-        if (j.contains("allow_legacy_peers")) allow_legacy_peers = j["allow_legacy_peers"].get<bool>();
+        loadField(j, kEnableEncryption, enable_encryption);
+        loadField(j, kEncryptionMode, encryption_mode);
+        loadField(j, kAllowLegacyPeers, allow_legacy_peers);
 
         // IPv6 settings
-        if (j.contains("enable_ipv6")) enable_ipv6 = j["enable_ipv6"].get<bool>();
-        if (j.contains("ip_version")) ip_version = j["ip_version"].get<std::string>();
+        loadField(j, kEnableIpv6, enable_ipv6);
+        loadField(j, kIpVersion, ip_version);
 
         // LSD settings
-        if (j.contains("enable_lsd")) enable_lsd = j["enable_lsd"].get<bool>();
+        loadField(j, kEnableLsd, enable_lsd);
 
         // Web Seeding settings
-        if (j.contains("enable_webseeds")) enable_webseeds = j["enable_webseeds"].get<bool>();
+        loadField(j, kEnableWebseeds, enable_webseeds);
 
         // uTP settings
-        if (j.contains("enable_utp")) enable_utp = j["enable_utp"].get<bool>();
-        if (j.contains("prefer_utp")) prefer_utp = j["prefer_utp"].get<bool>();
+        loadField(j, kEnableUtp, enable_utp);
+        loadField(j, kPreferUtp, prefer_utp);
 
         LOG_INFO("Configuration loaded successfully");
         return true;
@@ -118,64 +154,64 @@ bool Config::saveToFile(const std::string& filepath) const {
         json j;
 
         // Network settings
-        j["listen_port"] = listen_port;
-        j["max_peers"] = max_peers;
-        j["max_connections"] = max_connections;
+        j[kListenPort] = listen_port;
+        j[kMaxPeers] = max_peers;
+        j[kMaxConnections] = max_connections;
 
         // Speed limits
-        j["max_download_speed"] = max_download_speed;
-        j["max_upload_speed"] = max_upload_speed;
+        j[kMaxDownloadSpeed] = max_download_speed;
+        j[kMaxUploadSpeed] = max_upload_speed;
 
         // Download settings
-        j["download_dir"] = download_dir;
-        j["sequential_download"] = sequential_download;
-        j["piece_timeout_seconds"] = piece_timeout_seconds;
+        j[kDownloadDir] = download_dir;
+        j[kSequentialDownload] = sequential_download;
+        j[kPieceTimeoutSeconds] = piece_timeout_seconds;
 
         // Upload/Seeding settings
-        j["seed_after_download"] = seed_after_download;
-        j["seed_ratio_limit"] = seed_ratio_limit;
-        j["seed_time_limit_hours"] = seed_time_limit_hours;
+        j[kSeedAfterDownload] = seed_after_download;
+        j[kSeedRatioLimit] = seed_ratio_limit;
+        j[kSeedTimeLimitHours] = seed_time_limit_hours;
 
         // Tracker settings
-        j["tracker_announce_interval"] = tracker_announce_interval;
-        j["tracker_timeout_seconds"] = tracker_timeout_seconds;
-        j["tracker_max_retries"] = tracker_max_retries;
+        j[kTrackerAnnounceInterval] = tracker_announce_interval;
+        j[kTrackerTimeoutSeconds] = tracker_timeout_seconds;
+        j[kTrackerMaxRetries] = tracker_max_retries;
 
         // Logging settings
-        j["log_level"] = log_level;
-        j["log_file"] = log_file;
-        j["log_max_size"] = log_max_size;
-        j["log_max_files"] = log_max_files;
+        j[kLogLevel] = log_level;
+        j[kLogFile] = log_file;
+        j[kLogMaxSize] = log_max_size;
+        j[kLogMaxFiles] = log_max_files;
 
         // Resume capability
-        j["enable_resume"] = enable_resume;
-        j["resume_dir"] = resume_dir;
+        j[kEnableResume] = enable_resume;
+        j[kResumeDir] = resume_dir;
 
         // DHT settings
-        j["enable_dht"] = enable_dht;
-        j["dht_port"] = dht_port;
+        j[kEnableDht] = enable_dht;
+        j[kDhtPort] = dht_port;
 
         // PEX settings
-        j["enable_pex"] = enable_pex;
+        j[kEnablePex] = enable_pex;
 
         // Encryption settings
-        j["enable_encryption"] = enable_encryption;
-        j["encryption_mode"] = encryption_mode;
-        j["allow_legacy_peers"] = allow_legacy_peers;
+        j[kEnableEncryption] = enable_encryption;
+        j[kEncryptionMode] = encryption_mode;
+        j[kAllowLegacyPeers] = allow_legacy_peers;
 
         // IPv6 settings
-        j["enable_ipv6"] = enable_ipv6;
-        j["ip_version"] = ip_version;
+        j[kEnableIpv6] = enable_ipv6;
+        j[kIpVersion] = ip_version;
 
         // LSD settings
-        j["enable_lsd"] = enable_lsd;
+        j[kEnableLsd] = enable_lsd;
 
         // Web Seeding settings
-        j["enable_webseeds"] = enable_webseeds;
+        j[kEnableWebseeds] = enable_webseeds;
 
         // uTP settings
-        j["enable_utp"] = enable_utp;
-        j["prefer_utp"] = prefer_utp;
+        j[kEnableUtp] = enable_utp;
+        j[kPreferUtp] = prefer_utp;
 
         std::ofstream file(filepath);
         if (!file.is_open()) {
@@ -183,7 +219,9 @@ bool Config::saveToFile(const std::string& filepath) const {
             return false;
         }
 
-        file << j.dump(4);  // Pretty print with 4 spaces indent
+        // Serialize straight into the stream buffer — dump(4) would
+        // materialize the whole document as a temporary string first
+        file << std::setw(4) << j;
         LOG_INFO("Configuration saved to: {}", filepath);
         return true;
 
@@ -231,120 +269,156 @@ void Config::mergeWithCLI(const std::optional<std::string>& download_dir_cli,
 }
 
 bool Config::validate() const {
-    bool valid = true;
+    // Collect all failures into one buffer and log once at the end:
+    // the valid path stays log-free, and a bad config produces a
+    // single coherent report instead of eight separate logger
+    // lock/format/write cycles
+    fmt::memory_buffer errors;
+    auto push = [&](fmt::format_string<long long> message, long long value) {
+        fmt::format_to(std::back_inserter(errors), message, value);
+    };
 
     if (listen_port == 0 || listen_port > 65535) {
-        LOG_ERROR("Invalid listen_port: {}", listen_port);
-        valid = false;
+        push("  Invalid listen_port: {}\n", listen_port);
     }
 
     if (max_peers <= 0 || max_peers > 1000) {
-        LOG_ERROR("Invalid max_peers: {}", max_peers);
-        valid = false;
+        push("  Invalid max_peers: {}\n", max_peers);
     }
 
     if (max_connections <= 0 || max_connections > 10000) {
-        LOG_ERROR("Invalid max_connections: {}", max_connections);
-        valid = false;
+        push("  Invalid max_connections: {}\n", max_connections);
     }
 
     if (max_download_speed < 0) {
-        LOG_ERROR("Invalid max_download_speed: {}", max_download_speed);
-        valid = false;
+        push("  Invalid max_download_speed: {}\n", max_download_speed);
     }
 
     if (max_upload_speed < 0) {
-        LOG_ERROR("Invalid max_upload_speed: {}", max_upload_speed);
-        valid = false;
+        push("  Invalid max_upload_speed: {}\n", max_upload_speed);
     }
 
     if (seed_ratio_limit < 0) {
-        LOG_ERROR("Invalid seed_ratio_limit: {}", seed_ratio_limit);
-        valid = false;
+        fmt::format_to(std::back_inserter(errors),
+                       "  Invalid seed_ratio_limit: {}\n", seed_ratio_limit);
     }
 
     if (seed_time_limit_hours < 0) {
-        LOG_ERROR("Invalid seed_time_limit_hours: {}", seed_time_limit_hours);
-        valid = false;
+        push("  Invalid seed_time_limit_hours: {}\n", seed_time_limit_hours);
     }
 
-    if (log_level != "trace" && log_level != "debug" && log_level != "info" &&
-        log_level != "warn" && log_level != "error") {
-        LOG_ERROR("Invalid log_level: {}", log_level);
-        valid = false;
+    static constexpr std::array<std::string_view, 5> kLogLevels{
+        {"trace", "debug", "info", "warn", "error"}};
+    if (std::find(kLogLevels.begin(), kLogLevels.end(), log_level) ==
+        kLogLevels.end()) {
+        fmt::format_to(std::back_inserter(errors),
+                       "  Invalid log_level: {}\n", log_level);
     }
 
-    return valid;
+    if (errors.size() != 0) {
+        LOG_ERROR("Invalid configuration:\n{}",
+                  std::string_view(errors.data(), errors.size()));
+        return false;
+    }
+    return true;
 }
 
 void Config::print() const {
-    std::cout << "\n=== Configuration ===\n";
-    std::cout << "Network:\n";
-    std::cout << "  Listen port: " << listen_port << "\n";
-    std::cout << "  Max peers: " << max_peers << "\n";
-    std::cout << "  Max connections: " << max_connections << "\n";
-
-    std::cout << "\nSpeed Limits:\n";
+    // Assemble the whole report in one buffer and write it with a
+    // single fwrite — each cout insertion pays a sentry lock and a
+    // locale facet dispatch, and this dump is ~60 of them
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+
+    fmt::format_to(out,
+                   "\n=== Configuration ===\n"
+                   "Network:\n"
+                   "  Listen port: {}\n"
+                   "  Max peers: {}\n"
+                   "  Max connections: {}\n",
+                   listen_port, max_peers, max_connections);
+
+    fmt::format_to(out, "\nSpeed Limits:\n");
     if (max_download_speed > 0) {
-        std::cout << "  Max download: " << (max_download_speed / 1024) << " KB/s\n";
+        fmt::format_to(out, "  Max download: {} KB/s\n", max_download_speed / 1024);
     } else {
-        std::cout << "  Max download: unlimited\n";
+        fmt::format_to(out, "  Max download: unlimited\n");
     }
     if (max_upload_speed > 0) {
-        std::cout << "  Max upload: " << (max_upload_speed / 1024) << " KB/s\n";
+        fmt::format_to(out, "  Max upload: {} KB/s\n", max_upload_speed / 1024);
     } else {
-        std::cout << "  Max upload: unlimited\n";
+        fmt::format_to(out, "  Max upload: unlimited\n");
     }
 
-    std::cout << "\nDownload Settings:\n";
-    std::cout << "  Download directory: " << download_dir << "\n";
-    std::cout << "  Sequential download: " << (sequential_download ? "yes" : "no") << "\n";
-    std::cout << "  Piece timeout: " << piece_timeout_seconds << " seconds\n";
+    fmt::format_to(out,
+                   "\nDownload Settings:\n"
+                   "  Download directory: {}\n"
+                   "  Sequential download: {}\n"
+                   "  Piece timeout: {} seconds\n",
+                   download_dir, sequential_download ? "yes" : "no",
+                   piece_timeout_seconds);
 
-    std::cout << "\nSeeding Settings:\n";
-    std::cout << "  Seed after download: " << (seed_after_download ? "yes" : "no") << "\n";
+    fmt::format_to(out, "\nSeeding Settings:\n  Seed after download: {}\n",
+                   seed_after_download ? "yes" : "no");
     if (seed_ratio_limit > 0) {
-        std::cout << "  Seed ratio limit: " << seed_ratio_limit << "\n";
+        fmt::format_to(out, "  Seed ratio limit: {}\n", seed_ratio_limit);
     } else {
-        std::cout << "  Seed ratio limit: unlimited\n";
+        fmt::format_to(out, "  Seed ratio limit: unlimited\n");
     }
     if (seed_time_limit_hours > 0) {
-        std::cout << "  Seed time limit: " << seed_time_limit_hours << " hours\n";
+        fmt::format_to(out, "  Seed time limit: {} hours\n", seed_time_limit_hours);
     } else {
-        std::cout << "  Seed time limit: unlimited\n";
+        fmt::format_to(out, "  Seed time limit: unlimited\n");
     }
 
-    std::cout << "\nTracker Settings:\n";
-    std::cout << "  Announce interval: " << tracker_announce_interval << " seconds\n";
-    std::cout << "  Timeout: " << tracker_timeout_seconds << " seconds\n";
-    std::cout << "  Max retries: " << tracker_max_retries << "\n";
-
-    std::cout << "\nLogging:\n";
-    std::cout << "  Log level: " << log_level << "\n";
-    std::cout << "  Log file: " << log_file << "\n";
-    std::cout << "  Log max size: " << (log_max_size / 1024 / 1024) << " MB\n";
-    std::cout << "  Log max files: " << log_max_files << "\n";
-
-    std::cout << "\nAdvanced:\n";
-    std::cout << "  Resume enabled: " << (enable_resume ? "yes" : "no") << "\n";
-    std::cout << "  DHT enabled: " << (enable_dht ? "yes" : "no") << "\n";
-    std::cout << "  PEX enabled: " << (enable_pex ? "yes" : "no") << "\n";
-    std::cout << "  LSD enabled: " << (enable_lsd ? "yes" : "no") << "\n";
-    std::cout << "  Web Seeding enabled: " << (enable_webseeds ? "yes" : "no") << "\n";
-    std::cout << "  uTP enabled: " << (enable_utp ? "yes" : "no") << "\n";
+    fmt::format_to(out,
+                   "\nTracker Settings:\n"
+                   "  Announce interval: {} seconds\n"
+                   "  Timeout: {} seconds\n"
+                   "  Max retries: {}\n",
+                   tracker_announce_interval, tracker_timeout_seconds,
+                   tracker_max_retries);
+
+    fmt::format_to(out,
+                   "\nLogging:\n"
+                   "  Log level: {}\n"
+                   "  Log file: {}\n"
+                   "  Log max size: {} MB\n"
+                   "  Log max files: {}\n",
+                   log_level, log_file, log_max_size / 1024 / 1024,
+                   log_max_files);
+
+    fmt::format_to(out,
+                   "\nAdvanced:\n"
+                   "  Resume enabled: {}\n"
+                   "  DHT enabled: {}\n"
+                   "  PEX enabled: {}\n"
+                   "  LSD enabled: {}\n"
+                   "  Web Seeding enabled: {}\n"
+                   "  uTP enabled: {}\n",
+                   enable_resume ? "yes" : "no", enable_dht ? "yes" : "no",
+                   enable_pex ? "yes" : "no", enable_lsd ? "yes" : "no",
+                   enable_webseeds ? "yes" : "no", enable_utp ? "yes" : "no");
     if (enable_utp) {
-        std::cout << "  Prefer uTP: " << (prefer_utp ? "yes" : "no") << "\n";
+        fmt::format_to(out, "  Prefer uTP: {}\n", prefer_utp ? "yes" : "no");
     }
 
-    std::cout << "\nEncryption (MSE/PE):\n";
-    std::cout << "  Encryption enabled: " << (enable_encryption ? "yes" : "no") << "\n";
-    std::cout << "  Encryption mode: " << encryption_mode << "\n";
-    std::cout << "  Allow legacy peers: " << (allow_legacy_peers ? "yes" : "no") << "\n";
-
-    std::cout << "\nIPv6 Support:\n";
-    std::cout << "  IPv6 enabled: " << (enable_ipv6 ? "yes" : "no") << "\n";
-    std::cout << "  IP version preference: " << ip_version << "\n";
-    std::cout << "====================\n\n";
+    fmt::format_to(out,
+                   "\nEncryption (MSE/PE):\n"
+                   "  Encryption enabled: {}\n"
+                   "  Encryption mode: {}\n"
+                   "  Allow legacy peers: {}\n",
+                   enable_encryption ? "yes" : "no", encryption_mode,
+                   allow_legacy_peers ? "yes" : "no");
+
+    fmt::format_to(out,
+                   "\nIPv6 Support:\n"
+                   "  IPv6 enabled: {}\n"
+                   "  IP version preference: {}\n"
+                   "====================\n\n",
+                   enable_ipv6 ? "yes" : "no", ip_version);
+
+    std::fwrite(buf.data(), 1, buf.size(), stdout);
 }
 
 } // namespace torrent
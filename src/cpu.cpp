@@ -0,0 +1,78 @@
+#include "cpu.h"
+
+// target_clones emits one clone per listed target plus an ifunc resolver;
+// glibc binds each call site to the best clone at load time. Only enabled
+// where GNU ifunc support is a given (x86 + GCC/Clang on glibc).
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__gnu_linux__)
+#define TORRENT_CPU_CLONES __attribute__((target_clones("arch=x86-64-v4", "avx2", "popcnt", "default")))
+#else
+#define TORRENT_CPU_CLONES
+#endif
+
+namespace torrent {
+namespace cpu {
+
+TORRENT_CPU_CLONES
+size_t bitmapPopcount(const uint64_t* words, size_t num_words) {
+    size_t sum = 0;
+    for (size_t i = 0; i < num_words; ++i) {
+        sum += static_cast<size_t>(__builtin_popcountll(words[i]));
+    }
+    return sum;
+}
+
+TORRENT_CPU_CLONES
+uint64_t bitmapAndMissingAny(const uint64_t* ours, const uint64_t* peer,
+                             size_t num_words) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < num_words; ++i) {
+        acc |= ~ours[i] & peer[i];
+    }
+    return acc;
+}
+
+TORRENT_CPU_CLONES
+size_t bitmapAndMissingCount(const uint64_t* ours, const uint64_t* peer,
+                             size_t num_words) {
+    size_t sum = 0;
+    for (size_t i = 0; i < num_words; ++i) {
+        sum += static_cast<size_t>(__builtin_popcountll(~ours[i] & peer[i]));
+    }
+    return sum;
+}
+
+TORRENT_CPU_CLONES
+void bitmapPositionalCount(const uint64_t* words, size_t num_words,
+                           uint32_t counts[64]) {
+    for (int b = 0; b < 64; ++b) {
+        counts[b] = 0;
+    }
+
+    // Byte-lane SWAR: acc[k] holds eight 8-bit counters, one per byte
+    // lane, so lane `l` of acc[k] counts bit position k + 8*l. Eight
+    // mask-and-add ops tally all 64 positions of a word, and the fixed
+    // inner trip count vectorizes cleanly. Lanes saturate after 255
+    // words, so flush into the 32-bit counts at most every 255.
+    constexpr uint64_t kLanes = 0x0101010101010101ULL;
+    size_t i = 0;
+    while (i < num_words) {
+        size_t block = num_words - i < 255 ? num_words - i : 255;
+        uint64_t acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (size_t j = 0; j < block; ++j) {
+            uint64_t w = words[i + j];
+            for (int k = 0; k < 8; ++k) {
+                acc[k] += (w >> k) & kLanes;
+            }
+        }
+        for (int k = 0; k < 8; ++k) {
+            for (int lane = 0; lane < 8; ++lane) {
+                counts[k + 8 * lane] +=
+                    static_cast<uint32_t>((acc[k] >> (8 * lane)) & 0xFF);
+            }
+        }
+        i += block;
+    }
+}
+
+} // namespace cpu
+} // namespace torrent
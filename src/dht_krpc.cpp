@@ -1,8 +1,17 @@
 #include "dht_krpc.h"
-#include <random>
+#include "utils.h"
+#include <charconv>
+#include <cstring>
 #include <sstream>
 #include <stdexcept>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
 namespace torrent {
 namespace dht {
 
@@ -78,14 +87,17 @@ KRPCQuery KRPCQuery::fromBencode(const bencode::BencodeValue& value) {
 
     const auto& dict = value.asDict();
 
+    // One binary search per key: find() once, reuse the iterator. The
+    // at() form repeated the whole lookup for every access.
+
     // Parse transaction ID
-    if (dict.find("t") != dict.end() && dict.at("t").isString()) {
-        query.transaction_id = dict.at("t").asString();
+    if (auto it = dict.find("t"); it != dict.end() && it->second.isString()) {
+        query.transaction_id = it->second.asString();
     }
 
     // Parse query method
-    if (dict.find("q") != dict.end() && dict.at("q").isString()) {
-        std::string method = dict.at("q").asString();
+    if (auto it = dict.find("q"); it != dict.end() && it->second.isString()) {
+        const std::string& method = it->second.asString();
         if (method == "ping") query.query_type = QueryType::PING;
         else if (method == "find_node") query.query_type = QueryType::FIND_NODE;
         else if (method == "get_peers") query.query_type = QueryType::GET_PEERS;
@@ -93,20 +105,20 @@ KRPCQuery KRPCQuery::fromBencode(const bencode::BencodeValue& value) {
     }
 
     // Parse arguments
-    if (dict.find("a") != dict.end() && dict.at("a").isDict()) {
-        const auto& args = dict.at("a").asDict();
+    if (auto a_it = dict.find("a"); a_it != dict.end() && a_it->second.isDict()) {
+        const auto& args = a_it->second.asDict();
 
         // Sender ID
-        if (args.find("id") != args.end() && args.at("id").isString()) {
-            std::string id_str = args.at("id").asString();
+        if (auto it = args.find("id"); it != args.end() && it->second.isString()) {
+            const std::string& id_str = it->second.asString();
             if (id_str.size() == NODE_ID_SIZE) {
                 std::copy(id_str.begin(), id_str.end(), query.sender_id.begin());
             }
         }
 
         // Target (for find_node)
-        if (args.find("target") != args.end() && args.at("target").isString()) {
-            std::string target_str = args.at("target").asString();
+        if (auto it = args.find("target"); it != args.end() && it->second.isString()) {
+            const std::string& target_str = it->second.asString();
             if (target_str.size() == NODE_ID_SIZE) {
                 NodeID target_id;
                 std::copy(target_str.begin(), target_str.end(), target_id.begin());
@@ -114,25 +126,30 @@ KRPCQuery KRPCQuery::fromBencode(const bencode::BencodeValue& value) {
             }
         }
 
-        // Info hash (for get_peers, announce_peer)
-        if (args.find("info_hash") != args.end() && args.at("info_hash").isString()) {
-            std::string hash_str = args.at("info_hash").asString();
-            query.info_hash = std::vector<uint8_t>(hash_str.begin(), hash_str.end());
+        // Info hash (for get_peers, announce_peer); anything that is not
+        // exactly 160 bits is malformed and left unset
+        if (auto it = args.find("info_hash"); it != args.end() && it->second.isString()) {
+            const std::string& hash_str = it->second.asString();
+            if (hash_str.size() == NODE_ID_SIZE) {
+                InfoHash hash;
+                std::copy(hash_str.begin(), hash_str.end(), hash.begin());
+                query.info_hash = hash;
+            }
         }
 
         // Port (for announce_peer)
-        if (args.find("port") != args.end() && args.at("port").isInt()) {
-            query.port = static_cast<uint16_t>(args.at("port").asInt());
+        if (auto it = args.find("port"); it != args.end() && it->second.isInt()) {
+            query.port = static_cast<uint16_t>(it->second.asInt());
         }
 
         // Token (for announce_peer)
-        if (args.find("token") != args.end() && args.at("token").isString()) {
-            query.token = args.at("token").asString();
+        if (auto it = args.find("token"); it != args.end() && it->second.isString()) {
+            query.token = it->second.asString();
         }
 
         // Implied port (for announce_peer)
-        if (args.find("implied_port") != args.end() && args.at("implied_port").isInt()) {
-            query.implied_port = static_cast<int>(args.at("implied_port").asInt());
+        if (auto it = args.find("implied_port"); it != args.end() && it->second.isInt()) {
+            query.implied_port = static_cast<int>(it->second.asInt());
         }
     }
 
@@ -202,31 +219,30 @@ KRPCResponse KRPCResponse::fromBencode(const bencode::BencodeValue& value) {
     const auto& dict = value.asDict();
 
     // Parse transaction ID
-    if (dict.find("t") != dict.end() && dict.at("t").isString()) {
-        response.transaction_id = dict.at("t").asString();
+    if (auto it = dict.find("t"); it != dict.end() && it->second.isString()) {
+        response.transaction_id = it->second.asString();
     }
 
     // Parse response values
-    if (dict.find("r") != dict.end() && dict.at("r").isDict()) {
-        const auto& resp = dict.at("r").asDict();
+    if (auto r_it = dict.find("r"); r_it != dict.end() && r_it->second.isDict()) {
+        const auto& resp = r_it->second.asDict();
 
         // Sender ID
-        if (resp.find("id") != resp.end() && resp.at("id").isString()) {
-            std::string id_str = resp.at("id").asString();
+        if (auto it = resp.find("id"); it != resp.end() && it->second.isString()) {
+            const std::string& id_str = it->second.asString();
             if (id_str.size() == NODE_ID_SIZE) {
                 std::copy(id_str.begin(), id_str.end(), response.sender_id.begin());
             }
         }
 
         // Nodes
-        if (resp.find("nodes") != resp.end() && resp.at("nodes").isString()) {
-            std::string compact = resp.at("nodes").asString();
-            response.nodes = KRPCMessageFactory::parseCompactNodes(compact);
+        if (auto it = resp.find("nodes"); it != resp.end() && it->second.isString()) {
+            response.nodes = KRPCMessageFactory::parseCompactNodes(it->second.asString());
         }
 
         // Values (peer list)
-        if (resp.find("values") != resp.end() && resp.at("values").isList()) {
-            const auto& vals = resp.at("values").asList();
+        if (auto it = resp.find("values"); it != resp.end() && it->second.isList()) {
+            const auto& vals = it->second.asList();
             std::vector<std::string> peer_values;
             for (const auto& val : vals) {
                 if (val.isString()) {
@@ -237,8 +253,8 @@ KRPCResponse KRPCResponse::fromBencode(const bencode::BencodeValue& value) {
         }
 
         // Token
-        if (resp.find("token") != resp.end() && resp.at("token").isString()) {
-            response.token = resp.at("token").asString();
+        if (auto it = resp.find("token"); it != resp.end() && it->second.isString()) {
+            response.token = it->second.asString();
         }
     }
 
@@ -276,13 +292,13 @@ KRPCError KRPCError::fromBencode(const bencode::BencodeValue& value) {
     const auto& dict = value.asDict();
 
     // Parse transaction ID
-    if (dict.find("t") != dict.end() && dict.at("t").isString()) {
-        error.transaction_id = dict.at("t").asString();
+    if (auto it = dict.find("t"); it != dict.end() && it->second.isString()) {
+        error.transaction_id = it->second.asString();
     }
 
     // Parse error
-    if (dict.find("e") != dict.end() && dict.at("e").isList()) {
-        const auto& error_list = dict.at("e").asList();
+    if (auto it = dict.find("e"); it != dict.end() && it->second.isList()) {
+        const auto& error_list = it->second.asList();
         if (error_list.size() >= 2) {
             if (error_list[0].isInt()) {
                 error.error_code = static_cast<ErrorCode>(error_list[0].asInt());
@@ -300,8 +316,13 @@ KRPCError KRPCError::fromBencode(const bencode::BencodeValue& value) {
 
 std::variant<KRPCQuery, KRPCResponse, KRPCError> KRPCMessageFactory::parse(
     const std::vector<uint8_t>& data) {
+    return parse(data.data(), data.size());
+}
 
-    bencode::BencodeValue value = bencode::decode(data);
+std::variant<KRPCQuery, KRPCResponse, KRPCError> KRPCMessageFactory::parse(
+    const uint8_t* data, size_t length) {
+
+    bencode::BencodeValue value = bencode::decode(data, length);
 
     if (!value.isDict()) {
         throw std::runtime_error("Invalid KRPC message: not a dictionary");
@@ -310,11 +331,12 @@ std::variant<KRPCQuery, KRPCResponse, KRPCError> KRPCMessageFactory::parse(
     const auto& dict = value.asDict();
 
     // Determine message type
-    if (dict.find("y") == dict.end() || !dict.at("y").isString()) {
+    auto y_it = dict.find("y");
+    if (y_it == dict.end() || !y_it->second.isString()) {
         throw std::runtime_error("Invalid KRPC message: missing type");
     }
 
-    std::string type = dict.at("y").asString();
+    const std::string& type = y_it->second.asString();
 
     if (type == "q") {
         return KRPCQuery::fromBencode(value);
@@ -347,7 +369,7 @@ KRPCQuery KRPCMessageFactory::createFindNode(const NodeID& sender_id,
 }
 
 KRPCQuery KRPCMessageFactory::createGetPeers(const NodeID& sender_id,
-                                             const std::vector<uint8_t>& info_hash,
+                                             const InfoHash& info_hash,
                                              const std::string& tid) {
     KRPCQuery query;
     query.transaction_id = tid;
@@ -358,7 +380,7 @@ KRPCQuery KRPCMessageFactory::createGetPeers(const NodeID& sender_id,
 }
 
 KRPCQuery KRPCMessageFactory::createAnnouncePeer(const NodeID& sender_id,
-                                                 const std::vector<uint8_t>& info_hash,
+                                                 const InfoHash& info_hash,
                                                  uint16_t port,
                                                  const std::string& token,
                                                  const std::string& tid,
@@ -424,20 +446,259 @@ KRPCError KRPCMessageFactory::createError(ErrorCode code,
     return error;
 }
 
+namespace {
+
+// Bounded bencode writer: appends straight into a caller-provided buffer
+// so building a datagram performs no heap allocation. Overflow clears
+// `ok`, and serialize() reports 0 bytes written.
+struct BencodeWriter {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok = true;
+
+    BencodeWriter(uint8_t* buf, size_t capacity) : p(buf), end(buf + capacity) {}
+
+    void raw(const void* data, size_t length) {
+        if (!ok || static_cast<size_t>(end - p) < length) {
+            ok = false;
+            return;
+        }
+        std::memcpy(p, data, length);
+        p += length;
+    }
+
+    void byte(char c) { raw(&c, 1); }
+
+    // Constant segment: N is known at compile time, so this inlines to a
+    // fixed-size memcpy
+    template <size_t N>
+    void lit(const char (&s)[N]) { raw(s, N - 1); }
+
+    // <length>: only, for payloads assembled in place with raw()
+    void strPrefix(size_t length) {
+        char prefix[24];
+        auto res = std::to_chars(prefix, prefix + sizeof(prefix), length);
+        raw(prefix, res.ptr - prefix);
+        byte(':');
+    }
+
+    // <length>:<bytes>
+    void str(const char* data, size_t length) {
+        strPrefix(length);
+        raw(data, length);
+    }
+
+    void str(const std::string& s) { str(s.data(), s.size()); }
+
+    template <size_t N>
+    void str(const std::array<uint8_t, N>& bytes) {
+        str(reinterpret_cast<const char*>(bytes.data()), N);
+    }
+
+    // i<value>e
+    void integer(int64_t value) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), value);
+        byte('i');
+        raw(digits, res.ptr - digits);
+        byte('e');
+    }
+};
+
+} // namespace
+
+size_t KRPCMessageFactory::serialize(const KRPCMessage& message, uint8_t* out, size_t capacity) {
+    BencodeWriter w(out, capacity);
+    char y_value = 'q';
+
+    // Fixed-shape fast paths for the outbound query types whose layout is
+    // fully determined by the type: everything around the 20-byte fields
+    // is a compile-time literal, so a ping/find_node/get_peers datagram is
+    // a handful of fused memcpys instead of a field-by-field walk. The
+    // guards on the unused optionals keep odd hand-built queries on the
+    // general path below, byte-identical either way. announce_peer stays
+    // general for its variable port and token.
+    if (message.type == MessageType::QUERY) {
+        const auto& query = static_cast<const KRPCQuery&>(message);
+        const bool bare = !query.port.has_value() && !query.token.has_value() &&
+                          !query.implied_port.has_value();
+        switch (query.query_type) {
+            case QueryType::PING:
+                if (bare && !query.target.has_value() &&
+                    !query.info_hash.has_value()) {
+                    w.lit("d1:ad2:id20:");
+                    w.raw(query.sender_id.data(), NODE_ID_SIZE);
+                    w.lit("e1:q4:ping1:t");
+                    w.str(message.transaction_id);
+                    w.lit("1:y1:qe");
+                    return w.ok ? static_cast<size_t>(w.p - out) : 0;
+                }
+                break;
+            case QueryType::FIND_NODE:
+                if (bare && query.target.has_value() &&
+                    !query.info_hash.has_value()) {
+                    w.lit("d1:ad2:id20:");
+                    w.raw(query.sender_id.data(), NODE_ID_SIZE);
+                    w.lit("6:target20:");
+                    w.raw(query.target->data(), NODE_ID_SIZE);
+                    w.lit("e1:q9:find_node1:t");
+                    w.str(message.transaction_id);
+                    w.lit("1:y1:qe");
+                    return w.ok ? static_cast<size_t>(w.p - out) : 0;
+                }
+                break;
+            case QueryType::GET_PEERS:
+                if (bare && !query.target.has_value() &&
+                    query.info_hash.has_value()) {
+                    w.lit("d1:ad2:id20:");
+                    w.raw(query.sender_id.data(), NODE_ID_SIZE);
+                    w.lit("9:info_hash20:");
+                    w.raw(query.info_hash->data(), NODE_ID_SIZE);
+                    w.lit("e1:q9:get_peers1:t");
+                    w.str(message.transaction_id);
+                    w.lit("1:y1:qe");
+                    return w.ok ? static_cast<size_t>(w.p - out) : 0;
+                }
+                break;
+            case QueryType::ANNOUNCE_PEER:
+                break;
+        }
+    }
+
+    // Same treatment for the bare response (sender id only) that answers
+    // ping and announce_peer -- the most frequent replies a reachable
+    // node emits. Byte-identical to the general path below.
+    if (message.type == MessageType::RESPONSE) {
+        const auto& response = static_cast<const KRPCResponse&>(message);
+        const bool bare =
+            (!response.nodes.has_value() || response.nodes->empty()) &&
+            (!response.values.has_value() || response.values->empty()) &&
+            !response.token.has_value();
+        if (bare) {
+            w.lit("d1:rd2:id20:");
+            w.raw(response.sender_id.data(), NODE_ID_SIZE);
+            w.lit("e1:t");
+            w.str(message.transaction_id);
+            w.lit("1:y1:re");
+            return w.ok ? static_cast<size_t>(w.p - out) : 0;
+        }
+    }
+
+    // Keys are emitted in bencode-sorted order by hand, matching what the
+    // tree-based encoder produced from its sorted dictionaries
+    w.byte('d');
+    switch (message.type) {
+        case MessageType::QUERY: {
+            const auto& query = static_cast<const KRPCQuery&>(message);
+            w.str("a", 1);
+            w.byte('d');
+            w.str("id", 2);
+            w.str(query.sender_id);
+            if (query.implied_port.has_value()) {
+                w.str("implied_port", 12);
+                w.integer(query.implied_port.value());
+            }
+            if (query.info_hash.has_value()) {
+                w.str("info_hash", 9);
+                w.str(reinterpret_cast<const char*>(query.info_hash->data()),
+                      query.info_hash->size());
+            }
+            if (query.port.has_value()) {
+                w.str("port", 4);
+                w.integer(query.port.value());
+            }
+            if (query.target.has_value()) {
+                w.str("target", 6);
+                w.str(query.target.value());
+            }
+            if (query.token.has_value()) {
+                w.str("token", 5);
+                w.str(query.token.value());
+            }
+            w.byte('e');
+            w.str("q", 1);
+            w.str(query.getQueryName());
+            y_value = 'q';
+            break;
+        }
+
+        case MessageType::RESPONSE: {
+            const auto& response = static_cast<const KRPCResponse&>(message);
+            w.str("r", 1);
+            w.byte('d');
+            w.str("id", 2);
+            w.str(response.sender_id);
+            if (response.nodes.has_value() && !response.nodes->empty()) {
+                // Compact node list assembled in place (26 bytes per
+                // node) rather than via the string-returning
+                // encodeCompactNodes, so serving a find_node/get_peers
+                // reply stays allocation-free end to end
+                const auto& node_list = response.nodes.value();
+                w.str("nodes", 5);
+                w.strPrefix(node_list.size() * 26);
+                for (const auto& node : node_list) {
+                    w.raw(node.id().data(), NODE_ID_SIZE);
+                    uint32_t ip_be = node.ipNetworkOrder();
+                    w.raw(&ip_be, 4);
+                    uint8_t port_be[2] = {
+                        static_cast<uint8_t>(node.port() >> 8),
+                        static_cast<uint8_t>(node.port() & 0xFF)};
+                    w.raw(port_be, 2);
+                }
+            }
+            if (response.token.has_value()) {
+                w.str("token", 5);
+                w.str(response.token.value());
+            }
+            if (response.values.has_value() && !response.values->empty()) {
+                w.str("values", 6);
+                w.byte('l');
+                for (const auto& val : response.values.value()) {
+                    w.str(val);
+                }
+                w.byte('e');
+            }
+            w.byte('e');
+            y_value = 'r';
+            break;
+        }
+
+        case MessageType::ERROR: {
+            const auto& error = static_cast<const KRPCError&>(message);
+            w.str("e", 1);
+            w.byte('l');
+            w.integer(static_cast<int64_t>(error.error_code));
+            w.str(error.error_message);
+            w.byte('e');
+            y_value = 'e';
+            break;
+        }
+    }
+
+    w.str("t", 1);
+    w.str(message.transaction_id);
+    w.str("y", 1);
+    w.str(&y_value, 1);
+    w.byte('e');
+
+    return w.ok ? static_cast<size_t>(w.p - out) : 0;
+}
+
 std::vector<uint8_t> KRPCMessageFactory::serialize(const KRPCMessage& message) {
-    bencode::BencodeValue value = message.toBencode();
-    return bencode::encode(value);
+    std::vector<uint8_t> data(MAX_PACKET_SIZE);
+    size_t length = serialize(message, data.data(), data.size());
+    data.resize(length);
+    return data;
 }
 
 std::string KRPCMessageFactory::generateTransactionId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 65535);
-
-    uint16_t tid = dis(gen);
+    // Two bytes off the shared thread-local generator — same source the
+    // UDP tracker ids use, no lock around a shared mt19937 and no
+    // distribution object. The 2-char result lives in SSO storage.
+    uint16_t tid = static_cast<uint16_t>(utils::fastRand32());
     std::string result(2, '\0');
-    result[0] = (tid >> 8) & 0xFF;
-    result[1] = tid & 0xFF;
+    result[0] = static_cast<char>(tid >> 8);
+    result[1] = static_cast<char>(tid & 0xFF);
     return result;
 }
 
@@ -450,26 +711,26 @@ std::vector<Node> KRPCMessageFactory::parseCompactNodes(const std::string& compa
     }
 
     size_t count = compact.size() / 26;
-    for (size_t i = 0; i < count; ++i) {
-        std::vector<uint8_t> node_data(compact.begin() + i * 26,
-                                       compact.begin() + (i + 1) * 26);
-        try {
-            nodes.push_back(Node::fromCompact(node_data));
-        } catch (...) {
-            // Skip invalid nodes
-        }
+    nodes.reserve(count);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(compact.data());
+    for (size_t i = 0; i < count; ++i, p += 26) {
+        // Length is validated above; the pointer overload reads the 26
+        // bytes in place with no per-node staging vector
+        nodes.push_back(Node::fromCompact(p));
     }
 
     return nodes;
 }
 
 std::string KRPCMessageFactory::encodeCompactNodes(const std::vector<Node>& nodes) {
-    std::string result;
-    result.reserve(nodes.size() * 26);
+    // One allocation for the whole reply; each node encodes in place
+    // into its 26-byte slot instead of through a temporary vector
+    std::string result(nodes.size() * 26, '\0');
 
+    uint8_t* out = reinterpret_cast<uint8_t*>(result.data());
     for (const auto& node : nodes) {
-        std::vector<uint8_t> compact = node.toCompact();
-        result.append(compact.begin(), compact.end());
+        node.writeCompact(out);
+        out += 26;
     }
 
     return result;
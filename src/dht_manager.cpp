@@ -5,7 +5,9 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <future>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -29,19 +31,117 @@ static const std::vector<BootstrapNode> DEFAULT_BOOTSTRAP_NODES = {
     {"router.utorrent.com", 6881}
 };
 
-// PeerStorage implementation
+// Decode a wire transaction ID into the uint16 key the pending map uses.
+// Our TIDs are always 2 big-endian bytes; anything else cannot match a
+// transaction we issued.
+static bool tidToKey(const std::string& tid, uint16_t& key) {
+    if (tid.size() != 2) {
+        return false;
+    }
+    key = static_cast<uint16_t>(
+        (static_cast<uint8_t>(tid[0]) << 8) | static_cast<uint8_t>(tid[1]));
+    return true;
+}
+
+// SipHash-2-4 (Aumasson/Bernstein): a keyed 64-bit PRF built for short
+// inputs. Announce tokens only need to be unforgeable without the key,
+// and the input is 24 bytes, so this replaces a full SHA-1 pass per
+// get_peers response with a handful of add-rotate-xor rounds.
+static inline uint64_t rotl64(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static uint64_t siphash24(const uint64_t key[2], const uint8_t* data, size_t len) {
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    auto sipround = [&]() {
+        v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);
+        v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);
+    };
+
+    const uint8_t* end = data + (len & ~size_t(7));
+    for (; data != end; data += 8) {
+        uint64_t m;
+        std::memcpy(&m, data, 8);
+        v3 ^= m;
+        sipround();
+        sipround();
+        v0 ^= m;
+    }
+
+    uint8_t tail[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::memcpy(tail, data, len & 7);
+    uint64_t b;
+    std::memcpy(&b, tail, 8);
+    b |= static_cast<uint64_t>(len & 0xff) << 56;
+
+    v3 ^= b;
+    sipround();
+    sipround();
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    sipround();
+    sipround();
+    sipround();
+    sipround();
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Token = SipHash(key, ipv4 | info_hash), sent as 8 raw bytes. An IP
+// that does not parse hashes as 0.0.0.0 — consistently on both the
+// generate and verify side, so such peers still round-trip.
+static std::string makeToken(const uint64_t key[2],
+                             const std::string& ip,
+                             const InfoHash& info_hash) {
+    uint8_t buf[4 + NODE_ID_SIZE];
+    struct in_addr addr;
+    std::memset(&addr, 0, sizeof(addr));
+    inet_pton(AF_INET, ip.c_str(), &addr);
+    std::memcpy(buf, &addr.s_addr, 4);
+    std::memcpy(buf + 4, info_hash.data(), NODE_ID_SIZE);
+
+    uint64_t h = siphash24(key, buf, sizeof(buf));
+    return std::string(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+// Constant-time token compare; a timing oracle here would let a peer
+// recover valid tokens byte by byte
+static bool tokenEqual(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    uint8_t acc = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        acc |= static_cast<uint8_t>(a[i]) ^ static_cast<uint8_t>(b[i]);
+    }
+    return acc == 0;
+}
+
+// Fresh 128-bit token key from the same entropy source node IDs use
+static void randomTokenKey(uint64_t key[2]) {
+    NodeID rnd = NodeDistance::generateRandomID();
+    std::memcpy(key, rnd.data(), 2 * sizeof(uint64_t));
+}
 
-void DHTManager::PeerStorage::addPeer(const std::vector<uint8_t>& info_hash,
-                                      const DHTpeer& peer) {
-    std::lock_guard<std::mutex> lock(mutex);
+// PeerStorage implementation
 
-    auto& peer_list = peers[info_hash];
+void DHTManager::PeerStorage::addPeer(const InfoHash& info_hash,
+                                      const CompactPeer6& peer) {
+    Shard& shard = shardFor(info_hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    // Check if peer already exists
-    auto it = std::find_if(peer_list.begin(), peer_list.end(),
-        [&](const DHTpeer& p) { return p.ip == peer.ip && p.port == peer.port; });
+    auto& peer_list = shard.peers[info_hash];
 
-    if (it == peer_list.end()) {
+    // Dedup with a linear scan; entries are 6 bytes, so even the 200-peer
+    // cap stays within a handful of cache lines
+    if (std::find(peer_list.begin(), peer_list.end(), peer) == peer_list.end()) {
         peer_list.push_back(peer);
 
         // Limit to 200 peers per info_hash
@@ -51,13 +151,14 @@ void DHTManager::PeerStorage::addPeer(const std::vector<uint8_t>& info_hash,
     }
 }
 
-std::vector<DHTpeer> DHTManager::PeerStorage::getPeers(
-    const std::vector<uint8_t>& info_hash) const {
+std::vector<CompactPeer6> DHTManager::PeerStorage::getPeers(
+    const InfoHash& info_hash) const {
 
-    std::lock_guard<std::mutex> lock(mutex);
+    const Shard& shard = shardFor(info_hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    auto it = peers.find(info_hash);
-    if (it != peers.end()) {
+    auto it = shard.peers.find(info_hash);
+    if (it != shard.peers.end()) {
         return it->second;
     }
     return {};
@@ -75,8 +176,8 @@ DHTManager::DHTManager(uint16_t port)
     , responses_received_(0)
     , errors_received_(0) {
 
-    // Initialize token secret
-    token_secret_ = utils::generatePeerId().substr(0, 8);
+    // Initialize token key
+    randomTokenKey(token_key_);
     last_token_rotation_ = std::chrono::steady_clock::now();
 
 #ifdef _WIN32
@@ -134,11 +235,12 @@ void DHTManager::start() {
         return;
     }
 
+    udp_batcher_ = std::make_unique<UdpBatcher>(socket_fd_);
+
     running_ = true;
 
-    // Start threads
+    // Single thread: maintenance runs on deadlines inside the network loop
     network_thread_ = std::thread(&DHTManager::networkLoop, this);
-    maintenance_thread_ = std::thread(&DHTManager::maintenanceLoop, this);
 
     LOG_INFO("DHT started with node ID: {}", NodeDistance::toHex(our_id_).substr(0, 16) + "...");
 }
@@ -156,8 +258,9 @@ void DHTManager::stop() {
         network_thread_.join();
     }
 
-    if (maintenance_thread_.joinable()) {
-        maintenance_thread_.join();
+    if (udp_batcher_) {
+        udp_batcher_->flush();
+        udp_batcher_.reset();
     }
 
     if (socket_fd_ >= 0) {
@@ -177,96 +280,147 @@ void DHTManager::bootstrap(const std::vector<BootstrapNode>& bootstrap_nodes) {
 
     auto nodes_to_use = bootstrap_nodes.empty() ? DEFAULT_BOOTSTRAP_NODES : bootstrap_nodes;
 
+    // Resolve all hosts concurrently: each getaddrinfo can take a DNS
+    // round trip of hundreds of ms, so serial resolution costs the sum
+    // where the overlap costs the slowest one
+    std::vector<std::future<std::string>> resolutions;
+    resolutions.reserve(nodes_to_use.size());
     for (const auto& bn : nodes_to_use) {
-        // Resolve hostname
-        struct addrinfo hints, *result;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_DGRAM;
-
-        std::string port_str = std::to_string(bn.port);
-        if (getaddrinfo(bn.host.c_str(), port_str.c_str(), &hints, &result) == 0) {
-            struct sockaddr_in* addr = (struct sockaddr_in*)result->ai_addr;
-            char ip_str[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &addr->sin_addr, ip_str, INET_ADDRSTRLEN);
-
-            // Create a temporary node for bootstrap
-            NodeID bootstrap_id = NodeDistance::generateRandomID();
-            Node bootstrap_node(bootstrap_id, ip_str, bn.port);
-
-            LOG_DEBUG("Bootstrapping from {}:{}", ip_str, bn.port);
-
-            // Send find_node to discover nodes close to our ID
-            findNode(bootstrap_node, our_id_,
-                [this](const KRPCResponse& response) {
-                    if (response.nodes.has_value()) {
-                        for (const auto& node : response.nodes.value()) {
-                            routing_table_->addNode(node);
-                        }
-                        LOG_DEBUG("Bootstrap: received {} nodes", response.nodes.value().size());
-                    }
-                },
-                []() {
-                    LOG_DEBUG("Bootstrap: find_node timeout");
+        resolutions.push_back(std::async(std::launch::async,
+            [host = bn.host, port = bn.port]() -> std::string {
+                struct addrinfo hints, *result;
+                memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_INET;
+                hints.ai_socktype = SOCK_DGRAM;
+                hints.ai_flags = AI_NUMERICSERV;
+
+                std::string port_str = std::to_string(port);
+                if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &result) != 0) {
+                    return {};
                 }
-            );
+                struct sockaddr_in* addr = (struct sockaddr_in*)result->ai_addr;
+                char ip_str[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &addr->sin_addr, ip_str, INET_ADDRSTRLEN);
+                freeaddrinfo(result);
+                return ip_str;
+            }));
+    }
+
+    // Completion state shared with the find_node continuations, which
+    // outlive this call (timeouts fire up to 15s later on the network
+    // thread) — hence the shared_ptr, not stack references
+    struct BootstrapWait {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int pending = 0;
+    };
+    auto wait_state = std::make_shared<BootstrapWait>();
+
+    for (size_t i = 0; i < nodes_to_use.size(); ++i) {
+        std::string ip_str = resolutions[i].get();
+        if (ip_str.empty()) {
+            LOG_WARN("Failed to resolve bootstrap node: {}", nodes_to_use[i].host);
+            continue;
+        }
+
+        // Create a temporary node for bootstrap
+        NodeID bootstrap_id = NodeDistance::generateRandomID();
+        Node bootstrap_node(bootstrap_id, ip_str, nodes_to_use[i].port);
 
-            freeaddrinfo(result);
-        } else {
-            LOG_WARN("Failed to resolve bootstrap node: {}", bn.host);
+        LOG_DEBUG("Bootstrapping from {}:{}", ip_str, nodes_to_use[i].port);
+
+        {
+            std::lock_guard<std::mutex> lock(wait_state->mutex);
+            ++wait_state->pending;
         }
+
+        // Send find_node to discover nodes close to our ID
+        findNode(bootstrap_node, our_id_,
+            [this, wait_state](const KRPCResponse& response) {
+                if (response.nodes.has_value()) {
+                    for (const auto& node : response.nodes.value()) {
+                        routing_table_->addNode(node);
+                    }
+                    LOG_DEBUG("Bootstrap: received {} nodes", response.nodes.value().size());
+                }
+                {
+                    std::lock_guard<std::mutex> lock(wait_state->mutex);
+                    --wait_state->pending;
+                }
+                wait_state->cv.notify_one();
+            },
+            [wait_state]() {
+                LOG_DEBUG("Bootstrap: find_node timeout");
+                {
+                    std::lock_guard<std::mutex> lock(wait_state->mutex);
+                    --wait_state->pending;
+                }
+                wait_state->cv.notify_one();
+            }
+        );
     }
 
-    // Wait a bit for responses
-    std::this_thread::sleep_for(std::chrono::seconds(2));
+    // Wake as soon as every contacted node answered instead of always
+    // sleeping out a fixed grace period; the cap only bounds the wait
+    // when a bootstrap node is down (its timeout fires later)
+    {
+        std::unique_lock<std::mutex> lock(wait_state->mutex);
+        wait_state->cv.wait_for(lock, std::chrono::seconds(5),
+                                [&] { return wait_state->pending == 0; });
+    }
 
     LOG_INFO("Bootstrap complete. Routing table size: {}", routing_table_->size());
 }
 
-std::vector<DHTpeer> DHTManager::getPeers(const std::vector<uint8_t>& info_hash,
+std::vector<DHTpeer> DHTManager::getPeers(const InfoHash& info_hash,
                                           int timeout_seconds) {
     LOG_DEBUG("DHT: Looking up peers for info_hash");
 
-    std::vector<DHTpeer> found_peers;
-    std::mutex peers_mutex;
-    std::atomic<int> pending_requests(0);
+    // Shared with the continuations, which can outlive this call (a
+    // node that never answers fires its timeout on the network thread
+    // up to 15s later) — shared_ptr ownership, not stack references
+    struct LookupState {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<DHTpeer> peers;
+        int pending = 0;
+    };
+    auto state = std::make_shared<LookupState>();
 
     auto start_time = std::chrono::steady_clock::now();
 
-    // Get closest nodes to info_hash
-    NodeID target;
-    if (info_hash.size() == NODE_ID_SIZE) {
-        std::copy(info_hash.begin(), info_hash.end(), target.begin());
-    }
-
-    auto closest_nodes = routing_table_->findClosestNodes(target, 8);
+    // The info hash is itself the lookup target in the node ID keyspace
+    auto closest_nodes = routing_table_->findClosestNodes(info_hash, 8);
 
     if (closest_nodes.empty()) {
         LOG_WARN("DHT: No nodes in routing table for get_peers");
-        return found_peers;
+        return {};
     }
 
-    pending_requests = closest_nodes.size();
+    state->pending = static_cast<int>(closest_nodes.size());
 
     // Send get_peers to closest nodes
     for (const auto& node : closest_nodes) {
         getPeersFromNode(node, info_hash,
-            [&, info_hash](const KRPCResponse& response) {
+            [this, state](const KRPCResponse& response) {
                 // Check for peer values
                 if (response.values.has_value()) {
-                    std::lock_guard<std::mutex> lock(peers_mutex);
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->peers.reserve(state->peers.size() +
+                                         response.values->size());
                     for (const auto& val : response.values.value()) {
                         if (val.size() == 6) {
                             // Compact peer format: 4 bytes IP + 2 bytes port
                             DHTpeer peer;
                             struct in_addr addr;
-                            addr.s_addr = (val[0] << 0) | (val[1] << 8) |
-                                        (val[2] << 16) | (val[3] << 24);
+                            std::memcpy(&addr.s_addr, val.data(), 4);
                             char ip_str[INET_ADDRSTRLEN];
                             inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
                             peer.ip = ip_str;
-                            peer.port = (static_cast<uint16_t>(val[4]) << 8) | val[5];
-                            found_peers.push_back(peer);
+                            peer.port = (static_cast<uint16_t>(
+                                             static_cast<uint8_t>(val[4])) << 8) |
+                                        static_cast<uint8_t>(val[5]);
+                            state->peers.push_back(std::move(peer));
                         }
                     }
                 }
@@ -278,41 +432,38 @@ std::vector<DHTpeer> DHTManager::getPeers(const std::vector<uint8_t>& info_hash,
                     }
                 }
 
-                pending_requests--;
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    --state->pending;
+                }
+                state->cv.notify_one();
             },
-            [&]() {
-                pending_requests--;
+            [state]() {
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    --state->pending;
+                }
+                state->cv.notify_one();
             }
         );
     }
 
-    // Wait for responses or timeout
-    while (pending_requests > 0) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::steady_clock::now() - start_time
-        ).count();
+    // Wake the moment the last contacted node answers instead of
+    // sleeping out 100ms poll ticks; the deadline still bounds the wait
+    // when nodes never reply
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait_until(lock,
+                         start_time + std::chrono::seconds(timeout_seconds),
+                         [&] { return state->pending == 0; });
 
-        if (elapsed >= timeout_seconds) {
-            break;
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-
-    LOG_INFO("DHT: Found {} peers", found_peers.size());
-    return found_peers;
+    LOG_INFO("DHT: Found {} peers", state->peers.size());
+    return std::move(state->peers);
 }
 
-void DHTManager::announcePeer(const std::vector<uint8_t>& info_hash, uint16_t port) {
+void DHTManager::announcePeer(const InfoHash& info_hash, uint16_t port) {
     LOG_DEBUG("DHT: Announcing as peer for info_hash on port {}", port);
 
-    // Get closest nodes to info_hash
-    NodeID target;
-    if (info_hash.size() == NODE_ID_SIZE) {
-        std::copy(info_hash.begin(), info_hash.end(), target.begin());
-    }
-
-    auto closest_nodes = routing_table_->findClosestNodes(target, 8);
+    auto closest_nodes = routing_table_->findClosestNodes(info_hash, 8);
 
     if (closest_nodes.empty()) {
         LOG_WARN("DHT: No nodes in routing table for announce_peer");
@@ -351,36 +502,88 @@ RoutingTable::Stats DHTManager::getRoutingStats() const {
 // Network operations
 
 void DHTManager::networkLoop() {
-    std::vector<uint8_t> buffer(65536);
+    std::vector<UdpBatcher::Datagram> batch;
+    auto last_timeout_check = std::chrono::steady_clock::now();
+    auto last_maintenance = last_timeout_check;
 
     while (running_) {
-        struct sockaddr_in from_addr;
-        socklen_t from_len = sizeof(from_addr);
-
-        int received = recvfrom(socket_fd_, (char*)buffer.data(), buffer.size(), 0,
-                               (struct sockaddr*)&from_addr, &from_len);
+        // Push out everything queued since the last tick in one sendmmsg
+        udp_batcher_->flush();
+
+        // Drain whatever the kernel has buffered in one recvmmsg; the
+        // 10ms poll timeout replaces the old sleep tick. A full batch
+        // means a backlog (bootstrap burst, lookup fan-in), so keep
+        // pulling without waiting out another tick, flushing the replies
+        // each handling pass queued.
+        size_t received = udp_batcher_->receiveBatch(batch, 10);
+        while (received > 0 && running_) {
+            for (const auto& dg : batch) {
+                char ip_str[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &dg.from.sin_addr, ip_str, INET_ADDRSTRLEN);
+                uint16_t from_port = ntohs(dg.from.sin_port);
+
+                handleIncomingMessage(dg.data, dg.length, ip_str, from_port);
+            }
 
-        if (received > 0) {
-            std::vector<uint8_t> data(buffer.begin(), buffer.begin() + received);
+            if (received < UdpBatcher::kBatchSize) {
+                break;
+            }
+            udp_batcher_->flush();
+            received = udp_batcher_->receiveBatch(batch, 0);
+        }
 
-            char ip_str[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &from_addr.sin_addr, ip_str, INET_ADDRSTRLEN);
-            uint16_t from_port = ntohs(from_addr.sin_port);
+        // Transaction timeouts are 15s; scanning the pending map under
+        // its mutex every 10ms tick bought nothing, once a second is
+        // plenty of resolution
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_timeout_check >= std::chrono::seconds(1)) {
+            checkTransactionTimeouts();
+            last_timeout_check = now;
+        }
 
-            handleIncomingMessage(data, ip_str, from_port);
+        // Bucket refresh / bad-node cleanup / token rotation used to live
+        // on a dedicated thread that slept 60s and then contended for the
+        // routing table against this loop; run it here on the same
+        // deadline instead and the second thread (and its wake-up lock
+        // contention) goes away entirely
+        if (now - last_maintenance >= std::chrono::seconds(60)) {
+            runMaintenance();
+            last_maintenance = now;
         }
 
-        // Check transaction timeouts
-        checkTransactionTimeouts();
+        // Drip queued refresh queries at a couple per tick (~200/s
+        // ceiling) so they ride the regular sendmmsg flushes instead of
+        // overflowing the tx ring in one burst
+        for (size_t i = 0;
+             i < kRefreshQueriesPerTick && !refresh_queue_.empty(); ++i) {
+            PendingRefresh pr = std::move(refresh_queue_.front());
+            refresh_queue_.pop_front();
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            findNode(pr.node, pr.target,
+                [this](const KRPCResponse& response) {
+                    if (response.nodes.has_value()) {
+                        for (const auto& node : response.nodes.value()) {
+                            routing_table_->addNode(node);
+                        }
+                    }
+                },
+                []() {}
+            );
+        }
     }
 }
 
 bool DHTManager::sendMessage(const KRPCMessage& message,
                             const std::string& ip,
                             uint16_t port) {
-    std::vector<uint8_t> data = KRPCMessageFactory::serialize(message);
+    // Serialize onto the stack: KRPC datagrams are MTU-bounded, so no
+    // heap vector per outbound query
+    uint8_t data[KRPCMessageFactory::MAX_PACKET_SIZE];
+    size_t length = KRPCMessageFactory::serialize(message, data, sizeof(data));
+    if (length == 0) {
+        LOG_ERROR("KRPC message too large to serialize");
+        return false;
+    }
 
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -392,17 +595,24 @@ bool DHTManager::sendMessage(const KRPCMessage& message,
         return false;
     }
 
-    int sent = sendto(socket_fd_, (char*)data.data(), data.size(), 0,
+    // Queue for the network loop's next flush (at most one tick away);
+    // a lookup fan-out thus leaves in one sendmmsg instead of per-node
+    // sendto calls
+    if (udp_batcher_) {
+        return udp_batcher_->queueSend(data, length, addr);
+    }
+
+    int sent = sendto(socket_fd_, (char*)data, length, 0,
                      (struct sockaddr*)&addr, sizeof(addr));
 
-    return sent == static_cast<int>(data.size());
+    return sent == static_cast<int>(length);
 }
 
-void DHTManager::handleIncomingMessage(const std::vector<uint8_t>& data,
+void DHTManager::handleIncomingMessage(const uint8_t* data, size_t length,
                                       const std::string& from_ip,
                                       uint16_t from_port) {
     try {
-        auto message = KRPCMessageFactory::parse(data);
+        auto message = KRPCMessageFactory::parse(data, length);
 
         if (std::holds_alternative<KRPCQuery>(message)) {
             handleQuery(std::get<KRPCQuery>(message), from_ip, from_port);
@@ -450,8 +660,12 @@ void DHTManager::handleResponse(const KRPCResponse& response) {
     routing_table_->updateNode(response.sender_id);
 
     // Find and execute callback
+    uint16_t tid_key;
+    if (!tidToKey(response.transaction_id, tid_key)) {
+        return; // Not a TID we could have issued
+    }
     std::lock_guard<std::mutex> lock(transactions_mutex_);
-    auto it = pending_transactions_.find(response.transaction_id);
+    auto it = pending_transactions_.find(tid_key);
     if (it != pending_transactions_.end()) {
         if (it->second.on_response) {
             it->second.on_response(response);
@@ -466,7 +680,10 @@ void DHTManager::handleError(const KRPCError& error) {
              error.error_message);
 
     // Remove transaction
-    removeTransaction(error.transaction_id);
+    uint16_t tid_key;
+    if (tidToKey(error.transaction_id, tid_key)) {
+        removeTransaction(tid_key);
+    }
 }
 
 // Query handlers
@@ -504,21 +721,15 @@ void DHTManager::handleGetPeers(const KRPCQuery& query,
     auto peers = peer_storage_.getPeers(query.info_hash.value());
 
     if (!peers.empty()) {
-        // Return peer values
+        // Return peer values; storage already holds the 6-byte compact
+        // wire form, so each value is a straight copy
         std::vector<std::string> values;
+        values.reserve(peers.size());
         for (const auto& peer : peers) {
-            // Compact format: 4 bytes IP + 2 bytes port
-            std::vector<uint8_t> compact(6);
-            struct in_addr addr;
-            inet_pton(AF_INET, peer.ip.c_str(), &addr);
-            uint32_t ip_network = addr.s_addr;
-            compact[0] = (ip_network >> 0) & 0xFF;
-            compact[1] = (ip_network >> 8) & 0xFF;
-            compact[2] = (ip_network >> 16) & 0xFF;
-            compact[3] = (ip_network >> 24) & 0xFF;
-            compact[4] = (peer.port >> 8) & 0xFF;
-            compact[5] = peer.port & 0xFF;
-            values.push_back(std::string(compact.begin(), compact.end()));
+            char compact[6];
+            std::memcpy(compact, &peer.ip, 4);
+            std::memcpy(compact + 4, &peer.port, 2);
+            values.emplace_back(compact, sizeof(compact));
         }
 
         auto response = KRPCMessageFactory::createGetPeersResponseValues(our_id_, values,
@@ -526,10 +737,8 @@ void DHTManager::handleGetPeers(const KRPCQuery& query,
                                                                          query.transaction_id);
         sendMessage(response, from_ip, from_port);
     } else {
-        // Return closest nodes
-        NodeID target;
-        std::copy(query.info_hash->begin(), query.info_hash->end(), target.begin());
-        auto closest = routing_table_->findClosestNodes(target, BUCKET_SIZE);
+        // Return closest nodes (the info hash is the lookup target)
+        auto closest = routing_table_->findClosestNodes(query.info_hash.value(), BUCKET_SIZE);
 
         auto response = KRPCMessageFactory::createGetPeersResponseNodes(our_id_, closest,
                                                                         token,
@@ -554,13 +763,19 @@ void DHTManager::handleAnnouncePeer(const KRPCQuery& query,
         return;
     }
 
-    // Store peer
-    DHTpeer peer;
-    peer.ip = from_ip;
-    peer.port = query.implied_port.value_or(0) != 0 ? from_port : query.port.value();
+    // Store peer in compact form (IP and port in network byte order)
+    uint16_t peer_port =
+        query.implied_port.value_or(0) != 0 ? from_port : query.port.value();
+    struct in_addr addr;
+    if (inet_pton(AF_INET, from_ip.c_str(), &addr) <= 0) {
+        return;
+    }
+    CompactPeer6 peer;
+    peer.ip = addr.s_addr;
+    peer.port = htons(peer_port);
     peer_storage_.addPeer(query.info_hash.value(), peer);
 
-    LOG_DEBUG("DHT: Stored peer {}:{} for info_hash", peer.ip, peer.port);
+    LOG_DEBUG("DHT: Stored peer {}:{} for info_hash", from_ip, peer_port);
 
     // Send response
     auto response = KRPCMessageFactory::createPingResponse(our_id_, query.transaction_id);
@@ -570,61 +785,73 @@ void DHTManager::handleAnnouncePeer(const KRPCQuery& query,
 // DHT operations (continued in next part due to length)
 
 void DHTManager::ping(const Node& node,
-                     std::function<void(const KRPCResponse&)> on_response,
-                     std::function<void()> on_timeout) {
+                     ResponseCallback on_response,
+                     TimeoutCallback on_timeout) {
     std::string tid = KRPCMessageFactory::generateTransactionId();
     auto query = KRPCMessageFactory::createPing(our_id_, tid);
 
-    addTransaction(tid, QueryType::PING, node.id(), on_response, on_timeout);
+    uint16_t tid_key = 0;
+    tidToKey(tid, tid_key);
+    addTransaction(tid_key, QueryType::PING, node.id(),
+                   std::move(on_response), std::move(on_timeout));
     sendMessage(query, node.ip(), node.port());
     queries_sent_++;
 }
 
 void DHTManager::findNode(const Node& node,
                          const NodeID& target,
-                         std::function<void(const KRPCResponse&)> on_response,
-                         std::function<void()> on_timeout) {
+                         ResponseCallback on_response,
+                         TimeoutCallback on_timeout) {
     std::string tid = KRPCMessageFactory::generateTransactionId();
     auto query = KRPCMessageFactory::createFindNode(our_id_, target, tid);
 
-    addTransaction(tid, QueryType::FIND_NODE, node.id(), on_response, on_timeout);
+    uint16_t tid_key = 0;
+    tidToKey(tid, tid_key);
+    addTransaction(tid_key, QueryType::FIND_NODE, node.id(),
+                   std::move(on_response), std::move(on_timeout));
     sendMessage(query, node.ip(), node.port());
     queries_sent_++;
 }
 
 void DHTManager::getPeersFromNode(const Node& node,
-                                 const std::vector<uint8_t>& info_hash,
-                                 std::function<void(const KRPCResponse&)> on_response,
-                                 std::function<void()> on_timeout) {
+                                 const InfoHash& info_hash,
+                                 ResponseCallback on_response,
+                                 TimeoutCallback on_timeout) {
     std::string tid = KRPCMessageFactory::generateTransactionId();
     auto query = KRPCMessageFactory::createGetPeers(our_id_, info_hash, tid);
 
-    addTransaction(tid, QueryType::GET_PEERS, node.id(), on_response, on_timeout);
+    uint16_t tid_key = 0;
+    tidToKey(tid, tid_key);
+    addTransaction(tid_key, QueryType::GET_PEERS, node.id(),
+                   std::move(on_response), std::move(on_timeout));
     sendMessage(query, node.ip(), node.port());
     queries_sent_++;
 }
 
 void DHTManager::announcePeerToNode(const Node& node,
-                                   const std::vector<uint8_t>& info_hash,
+                                   const InfoHash& info_hash,
                                    uint16_t port,
                                    const std::string& token,
-                                   std::function<void(const KRPCResponse&)> on_response,
-                                   std::function<void()> on_timeout) {
+                                   ResponseCallback on_response,
+                                   TimeoutCallback on_timeout) {
     std::string tid = KRPCMessageFactory::generateTransactionId();
     auto query = KRPCMessageFactory::createAnnouncePeer(our_id_, info_hash, port, token, tid);
 
-    addTransaction(tid, QueryType::ANNOUNCE_PEER, node.id(), on_response, on_timeout);
+    uint16_t tid_key = 0;
+    tidToKey(tid, tid_key);
+    addTransaction(tid_key, QueryType::ANNOUNCE_PEER, node.id(),
+                   std::move(on_response), std::move(on_timeout));
     sendMessage(query, node.ip(), node.port());
     queries_sent_++;
 }
 
 // Transaction management
 
-void DHTManager::addTransaction(const std::string& tid,
+void DHTManager::addTransaction(uint16_t tid,
                                 QueryType type,
                                 const NodeID& target_node,
-                                std::function<void(const KRPCResponse&)> on_response,
-                                std::function<void()> on_timeout) {
+                                ResponseCallback on_response,
+                                TimeoutCallback on_timeout) {
     std::lock_guard<std::mutex> lock(transactions_mutex_);
 
     Transaction trans;
@@ -632,13 +859,14 @@ void DHTManager::addTransaction(const std::string& tid,
     trans.type = type;
     trans.target_node = target_node;
     trans.sent_time = std::chrono::steady_clock::now();
-    trans.on_response = on_response;
-    trans.on_timeout = on_timeout;
+    trans.on_response = std::move(on_response);
+    trans.on_timeout = std::move(on_timeout);
 
-    pending_transactions_[tid] = trans;
+    timeout_heap_.emplace(trans.sent_time + kTransactionTimeout, tid);
+    pending_transactions_[tid] = std::move(trans);
 }
 
-void DHTManager::removeTransaction(const std::string& tid) {
+void DHTManager::removeTransaction(uint16_t tid) {
     std::lock_guard<std::mutex> lock(transactions_mutex_);
     pending_transactions_.erase(tid);
 }
@@ -647,52 +875,45 @@ void DHTManager::checkTransactionTimeouts() {
     std::lock_guard<std::mutex> lock(transactions_mutex_);
 
     auto now = std::chrono::steady_clock::now();
-    std::vector<std::string> to_remove;
+    while (!timeout_heap_.empty() && timeout_heap_.top().first <= now) {
+        uint16_t tid = timeout_heap_.top().second;
+        timeout_heap_.pop();
 
-    for (auto& [tid, trans] : pending_transactions_) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - trans.sent_time
-        ).count();
-
-        if (elapsed >= 15) { // 15 second timeout
-            if (trans.on_timeout) {
-                trans.on_timeout();
-            }
-            to_remove.push_back(tid);
+        auto it = pending_transactions_.find(tid);
+        if (it == pending_transactions_.end()) {
+            continue; // answered or cancelled; stale heap entry
+        }
+        if (it->second.sent_time + kTransactionTimeout > now) {
+            // TID was reused after the original transaction completed;
+            // the fresher transaction has its own heap entry
+            continue;
         }
-    }
 
-    for (const auto& tid : to_remove) {
-        pending_transactions_.erase(tid);
+        if (it->second.on_timeout) {
+            it->second.on_timeout();
+        }
+        pending_transactions_.erase(it);
     }
 }
 
 // Token management
 
 std::string DHTManager::generateToken(const std::string& ip,
-                                     const std::vector<uint8_t>& info_hash) {
-    std::string data = ip + token_secret_;
-    data.insert(data.end(), info_hash.begin(), info_hash.end());
-
-    auto hash = utils::sha1(std::vector<uint8_t>(data.begin(), data.end()));
-    return std::string(hash.begin(), hash.begin() + 8); // Use first 8 bytes
+                                     const InfoHash& info_hash) {
+    return makeToken(token_key_, ip, info_hash);
 }
 
 bool DHTManager::verifyToken(const std::string& token,
                             const std::string& ip,
-                            const std::vector<uint8_t>& info_hash) {
-    // Check with current secret
-    if (token == generateToken(ip, info_hash)) {
+                            const InfoHash& info_hash) {
+    // Check with current key
+    if (tokenEqual(token, makeToken(token_key_, ip, info_hash))) {
         return true;
     }
 
-    // Check with old secret (for rotation tolerance)
-    if (!old_token_secret_.empty()) {
-        std::string old_token_secret_backup = token_secret_;
-        token_secret_ = old_token_secret_;
-        bool valid = token == generateToken(ip, info_hash);
-        token_secret_ = old_token_secret_backup;
-        return valid;
+    // Check with old key (for rotation tolerance)
+    if (has_old_token_key_) {
+        return tokenEqual(token, makeToken(old_token_key_, ip, info_hash));
     }
 
     return false;
@@ -700,35 +921,31 @@ bool DHTManager::verifyToken(const std::string& token,
 
 // Maintenance
 
-void DHTManager::maintenanceLoop() {
-    while (running_) {
-        std::this_thread::sleep_for(std::chrono::seconds(60));
-
-        if (!running_) break;
-
-        // Refresh buckets
-        refreshBuckets();
-
-        // Cleanup bad nodes
-        cleanupBadNodes();
+void DHTManager::runMaintenance() {
+    // Refresh buckets
+    refreshBuckets();
 
-        // Rotate token secret every hour
-        auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
-            std::chrono::steady_clock::now() - last_token_rotation_
-        ).count();
+    // Cleanup bad nodes
+    cleanupBadNodes();
 
-        if (elapsed >= 60) {
-            old_token_secret_ = token_secret_;
-            token_secret_ = utils::generatePeerId().substr(0, 8);
-            last_token_rotation_ = std::chrono::steady_clock::now();
-        }
+    // Rotate token key every hour
+    auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
+        std::chrono::steady_clock::now() - last_token_rotation_
+    ).count();
 
-        // Log statistics
-        auto stats = routing_table_->getStats();
-        LOG_DEBUG("DHT stats: {} nodes ({} good, {} questionable, {} bad), {} buckets",
-                 stats.total_nodes, stats.good_nodes, stats.questionable_nodes,
-                 stats.bad_nodes, stats.filled_buckets);
+    if (elapsed >= 60) {
+        old_token_key_[0] = token_key_[0];
+        old_token_key_[1] = token_key_[1];
+        has_old_token_key_ = true;
+        randomTokenKey(token_key_);
+        last_token_rotation_ = std::chrono::steady_clock::now();
     }
+
+    // Log statistics
+    auto stats = routing_table_->getStats();
+    LOG_DEBUG("DHT stats: {} nodes ({} good, {} questionable, {} bad), {} buckets",
+             stats.total_nodes, stats.good_nodes, stats.questionable_nodes,
+             stats.bad_nodes, stats.filled_buckets);
 }
 
 void DHTManager::refreshBuckets() {
@@ -740,16 +957,7 @@ void DHTManager::refreshBuckets() {
         auto closest_nodes = routing_table_->findClosestNodes(random_target, 3);
 
         for (const auto& node : closest_nodes) {
-            findNode(node, random_target,
-                [this](const KRPCResponse& response) {
-                    if (response.nodes.has_value()) {
-                        for (const auto& node : response.nodes.value()) {
-                            routing_table_->addNode(node);
-                        }
-                    }
-                },
-                []() {}
-            );
+            refresh_queue_.push_back({node, random_target});
         }
 
         routing_table_->markBucketRefreshed(bucket_idx);
@@ -1,7 +1,5 @@
 #include "dht_node.h"
 #include "utils.h"
-#include <sstream>
-#include <iomanip>
 #include <random>
 #include <cstring>
 #include <algorithm>
@@ -16,21 +14,55 @@
 namespace torrent {
 namespace dht {
 
+namespace {
+
+// Same table-lookup conversion as utils::toHex; these show up in every
+// log line that prints a node, so no stream machinery
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+uint8_t hexNibble(char c) {
+    if (c >= '0' && c <= '9') return static_cast<uint8_t>(c - '0');
+    if (c >= 'a' && c <= 'f') return static_cast<uint8_t>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return static_cast<uint8_t>(c - 'A' + 10);
+    return 0;
+}
+
+} // namespace
+
 // Node implementation
 
+namespace {
+
+// Dotted-decimal to network-order word, once at construction; the
+// stored form is what the compact wire format and bucket columns use
+uint32_t parseIPv4(const std::string& ip) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip.c_str(), &addr) == 1) {
+        return addr.s_addr;
+    }
+    return 0;
+}
+
+} // namespace
+
 Node::Node(const NodeID& id, const std::string& ip, uint16_t port)
     : id_(id)
-    , ip_(ip)
+    , ip_be_(parseIPv4(ip))
     , port_(port)
-    , status_(NodeStatus::QUESTIONABLE)
-    , last_seen_(std::chrono::steady_clock::now())
+    , status_and_seen_(packStatusSeen(NodeStatus::QUESTIONABLE, steadyNowNs()))
+    , consecutive_failures_(0) {}
+
+Node::Node(const NodeID& id, uint32_t ip_be, uint16_t port)
+    : id_(id)
+    , ip_be_(ip_be)
+    , port_(port)
+    , status_and_seen_(packStatusSeen(NodeStatus::QUESTIONABLE, steadyNowNs()))
     , consecutive_failures_(0) {}
 
 Node::Node(const std::vector<uint8_t>& id_bytes, const std::string& ip, uint16_t port)
-    : ip_(ip)
+    : ip_be_(parseIPv4(ip))
     , port_(port)
-    , status_(NodeStatus::QUESTIONABLE)
-    , last_seen_(std::chrono::steady_clock::now())
+    , status_and_seen_(packStatusSeen(NodeStatus::QUESTIONABLE, steadyNowNs()))
     , consecutive_failures_(0) {
 
     if (id_bytes.size() != NODE_ID_SIZE) {
@@ -40,17 +72,18 @@ Node::Node(const std::vector<uint8_t>& id_bytes, const std::string& ip, uint16_t
 }
 
 void Node::markGood() {
-    status_ = NodeStatus::GOOD;
+    status_and_seen_ = packStatusSeen(NodeStatus::GOOD, steadyNowNs());
     consecutive_failures_ = 0;
-    updateLastSeen();
 }
 
 void Node::markQuestionable() {
-    status_ = NodeStatus::QUESTIONABLE;
+    status_and_seen_ = (status_and_seen_ & ~NODE_STATUS_MASK) |
+                       static_cast<uint64_t>(NodeStatus::QUESTIONABLE);
 }
 
 void Node::markBad() {
-    status_ = NodeStatus::BAD;
+    status_and_seen_ = (status_and_seen_ & ~NODE_STATUS_MASK) |
+                       static_cast<uint64_t>(NodeStatus::BAD);
 }
 
 void Node::incrementFailures() {
@@ -65,27 +98,7 @@ void Node::resetFailures() {
 }
 
 void Node::updateLastSeen() {
-    last_seen_ = std::chrono::steady_clock::now();
-}
-
-bool Node::isGood() const {
-    // Good if responded within last 15 minutes
-    auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
-        std::chrono::steady_clock::now() - last_seen_
-    ).count();
-    return status_ == NodeStatus::GOOD && elapsed < 15;
-}
-
-bool Node::isQuestionable() const {
-    auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
-        std::chrono::steady_clock::now() - last_seen_
-    ).count();
-    return status_ == NodeStatus::QUESTIONABLE ||
-           (status_ == NodeStatus::GOOD && elapsed >= 15);
-}
-
-bool Node::isBad() const {
-    return status_ == NodeStatus::BAD || consecutive_failures_ >= 3;
+    status_and_seen_ = packStatusSeen(status(), steadyNowNs());
 }
 
 bool Node::operator==(const Node& other) const {
@@ -96,117 +109,175 @@ bool Node::operator!=(const Node& other) const {
     return !(*this == other);
 }
 
-std::vector<uint8_t> Node::toCompact() const {
-    std::vector<uint8_t> compact;
-    compact.reserve(26); // 20 bytes ID + 4 bytes IP + 2 bytes port
-
-    // Add node ID
-    compact.insert(compact.end(), id_.begin(), id_.end());
+std::array<uint8_t, 26> Node::toCompact() const {
+    std::array<uint8_t, 26> compact; // 20 bytes ID + 4 bytes IP + 2 bytes port
+    writeCompact(compact.data());
+    return compact;
+}
 
-    // Add IP address (4 bytes)
+std::string Node::ip() const {
     struct in_addr addr;
-    if (inet_pton(AF_INET, ip_.c_str(), &addr) == 1) {
-        uint32_t ip_network = addr.s_addr; // Already in network byte order
-        compact.push_back((ip_network >> 0) & 0xFF);
-        compact.push_back((ip_network >> 8) & 0xFF);
-        compact.push_back((ip_network >> 16) & 0xFF);
-        compact.push_back((ip_network >> 24) & 0xFF);
-    } else {
-        // Invalid IP, use 0.0.0.0
-        compact.insert(compact.end(), {0, 0, 0, 0});
-    }
+    addr.s_addr = ip_be_;
+    char ip_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
+    return ip_str;
+}
 
-    // Add port (2 bytes, big-endian)
-    compact.push_back((port_ >> 8) & 0xFF);
-    compact.push_back(port_ & 0xFF);
+void Node::writeCompact(uint8_t* out) const {
+    // Node ID (first 20 bytes)
+    std::copy(id_.begin(), id_.end(), out);
 
-    return compact;
+    // IP address (4 bytes): stored in network order, straight copy
+    std::memcpy(out + 20, &ip_be_, 4);
+
+    // Port (2 bytes, big-endian)
+    out[24] = static_cast<uint8_t>(port_ >> 8);
+    out[25] = static_cast<uint8_t>(port_ & 0xFF);
 }
 
 Node Node::fromCompact(const std::vector<uint8_t>& compact) {
     if (compact.size() != 26) {
         throw std::runtime_error("Invalid compact node format");
     }
+    return fromCompact(compact.data());
+}
 
+Node Node::fromCompact(const uint8_t* compact) {
     // Extract node ID (first 20 bytes)
     NodeID id;
-    std::copy(compact.begin(), compact.begin() + 20, id.begin());
+    std::copy(compact, compact + 20, id.begin());
 
-    // Extract IP (next 4 bytes)
-    struct in_addr addr;
-    addr.s_addr = (compact[20] << 0) | (compact[21] << 8) |
-                  (compact[22] << 16) | (compact[23] << 24);
-
-    char ip_str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
-    std::string ip(ip_str);
+    // IP bytes are already in network order; keep them that way
+    uint32_t ip_be;
+    std::memcpy(&ip_be, compact + 20, 4);
 
     // Extract port (last 2 bytes, big-endian)
     uint16_t port = (static_cast<uint16_t>(compact[24]) << 8) | compact[25];
 
-    return Node(id, ip, port);
+    return Node(id, ip_be, port);
 }
 
 std::string Node::toString() const {
-    std::ostringstream oss;
-    oss << NodeDistance::toHex(id_).substr(0, 8) << "... @ "
-        << ip_ << ":" << port_
-        << " [" << (isGood() ? "GOOD" : isQuestionable() ? "QUESTIONABLE" : "BAD") << "]";
-    return oss.str();
+    // "xxxxxxxx... @ ip:port [STATUS]"
+    std::string result;
+    result.reserve(8 + 6 + INET_ADDRSTRLEN + 6 + 16);
+    for (size_t i = 0; i < 4; ++i) {
+        result.push_back(kHexDigits[id_[i] >> 4]);
+        result.push_back(kHexDigits[id_[i] & 0x0F]);
+    }
+    result += "... @ ";
+    result += ip();
+    result += ':';
+    result += std::to_string(port_);
+    result += isGood() ? " [GOOD]"
+            : isQuestionable() ? " [QUESTIONABLE]"
+                               : " [BAD]";
+    return result;
 }
 
 // NodeDistance implementation
+//
+// A 20-byte NodeID is treated as two big-endian 64-bit words plus one
+// 32-bit tail: XOR distance is three word XORs instead of twenty byte
+// ops, the bucket index is a count-leading-zeros on the first nonzero
+// word, and distance comparison is a three-word tuple compare. Closest-
+// node searches evaluate distance O(N) times per lookup, so this is the
+// routing table's hottest arithmetic.
+
+namespace {
+
+uint64_t load64be(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return __builtin_bswap64(v);
+}
+
+uint32_t load32be(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+}
+
+} // namespace
 
 NodeID NodeDistance::distance(const NodeID& a, const NodeID& b) {
     NodeID result;
-    for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
-        result[i] = a[i] ^ b[i];
-    }
+    uint64_t a0, a1, b0, b1;
+    uint32_t a2, b2;
+    std::memcpy(&a0, a.data(), 8);
+    std::memcpy(&a1, a.data() + 8, 8);
+    std::memcpy(&a2, a.data() + 16, 4);
+    std::memcpy(&b0, b.data(), 8);
+    std::memcpy(&b1, b.data() + 8, 8);
+    std::memcpy(&b2, b.data() + 16, 4);
+    a0 ^= b0;
+    a1 ^= b1;
+    a2 ^= b2;
+    std::memcpy(result.data(), &a0, 8);
+    std::memcpy(result.data() + 8, &a1, 8);
+    std::memcpy(result.data() + 16, &a2, 4);
     return result;
 }
 
 bool NodeDistance::isCloser(const NodeID& target, const NodeID& a, const NodeID& b) {
-    NodeID dist_a = distance(target, a);
-    NodeID dist_b = distance(target, b);
-    return less(dist_a, dist_b);
+    // Compare XOR distances word-by-word without materializing them:
+    // the first word where the distances differ decides
+    uint64_t da = load64be(target.data()) ^ load64be(a.data());
+    uint64_t db = load64be(target.data()) ^ load64be(b.data());
+    if (da != db) {
+        return da < db;
+    }
+    da = load64be(target.data() + 8) ^ load64be(a.data() + 8);
+    db = load64be(target.data() + 8) ^ load64be(b.data() + 8);
+    if (da != db) {
+        return da < db;
+    }
+    return (load32be(target.data() + 16) ^ load32be(a.data() + 16)) <
+           (load32be(target.data() + 16) ^ load32be(b.data() + 16));
 }
 
 int NodeDistance::bucketIndex(const NodeID& our_id, const NodeID& other_id) {
-    NodeID dist = distance(our_id, other_id);
-
-    // Find the first non-zero bit (from left to right)
-    for (int byte = 0; byte < NODE_ID_SIZE; ++byte) {
-        if (dist[byte] != 0) {
-            // Find the highest bit set in this byte
-            uint8_t b = dist[byte];
-            int bit_pos = 7;
-            while (bit_pos >= 0 && !(b & (1 << bit_pos))) {
-                --bit_pos;
-            }
-            return byte * 8 + (7 - bit_pos);
-        }
+    // Leading-zero count of the 160-bit XOR distance, one word at a time
+    uint64_t d = load64be(our_id.data()) ^ load64be(other_id.data());
+    if (d != 0) {
+        return __builtin_clzll(d);
+    }
+    d = load64be(our_id.data() + 8) ^ load64be(other_id.data() + 8);
+    if (d != 0) {
+        return 64 + __builtin_clzll(d);
+    }
+    uint32_t t = load32be(our_id.data() + 16) ^ load32be(other_id.data() + 16);
+    if (t != 0) {
+        return 128 + __builtin_clz(t);
     }
     return 159; // Same node (should not happen in practice)
 }
 
 std::string NodeDistance::toHex(const NodeID& id) {
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
+    std::string result(NODE_ID_SIZE * 2, '\0');
+    char* out = result.data();
     for (uint8_t byte : id) {
-        oss << std::setw(2) << static_cast<int>(byte);
+        *out++ = kHexDigits[byte >> 4];
+        *out++ = kHexDigits[byte & 0x0F];
     }
-    return oss.str();
+    return result;
 }
 
 NodeID NodeDistance::generateRandomID() {
-    NodeID id;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
+    // Seed once per thread: constructing a random_device and re-running
+    // the full mt19937 state init on every call dwarfed the cost of the
+    // 20 bytes actually drawn (token key rotation and bucket refresh
+    // both come through here)
+    thread_local std::mt19937_64 gen{std::random_device{}()};
 
-    for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
-        id[i] = static_cast<uint8_t>(dis(gen));
-    }
+    // 20 bytes = two full 64-bit draws plus half a third
+    NodeID id;
+    uint64_t w0 = gen();
+    uint64_t w1 = gen();
+    uint32_t w2 = static_cast<uint32_t>(gen());
+    std::memcpy(id.data(), &w0, 8);
+    std::memcpy(id.data() + 8, &w1, 8);
+    std::memcpy(id.data() + 16, &w2, 4);
     return id;
 }
 
@@ -215,20 +286,30 @@ NodeID NodeDistance::fromHex(const std::string& hex) {
         throw std::runtime_error("Invalid hex string length for NodeID");
     }
 
+    // Nibble lookups straight off the input, as in utils::fromHex; the
+    // old substr + stoi pair allocated and parsed per byte
     NodeID id;
     for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
-        std::string byte_str = hex.substr(i * 2, 2);
-        id[i] = static_cast<uint8_t>(std::stoi(byte_str, nullptr, 16));
+        id[i] = static_cast<uint8_t>((hexNibble(hex[i * 2]) << 4) |
+                                     hexNibble(hex[i * 2 + 1]));
     }
     return id;
 }
 
 bool NodeDistance::less(const NodeID& a, const NodeID& b) {
-    for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
-        if (a[i] < b[i]) return true;
-        if (a[i] > b[i]) return false;
+    // Same word-wise compare as isCloser; big-endian loads preserve
+    // lexicographic byte order
+    uint64_t wa = load64be(a.data());
+    uint64_t wb = load64be(b.data());
+    if (wa != wb) {
+        return wa < wb;
+    }
+    wa = load64be(a.data() + 8);
+    wb = load64be(b.data() + 8);
+    if (wa != wb) {
+        return wa < wb;
     }
-    return false; // Equal
+    return load32be(a.data() + 16) < load32be(b.data() + 16);
 }
 
 } // namespace dht
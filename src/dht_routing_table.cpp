@@ -1,29 +1,149 @@
 #include "dht_routing_table.h"
 #include <algorithm>
+#include <cstring>
 #include <random>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace torrent {
 namespace dht {
 
+namespace {
+
+// XOR distance to the lookup target as three big-endian words plus the
+// bucket slot it came from: closest-node selection compares word tuples
+// instead of re-deriving 20-byte distances per comparison during a sort,
+// and only the winning slots are materialized into Nodes
+struct DistanceKey {
+    uint64_t hi;
+    uint64_t mid;
+    uint32_t lo;
+    const Bucket* bucket;
+    uint8_t slot;
+};
+
+uint64_t load64be(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return __builtin_bswap64(v);
+}
+
+uint32_t load32be(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+}
+
+DistanceKey makeDistanceKey(const NodeID& target, const Bucket& bucket,
+                            size_t slot) {
+    const uint8_t* t = target.data();
+    const uint8_t* n = bucket.idAt(slot).data();
+    return DistanceKey{load64be(t) ^ load64be(n),
+                       load64be(t + 8) ^ load64be(n + 8),
+                       load32be(t + 16) ^ load32be(n + 16),
+                       &bucket, static_cast<uint8_t>(slot)};
+}
+
+bool closerThan(const DistanceKey& a, const DistanceKey& b) {
+    if (a.hi != b.hi) {
+        return a.hi < b.hi;
+    }
+    if (a.mid != b.mid) {
+        return a.mid < b.mid;
+    }
+    return a.lo < b.lo;
+}
+
+} // namespace
+
 // Bucket implementation
 
+int Bucket::indexOf(const NodeID& id) const {
+    uint64_t needle;
+    std::memcpy(&needle, id.data(), 8);
+
+#if defined(__AVX2__)
+    // Compare the whole prefix column in two 4-lane equality tests; a
+    // set byte group in the mask names a candidate slot. Random 160-bit
+    // ids collide on 64-bit prefixes essentially never, so the 12-byte
+    // tail check runs at most once.
+    __m256i key = _mm256_set1_epi64x(static_cast<int64_t>(needle));
+    __m256i lo = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(id_prefix_.data()));
+    __m256i hi = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(id_prefix_.data() + 4));
+    uint64_t mask =
+        static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi64(lo, key))) |
+        (static_cast<uint64_t>(static_cast<uint32_t>(
+             _mm256_movemask_epi8(_mm256_cmpeq_epi64(hi, key)))) << 32);
+    while (mask != 0) {
+        size_t slot = static_cast<size_t>(__builtin_ctzll(mask)) >> 3;
+        // Unoccupied slots keep stale prefixes; the size_ guard filters them
+        if (slot < size_ &&
+            std::memcmp(id.data() + 8, ids_[slot].data() + 8, 12) == 0) {
+            return static_cast<int>(slot);
+        }
+        mask &= ~(UINT64_C(0xFF) << (slot * 8));
+    }
+    return -1;
+#else
+    for (size_t i = 0; i < size_; ++i) {
+        if (id_prefix_[i] == needle &&
+            std::memcmp(id.data() + 8, ids_[i].data() + 8, 12) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+#endif
+}
+
+void Bucket::storeSlot(size_t i, const Node& node) {
+    ids_[i] = node.id_;
+    std::memcpy(&id_prefix_[i], node.id_.data(), 8);
+    ports_[i] = node.port_;
+    status_and_seen_[i] = node.status_and_seen_;
+    failures_[i] = static_cast<uint8_t>(node.consecutive_failures_);
+    ips_[i] = node.ip_be_; // Already network byte order
+}
+
+void Bucket::moveToBack(size_t slot) {
+    // A "seen" refresh only rotates a few bytes of the order_ permutation;
+    // the node's columns stay where they are
+    size_t pos = 0;
+    while (order_[pos] != slot) {
+        ++pos;
+    }
+    std::rotate(order_.begin() + pos, order_.begin() + pos + 1,
+                order_.begin() + size_);
+}
+
+Node Bucket::materialize(size_t i) const {
+    Node node(ids_[i], ips_[i], ports_[i]);
+    node.status_and_seen_ = status_and_seen_[i];
+    node.consecutive_failures_ = failures_[i];
+    return node;
+}
+
 bool Bucket::addNode(const Node& node) {
-    // Check if node already exists
-    auto it = std::find_if(nodes_.begin(), nodes_.end(),
-        [&](const Node& n) { return n.id() == node.id(); });
-
-    if (it != nodes_.end()) {
-        // Node exists, move to back (most recently seen)
-        nodes_.erase(it);
-        nodes_.push_back(node);
+    int idx = indexOf(node.id());
+
+    if (idx >= 0) {
+        // Node exists: refresh in place and mark most recently seen
+        storeSlot(static_cast<size_t>(idx), node);
+        moveToBack(static_cast<size_t>(idx));
         last_changed_ = std::chrono::steady_clock::now();
         return true;
     }
 
     // Node doesn't exist
-    if (nodes_.size() < BUCKET_SIZE) {
-        // Bucket not full, add to back
-        nodes_.push_back(node);
+    if (size_ < BUCKET_SIZE) {
+        // Bucket not full: take the next free slot, most recently seen
+        storeSlot(size_, node);
+        order_[size_] = size_;
+        ++size_;
         last_changed_ = std::chrono::steady_clock::now();
         return true;
     }
@@ -32,15 +152,16 @@ bool Bucket::addNode(const Node& node) {
 }
 
 bool Bucket::updateNode(const NodeID& id) {
-    auto it = std::find_if(nodes_.begin(), nodes_.end(),
-        [&](const Node& n) { return n.id() == id; });
-
-    if (it != nodes_.end()) {
-        // Move to back (most recently seen)
-        Node node = *it;
-        node.updateLastSeen();
-        nodes_.erase(it);
-        nodes_.push_back(node);
+    int idx = indexOf(id);
+
+    if (idx >= 0) {
+        // Mark most recently seen
+        size_t i = static_cast<size_t>(idx);
+        moveToBack(i);
+        status_and_seen_[i] =
+            packStatusSeen(static_cast<NodeStatus>(status_and_seen_[i] &
+                                                   NODE_STATUS_MASK),
+                           steadyNowNs());
         return true;
     }
 
@@ -48,11 +169,33 @@ bool Bucket::updateNode(const NodeID& id) {
 }
 
 bool Bucket::removeNode(const NodeID& id) {
-    auto it = std::find_if(nodes_.begin(), nodes_.end(),
-        [&](const Node& n) { return n.id() == id; });
-
-    if (it != nodes_.end()) {
-        nodes_.erase(it);
+    int idx = indexOf(id);
+
+    if (idx >= 0) {
+        // Drop from the order, then keep the slots dense by moving the
+        // last slot's columns into the hole (one node, not a rotate)
+        size_t slot = static_cast<size_t>(idx);
+        size_t pos = 0;
+        while (order_[pos] != slot) {
+            ++pos;
+        }
+        std::copy(order_.begin() + pos + 1, order_.begin() + size_,
+                  order_.begin() + pos);
+        --size_;
+        if (slot != size_) {
+            ids_[slot] = ids_[size_];
+            id_prefix_[slot] = id_prefix_[size_];
+            ips_[slot] = ips_[size_];
+            ports_[slot] = ports_[size_];
+            status_and_seen_[slot] = status_and_seen_[size_];
+            failures_[slot] = failures_[size_];
+            for (size_t p = 0; p < size_; ++p) {
+                if (order_[p] == size_) {
+                    order_[p] = static_cast<uint8_t>(slot);
+                    break;
+                }
+            }
+        }
         last_changed_ = std::chrono::steady_clock::now();
         return true;
     }
@@ -61,35 +204,28 @@ bool Bucket::removeNode(const NodeID& id) {
 }
 
 std::optional<Node> Bucket::findNode(const NodeID& id) const {
-    auto it = std::find_if(nodes_.begin(), nodes_.end(),
-        [&](const Node& n) { return n.id() == id; });
-
-    if (it != nodes_.end()) {
-        return *it;
+    int idx = indexOf(id);
+    if (idx >= 0) {
+        return materialize(static_cast<size_t>(idx));
     }
 
     return std::nullopt;
 }
 
 std::vector<Node> Bucket::getNodes() const {
-    return std::vector<Node>(nodes_.begin(), nodes_.end());
-}
-
-std::vector<Node> Bucket::getGoodNodes() const {
-    std::vector<Node> good_nodes;
-    for (const auto& node : nodes_) {
-        if (node.isGood()) {
-            good_nodes.push_back(node);
-        }
+    std::vector<Node> nodes;
+    nodes.reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+        nodes.push_back(materialize(i));
     }
-    return good_nodes;
+    return nodes;
 }
 
 std::optional<Node> Bucket::getLeastRecentlySeen() const {
-    if (nodes_.empty()) {
+    if (size_ == 0) {
         return std::nullopt;
     }
-    return nodes_.front(); // Front is least recently seen
+    return materialize(order_[0]); // Front of the order is least recently seen
 }
 
 bool Bucket::needsRefresh() const {
@@ -174,47 +310,133 @@ std::optional<Node> RoutingTable::findNode(const NodeID& id) const {
 std::vector<Node> RoutingTable::findClosestNodes(const NodeID& target, size_t count) const {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    std::vector<Node> all_nodes;
-
-    // Collect all good nodes
-    for (const auto& bucket : buckets_) {
-        auto nodes = bucket.getGoodNodes();
-        all_nodes.insert(all_nodes.end(), nodes.begin(), nodes.end());
+    // Bounded selection: scan the buckets in place, keeping the count
+    // closest candidates in a max-heap keyed on precomputed distance
+    // words (top = farthest kept). A full table is ~1280 nodes, so this
+    // replaces copying every Node and sorting them all with one linear
+    // pass; only the winners are copied out.
+    if (count == 0) {
+        return {};
     }
 
-    // If we don't have enough good nodes, add questionable ones
-    if (all_nodes.size() < count) {
-        for (const auto& bucket : buckets_) {
-            auto nodes = bucket.getNodes();
-            for (const auto& node : nodes) {
-                if (node.isQuestionable()) {
-                    all_nodes.push_back(node);
+    std::vector<DistanceKey> heap;
+    heap.reserve(count);
+
+    auto consider = [&](const Bucket& bucket, size_t slot) {
+        // Once the heap is full, most candidates lose on the first
+        // distance word alone: reject on that one XOR before loading and
+        // byte-swapping the other twelve bytes or touching the heap
+        if (heap.size() == count) {
+            uint64_t hi = load64be(target.data()) ^
+                          load64be(bucket.idAt(slot).data());
+            if (hi > heap.front().hi) {
+                return;
+            }
+        }
+        DistanceKey key = makeDistanceKey(target, bucket, slot);
+        if (heap.size() < count) {
+            heap.push_back(key);
+            std::push_heap(heap.begin(), heap.end(), closerThan);
+        } else if (closerThan(key, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), closerThan);
+            heap.back() = key;
+            std::push_heap(heap.begin(), heap.end(), closerThan);
+        }
+    };
+
+    // Buckets are visited in order of their distance floor to the
+    // target instead of 0..159. With home = bucketIndex(our_id, target):
+    // bucket `home` holds the only nodes that agree with the target at
+    // bit `home` (distance < 2^(159-home)); every bucket above `home`
+    // holds nodes differing from the target exactly at bit `home`
+    // (distance >= 2^(159-home)); bucket b below `home` holds nodes at
+    // distance >= 2^(159-b), growing as b drops. So once the heap is
+    // full, a whole group can be skipped when the farthest kept
+    // candidate already beats its floor — on a populated table the walk
+    // ends after one or two buckets instead of touching all 160.
+    const int home = NodeDistance::bucketIndex(our_id_, target);
+
+    // True when every node at or below bucket b's distance floor
+    // 2^(159-b) loses to the farthest candidate we are keeping, i.e.
+    // the front's distance has more than b leading zeros
+    auto floorBeaten = [&](int b) {
+        if (heap.size() < count) {
+            return false;
+        }
+        const DistanceKey& f = heap.front();
+        int clz = f.hi  ? __builtin_clzll(f.hi)
+                : f.mid ? 64 + __builtin_clzll(f.mid)
+                : f.lo  ? 128 + __builtin_clz(f.lo)
+                        : 160;
+        return clz > b;
+    };
+
+    auto orderedScan = [&](auto&& keep) {
+        auto scanBucket = [&](int b) {
+            const Bucket& bucket = buckets_[b];
+            for (size_t i = 0; i < bucket.size(); ++i) {
+                if (keep(bucket, i)) {
+                    consider(bucket, i);
                 }
             }
+        };
+
+        scanBucket(home);
+        if (!floorBeaten(home)) {
+            // All of these share the 2^(159-home) floor; their index
+            // says nothing further about distance, so no cutoff between
+            // them
+            for (int b = home + 1; b < static_cast<int>(NUM_BUCKETS); ++b) {
+                scanBucket(b);
+            }
+        }
+        for (int b = home - 1; b >= 0; --b) {
+            if (floorBeaten(b)) {
+                break;
+            }
+            scanBucket(b);
         }
+    };
+
+    // Good nodes first (one clock read for the whole walk); fall back to
+    // questionable ones only if the good walk could not fill the heap
+    uint64_t now_ns = steadyNowNs();
+    orderedScan([&](const Bucket& bucket, size_t i) {
+        return bucket.goodAt(i, now_ns);
+    });
+    if (heap.size() < count) {
+        orderedScan([&](const Bucket& bucket, size_t i) {
+            return bucket.questionableAt(i, now_ns);
+        });
     }
 
-    // Sort by distance to target
-    std::sort(all_nodes.begin(), all_nodes.end(),
-        [&](const Node& a, const Node& b) {
-            return NodeDistance::isCloser(target, a.id(), b.id());
-        });
+    // Closest first
+    std::sort_heap(heap.begin(), heap.end(), closerThan);
 
-    // Return up to 'count' closest nodes
-    if (all_nodes.size() > count) {
-        all_nodes.resize(count);
+    std::vector<Node> result;
+    result.reserve(heap.size());
+    for (const auto& key : heap) {
+        result.push_back(key.bucket->materialize(key.slot));
     }
-
-    return all_nodes;
+    return result;
 }
 
 std::vector<Node> RoutingTable::getAllNodes() const {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    // Size the result in one pass, then materialize straight into it —
+    // no per-bucket temporaries, no reallocation growth
+    size_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.size();
+    }
+
     std::vector<Node> all_nodes;
+    all_nodes.reserve(total);
     for (const auto& bucket : buckets_) {
-        auto nodes = bucket.getNodes();
-        all_nodes.insert(all_nodes.end(), nodes.begin(), nodes.end());
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            all_nodes.push_back(bucket.materialize(i));
+        }
     }
 
     return all_nodes;
@@ -223,10 +445,21 @@ std::vector<Node> RoutingTable::getAllNodes() const {
 std::vector<Node> RoutingTable::getGoodNodes() const {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    // Total node count is a safe upper bound for the good subset
+    size_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.size();
+    }
+
     std::vector<Node> good_nodes;
+    good_nodes.reserve(total);
+    uint64_t now_ns = steadyNowNs();
     for (const auto& bucket : buckets_) {
-        auto nodes = bucket.getGoodNodes();
-        good_nodes.insert(good_nodes.end(), nodes.begin(), nodes.end());
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            if (bucket.goodAt(i, now_ns)) {
+                good_nodes.push_back(bucket.materialize(i));
+            }
+        }
     }
 
     return good_nodes;
@@ -305,10 +538,14 @@ void RoutingTable::cleanupBadNodes() {
     std::lock_guard<std::mutex> lock(mutex_);
 
     for (auto& bucket : buckets_) {
-        auto nodes = bucket.getNodes();
-        for (const auto& node : nodes) {
-            if (node.isBad()) {
-                bucket.removeNode(node.id());
+        // Straight off the status/failure columns; removal swaps the
+        // last slot into the hole, so only advance on a keep
+        size_t i = 0;
+        while (i < bucket.size()) {
+            if (bucket.badAt(i)) {
+                bucket.removeNode(bucket.idAt(i));
+            } else {
+                ++i;
             }
         }
     }
@@ -319,19 +556,21 @@ RoutingTable::Stats RoutingTable::getStats() const {
 
     Stats stats;
 
+    // Classify straight off the packed columns with one clock read for
+    // the whole table; no Node materialization for a pure count
+    uint64_t now_ns = steadyNowNs();
     for (const auto& bucket : buckets_) {
-        auto nodes = bucket.getNodes();
-        if (!nodes.empty()) {
+        if (bucket.size() > 0) {
             stats.filled_buckets++;
         }
 
-        for (const auto& node : nodes) {
+        for (size_t i = 0; i < bucket.size(); ++i) {
             stats.total_nodes++;
-            if (node.isGood()) {
+            if (bucket.goodAt(i, now_ns)) {
                 stats.good_nodes++;
-            } else if (node.isQuestionable()) {
+            } else if (bucket.questionableAt(i, now_ns)) {
                 stats.questionable_nodes++;
-            } else if (node.isBad()) {
+            } else if (bucket.badAt(i)) {
                 stats.bad_nodes++;
             }
         }
@@ -347,24 +586,22 @@ int RoutingTable::getBucketIndex(const NodeID& id) const {
 bool RoutingTable::tryReplaceNode(int bucket_index, const Node& new_node) {
     Bucket& bucket = buckets_[bucket_index];
 
-    // Get all nodes in bucket
-    auto nodes = bucket.getNodes();
-
     // Try to find a bad node to replace
-    for (const auto& node : nodes) {
-        if (node.isBad()) {
-            bucket.removeNode(node.id());
+    for (size_t i = 0; i < bucket.size(); ++i) {
+        if (bucket.badAt(i)) {
+            bucket.removeNode(bucket.idAt(i));
             bucket.addNode(new_node);
             return true;
         }
     }
 
     // Try to find a questionable node to replace
-    for (const auto& node : nodes) {
-        if (node.isQuestionable()) {
+    uint64_t now_ns = steadyNowNs();
+    for (size_t i = 0; i < bucket.size(); ++i) {
+        if (bucket.questionableAt(i, now_ns)) {
             // In real implementation, we should ping the questionable node first
             // For now, just replace it
-            bucket.removeNode(node.id());
+            bucket.removeNode(bucket.idAt(i));
             bucket.addNode(new_node);
             return true;
         }
@@ -0,0 +1,215 @@
+#include "dht_udp_batcher.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace torrent {
+namespace dht {
+
+UdpBatcher::UdpBatcher(int socket_fd)
+    : socket_fd_(socket_fd),
+      send_slab_(kQueueSize * kSlotSize),
+      send_lengths_(kQueueSize),
+      send_addrs_(kQueueSize),
+      send_seq_(new std::atomic<uint32_t>[kQueueSize]),
+      recv_slab_(kBatchSize * kSlotSize) {
+    for (size_t i = 0; i < kQueueSize; ++i) {
+        send_seq_[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+    }
+#if defined(__linux__)
+    // Wire the receive scatter arrays to the slab once; receiveBatch only
+    // has to repair the fields the kernel rewrites
+    recv_msgs_.resize(kBatchSize);
+    recv_iovs_.resize(kBatchSize);
+    recv_addrs_.resize(kBatchSize);
+    std::memset(recv_msgs_.data(), 0, kBatchSize * sizeof(struct mmsghdr));
+    for (size_t i = 0; i < kBatchSize; ++i) {
+        recv_iovs_[i].iov_base = recv_slab_.data() + i * kSlotSize;
+        recv_iovs_[i].iov_len = kSlotSize;
+        recv_msgs_[i].msg_hdr.msg_iov = &recv_iovs_[i];
+        recv_msgs_[i].msg_hdr.msg_iovlen = 1;
+        recv_msgs_[i].msg_hdr.msg_name = &recv_addrs_[i];
+        recv_msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+#endif
+}
+
+bool UdpBatcher::queueSend(const uint8_t* data, size_t length,
+                           const struct sockaddr_in& addr) {
+    // Oversized datagrams skip the slab; nothing in KRPC gets near this
+    if (length > kSlotSize) {
+        int sent = sendto(socket_fd_, (const char*)data, length, 0,
+                          (const struct sockaddr*)&addr, sizeof(addr));
+        return sent == static_cast<int>(length);
+    }
+
+    constexpr uint32_t kMask = kQueueSize - 1;
+
+    // Claim a slot: CAS on head_, with the slot's sequence number telling
+    // us whether it has been recycled yet (seq == pos) or the ring is a
+    // full lap behind (seq < pos)
+    uint32_t pos = send_head_.load(std::memory_order_relaxed);
+    for (;;) {
+        std::atomic<uint32_t>& seq = send_seq_[pos & kMask];
+        int32_t dif = static_cast<int32_t>(seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0) {
+            if (send_head_.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            // Ring full: the network thread is a whole lap behind. Send
+            // directly rather than block the producer; ordering within a
+            // UDP stream is meaningless anyway.
+            int sent = sendto(socket_fd_, (const char*)data, length, 0,
+                              (const struct sockaddr*)&addr, sizeof(addr));
+            return sent == static_cast<int>(length);
+        } else {
+            pos = send_head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t slot = pos & kMask;
+    std::memcpy(send_slab_.data() + slot * kSlotSize, data, length);
+    send_lengths_[slot] = length;
+    send_addrs_[slot] = addr;
+    // Publish: the consumer's acquire load of the sequence pairs with
+    // this release, making the slot contents visible
+    send_seq_[slot].store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+size_t UdpBatcher::flush() {
+    constexpr uint32_t kMask = kQueueSize - 1;
+    size_t total = 0;
+
+    for (;;) {
+        // Gather the contiguous run of published slots, one batch at a time
+        size_t count = 0;
+        while (count < kBatchSize) {
+            uint32_t pos = send_tail_ + static_cast<uint32_t>(count);
+            uint32_t seq = send_seq_[pos & kMask].load(std::memory_order_acquire);
+            if (seq != pos + 1) {
+                break;
+            }
+            ++count;
+        }
+        if (count == 0) {
+            return total;
+        }
+
+#if defined(__linux__)
+        struct mmsghdr msgs[kBatchSize];
+        struct iovec iovs[kBatchSize];
+        std::memset(msgs, 0, sizeof(mmsghdr) * count);
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t slot = (send_tail_ + i) & kMask;
+            iovs[i].iov_base = send_slab_.data() + slot * kSlotSize;
+            iovs[i].iov_len = send_lengths_[slot];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &send_addrs_[slot];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+
+        // The kernel may accept fewer than requested; retry the tail so a
+        // partial sendmmsg does not silently drop queries
+        size_t offset = 0;
+        while (offset < count) {
+            int n = sendmmsg(socket_fd_, msgs + offset,
+                             static_cast<unsigned int>(count - offset), 0);
+            if (n <= 0) {
+                break;
+            }
+            offset += static_cast<size_t>(n);
+        }
+        total += offset;
+#else
+        for (size_t i = 0; i < count; ++i) {
+            size_t slot = (send_tail_ + i) & kMask;
+            int n = sendto(socket_fd_,
+                           (const char*)(send_slab_.data() + slot * kSlotSize),
+                           send_lengths_[slot], 0,
+                           (const struct sockaddr*)&send_addrs_[slot],
+                           sizeof(struct sockaddr_in));
+            if (n == static_cast<int>(send_lengths_[slot])) {
+                ++total;
+            }
+        }
+#endif
+
+        // Recycle the drained slots so producers a lap ahead can claim them
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t pos = send_tail_ + static_cast<uint32_t>(i);
+            send_seq_[pos & kMask].store(pos + kQueueSize,
+                                         std::memory_order_release);
+        }
+        send_tail_ += static_cast<uint32_t>(count);
+
+        if (count < kBatchSize) {
+            return total;
+        }
+    }
+}
+
+size_t UdpBatcher::receiveBatch(std::vector<Datagram>& out, int timeout_ms) {
+    out.clear();
+
+    // Wait for readability on the non-blocking socket; the timeout doubles
+    // as the network loop's tick
+#ifdef _WIN32
+    WSAPOLLFD pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    if (WSAPoll(&pfd, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+#else
+    struct pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+#endif
+
+#if defined(__linux__)
+    int n = recvmmsg(socket_fd_, recv_msgs_.data(), kBatchSize, 0, nullptr);
+    if (n <= 0) {
+        return 0;
+    }
+
+    out.reserve(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        Datagram dg;
+        dg.data = recv_slab_.data() + i * kSlotSize;
+        dg.length = recv_msgs_[i].msg_len;
+        dg.from = recv_addrs_[i];
+        // Restore what the kernel rewrote so the slot is ready for reuse
+        recv_msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        out.push_back(dg);
+    }
+    return static_cast<size_t>(n);
+#else
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int n = recvfrom(socket_fd_, (char*)recv_slab_.data(), kSlotSize, 0,
+                     (struct sockaddr*)&from, &from_len);
+    if (n <= 0) {
+        return 0;
+    }
+    Datagram dg;
+    dg.data = recv_slab_.data();
+    dg.length = static_cast<size_t>(n);
+    dg.from = from;
+    out.push_back(dg);
+    return 1;
+#endif
+}
+
+} // namespace dht
+} // namespace torrent
@@ -1,9 +1,11 @@
 #include "download_manager.h"
 #include "utils.h"
+#include "logger.h"
 #include "pex_manager.h"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <cstdio>
 #include <thread>
 
 namespace torrent {
@@ -48,6 +50,7 @@ DownloadManager::DownloadManager(const std::string& torrent_path,
         torrent_.totalLength(),
         torrent_.pieces()
     );
+    pieces_in_download_.resize(torrent_.numPieces());
 
     file_manager_ = std::make_unique<FileManager>(torrent_, download_dir_);
 
@@ -130,6 +133,7 @@ DownloadManager::DownloadManager(const TorrentFile& torrent_file,
         torrent_.totalLength(),
         torrent_.pieces()
     );
+    pieces_in_download_.resize(torrent_.numPieces());
 
     file_manager_ = std::make_unique<FileManager>(torrent_, download_dir_);
 
@@ -218,10 +222,13 @@ void DownloadManager::start() {
         lsd_manager_->start();
         // Set callback for discovered peers
         lsd_manager_->setPeerCallback([this](const std::vector<LSDPeer>& peers) {
+            // Runs on the LSD receive thread: grow once, then construct
+            // in place, so a discovery burst can't reallocate repeatedly
+            // while holding peers_mutex_
             std::lock_guard<std::mutex> lock(peers_mutex_);
+            available_peers_.reserve(available_peers_.size() + peers.size());
             for (const auto& lsd_peer : peers) {
-                Peer peer(lsd_peer.ip, lsd_peer.port);
-                available_peers_.push_back(peer);
+                available_peers_.emplace_back(lsd_peer.ip, lsd_peer.port);
             }
         });
         // Announce our torrent
@@ -345,6 +352,8 @@ void DownloadManager::stop() {
     {
         std::lock_guard<std::mutex> lock(peers_mutex_);
         active_peers_.clear();
+        active_peer_count_.store(0, std::memory_order_relaxed);
+        downloading_peer_count_.store(0, std::memory_order_relaxed);
     }
 
     std::cout << "Client stopped.\n";
@@ -371,27 +380,27 @@ int64_t DownloadManager::uploadSpeed() const {
 }
 
 void DownloadManager::printStatus() const {
-    size_t active_peer_count = 0;
-    size_t downloading_peers = 0;
-
-    {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        active_peer_count = active_peers_.size();
-        for (const auto& peer : active_peers_) {
-            if (peer.current_piece != UINT32_MAX) {
-                downloading_peers++;
-            }
-        }
+    // Mirrored counters: the status refresh neither takes peers_mutex_
+    // nor walks the PeerInfo vector
+    size_t active_peer_count = active_peer_count_.load(std::memory_order_relaxed);
+    size_t downloading_peers = downloading_peer_count_.load(std::memory_order_relaxed);
+
+    // One formatted write instead of a dozen operator<< calls, so the
+    // status line can't interleave with log output mid-line
+    char line[160];
+    int len = std::snprintf(
+        line, sizeof(line),
+        "\r[Progress: %.2f%%] Down: %s Up: %s Peers: %zu (%zu active)%s%s   ",
+        progress(),
+        utils::formatSpeed(downloadSpeed()).c_str(),
+        utils::formatSpeed(uploadSpeed()).c_str(),
+        active_peer_count, downloading_peers,
+        seeding_mode_ ? " [SEEDING]" : "",
+        endgame_mode_ ? " [ENDGAME]" : "");
+    if (len > 0) {
+        std::cout.write(line, std::min(len, static_cast<int>(sizeof(line) - 1)));
+        std::cout.flush();
     }
-
-    std::cout << "\r[Progress: " << std::fixed << std::setprecision(2)
-              << progress() << "%] "
-              << "Down: " << utils::formatSpeed(downloadSpeed()) << " "
-              << "Up: " << utils::formatSpeed(uploadSpeed()) << " "
-              << "Peers: " << active_peer_count << " (" << downloading_peers << " active)"
-              << (seeding_mode_ ? " [SEEDING]" : "")
-              << (endgame_mode_ ? " [ENDGAME]" : "")
-              << "   " << std::flush;
 }
 
 void DownloadManager::downloadLoop() {
@@ -490,6 +499,9 @@ void DownloadManager::peerLoop(size_t peer_index) {
     // Initialize peer bitfield
     connection->initializePeerBitfield(torrent_.numPieces());
 
+    // Let PIECE payloads land straight in the in-progress piece buffers
+    connection->attachPieceManager(piece_manager_.get());
+
     // Add to connections list
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
@@ -509,9 +521,9 @@ void DownloadManager::peerLoop(size_t peer_index) {
         return;
     }
 
-    // Perform handshake with our bitfield
-    std::vector<bool> our_bitfield = piece_manager_->getBitfield();
-    if (!conn_ptr->performHandshake(our_bitfield)) {
+    // Perform handshake with our pre-framed bitfield message
+    std::vector<uint8_t> our_bitfield_frame = piece_manager_->bitfieldMessage();
+    if (!conn_ptr->performHandshake(our_bitfield_frame)) {
         std::cerr << "Failed to perform handshake with " << peer.ip << ":" << peer.port << "\n";
         return;
     }
@@ -537,10 +549,17 @@ void DownloadManager::peerLoop(size_t peer_index) {
             break;
         }
 
+        // Park for data with a 1s tick so the keep-alive and idle
+        // deadlines above still run on a quiet link; when traffic is
+        // flowing this returns immediately off buffered bytes
+        if (!conn_ptr->waitForMessage(1000)) {
+            continue;
+        }
+
         // Receive and process messages
         auto message = conn_ptr->receiveMessage();
         if (!message) {
-            std::cerr << "Connection closed or timeout from peer " << peer.ip << ":" << peer.port << "\n";
+            LOG_WARN("Connection closed or timeout from peer {}:{}", peer.ip, peer.port);
             break;
         }
 
@@ -549,17 +568,15 @@ void DownloadManager::peerLoop(size_t peer_index) {
 
         // Check if we're interested in this peer
         if (!conn_ptr->amInterested()) {
-            // Check if peer has pieces we need
-            bool has_needed_pieces = false;
-            for (uint32_t i = 0; i < torrent_.numPieces(); ++i) {
-                if (!piece_manager_->hasPiece(i) && conn_ptr->peerHasPiece(i)) {
-                    has_needed_pieces = true;
-                    break;
-                }
-            }
-
-            if (has_needed_pieces) {
-                std::cout << "Sending INTERESTED to " << peer.ip << "\n";
+            // Check if peer has pieces we need: one fused AND+popcount
+            // over the packed words instead of a per-piece
+            // hasPiece/peerHasPiece loop
+            size_t needed_pieces = countInteresting(
+                piece_manager_->getBitfieldWords(), conn_ptr->peerBitfieldWords());
+
+            if (needed_pieces > 0) {
+                LOG_DEBUG("Sending INTERESTED to {} ({} pieces we need)",
+                          peer.ip, needed_pieces);
                 conn_ptr->sendInterested();
             }
         }
@@ -567,13 +584,13 @@ void DownloadManager::peerLoop(size_t peer_index) {
         // If we can download, request pieces
         if (conn_ptr->canDownload() && !conn_ptr->hasPendingRequests()) {
             // Get next piece to download
-            int32_t next_piece = piece_manager_->getNextPiece(conn_ptr->peerBitfield());
+            int32_t next_piece = piece_manager_->getNextPiece(conn_ptr->peerBitfieldPacked());
 
             if (next_piece >= 0) {
-                std::cout << "Requesting piece #" << next_piece << " from " << peer.ip << "\n";
+                LOG_DEBUG("Requesting piece #{} from {}", next_piece, peer.ip);
 
                 // Get blocks for this piece
-                std::vector<Block> blocks = piece_manager_->getBlocksForPiece(next_piece);
+                BlockList blocks = piece_manager_->getBlocksForPiece(next_piece);
 
                 // Request the piece
                 conn_ptr->requestPiece(next_piece, blocks);
@@ -583,18 +600,18 @@ void DownloadManager::peerLoop(size_t peer_index) {
         // Handle timed out requests
         auto timed_out = conn_ptr->getTimedOutRequests(30);
         if (!timed_out.empty()) {
-            std::cout << "Detected " << timed_out.size() << " timed out requests from " << peer.ip << "\n";
+            LOG_DEBUG("Detected {} timed out requests from {}", timed_out.size(), peer.ip);
 
             // Retry timed out requests
             for (const auto& req : timed_out) {
-                std::cout << "Retrying timed out request: piece=" << req.piece_index
-                          << " offset=" << req.offset << " length=" << req.length << "\n";
+                LOG_DEBUG("Retrying timed out request: piece={} offset={} length={}",
+                          req.piece_index, req.offset, req.length);
 
                 // Retry the request
                 if (conn_ptr->requestBlock(req.piece_index, req.offset, req.length)) {
-                    std::cout << "Successfully re-requested block\n";
+                    LOG_TRACE("Successfully re-requested block");
                 } else {
-                    std::cerr << "Failed to re-request block (peer may be choking us)\n";
+                    LOG_WARN("Failed to re-request block (peer may be choking us)");
                     // Note: If retry fails, coordinatorLoop will eventually reassign to another peer
                 }
             }
@@ -604,43 +621,50 @@ void DownloadManager::peerLoop(size_t peer_index) {
         if (message->type == MessageType::PIECE) {
             PieceMessage piece_msg;
             if (conn_ptr->parsePiece(*message, piece_msg)) {
-                std::cout << "Received piece data: piece=" << piece_msg.piece_index
-                          << " offset=" << piece_msg.offset
-                          << " size=" << piece_msg.data.size() << "\n";
+                LOG_TRACE("Received piece data: piece={} offset={} size={}",
+                          piece_msg.piece_index, piece_msg.offset, piece_msg.length);
 
                 // Apply download rate limiting
-                download_limiter_.waitAndConsume(piece_msg.data.size());
+                download_limiter_.waitAndConsume(piece_msg.length);
+
+                // Add block to piece manager (zero-copy receives are already
+                // committed to the piece buffer by receiveMessage)
+                if (!piece_msg.data.empty() || piece_msg.length == 0) {
+                    piece_manager_->addBlock(piece_msg.piece_index, piece_msg.offset, piece_msg.data);
+                }
 
-                // Add block to piece manager
-                piece_manager_->addBlock(piece_msg.piece_index, piece_msg.offset, piece_msg.data);
+                // Endgame issues the same block to several peers; once
+                // one delivers, cancel it everywhere else so the tail of
+                // the download isn't spent receiving duplicates
+                if (endgame_mode_) {
+                    broadcastCancel(piece_msg.piece_index, piece_msg.offset,
+                                    piece_msg.length, conn_ptr);
+                }
 
                 // Update statistics
-                total_downloaded_ += piece_msg.data.size();
-                download_tracker_.addBytes(piece_msg.data.size());
+                total_downloaded_ += piece_msg.length;
+                download_tracker_.addBytes(piece_msg.length);
 
                 // Check if piece is complete
                 if (piece_manager_->isPieceInProgress(piece_msg.piece_index)) {
                     PieceInProgress* piece = piece_manager_->getPieceInProgress(piece_msg.piece_index);
                     if (piece && piece->isComplete()) {
-                        std::cout << "\n========== PIECE COMPLETE ==========\n";
-                        std::cout << "All blocks received for piece " << piece_msg.piece_index << "\n";
+                        LOG_DEBUG("All blocks received for piece {}", piece_msg.piece_index);
 
                         // Complete the piece (verify and write to disk)
                         if (piece_manager_->completePiece(piece_msg.piece_index, file_manager_.get())) {
-                            std::cout << "SUCCESS: Piece " << piece_msg.piece_index << " verified and saved!\n";
+                            LOG_INFO("Piece {} verified and saved", piece_msg.piece_index);
 
                             // Send HAVE message to all connected peers
                             broadcastHave(piece_msg.piece_index);
-
-                            std::cout << "===================================\n\n";
                         } else {
-                            std::cerr << "FAILED: Piece " << piece_msg.piece_index << " verification or write failed\n";
-                            std::cerr << "Marking piece for re-download\n";
+                            LOG_ERROR("Piece {} verification or write failed; marking for re-download",
+                                      piece_msg.piece_index);
 
                             // Remove from pieces_in_download so it can be reassigned
                             {
                                 std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
-                                pieces_in_download_.erase(piece_msg.piece_index);
+                                pieces_in_download_.reset(piece_msg.piece_index);
                             }
 
                             // Clear current_piece assignment from peer
@@ -649,13 +673,15 @@ void DownloadManager::peerLoop(size_t peer_index) {
                                 for (auto& peer_info : active_peers_) {
                                     if (peer_info.current_piece == piece_msg.piece_index) {
                                         peer_info.current_piece = UINT32_MAX;
+                                        downloading_peer_count_.fetch_sub(1, std::memory_order_relaxed);
                                         peer_info.failed_requests++;
                                         break;
                                     }
                                 }
                             }
 
-                            std::cout << "Piece " << piece_msg.piece_index << " will be re-requested from another peer\n";
+                            LOG_INFO("Piece {} will be re-requested from another peer",
+                                     piece_msg.piece_index);
                         }
                     }
                 }
@@ -666,70 +692,84 @@ void DownloadManager::peerLoop(size_t peer_index) {
         if (message->type == MessageType::REQUEST) {
             RequestMessage req_msg;
             if (conn_ptr->parseRequest(*message, req_msg)) {
-                std::cout << "Peer " << peer.ip << " requests: piece=" << req_msg.piece_index
-                          << " offset=" << req_msg.offset
-                          << " length=" << req_msg.length << "\n";
+                LOG_TRACE("Peer {} requests: piece={} offset={} length={}",
+                          peer.ip, req_msg.piece_index, req_msg.offset, req_msg.length);
 
                 // Check if we're choking this peer
                 if (conn_ptr->amChoking()) {
-                    std::cout << "Ignoring REQUEST: we are choking this peer\n";
+                    LOG_DEBUG("Ignoring REQUEST: we are choking this peer");
                 }
                 // Check if we have the requested piece
                 else if (!piece_manager_->hasPiece(req_msg.piece_index)) {
-                    std::cout << "Ignoring REQUEST: we don't have piece " << req_msg.piece_index << "\n";
+                    LOG_DEBUG("Ignoring REQUEST: we don't have piece {}", req_msg.piece_index);
                 }
                 // Validate request parameters
                 else if (req_msg.length == 0 || req_msg.length > 16384) {
-                    std::cerr << "Invalid REQUEST: length=" << req_msg.length << " (max 16384)\n";
+                    LOG_WARN("Invalid REQUEST: length={} (max 16384)", req_msg.length);
                 }
                 else {
-                    // Read the complete piece from disk
-                    std::vector<uint8_t> piece_data = file_manager_->readPiece(req_msg.piece_index);
-
-                    if (piece_data.empty()) {
-                        std::cerr << "Failed to read piece " << req_msg.piece_index << " from disk\n";
-                    }
-                    // Validate offset and length
-                    else if (req_msg.offset + req_msg.length > piece_data.size()) {
-                        std::cerr << "Invalid REQUEST: offset=" << req_msg.offset
-                                  << " length=" << req_msg.length
-                                  << " exceeds piece size " << piece_data.size() << "\n";
+                    // Zero-copy path: when the block lies inside one file,
+                    // skip the whole-piece read and let sendPiece stream it
+                    // from the page cache straight to the socket. Blocks
+                    // spanning a file boundary fall back to the buffered
+                    // read below. locateBlock bounds-checks the range
+                    // against the torrent, which covers the piece-size
+                    // validation the buffered path does explicitly.
+                    int block_fd = -1;
+                    int64_t block_off = 0;
+                    bool have_fd_source = file_manager_->locateBlock(
+                        req_msg.piece_index, req_msg.offset, req_msg.length,
+                        block_fd, block_off);
+
+                    std::vector<uint8_t> block_data;
+                    if (!have_fd_source) {
+                        // Block spans a file boundary: read just the
+                        // requested range across the touched files
+                        // instead of the whole piece. readBlock
+                        // bounds-checks against the piece size.
+                        block_data.resize(req_msg.length);
+                        if (!file_manager_->readBlock(req_msg.piece_index,
+                                                      req_msg.offset,
+                                                      req_msg.length,
+                                                      block_data.data())) {
+                            LOG_ERROR("Failed to read block: piece={} offset={} length={}",
+                                      req_msg.piece_index, req_msg.offset, req_msg.length);
+                            block_data.clear();
+                        }
                     }
-                    else {
-                        // Extract the requested block
-                        std::vector<uint8_t> block_data(
-                            piece_data.begin() + req_msg.offset,
-                            piece_data.begin() + req_msg.offset + req_msg.length
-                        );
 
+                    if (have_fd_source || !block_data.empty()) {
                         // Track this upload
                         conn_ptr->addPendingUpload(req_msg.piece_index, req_msg.offset, req_msg.length);
 
                         // Apply upload rate limiting
-                        upload_limiter_.waitAndConsume(block_data.size());
+                        upload_limiter_.waitAndConsume(req_msg.length);
 
                         // Send PIECE message
-                        if (conn_ptr->sendPiece(req_msg.piece_index, req_msg.offset, block_data)) {
-                            std::cout << "Uploaded block: piece=" << req_msg.piece_index
-                                      << " offset=" << req_msg.offset
-                                      << " size=" << block_data.size() << " bytes to " << peer.ip << "\n";
+                        bool sent = have_fd_source
+                            ? conn_ptr->sendPiece(req_msg.piece_index, req_msg.offset,
+                                                  block_fd, block_off, req_msg.length)
+                            : conn_ptr->sendPiece(req_msg.piece_index, req_msg.offset, block_data);
+                        if (sent) {
+                            LOG_TRACE("Uploaded block: piece={} offset={} size={} bytes to {}",
+                                      req_msg.piece_index, req_msg.offset, req_msg.length, peer.ip);
 
                             // Update upload statistics
-                            total_uploaded_ += block_data.size();
-                            upload_tracker_.addBytes(block_data.size());
+                            total_uploaded_ += req_msg.length;
+                            upload_tracker_.addBytes(req_msg.length);
 
                             // Update peer statistics
                             {
                                 std::lock_guard<std::mutex> lock(peers_mutex_);
                                 if (peer_index < active_peers_.size()) {
-                                    active_peers_[peer_index].bytes_uploaded += block_data.size();
+                                    active_peers_[peer_index].bytes_uploaded += req_msg.length;
                                 }
                             }
 
                             // Remove from pending uploads
                             conn_ptr->removePendingUpload(req_msg.piece_index, req_msg.offset);
                         } else {
-                            std::cerr << "Failed to send PIECE message to " << peer.ip << "\n";
+                            LOG_WARN("Failed to send PIECE message to {}", peer.ip);
                             conn_ptr->removePendingUpload(req_msg.piece_index, req_msg.offset);
                         }
                     }
@@ -741,23 +781,20 @@ void DownloadManager::peerLoop(size_t peer_index) {
         if (message->type == MessageType::CANCEL) {
             CancelMessage cancel_msg;
             if (conn_ptr->parseCancel(*message, cancel_msg)) {
-                std::cout << "Peer " << peer.ip << " cancels: piece=" << cancel_msg.piece_index
-                          << " offset=" << cancel_msg.offset
-                          << " length=" << cancel_msg.length << "\n";
+                LOG_TRACE("Peer {} cancels: piece={} offset={} length={}",
+                          peer.ip, cancel_msg.piece_index, cancel_msg.offset, cancel_msg.length);
 
                 // Remove from pending uploads if present
                 if (conn_ptr->isPendingUpload(cancel_msg.piece_index, cancel_msg.offset)) {
                     conn_ptr->removePendingUpload(cancel_msg.piece_index, cancel_msg.offset);
-                    std::cout << "Cancelled pending upload: piece=" << cancel_msg.piece_index
-                              << " offset=" << cancel_msg.offset << "\n";
+                    LOG_TRACE("Cancelled pending upload: piece={} offset={}",
+                              cancel_msg.piece_index, cancel_msg.offset);
                 } else {
-                    std::cout << "No pending upload found for cancellation\n";
+                    LOG_TRACE("No pending upload found for cancellation");
                 }
             }
         }
 
-        // Small sleep to prevent busy loop
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
     // Graceful cleanup on peer disconnection
@@ -784,10 +821,11 @@ void DownloadManager::peerLoop(size_t peer_index) {
                     // Remove from pieces_in_download so it can be reassigned
                     {
                         std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
-                        pieces_in_download_.erase(peer_info.current_piece);
+                        pieces_in_download_.reset(peer_info.current_piece);
                     }
 
                     peer_info.current_piece = UINT32_MAX;
+                    downloading_peer_count_.fetch_sub(1, std::memory_order_relaxed);
                 }
                 break;
             }
@@ -826,21 +864,26 @@ void DownloadManager::connectToPeers() {
         }
 
         connection->initializePeerBitfield(torrent_.numPieces());
+        connection->attachPieceManager(piece_manager_.get());
 
-        std::vector<bool> our_bitfield = piece_manager_->getBitfield();
-        if (!connection->performHandshake(our_bitfield)) {
+        std::vector<uint8_t> our_bitfield_frame = piece_manager_->bitfieldMessage();
+        if (!connection->performHandshake(our_bitfield_frame)) {
             std::cerr << "Failed handshake with " << peer.ip << "\n";
             continue;
         }
 
+        // Cork the post-handshake burst: the Fast Extension frames and
+        // the extended handshake below are all tiny and back-to-back
+        // with no intervening read, so let them leave as one segment
+        connection->corkOutput(true);
+
         // If peer supports Fast Extension, send optimized messages
         if (connection->peerSupportsFastExtension()) {
             // Check if we're a seeder or have no pieces
             bool is_seeder = piece_manager_->isComplete();
-            size_t pieces_have = 0;
-            for (bool have : our_bitfield) {
-                if (have) pieces_have++;
-            }
+            // PieceManager already keeps a running count; no per-peer
+            // bitfield scan
+            size_t pieces_have = piece_manager_->numPiecesDownloaded();
 
             if (is_seeder) {
                 // Send HAVE_ALL instead of bitfield
@@ -862,8 +905,11 @@ void DownloadManager::connectToPeers() {
             connection->sendExtendedHandshake();
         }
 
+        connection->corkOutput(false);
+
         // Add to active peers
         active_peers_.emplace_back(std::move(connection), peer);
+        active_peer_count_.fetch_add(1, std::memory_order_relaxed);
         size_t peer_idx = active_peers_.size() - 1;
 
         // Start peer thread
@@ -932,21 +978,110 @@ void DownloadManager::updateTracker() {
 }
 
 void DownloadManager::broadcastHave(uint32_t piece_index) {
+    // Collect pieces completing close together and announce them in one
+    // send per peer. The first caller in an empty window becomes the
+    // flusher; concurrent completions just append and return.
+    {
+        std::lock_guard<std::mutex> lock(pending_haves_mutex_);
+        pending_haves_.push_back(piece_index);
+        if (have_flush_in_progress_) {
+            return;
+        }
+        have_flush_in_progress_ = true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::vector<uint32_t> pieces;
+    {
+        std::lock_guard<std::mutex> lock(pending_haves_mutex_);
+        pieces.swap(pending_haves_);
+        have_flush_in_progress_ = false;
+    }
+
+    flushPendingHaves(pieces);
+}
+
+void DownloadManager::flushPendingHaves(const std::vector<uint32_t>& pieces) {
     std::lock_guard<std::mutex> lock(peers_mutex_);
 
-    std::cout << "Broadcasting HAVE message for piece " << piece_index
-              << " to " << active_peers_.size() << " peers\n";
+    std::cout << "Broadcasting HAVE for " << pieces.size()
+              << " piece(s) to " << active_peers_.size() << " peers\n";
+
+    // Scratch for the concatenated 9-byte HAVE frames; rebuilt per peer
+    // because each peer only hears about pieces it doesn't already have
+    std::vector<uint8_t> frames;
+    frames.reserve(pieces.size() * 9);
 
     size_t sent = 0;
+    size_t suppressed = 0;
     for (auto& peer_info : active_peers_) {
         if (peer_info.connection && peer_info.connection->isConnected()) {
-            if (peer_info.connection->sendHave(piece_index)) {
+            frames.clear();
+            for (uint32_t piece_index : pieces) {
+                // Peers that already advertised this piece don't need to
+                // hear about it: a HAVE only marks the piece requestable
+                if (peer_info.connection->peerHasPiece(piece_index)) {
+                    suppressed++;
+                    continue;
+                }
+                uint8_t have_frame[9] = {
+                    0x00, 0x00, 0x00, 0x05,                   // Length prefix: 5
+                    static_cast<uint8_t>(MessageType::HAVE),  // Message ID: 4
+                    static_cast<uint8_t>((piece_index >> 24) & 0xFF),
+                    static_cast<uint8_t>((piece_index >> 16) & 0xFF),
+                    static_cast<uint8_t>((piece_index >> 8) & 0xFF),
+                    static_cast<uint8_t>(piece_index & 0xFF)
+                };
+                frames.insert(frames.end(), have_frame, have_frame + 9);
+            }
+            if (frames.empty()) {
+                continue;
+            }
+            if (peer_info.connection->sendSerializedMessage(frames.data(), frames.size())) {
                 sent++;
             }
         }
     }
 
-    std::cout << "HAVE message sent to " << sent << " peers\n";
+    std::cout << "HAVE message sent to " << sent << " peers ("
+              << suppressed << " suppressed)\n";
+}
+
+void DownloadManager::broadcastCancel(uint32_t piece_index, uint32_t offset,
+                                      uint32_t length, PeerConnection* source) {
+    // One 17-byte CANCEL frame serialized once and shared by reference
+    // across the whole fan-out; only peers that actually have this block
+    // outstanding are touched
+    uint8_t frame[17] = {
+        0x00, 0x00, 0x00, 0x0D,                     // Length prefix: 13
+        static_cast<uint8_t>(MessageType::CANCEL),  // Message ID: 8
+        static_cast<uint8_t>((piece_index >> 24) & 0xFF),
+        static_cast<uint8_t>((piece_index >> 16) & 0xFF),
+        static_cast<uint8_t>((piece_index >> 8) & 0xFF),
+        static_cast<uint8_t>(piece_index & 0xFF),
+        static_cast<uint8_t>((offset >> 24) & 0xFF),
+        static_cast<uint8_t>((offset >> 16) & 0xFF),
+        static_cast<uint8_t>((offset >> 8) & 0xFF),
+        static_cast<uint8_t>(offset & 0xFF),
+        static_cast<uint8_t>((length >> 24) & 0xFF),
+        static_cast<uint8_t>((length >> 16) & 0xFF),
+        static_cast<uint8_t>((length >> 8) & 0xFF),
+        static_cast<uint8_t>(length & 0xFF)
+    };
+
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    for (auto& peer_info : active_peers_) {
+        PeerConnection* conn = peer_info.connection.get();
+        if (!conn || conn == source || !conn->isConnected()) {
+            continue;
+        }
+        if (!conn->isPendingRequest(piece_index, offset)) {
+            continue;
+        }
+        conn->removeRequest(piece_index, offset);
+        conn->sendSerializedMessage(frame, sizeof(frame));
+    }
 }
 
 // Coordinator loop - manages piece distribution across peers
@@ -999,11 +1134,12 @@ void DownloadManager::assignPiecesToPeers() {
 
         // Assign piece to peer
         peer_info.current_piece = next_piece;
+        downloading_peer_count_.fetch_add(1, std::memory_order_relaxed);
 
         // Mark piece as being downloaded
         {
             std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
-            pieces_in_download_.insert(next_piece);
+            pieces_in_download_.set(next_piece);
         }
 
         std::cout << "Assigned piece #" << next_piece << " to peer "
@@ -1016,17 +1152,25 @@ int32_t DownloadManager::selectNextPiece(PeerInfo* peer) {
         return -1;
     }
 
-    // In endgame mode, request any missing piece
+    // In endgame mode, request any missing piece. Intersect the packed
+    // bitmaps word by word (~ours & peer) instead of a per-piece
+    // hasPiece/peerHasPiece loop that takes the piece mutex per probe:
+    // 64 pieces per iteration, and most words are zero this late in the
+    // download.
     if (endgame_mode_) {
-        for (uint32_t i = 0; i < torrent_.numPieces(); ++i) {
-            if (!piece_manager_->hasPiece(i) && peer->connection->peerHasPiece(i)) {
-                return i;
+        const auto& ours = piece_manager_->getBitfieldWords();
+        const auto& peer_words = peer->connection->peerBitfieldWords();
+        size_t num_words = ours.size() < peer_words.size() ? ours.size() : peer_words.size();
+        for (size_t w = 0; w < num_words; ++w) {
+            uint64_t wanted = ~ours[w] & peer_words[w];
+            if (wanted != 0) {
+                return static_cast<int32_t>((w << 6) + __builtin_ctzll(wanted));
             }
         }
         return -1;
     }
 
-    std::vector<bool> peer_has_pieces = peer->connection->peerBitfield();
+    const Bitfield& peer_has_pieces = peer->connection->peerBitfieldPacked();
     std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
 
     // Sequential mode - user preference
@@ -1040,19 +1184,10 @@ int32_t DownloadManager::selectNextPiece(PeerInfo* peer) {
         return random_piece;
     }
 
-    // Collect all peer bitfields for rarity calculation
-    std::vector<std::vector<bool>> all_peer_bitfields;
-    {
-        std::lock_guard<std::mutex> peers_lock(peers_mutex_);
-        for (const auto& peer_info : active_peers_) {
-            if (peer_info.connection && peer_info.connection->isConnected()) {
-                all_peer_bitfields.push_back(peer_info.connection->peerBitfield());
-            }
-        }
-    }
-
-    // Rarest-first strategy
-    return piece_manager_->getNextPieceRarestFirst(all_peer_bitfields, peer_has_pieces, pieces_in_download_);
+    // Rarest-first from the availability counts PieceManager maintains
+    // incrementally on HAVE/BITFIELD/disconnect — no per-call collection
+    // or rescan of every peer's bitfield
+    return piece_manager_->getNextPieceRarestFirst(peer_has_pieces, pieces_in_download_);
 }
 
 bool DownloadManager::isEndgameMode() const {
@@ -1064,17 +1199,25 @@ bool DownloadManager::isEndgameMode() const {
 void DownloadManager::cleanupStalePeers() {
     std::lock_guard<std::mutex> lock(peers_mutex_);
 
+    // One clock read for the whole sweep; staleness is then a plain
+    // comparison against the hot leading block of each PeerInfo
+    auto now = std::chrono::steady_clock::now();
+
     for (auto it = active_peers_.begin(); it != active_peers_.end(); ) {
-        if (!it->connection || !it->connection->isConnected() || it->isStale(60)) {
+        if (!it->connection || !it->connection->isConnected() || it->isStale(now, 60)) {
             std::cout << "Removing stale/disconnected peer " << it->peer_data.ip << "\n";
 
             // Remove piece assignment
             if (it->current_piece != UINT32_MAX) {
-                std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
-                pieces_in_download_.erase(it->current_piece);
+                {
+                    std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
+                    pieces_in_download_.reset(it->current_piece);
+                }
+                downloading_peer_count_.fetch_sub(1, std::memory_order_relaxed);
             }
 
             it = active_peers_.erase(it);
+            active_peer_count_.fetch_sub(1, std::memory_order_relaxed);
         } else {
             ++it;
         }
@@ -1132,12 +1275,34 @@ void DownloadManager::loadResumeState() {
 void DownloadManager::verifyExistingPieces() {
     std::cout << "Verifying existing pieces on disk...\n";
 
-    std::vector<bool> bitfield = piece_manager_->getBitfield();
-    int verified = 0;
-    int corrupted = 0;
+    Bitfield bitfield = piece_manager_->getBitfieldPacked();
+
+    // Hash checking at resume is the one remaining full-piece SHA-1 pass
+    // (live downloads hash incrementally as blocks arrive), and on a big
+    // resume it stalls startup for seconds. Fan it out across a small
+    // worker pool: workers claim the next piece index from a shared
+    // atomic, and each result lands in that piece's own slot, so no lock
+    // is needed anywhere. Reads still serialize on the FileManager mutex,
+    // but one worker hashes while another is in pread, which keeps both
+    // the disk and the cores busy.
+    unsigned num_workers = std::min(4u, std::thread::hardware_concurrency());
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+
+    std::atomic<size_t> next_piece{0};
+    std::vector<uint8_t> failed(bitfield.size(), 0);
+
+    auto verify_worker = [&]() {
+        for (;;) {
+            size_t i = next_piece.fetch_add(1);
+            if (i >= bitfield.size()) {
+                break;
+            }
+            if (!bitfield.test(i)) {
+                continue;
+            }
 
-    for (size_t i = 0; i < bitfield.size(); ++i) {
-        if (bitfield[i]) {
             // Get expected hash for this piece
             size_t hash_offset = i * 20;  // SHA1 = 20 bytes
             std::vector<uint8_t> expected_hash(
@@ -1146,14 +1311,34 @@ void DownloadManager::verifyExistingPieces() {
             );
 
             // Verify piece on disk
-            if (file_manager_->verifyPiece(i, expected_hash)) {
-                verified++;
-            } else {
-                std::cerr << "Piece " << i << " failed verification, will re-download\n";
-                bitfield[i] = false;
-                corrupted++;
+            if (!file_manager_->verifyPiece(i, expected_hash)) {
+                failed[i] = 1;
             }
         }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < num_workers; ++w) {
+        workers.emplace_back(verify_worker);
+    }
+    verify_worker();  // This thread pulls its weight too
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    int verified = 0;
+    int corrupted = 0;
+    for (size_t i = 0; i < bitfield.size(); ++i) {
+        if (!bitfield.test(i)) {
+            continue;
+        }
+        if (failed[i]) {
+            std::cerr << "Piece " << i << " failed verification, will re-download\n";
+            bitfield.reset(i);
+            corrupted++;
+        } else {
+            verified++;
+        }
     }
 
     // Update bitfield with verified pieces only
@@ -1206,7 +1391,7 @@ void DownloadManager::dhtLoop() {
     // Announce ourselves in DHT
     if (dht_manager_->getNodeCount() > 0) {
         std::cout << "DHT: Announcing ourselves for info_hash\n";
-        dht_manager_->announcePeer(torrent_.infoHash(), listen_port_);
+        dht_manager_->announcePeer(dht::toInfoHash(torrent_.infoHash()), listen_port_);
     }
 
     while (running_) {
@@ -1229,7 +1414,7 @@ void DownloadManager::dhtLoop() {
 
         // Periodically re-announce
         if (dht_manager_->getNodeCount() > 0) {
-            dht_manager_->announcePeer(torrent_.infoHash(), listen_port_);
+            dht_manager_->announcePeer(dht::toInfoHash(torrent_.infoHash()), listen_port_);
         }
 
         // Log DHT statistics
@@ -1253,7 +1438,7 @@ void DownloadManager::updateDHT() {
 
     std::cout << "DHT: Looking up peers for info_hash...\n";
 
-    auto dht_peers = dht_manager_->getPeers(torrent_.infoHash(), 15);
+    auto dht_peers = dht_manager_->getPeers(dht::toInfoHash(torrent_.infoHash()), 15);
 
     if (dht_peers.empty()) {
         std::cout << "DHT: No peers found\n";
@@ -1363,7 +1548,7 @@ void DownloadManager::updatePEX() {
         }
 
         // Collect new peers discovered via PEX
-        const auto& known_peers = pex_manager->getKnownPeers();
+        const auto known_peers = pex_manager->getKnownPeers();
         for (const auto& pex_peer : known_peers) {
             // Check if we already have this peer
             bool already_have = false;
@@ -1480,51 +1665,75 @@ void DownloadManager::updateWebSeeds() {
     // Prefer sequential gaps for web seeds (BEP 19 optimization)
     std::lock_guard<std::mutex> lock(pieces_mutex_);
 
-    // Get bitfield to see what pieces we need
-    auto bitfield = piece_manager_->getBitfield();
-    size_t num_pieces = bitfield.size();
+    // Work straight off the packed words: wanted = ~have & ~in-download,
+    // iterated one ctz per set bit instead of a vector<bool> copy probed
+    // per piece
+    const auto& ours = piece_manager_->getBitfieldWords();
+    const auto& indl = pieces_in_download_.words();
+    const size_t num_pieces = pieces_in_download_.size();
+    const size_t num_words = indl.size();
+
+    auto wantedWord = [&](size_t w) {
+        uint64_t word = ~ours[w] & ~indl[w];
+        if (w == num_words - 1 && (num_pieces & 63) != 0) {
+            word &= (uint64_t(1) << (num_pieces & 63)) - 1;  // Mask tail bits
+        }
+        return word;
+    };
 
     // Look for gaps (consecutive missing pieces) to download from web seeds
-    // This optimizes HTTP range requests
+    // This optimizes HTTP range requests. A gap continues exactly when the
+    // next wanted bit is adjacent to the previous one.
     uint32_t gap_start = UINT32_MAX;
     uint32_t gap_length = 0;
+    uint32_t prev = UINT32_MAX;
 
-    for (size_t i = 0; i < num_pieces; ++i) {
-        if (!bitfield[i] && pieces_in_download_.find(i) == pieces_in_download_.end()) {
-            // Found a missing piece not being downloaded
-            if (gap_start == UINT32_MAX) {
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t word = wantedWord(w);
+        while (word != 0) {
+            uint32_t i = static_cast<uint32_t>(w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+
+            if (gap_start != UINT32_MAX && i == prev + 1) {
+                gap_length++;
+            } else {
                 gap_start = i;
                 gap_length = 1;
-            } else {
-                gap_length++;
             }
+            prev = i;
 
             // If gap is large enough (4+ pieces), start downloading from web seed
             if (gap_length >= 4) {
                 // Download from gap_start
                 if (webseed_manager_->downloadFullPiece(gap_start)) {
-                    pieces_in_download_.insert(gap_start);
+                    pieces_in_download_.set(gap_start);
                     LOG_DEBUG("WebSeed: Requested piece {} from web seed", gap_start);
                 }
                 gap_start++;
                 gap_length--;
             }
-        } else {
-            // Reset gap
-            gap_start = UINT32_MAX;
-            gap_length = 0;
         }
     }
 
+    // The old per-piece loop reset the gap whenever it passed an unwanted
+    // piece, so a run ending before the last piece did not suppress the
+    // fallback below
+    if (prev != num_pieces - 1) {
+        gap_start = UINT32_MAX;
+    }
+
     // Also download random missing pieces if no gaps found
     // This helps with the last few pieces
     if (gap_start == UINT32_MAX) {
-        for (size_t i = 0; i < num_pieces; ++i) {
-            if (!bitfield[i] && pieces_in_download_.find(i) == pieces_in_download_.end()) {
+        for (size_t w = 0; w < num_words; ++w) {
+            uint64_t word = wantedWord(w);
+            while (word != 0) {
+                uint32_t i = static_cast<uint32_t>(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;
                 if (webseed_manager_->downloadFullPiece(i)) {
-                    pieces_in_download_.insert(i);
+                    pieces_in_download_.set(i);
                     LOG_DEBUG("WebSeed: Requested piece {} from web seed", i);
-                    break;  // Only request one piece at a time
+                    return;  // Only request one piece at a time
                 }
             }
         }
@@ -1,6 +1,7 @@
 #include "extension_protocol.h"
 #include "logger.h"
 #include <cstring>
+#include <mutex>
 
 namespace torrent {
 
@@ -21,6 +22,37 @@ uint8_t ExtensionProtocol::registerExtension(const std::string& name,
 }
 
 std::vector<uint8_t> ExtensionProtocol::buildExtendedHandshake() const {
+    // The handshake blob depends only on our extension table, metadata
+    // size, client name and uTP port — identical for every connection of
+    // a session, so running the bencode encoder per peer is pure rework.
+    // Serialize once per distinct input set and replay the cached bytes;
+    // a new torrent's metadata_size simply misses and rebuilds.
+    static std::mutex cache_mutex;
+    static std::string cache_key;
+    static std::vector<uint8_t> cache_message;
+
+    std::string key;
+    key.reserve(96);
+    for (const auto& [name, id_handler] : our_extensions_) {
+        key += name;
+        key += '=';
+        key += std::to_string(id_handler.first);
+        key += ';';
+    }
+    key += '|';
+    key += std::to_string(our_metadata_size_);
+    key += '|';
+    key += our_client_name_;
+    key += '|';
+    key += std::to_string(our_utp_port_);
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (!cache_message.empty() && cache_key == key) {
+            return cache_message;
+        }
+    }
+
     bencode::BencodeDict dict;
 
     // Add extension mappings
@@ -50,10 +82,17 @@ std::vector<uint8_t> ExtensionProtocol::buildExtendedHandshake() const {
 
     // Build message: [msg_id=20][ext_id=0][bencoded_dict]
     std::vector<uint8_t> message;
+    message.reserve(2 + encoded.size());
     message.push_back(MSG_EXTENDED);
     message.push_back(EXT_HANDSHAKE);
     message.insert(message.end(), encoded.begin(), encoded.end());
 
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cache_key = std::move(key);
+        cache_message = message;
+    }
+
     return message;
 }
 
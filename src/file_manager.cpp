@@ -1,7 +1,17 @@
 #include "file_manager.h"
+#include "utils.h"
+#include "sha1_hw.h"
 #include "logger.h"
 #include <filesystem>
 #include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 
 namespace fs = std::filesystem;
 
@@ -54,79 +64,125 @@ bool FileManager::initialize() {
 
 void FileManager::openFiles() {
     for (auto& handle : file_handles_) {
-        handle.stream.open(handle.path,
-                          std::ios::in | std::ios::out | std::ios::binary);
+        handle.fd = ::open(handle.path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (handle.fd < 0) {
+            throw std::runtime_error("Failed to open file: " + handle.path);
+        }
 
-        if (!handle.stream.is_open()) {
-            // Try creating the file
-            handle.stream.open(handle.path,
-                             std::ios::out | std::ios::binary);
-            handle.stream.close();
+        if (handle.length == 0) {
+            continue;  // Nothing to map
+        }
 
-            // Reopen in read/write mode
-            handle.stream.open(handle.path,
-                             std::ios::in | std::ios::out | std::ios::binary);
+        // Reserve the full extent up front so the mapping never faults
+        // past EOF; ftruncate is the fallback for filesystems without
+        // fallocate support (the file goes sparse there, which is fine)
+        if (::posix_fallocate(handle.fd, 0, handle.length) != 0) {
+            if (::ftruncate(handle.fd, handle.length) != 0) {
+                throw std::runtime_error("Failed to allocate file: " + handle.path);
+            }
         }
 
-        if (!handle.stream.is_open()) {
-            throw std::runtime_error("Failed to open file: " + handle.path);
+        // Map the whole file shared: piece writes become memcpys into the
+        // page cache with no write() syscall, and the kernel handles
+        // writeback. On mmap failure the fd stays as a pwritev/pread
+        // fallback with identical semantics.
+        void* map = ::mmap(nullptr, static_cast<size_t>(handle.length),
+                           PROT_READ | PROT_WRITE, MAP_SHARED, handle.fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_WARN("mmap failed for {} ({}), using positioned I/O",
+                     handle.path, strerror(errno));
+            continue;
         }
+        handle.mapping = static_cast<uint8_t*>(map);
+
+        // Piece traffic is effectively random across the file; stop the
+        // kernel from readahead-faulting megabytes per touched page
+        ::madvise(handle.mapping, static_cast<size_t>(handle.length), MADV_RANDOM);
     }
 }
 
 void FileManager::closeFiles() {
     for (auto& handle : file_handles_) {
-        if (handle.stream.is_open()) {
-            handle.stream.close();
+        if (handle.mapping != nullptr) {
+            // Kick off writeback of whatever is still dirty before the
+            // mapping goes away (munmap alone leaves it to the flusher)
+            ::msync(handle.mapping, static_cast<size_t>(handle.length), MS_ASYNC);
+            ::munmap(handle.mapping, static_cast<size_t>(handle.length));
+            handle.mapping = nullptr;
+        }
+        if (handle.fd >= 0) {
+            ::close(handle.fd);
+            handle.fd = -1;
         }
     }
 }
 
 bool FileManager::writePiece(uint32_t piece_index, const std::vector<uint8_t>& data) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return writePiece(piece_index, data.data(), data.size());
+}
 
-    try {
-        int64_t piece_offset = static_cast<int64_t>(piece_index) * torrent_.pieceLength();
-        int64_t remaining = data.size();
-        int64_t data_offset = 0;
+bool FileManager::writePiece(uint32_t piece_index, const uint8_t* data, size_t length) {
+    return writePieceRange(piece_index, 0, data, length);
+}
 
-        // Write to appropriate file(s)
-        for (auto& handle : file_handles_) {
-            if (piece_offset >= handle.offset + handle.length) {
-                continue;  // This piece starts after this file
-            }
+bool FileManager::writePieceRange(uint32_t piece_index, size_t offset,
+                                  const uint8_t* data, size_t length) {
+    int64_t piece_offset = static_cast<int64_t>(piece_index) * torrent_.pieceLength()
+                         + static_cast<int64_t>(offset);
+    int64_t data_offset = 0;
 
-            if (piece_offset + remaining <= handle.offset) {
-                break;  // This piece ends before this file
-            }
+    // Write to appropriate file(s). A piece maps to one contiguous span
+    // per file it touches: with a mapping that span is one memcpy into
+    // the page cache, and distinct pieces touch disjoint ranges, so
+    // writers need no lock.
+    for (auto& handle : file_handles_) {
+        if (piece_offset >= handle.offset + handle.length) {
+            continue;  // This piece starts after this file
+        }
 
-            // Calculate write position in this file
-            int64_t file_write_offset = std::max(0LL, piece_offset - handle.offset);
-            int64_t write_start = std::max(piece_offset, handle.offset);
-            int64_t write_end = std::min(piece_offset + static_cast<int64_t>(data.size()),
-                                        handle.offset + handle.length);
-            int64_t write_size = write_end - write_start;
-
-            if (write_size > 0) {
-                handle.stream.seekp(file_write_offset);
-                handle.stream.write(reinterpret_cast<const char*>(data.data() + data_offset),
-                                  write_size);
-                data_offset += write_size;
-                remaining -= write_size;
-            }
+        if (piece_offset + static_cast<int64_t>(length) <= handle.offset) {
+            break;  // This piece ends before this file
         }
 
-        return true;
+        int64_t file_write_offset =
+            (piece_offset > handle.offset) ? piece_offset - handle.offset : 0;
+        int64_t write_start = std::max(piece_offset, handle.offset);
+        int64_t write_end = std::min(piece_offset + static_cast<int64_t>(length),
+                                    handle.offset + handle.length);
+        int64_t write_size = write_end - write_start;
+
+        if (handle.mapping != nullptr) {
+            std::memcpy(handle.mapping + file_write_offset,
+                        data + data_offset, static_cast<size_t>(write_size));
+            data_offset += write_size;
+            continue;
+        }
 
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to write piece " << piece_index << ": " << e.what() << "\n";
-        return false;
+        while (write_size > 0) {
+            struct iovec iov;
+            iov.iov_base = const_cast<uint8_t*>(data + data_offset);
+            iov.iov_len = static_cast<size_t>(write_size);
+
+            ssize_t written = ::pwritev(handle.fd, &iov, 1, file_write_offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Failed to write piece " << piece_index
+                          << " to " << handle.path << ": " << strerror(errno) << "\n";
+                return false;
+            }
+
+            data_offset += written;
+            file_write_offset += written;
+            write_size -= written;
+        }
     }
+
+    return true;
 }
 
 std::vector<uint8_t> FileManager::readPiece(uint32_t piece_index) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     try {
         int64_t piece_offset = static_cast<int64_t>(piece_index) * torrent_.pieceLength();
 
@@ -140,31 +196,51 @@ std::vector<uint8_t> FileManager::readPiece(uint32_t piece_index) {
         }
 
         std::vector<uint8_t> data(piece_size);
-        int64_t remaining = piece_size;
         int64_t data_offset = 0;
 
-        // Read from appropriate file(s)
+        // Read from appropriate file(s): one memcpy out of the mapping
+        // per touched file, or one pread on the fallback path
         for (auto& handle : file_handles_) {
             if (piece_offset >= handle.offset + handle.length) {
                 continue;
             }
 
-            if (piece_offset + piece_size <= handle.offset) {
+            if (piece_offset + static_cast<int64_t>(piece_size) <= handle.offset) {
                 break;
             }
 
-            int64_t file_read_offset = std::max(0LL, piece_offset - handle.offset);
+            int64_t file_read_offset =
+                (piece_offset > handle.offset) ? piece_offset - handle.offset : 0;
             int64_t read_start = std::max(piece_offset, handle.offset);
             int64_t read_end = std::min(piece_offset + static_cast<int64_t>(piece_size),
                                        handle.offset + handle.length);
             int64_t read_size = read_end - read_start;
 
-            if (read_size > 0) {
-                handle.stream.seekg(file_read_offset);
-                handle.stream.read(reinterpret_cast<char*>(data.data() + data_offset),
-                                 read_size);
+            if (handle.mapping != nullptr) {
+                std::memcpy(data.data() + data_offset,
+                            handle.mapping + file_read_offset,
+                            static_cast<size_t>(read_size));
                 data_offset += read_size;
-                remaining -= read_size;
+                continue;
+            }
+
+            while (read_size > 0) {
+                ssize_t bytes_read = ::pread(handle.fd, data.data() + data_offset,
+                                             static_cast<size_t>(read_size), file_read_offset);
+                if (bytes_read < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    std::cerr << "Failed to read piece " << piece_index
+                              << " from " << handle.path << ": " << strerror(errno) << "\n";
+                    return {};
+                }
+                if (bytes_read == 0) {
+                    break;  // Short file (sparse/unwritten region stays zeroed)
+                }
+                data_offset += bytes_read;
+                file_read_offset += bytes_read;
+                read_size -= bytes_read;
             }
         }
 
@@ -176,24 +252,240 @@ std::vector<uint8_t> FileManager::readPiece(uint32_t piece_index) {
     }
 }
 
-bool FileManager::verifyExistingFiles() {
-    // TODO: Implement verification of existing files
+bool FileManager::readBlock(uint32_t piece_index, size_t offset, size_t length,
+                            uint8_t* dst) {
+    // Bound against the piece, as the whole-piece path validated
+    size_t piece_size = torrent_.pieceLength();
+    if (piece_index == torrent_.numPieces() - 1) {
+        size_t last_piece_size = torrent_.totalLength() % torrent_.pieceLength();
+        if (last_piece_size != 0) {
+            piece_size = last_piece_size;
+        }
+    }
+    if (length == 0 || offset + length > piece_size) {
+        return false;
+    }
+
+    int64_t block_offset = static_cast<int64_t>(piece_index) * torrent_.pieceLength() +
+                           static_cast<int64_t>(offset);
+
+    // Short files leave their tail as zeros, same as readPiece's
+    // zero-initialized buffer
+    std::memset(dst, 0, length);
+
+    for (auto& handle : file_handles_) {
+        if (block_offset >= handle.offset + handle.length) {
+            continue;
+        }
+
+        if (block_offset + static_cast<int64_t>(length) <= handle.offset) {
+            break;
+        }
+
+        int64_t file_read_offset =
+            (block_offset > handle.offset) ? block_offset - handle.offset : 0;
+        int64_t read_start = std::max(block_offset, handle.offset);
+        int64_t read_end = std::min(block_offset + static_cast<int64_t>(length),
+                                    handle.offset + handle.length);
+        int64_t read_size = read_end - read_start;
+        // Position in dst derived per file, so a short read in one file
+        // cannot shift later files' data
+        int64_t data_offset = read_start - block_offset;
+
+        if (handle.mapping != nullptr) {
+            std::memcpy(dst + data_offset,
+                        handle.mapping + file_read_offset,
+                        static_cast<size_t>(read_size));
+            continue;
+        }
+
+        while (read_size > 0) {
+            ssize_t bytes_read = ::pread(handle.fd, dst + data_offset,
+                                         static_cast<size_t>(read_size), file_read_offset);
+            if (bytes_read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Failed to read block of piece " << piece_index
+                          << " from " << handle.path << ": " << strerror(errno) << "\n";
+                return false;
+            }
+            if (bytes_read == 0) {
+                break;  // Short file (sparse/unwritten region stays zeroed)
+            }
+            data_offset += bytes_read;
+            file_read_offset += bytes_read;
+            read_size -= bytes_read;
+        }
+    }
+
+    return true;
+}
+
+bool FileManager::locateBlock(uint32_t piece_index, size_t offset, size_t length,
+                              int& fd, int64_t& file_off) const {
+    int64_t block_start = static_cast<int64_t>(piece_index) * torrent_.pieceLength() +
+                          static_cast<int64_t>(offset);
+    int64_t block_end = block_start + static_cast<int64_t>(length);
+
+    if (length == 0 || block_end > torrent_.totalLength()) {
+        return false;
+    }
+
+    for (const auto& handle : file_handles_) {
+        if (block_start >= handle.offset + handle.length) {
+            continue;
+        }
+        // First file the block touches; usable only if it also holds the
+        // last byte and has an open descriptor
+        if (handle.fd >= 0 && block_start >= handle.offset &&
+            block_end <= handle.offset + handle.length) {
+            fd = handle.fd;
+            file_off = block_start - handle.offset;
+            return true;
+        }
+        return false;
+    }
+
     return false;
 }
 
-bool FileManager::verifyPiece(uint32_t piece_index, const std::vector<uint8_t>& expected_hash) {
-    // Read piece from disk
-    std::vector<uint8_t> piece_data = readPiece(piece_index);
+bool FileManager::hashPiece(uint32_t piece_index, uint8_t digest[20]) const {
+    int64_t piece_offset = static_cast<int64_t>(piece_index) * torrent_.pieceLength();
+
+    size_t piece_size = torrent_.pieceLength();
+    if (piece_index == torrent_.numPieces() - 1) {
+        size_t last_piece_size = torrent_.totalLength() % torrent_.pieceLength();
+        if (last_piece_size != 0) {
+            piece_size = last_piece_size;
+        }
+    }
+
+    utils::Sha1Stream stream;
+
+    for (const auto& handle : file_handles_) {
+        if (piece_offset >= handle.offset + handle.length) {
+            continue;
+        }
+
+        if (piece_offset + static_cast<int64_t>(piece_size) <= handle.offset) {
+            break;
+        }
+
+        int64_t file_read_offset =
+            (piece_offset > handle.offset) ? piece_offset - handle.offset : 0;
+        int64_t read_start = std::max(piece_offset, handle.offset);
+        int64_t read_end = std::min(piece_offset + static_cast<int64_t>(piece_size),
+                                   handle.offset + handle.length);
+        int64_t read_size = read_end - read_start;
+
+        if (handle.mapping != nullptr) {
+            // Hash straight out of the mapping: the hasher consumes page
+            // cache in place, no staging buffer
+            stream.update(handle.mapping + file_read_offset,
+                          static_cast<size_t>(read_size));
+            continue;
+        }
+
+        // Fallback path: pread in chunks; short files (sparse/unwritten
+        // regions) hash as zeros, matching what readPiece returns there
+        uint8_t chunk[64 * 1024];
+        while (read_size > 0) {
+            size_t want = std::min(read_size, static_cast<int64_t>(sizeof(chunk)));
+            ssize_t n = ::pread(handle.fd, chunk, want, file_read_offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (n < static_cast<ssize_t>(want)) {
+                std::memset(chunk + n, 0, want - n);
+            }
+            stream.update(chunk, want);
+            file_read_offset += want;
+            read_size -= want;
+        }
+    }
+
+    stream.finish(digest);
+    return true;
+}
 
-    if (piece_data.empty()) {
+bool FileManager::verifyExistingFiles() {
+    const size_t num_pieces = torrent_.numPieces();
+    if (num_pieces == 0) {
+        return true;
+    }
+
+    const std::vector<uint8_t>& hashes = torrent_.pieces();
+    if (hashes.size() < num_pieces * 20) {
         return false;
     }
 
-    // Calculate SHA1 hash
-    std::vector<uint8_t> actual_hash = utils::sha1(piece_data);
+    // This pass walks the files front to back; let the kernel read ahead
+    // through the mappings, then drop back to random for piece traffic
+    for (const auto& handle : file_handles_) {
+        if (handle.mapping != nullptr) {
+            ::madvise(handle.mapping, static_cast<size_t>(handle.length),
+                      MADV_SEQUENTIAL);
+        }
+    }
+
+    unsigned num_workers = std::min(4u, std::thread::hardware_concurrency());
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+
+    std::atomic<size_t> next_piece{0};
+    std::atomic<bool> all_match{true};
+
+    // Workers claim pieces off a shared counter; each piece hashes
+    // zero-copy from the mappings through the hardware-dispatched SHA-1
+    auto verify_worker = [&]() {
+        uint8_t digest[20];
+        for (;;) {
+            size_t piece = next_piece.fetch_add(1);
+            if (piece >= num_pieces) {
+                break;
+            }
+            if (!hashPiece(static_cast<uint32_t>(piece), digest) ||
+                std::memcmp(digest, hashes.data() + piece * 20, 20) != 0) {
+                all_match.store(false, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < num_workers; ++w) {
+        workers.emplace_back(verify_worker);
+    }
+    verify_worker();  // The calling thread is a worker too
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    for (const auto& handle : file_handles_) {
+        if (handle.mapping != nullptr) {
+            ::madvise(handle.mapping, static_cast<size_t>(handle.length),
+                      MADV_RANDOM);
+        }
+    }
+
+    return all_match.load();
+}
+
+bool FileManager::verifyPiece(uint32_t piece_index, const std::vector<uint8_t>& expected_hash) {
+    // Stream the piece through hashPiece — mapped regions are hashed in
+    // place, so no piece-sized staging vector is materialized
+    uint8_t actual_hash[20];
+    if (!hashPiece(piece_index, actual_hash)) {
+        return false;
+    }
 
     // Compare with expected hash
-    return actual_hash == expected_hash;
+    return expected_hash.size() == 20 &&
+           std::memcmp(actual_hash, expected_hash.data(), 20) == 0;
 }
 
 } // namespace torrent
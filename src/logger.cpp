@@ -1,11 +1,31 @@
 #include "logger.h"
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
+#include <algorithm>
 #include <vector>
 
 namespace torrent {
 
 std::shared_ptr<spdlog::logger> Logger::logger_ = nullptr;
+std::atomic<spdlog::logger*> Logger::raw_{nullptr};
+std::atomic<int> Logger::min_level_{static_cast<int>(spdlog::level::off)};
+
+// Recompute the cheapest level that can reach any sink: the logger's own
+// level gates everything, below that the most permissive sink wins
+void Logger::refreshMinLevel() {
+    if (!logger_) {
+        min_level_.store(static_cast<int>(spdlog::level::off),
+                         std::memory_order_relaxed);
+        return;
+    }
+
+    int sink_min = static_cast<int>(spdlog::level::off);
+    for (const auto& sink : logger_->sinks()) {
+        sink_min = std::min(sink_min, static_cast<int>(sink->level()));
+    }
+    min_level_.store(std::max(static_cast<int>(logger_->level()), sink_min),
+                     std::memory_order_relaxed);
+}
 
 void Logger::init(const std::string& log_file,
                   Level console_level,
@@ -36,6 +56,11 @@ void Logger::init(const std::string& log_file,
         // Register as default logger
         spdlog::set_default_logger(logger_);
 
+        // Publish the raw pointer and level gate for the LOG_* macros;
+        // logger_ keeps the instance alive for the process lifetime
+        raw_.store(logger_.get(), std::memory_order_release);
+        refreshMinLevel();
+
         LOG_INFO("Logger initialized - Console: {}, File: {}",
                  spdlog::level::to_string_view(toSpdlogLevel(console_level)),
                  spdlog::level::to_string_view(toSpdlogLevel(file_level)));
@@ -47,18 +72,21 @@ void Logger::init(const std::string& log_file,
 void Logger::setLevel(Level level) {
     if (logger_) {
         logger_->set_level(toSpdlogLevel(level));
+        refreshMinLevel();
     }
 }
 
 void Logger::setConsoleLevel(Level level) {
     if (logger_ && logger_->sinks().size() > 0) {
         logger_->sinks()[0]->set_level(toSpdlogLevel(level));
+        refreshMinLevel();
     }
 }
 
 void Logger::setFileLevel(Level level) {
     if (logger_ && logger_->sinks().size() > 1) {
         logger_->sinks()[1]->set_level(toSpdlogLevel(level));
+        refreshMinLevel();
     }
 }
 
@@ -115,7 +115,7 @@ void MagnetDownloadManager::findPeersViaDHT() {
 
     LOG_INFO("Magnet: Searching DHT for peers...");
 
-    auto dht_peers = dht_manager_->getPeers(magnet_uri_.infoHash(), 30);
+    auto dht_peers = dht_manager_->getPeers(dht::toInfoHash(magnet_uri_.infoHash()), 30);
 
     std::lock_guard<std::mutex> lock(peers_mutex_);
     for (const auto& dht_peer : dht_peers) {
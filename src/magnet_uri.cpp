@@ -92,11 +92,11 @@ std::string MagnetURI::toString() const {
             } else if (c == ' ') {
                 oss << '+';
             } else {
-                oss << '%' << std::hex << std::setw(2) << std::setfill('0')
-                    << (int)(unsigned char)c;
+                static constexpr char kHex[] = "0123456789abcdef";
+                unsigned char uc = static_cast<unsigned char>(c);
+                oss << '%' << kHex[uc >> 4] << kHex[uc & 0x0F];
             }
         }
-        oss << std::dec;
     }
 
     for (const auto& tracker : trackers_) {
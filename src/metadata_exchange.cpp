@@ -1,20 +1,99 @@
 #include "metadata_exchange.h"
 #include "logger.h"
 #include "utils.h"
+#include <algorithm>
 #include <cstring>
 
 namespace torrent {
 
+namespace {
+
+// Parse a bencoded integer "i<digits>e" at p[pos], advancing pos past
+// the closing 'e'. Rejects anything malformed rather than guessing.
+bool parseBencodeInt(const uint8_t* p, size_t n, size_t& pos, int64_t& out) {
+    if (pos >= n || p[pos] != 'i') {
+        return false;
+    }
+    ++pos;
+    bool negative = false;
+    if (pos < n && p[pos] == '-') {
+        negative = true;
+        ++pos;
+    }
+    if (pos >= n || p[pos] < '0' || p[pos] > '9') {
+        return false;
+    }
+    int64_t value = 0;
+    while (pos < n && p[pos] >= '0' && p[pos] <= '9') {
+        value = value * 10 + (p[pos] - '0');
+        ++pos;
+    }
+    if (pos >= n || p[pos] != 'e') {
+        return false;
+    }
+    ++pos;
+    out = negative ? -value : value;
+    return true;
+}
+
+// BEP 9 dicts carry at most three keys and bencode requires them sorted,
+// so a compliant header is exactly
+//   d8:msg_typei<T>e5:piecei<P>e[10:total_sizei<S>e]e
+// Match that shape with memcmp and digit scans; total_size is -1 when
+// absent and body_off is the offset of the raw piece data. Returns false
+// on any other shape so the caller can fall back to the generic decoder.
+bool parseMetadataHeader(const uint8_t* p, size_t n,
+                         int64_t& msg_type, int64_t& piece,
+                         int64_t& total_size, size_t& body_off) {
+    static const char kMsgType[] = "d8:msg_type";
+    static const char kPiece[] = "5:piece";
+    static const char kTotalSize[] = "10:total_size";
+
+    if (n < sizeof(kMsgType) - 1 ||
+        std::memcmp(p, kMsgType, sizeof(kMsgType) - 1) != 0) {
+        return false;
+    }
+    size_t pos = sizeof(kMsgType) - 1;
+    if (!parseBencodeInt(p, n, pos, msg_type)) {
+        return false;
+    }
+
+    if (n - pos < sizeof(kPiece) - 1 ||
+        std::memcmp(p + pos, kPiece, sizeof(kPiece) - 1) != 0) {
+        return false;
+    }
+    pos += sizeof(kPiece) - 1;
+    if (!parseBencodeInt(p, n, pos, piece)) {
+        return false;
+    }
+
+    total_size = -1;
+    if (n - pos >= sizeof(kTotalSize) - 1 &&
+        std::memcmp(p + pos, kTotalSize, sizeof(kTotalSize) - 1) == 0) {
+        pos += sizeof(kTotalSize) - 1;
+        if (!parseBencodeInt(p, n, pos, total_size)) {
+            return false;
+        }
+    }
+
+    if (pos >= n || p[pos] != 'e') {
+        return false;
+    }
+    body_off = pos + 1;
+    return true;
+}
+
+} // namespace
+
 MetadataExchange::MetadataExchange(int64_t metadata_size,
                                    MetadataCompleteCallback callback)
     : metadata_size_(metadata_size)
-    , on_complete_(callback)
-    , complete_(false) {
+    , on_complete_(callback) {
 
     if (metadata_size_ > 0) {
         num_pieces_ = (metadata_size_ + METADATA_PIECE_SIZE - 1) / METADATA_PIECE_SIZE;
-        pieces_.resize(num_pieces_);
-        have_pieces_.resize(num_pieces_, false);
+        buffer_.resize(metadata_size_);
+        have_pieces_.resize(num_pieces_);
 
         LOG_INFO("Metadata exchange initialized: {} bytes, {} pieces",
                 metadata_size_, num_pieces_);
@@ -28,21 +107,14 @@ size_t MetadataExchange::totalPieces() const {
 }
 
 bool MetadataExchange::isComplete() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return complete_;
+    return complete_.load(std::memory_order_acquire);
 }
 
 double MetadataExchange::progress() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     if (num_pieces_ == 0) return 0.0;
 
-    size_t received = 0;
-    for (bool have : have_pieces_) {
-        if (have) received++;
-    }
-
-    return (double)received / num_pieces_ * 100.0;
+    return (double)received_count_.load(std::memory_order_relaxed) /
+           num_pieces_ * 100.0;
 }
 
 bencode::BencodeValue MetadataExchange::buildRequestMessage(size_t piece_index) {
@@ -74,92 +146,113 @@ bencode::BencodeValue MetadataExchange::buildRejectMessage(size_t piece_index) {
 }
 
 void MetadataExchange::handleMessage(const std::vector<uint8_t>& payload) {
-    try {
-        // ut_metadata message format:
-        // [bencoded dict][optional piece data]
-
-        // Find end of bencoded dict
-        size_t dict_end = 0;
-        int depth = 0;
-        bool in_dict = false;
-
-        for (size_t i = 0; i < payload.size(); ++i) {
-            if (payload[i] == 'd') {
-                in_dict = true;
-                depth++;
-            } else if (payload[i] == 'e' && in_dict) {
-                depth--;
-                if (depth == 0) {
-                    dict_end = i + 1;
-                    break;
+    // ut_metadata message format:
+    // [bencoded dict][optional piece data]
+
+    // Fast path: sorted keys mean a compliant header has exactly one
+    // byte shape per message type, so match it in place — a few memcmps
+    // and digit scans instead of a generic decode allocating map nodes
+    // and key strings for every piece from every peer.
+    int64_t msg_type;
+    int64_t piece;
+    int64_t total_size;
+    size_t body_off;
+
+    if (!parseMetadataHeader(payload.data(), payload.size(),
+                             msg_type, piece, total_size, body_off)) {
+        // Unexpected shape (extra keys, unsorted dict): fall back to the
+        // generic decoder
+        try {
+            // Find end of bencoded dict
+            size_t dict_end = 0;
+            int depth = 0;
+            bool in_dict = false;
+
+            for (size_t i = 0; i < payload.size(); ++i) {
+                if (payload[i] == 'd') {
+                    in_dict = true;
+                    depth++;
+                } else if (payload[i] == 'e' && in_dict) {
+                    depth--;
+                    if (depth == 0) {
+                        dict_end = i + 1;
+                        break;
+                    }
                 }
             }
-        }
 
-        if (dict_end == 0) {
-            LOG_WARN("Invalid ut_metadata message: no valid bencoded dict");
-            return;
-        }
+            if (dict_end == 0) {
+                LOG_WARN("Invalid ut_metadata message: no valid bencoded dict");
+                return;
+            }
 
-        // Parse dict
-        std::vector<uint8_t> dict_data(payload.begin(), payload.begin() + dict_end);
-        bencode::BencodeValue value = bencode::decode(dict_data);
+            // Parse dict
+            std::vector<uint8_t> dict_data(payload.begin(), payload.begin() + dict_end);
+            bencode::BencodeValue value = bencode::decode(dict_data);
 
-        if (!value.isDict()) {
-            LOG_WARN("Invalid ut_metadata message: not a dict");
-            return;
-        }
+            if (!value.isDict()) {
+                LOG_WARN("Invalid ut_metadata message: not a dict");
+                return;
+            }
 
-        const auto& dict = value.asDict();
+            const auto& dict = value.asDict();
 
-        // Get message type
-        if (dict.find("msg_type") == dict.end() || !dict.at("msg_type").isInt()) {
-            LOG_WARN("Invalid ut_metadata message: missing msg_type");
-            return;
-        }
+            if (dict.find("msg_type") == dict.end() || !dict.at("msg_type").isInt()) {
+                LOG_WARN("Invalid ut_metadata message: missing msg_type");
+                return;
+            }
+            msg_type = dict.at("msg_type").asInt();
+
+            if (dict.find("piece") == dict.end() || !dict.at("piece").isInt()) {
+                LOG_WARN("Invalid ut_metadata message: missing piece");
+                return;
+            }
+            piece = dict.at("piece").asInt();
 
-        int msg_type = static_cast<int>(dict.at("msg_type").asInt());
+            body_off = dict_end;
 
-        // Extract piece data if present
-        std::vector<uint8_t> piece_data;
-        if (dict_end < payload.size()) {
-            piece_data.assign(payload.begin() + dict_end, payload.end());
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to handle ut_metadata message: {}", e.what());
+            return;
         }
+    }
 
-        // Handle based on type
-        switch (static_cast<MetadataMessageType>(msg_type)) {
-            case MetadataMessageType::REQUEST:
-                handleRequest(dict);
-                break;
+    if (piece < 0) {
+        LOG_WARN("Invalid ut_metadata message: negative piece index");
+        return;
+    }
 
-            case MetadataMessageType::DATA:
-                handleData(dict, piece_data);
-                break;
+    // Handle based on type
+    switch (static_cast<MetadataMessageType>(msg_type)) {
+        case MetadataMessageType::REQUEST:
+            handleRequest(static_cast<size_t>(piece));
+            break;
 
-            case MetadataMessageType::REJECT:
-                handleReject(dict);
-                break;
+        case MetadataMessageType::DATA:
+            handleData(static_cast<size_t>(piece),
+                       payload.data() + body_off, payload.size() - body_off);
+            break;
 
-            default:
-                LOG_WARN("Unknown ut_metadata message type: {}", msg_type);
-                break;
-        }
+        case MetadataMessageType::REJECT:
+            handleReject(static_cast<size_t>(piece));
+            break;
 
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to handle ut_metadata message: {}", e.what());
+        default:
+            LOG_WARN("Unknown ut_metadata message type: {}", msg_type);
+            break;
     }
 }
 
 int MetadataExchange::getNextPieceToRequest() {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (complete_) {
+    if (complete_.load(std::memory_order_acquire)) {
         return -1;
     }
 
     // Find a piece we don't have and haven't requested
     for (size_t i = 0; i < num_pieces_; ++i) {
-        if (!have_pieces_[i] && requested_pieces_.find(i) == requested_pieces_.end()) {
+        if (!have_pieces_.test(i) && requested_pieces_.find(i) == requested_pieces_.end()) {
             return static_cast<int>(i);
         }
     }
@@ -172,86 +265,67 @@ void MetadataExchange::markPieceRequested(size_t piece_index) {
     requested_pieces_.insert(piece_index);
 }
 
-void MetadataExchange::setMetadata(const std::vector<uint8_t>& metadata) {
+void MetadataExchange::setMetadata(std::vector<uint8_t> metadata) {
     std::lock_guard<std::mutex> lock(mutex_);
-    full_metadata_ = metadata;
-    metadata_size_ = metadata.size();
+    buffer_ = std::move(metadata);
+    metadata_size_ = buffer_.size();
     num_pieces_ = (metadata_size_ + METADATA_PIECE_SIZE - 1) / METADATA_PIECE_SIZE;
+    have_pieces_.resize(num_pieces_);
+    have_pieces_.setAll();
+    received_count_.store(num_pieces_, std::memory_order_relaxed);
+    complete_.store(true, std::memory_order_release);
 
     LOG_INFO("Metadata set for sharing: {} bytes, {} pieces", metadata_size_, num_pieces_);
 }
 
-std::vector<uint8_t> MetadataExchange::getMetadata() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (complete_ && !full_metadata_.empty()) {
-        return full_metadata_;
-    }
-
-    // Assemble from pieces
-    std::vector<uint8_t> metadata;
-    for (const auto& piece : pieces_) {
-        metadata.insert(metadata.end(), piece.begin(), piece.end());
-    }
-
-    return metadata;
+const std::vector<uint8_t>& MetadataExchange::getMetadata() const {
+    // Complete: the buffer is final and stable. Incomplete: pieces sit at
+    // their final offsets already, with holes zero-filled.
+    return buffer_;
 }
 
-void MetadataExchange::handleRequest(const bencode::BencodeDict& dict) {
+void MetadataExchange::handleRequest(size_t piece_index) {
     // Peer is requesting a metadata piece from us
-    if (dict.find("piece") == dict.end() || !dict.at("piece").isInt()) {
-        return;
-    }
-
-    size_t piece_index = static_cast<size_t>(dict.at("piece").asInt());
-
     LOG_DEBUG("Peer requested metadata piece {}", piece_index);
 
     // TODO: Send piece if we have full metadata
     // This would be handled by the caller (peer connection)
 }
 
-void MetadataExchange::handleData(const bencode::BencodeDict& dict,
-                                  const std::vector<uint8_t>& piece_data) {
+void MetadataExchange::handleData(size_t piece_index,
+                                  const uint8_t* piece_data, size_t data_len) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (dict.find("piece") == dict.end() || !dict.at("piece").isInt()) {
-        return;
-    }
-
-    size_t piece_index = static_cast<size_t>(dict.at("piece").asInt());
-
     if (piece_index >= num_pieces_) {
         LOG_WARN("Received invalid metadata piece index: {}", piece_index);
         return;
     }
 
-    if (have_pieces_[piece_index]) {
+    if (have_pieces_.test(piece_index)) {
         LOG_DEBUG("Already have metadata piece {}", piece_index);
         return;
     }
 
-    // Store piece
-    pieces_[piece_index] = piece_data;
-    have_pieces_[piece_index] = true;
+    // Copy straight to the piece's final offset (clamped to the declared
+    // metadata size; the last piece is short)
+    size_t offset = piece_index * METADATA_PIECE_SIZE;
+    size_t length = std::min(data_len, buffer_.size() - offset);
+    std::memcpy(buffer_.data() + offset, piece_data, length);
+    have_pieces_.set(piece_index);
+    size_t received = received_count_.fetch_add(1, std::memory_order_relaxed) + 1;
     requested_pieces_.erase(piece_index);
 
     LOG_INFO("Received metadata piece {} ({} bytes). Progress: {:.1f}%",
-            piece_index, piece_data.size(), progress());
+            piece_index, data_len,
+            (double)received / num_pieces_ * 100.0);
 
     // Check if complete
     checkCompletion();
 }
 
-void MetadataExchange::handleReject(const bencode::BencodeDict& dict) {
+void MetadataExchange::handleReject(size_t piece_index) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (dict.find("piece") == dict.end() || !dict.at("piece").isInt()) {
-        return;
-    }
-
-    size_t piece_index = static_cast<size_t>(dict.at("piece").asInt());
-
     LOG_WARN("Peer rejected metadata piece request: {}", piece_index);
 
     // Remove from requested set so we can try again
@@ -259,31 +333,24 @@ void MetadataExchange::handleReject(const bencode::BencodeDict& dict) {
 }
 
 void MetadataExchange::checkCompletion() {
-    // Check if all pieces received
-    for (bool have : have_pieces_) {
-        if (!have) {
-            return; // Not complete yet
-        }
-    }
-
-    // Assemble full metadata
-    full_metadata_.clear();
-    for (const auto& piece : pieces_) {
-        full_metadata_.insert(full_metadata_.end(), piece.begin(), piece.end());
-    }
-
-    // Trim to exact size
-    if (full_metadata_.size() > static_cast<size_t>(metadata_size_)) {
-        full_metadata_.resize(metadata_size_);
+    // handleData bumps received_count_ only on a fresh have-bit, so the
+    // counter equals the popcount and the per-piece completion test is
+    // O(1) instead of a word scan
+    if (received_count_.load(std::memory_order_relaxed) != num_pieces_) {
+        return; // Not complete yet
     }
 
-    complete_ = true;
+    // Pieces were written at their final offsets and the buffer is
+    // already exactly metadata_size_, so there is nothing to assemble —
+    // the assembly buffer IS the metadata. Release-publish so a
+    // lock-free isComplete() reader observes the finished bytes.
+    complete_.store(true, std::memory_order_release);
 
-    LOG_INFO("Metadata download complete! Total size: {} bytes", full_metadata_.size());
+    LOG_INFO("Metadata download complete! Total size: {} bytes", buffer_.size());
 
     // Call completion callback
     if (on_complete_) {
-        on_complete_(full_metadata_);
+        on_complete_(buffer_);
     }
 }
 
@@ -10,6 +10,19 @@ namespace torrent {
 // Verification constant (8 zero bytes)
 const std::vector<uint8_t> MSEHandshake::VC = {0, 0, 0, 0, 0, 0, 0, 0};
 
+namespace {
+
+const char* methodName(MSEHandshake::CryptoMethod method) {
+    switch (method) {
+        case MSEHandshake::AES_CTR: return "AES-CTR";
+        case MSEHandshake::RC4: return "RC4";
+        case MSEHandshake::PLAINTEXT: return "plaintext";
+    }
+    return "unknown";
+}
+
+} // namespace
+
 // ============================================================================
 // Constructor / Destructor
 // ============================================================================
@@ -50,16 +63,16 @@ MSEHandshake::Result MSEHandshake::performHandshakeInitiator(PeerConnection& con
             return result;
         }
 
-        // Compute shared secret
-        shared_secret_ = dh_.computeSharedSecret(
-            std::vector<uint8_t>(public_key_.begin() + 96, public_key_.end()),
-            private_key_
-        );
+        // Shared secret was computed from Yb inside receivePacket2; the
+        // recomputation that used to sit here sliced past the end of our
+        // own 96-byte key (an empty base) and cost a second modexp for a
+        // wrong answer.
 
         // Derive encryption keys
         keys_ = crypto::deriveKeys(shared_secret_, info_hash_, true);
 
-        // Initialize RC4 ciphers
+        // Initialize RC4 ciphers (the handshake itself is always RC4); the
+        // AES-CTR pair takes over for the payload stream if negotiated
         outgoing_cipher_ = std::make_unique<crypto::RC4>();
         incoming_cipher_ = std::make_unique<crypto::RC4>();
         outgoing_cipher_->init(keys_.outgoing_key);
@@ -67,6 +80,13 @@ MSEHandshake::Result MSEHandshake::performHandshakeInitiator(PeerConnection& con
         outgoing_cipher_->discard(1024);
         incoming_cipher_->discard(1024);
 
+        if (crypto::AesCtrStream::hardwareAvailable()) {
+            aes_outgoing_cipher_ = std::make_unique<crypto::AesCtrStream>();
+            aes_incoming_cipher_ = std::make_unique<crypto::AesCtrStream>();
+            aes_outgoing_cipher_->init(keys_.outgoing_key);
+            aes_incoming_cipher_->init(keys_.incoming_key);
+        }
+
         // Step 3: Send encrypted HASH("req1", S) + negotiation
         std::vector<uint8_t> initial_payload;  // Can include BT handshake
         if (!sendPacket3(conn, initial_payload)) {
@@ -84,7 +104,7 @@ MSEHandshake::Result MSEHandshake::performHandshakeInitiator(PeerConnection& con
         result.success = true;
         result.selected_method = selected_method_;
         LOG_INFO("MSE: Handshake completed as initiator, method: {}",
-                selected_method_ == RC4 ? "RC4" : "plaintext");
+                methodName(selected_method_));
 
     } catch (const std::exception& e) {
         result.error_message = std::string("MSE handshake exception: ") + e.what();
@@ -123,7 +143,8 @@ MSEHandshake::Result MSEHandshake::performHandshakeResponder(PeerConnection& con
         // Derive encryption keys
         keys_ = crypto::deriveKeys(shared_secret_, info_hash_, false);
 
-        // Initialize RC4 ciphers
+        // Initialize RC4 ciphers (the handshake itself is always RC4); the
+        // AES-CTR pair takes over for the payload stream if negotiated
         outgoing_cipher_ = std::make_unique<crypto::RC4>();
         incoming_cipher_ = std::make_unique<crypto::RC4>();
         outgoing_cipher_->init(keys_.outgoing_key);
@@ -131,6 +152,13 @@ MSEHandshake::Result MSEHandshake::performHandshakeResponder(PeerConnection& con
         outgoing_cipher_->discard(1024);
         incoming_cipher_->discard(1024);
 
+        if (crypto::AesCtrStream::hardwareAvailable()) {
+            aes_outgoing_cipher_ = std::make_unique<crypto::AesCtrStream>();
+            aes_incoming_cipher_ = std::make_unique<crypto::AesCtrStream>();
+            aes_outgoing_cipher_->init(keys_.outgoing_key);
+            aes_incoming_cipher_->init(keys_.incoming_key);
+        }
+
         // Step 3: Receive encrypted verification
         if (!receivePacket3Responder(conn)) {
             result.error_message = "Failed to receive packet 3 (encrypted verification)";
@@ -146,7 +174,7 @@ MSEHandshake::Result MSEHandshake::performHandshakeResponder(PeerConnection& con
         result.success = true;
         result.selected_method = selected_method_;
         LOG_INFO("MSE: Handshake completed as responder, method: {}",
-                selected_method_ == RC4 ? "RC4" : "plaintext");
+                methodName(selected_method_));
 
     } catch (const std::exception& e) {
         result.error_message = std::string("MSE handshake exception: ") + e.what();
@@ -163,9 +191,11 @@ MSEHandshake::Result MSEHandshake::performHandshakeResponder(PeerConnection& con
 bool MSEHandshake::sendPacket1(PeerConnection& conn) {
     LOG_DEBUG("MSE: Sending packet 1 (Ya + PadA)");
 
-    // Public key is 96 bytes
-    if (public_key_.size() != 96) {
-        public_key_.resize(96, 0);
+    // Public key is 96 bytes. BN_bn2bin strips leading zero bytes, so
+    // left-pad the big-endian value back to the fixed width (a trailing
+    // resize would multiply it by 256 per missing byte).
+    if (public_key_.size() < 96) {
+        public_key_.insert(public_key_.begin(), 96 - public_key_.size(), 0);
     }
 
     // Generate random padding (0-512 bytes)
@@ -286,6 +316,7 @@ bool MSEHandshake::receivePacket4(PeerConnection& conn) {
     const size_t chunk_size = 1024;
     bool found_vc = false;
     size_t vc_position = 0;
+    size_t search_from = 0;
 
     while (!found_vc && bytes_read < buffer.size()) {
         size_t to_read = std::min(chunk_size, buffer.size() - bytes_read);
@@ -299,14 +330,15 @@ bool MSEHandshake::receivePacket4(PeerConnection& conn) {
         incoming_cipher_->crypt(buffer.data() + bytes_read, to_read);
         bytes_read += to_read;
 
-        // Search for VC
-        for (size_t i = 0; i + 8 <= bytes_read; ++i) {
-            if (std::memcmp(buffer.data() + i, VC.data(), 8) == 0) {
-                found_vc = true;
-                vc_position = i;
-                LOG_DEBUG("MSE: Found VC at position {}", vc_position);
-                break;
-            }
+        // Search for VC; resume where the last chunk left off (backed up
+        // 7 bytes for a match straddling the chunk boundary)
+        int pos = findSyncPattern(buffer.data(), bytes_read, VC, search_from);
+        if (pos >= 0) {
+            found_vc = true;
+            vc_position = static_cast<size_t>(pos);
+            LOG_DEBUG("MSE: Found VC at position {}", vc_position);
+        } else {
+            search_from = bytes_read >= 7 ? bytes_read - 7 : 0;
         }
     }
 
@@ -326,7 +358,9 @@ bool MSEHandshake::receivePacket4(PeerConnection& conn) {
     LOG_DEBUG("MSE: Peer crypto_select: 0x{:08x}", crypto_select);
 
     // Verify selected method
-    if (crypto_select == RC4) {
+    if (crypto_select == AES_CTR && aes_incoming_cipher_) {
+        selected_method_ = AES_CTR;
+    } else if (crypto_select == RC4) {
         selected_method_ = RC4;
     } else if (crypto_select == PLAINTEXT) {
         selected_method_ = PLAINTEXT;
@@ -338,12 +372,12 @@ bool MSEHandshake::receivePacket4(PeerConnection& conn) {
     // Check if selected method is acceptable
     if (!isMethodAcceptable(selected_method_)) {
         LOG_ERROR("MSE: Peer selected unacceptable method: {}",
-                 selected_method_ == RC4 ? "RC4" : "plaintext");
+                 methodName(selected_method_));
         return false;
     }
 
     LOG_DEBUG("MSE: Selected encryption method: {}",
-             selected_method_ == RC4 ? "RC4" : "plaintext");
+             methodName(selected_method_));
 
     return true;
 }
@@ -380,9 +414,9 @@ bool MSEHandshake::receivePacket1Responder(PeerConnection& conn) {
 bool MSEHandshake::sendPacket2Responder(PeerConnection& conn) {
     LOG_DEBUG("MSE: Sending packet 2 as responder (Yb + PadB)");
 
-    // Ensure public key is 96 bytes
-    if (public_key_.size() != 96) {
-        public_key_.resize(96, 0);
+    // Ensure public key is 96 bytes (left-padded; see sendPacket1)
+    if (public_key_.size() < 96) {
+        public_key_.insert(public_key_.begin(), 96 - public_key_.size(), 0);
     }
 
     // Generate random padding
@@ -445,6 +479,7 @@ bool MSEHandshake::receivePacket3Responder(PeerConnection& conn) {
     // Read and decrypt until we find VC
     bool found_vc = false;
     size_t vc_position = 0;
+    size_t search_from = 40;
 
     while (!found_vc && bytes_read < buffer.size()) {
         size_t to_read = std::min<size_t>(1024, buffer.size() - bytes_read);
@@ -458,14 +493,15 @@ bool MSEHandshake::receivePacket3Responder(PeerConnection& conn) {
         incoming_cipher_->crypt(buffer.data() + bytes_read, to_read);
         bytes_read += to_read;
 
-        // Search for VC starting from position 40
-        for (size_t i = 40; i + 8 <= bytes_read; ++i) {
-            if (std::memcmp(buffer.data() + i, VC.data(), 8) == 0) {
-                found_vc = true;
-                vc_position = i;
-                LOG_DEBUG("MSE: Found VC at position {}", vc_position);
-                break;
-            }
+        // Search for VC starting from position 40; resume where the last
+        // chunk left off (backed up 7 bytes for a straddling match)
+        int pos = findSyncPattern(buffer.data(), bytes_read, VC, search_from);
+        if (pos >= 0) {
+            found_vc = true;
+            vc_position = static_cast<size_t>(pos);
+            LOG_DEBUG("MSE: Found VC at position {}", vc_position);
+        } else if (bytes_read >= 47) {
+            search_from = bytes_read - 7;
         }
     }
 
@@ -487,7 +523,7 @@ bool MSEHandshake::receivePacket3Responder(PeerConnection& conn) {
     selected_method_ = selectCryptoMethod(peer_crypto_provide);
 
     LOG_DEBUG("MSE: Selected method: {}",
-             selected_method_ == RC4 ? "RC4" : "plaintext");
+             methodName(selected_method_));
 
     return true;
 }
@@ -528,8 +564,44 @@ bool MSEHandshake::sendPacket4Responder(PeerConnection& conn) {
 // Helper Functions
 // ============================================================================
 
+int MSEHandshake::findSyncPattern(const uint8_t* data, size_t len,
+                                  const std::vector<uint8_t>& pattern,
+                                  size_t start) {
+    if (pattern.empty() || len < pattern.size()) {
+        return -1;
+    }
+
+    if (pattern.size() >= 8) {
+        // First-word filter: only positions whose leading 8 bytes match
+        // pay for the tail memcmp. For the 8-byte VC the word compare is
+        // the whole test.
+        uint64_t first8;
+        std::memcpy(&first8, pattern.data(), 8);
+
+        for (size_t i = start; i + pattern.size() <= len; ++i) {
+            uint64_t w;
+            std::memcpy(&w, data + i, 8);
+            if (w == first8 &&
+                (pattern.size() == 8 ||
+                 std::memcmp(data + i + 8, pattern.data() + 8,
+                             pattern.size() - 8) == 0)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    for (size_t i = start; i + pattern.size() <= len; ++i) {
+        if (std::memcmp(data + i, pattern.data(), pattern.size()) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
 std::vector<uint8_t> MSEHandshake::computeReq1() const {
     std::vector<uint8_t> data;
+    data.reserve(4 + shared_secret_.size());
     data.insert(data.end(), {'r', 'e', 'q', '1'});
     data.insert(data.end(), shared_secret_.begin(), shared_secret_.end());
     return utils::sha1(data);
@@ -537,6 +609,7 @@ std::vector<uint8_t> MSEHandshake::computeReq1() const {
 
 std::vector<uint8_t> MSEHandshake::computeReq2() const {
     std::vector<uint8_t> data;
+    data.reserve(4 + info_hash_.size());
     data.insert(data.end(), {'r', 'e', 'q', '2'});
     data.insert(data.end(), info_hash_.begin(), info_hash_.end());
     return utils::sha1(data);
@@ -544,48 +617,73 @@ std::vector<uint8_t> MSEHandshake::computeReq2() const {
 
 std::vector<uint8_t> MSEHandshake::computeReq3() const {
     std::vector<uint8_t> data;
+    data.reserve(4 + shared_secret_.size());
     data.insert(data.end(), {'r', 'e', 'q', '3'});
     data.insert(data.end(), shared_secret_.begin(), shared_secret_.end());
     return utils::sha1(data);
 }
 
+// The negotiation domain is tiny: 3 Mode values x a 3-bit crypto_provide
+// mask.  Flat tables replace the old bit-test chains so the first handshake
+// of a connection takes a single predicted load instead of a run of cold
+// branches.  AES-CTR support without AES-NI is folded in by masking the
+// AES_CTR bit out of the peer's provide word before indexing.
+
+// Methods we advertise (and accept) per mode, before the hardware mask.
+static constexpr uint32_t kProvideByMode[3] = {
+    // PREFER_PLAINTEXT
+    MSEHandshake::PLAINTEXT | MSEHandshake::RC4 | MSEHandshake::AES_CTR,
+    // PREFER_ENCRYPTED
+    MSEHandshake::PLAINTEXT | MSEHandshake::RC4 | MSEHandshake::AES_CTR,
+    // REQUIRE_ENCRYPTED
+    MSEHandshake::RC4 | MSEHandshake::AES_CTR,
+};
+
+// kSelect[mode][peer_provide & 7]: the method picked for every reachable
+// input.  Among encrypted methods AES-CTR wins whenever both ends provide
+// it; rows for a peer that provides nothing usable fall back to PLAINTEXT,
+// matching the old fallback path (isMethodAcceptable rejects it later when
+// the mode requires encryption).
+static constexpr MSEHandshake::CryptoMethod kSelect[3][8] = {
+    // PREFER_PLAINTEXT: plaintext first, then AES-CTR, then RC4
+    { MSEHandshake::PLAINTEXT, MSEHandshake::PLAINTEXT,
+      MSEHandshake::RC4,       MSEHandshake::PLAINTEXT,
+      MSEHandshake::AES_CTR,   MSEHandshake::PLAINTEXT,
+      MSEHandshake::AES_CTR,   MSEHandshake::PLAINTEXT },
+    // PREFER_ENCRYPTED: AES-CTR first, then RC4, then plaintext
+    { MSEHandshake::PLAINTEXT, MSEHandshake::PLAINTEXT,
+      MSEHandshake::RC4,       MSEHandshake::RC4,
+      MSEHandshake::AES_CTR,   MSEHandshake::AES_CTR,
+      MSEHandshake::AES_CTR,   MSEHandshake::AES_CTR },
+    // REQUIRE_ENCRYPTED: AES-CTR, then RC4; no plaintext row succeeds
+    { MSEHandshake::PLAINTEXT, MSEHandshake::PLAINTEXT,
+      MSEHandshake::RC4,       MSEHandshake::RC4,
+      MSEHandshake::AES_CTR,   MSEHandshake::AES_CTR,
+      MSEHandshake::AES_CTR,   MSEHandshake::AES_CTR },
+};
+
 uint32_t MSEHandshake::getCryptoProvide() const {
-    switch (mode_) {
-        case Mode::PREFER_PLAINTEXT:
-            return PLAINTEXT | RC4;
-        case Mode::PREFER_ENCRYPTED:
-            return RC4 | PLAINTEXT;
-        case Mode::REQUIRE_ENCRYPTED:
-            return RC4;
+    uint32_t provide = kProvideByMode[static_cast<int>(mode_)];
+    // Only advertise AES-CTR when this host can actually run it
+    if (!crypto::AesCtrStream::hardwareAvailable()) {
+        provide &= ~static_cast<uint32_t>(AES_CTR);
     }
-    return PLAINTEXT | RC4;
+    return provide;
 }
 
 MSEHandshake::CryptoMethod MSEHandshake::selectCryptoMethod(uint32_t peer_crypto_provide) const {
-    // Select based on our mode and peer's capabilities
-    switch (mode_) {
-        case Mode::PREFER_PLAINTEXT:
-            if (peer_crypto_provide & PLAINTEXT) return PLAINTEXT;
-            if (peer_crypto_provide & RC4) return RC4;
-            break;
-        case Mode::PREFER_ENCRYPTED:
-        case Mode::REQUIRE_ENCRYPTED:
-            if (peer_crypto_provide & RC4) return RC4;
-            if (mode_ == Mode::PREFER_ENCRYPTED && (peer_crypto_provide & PLAINTEXT)) {
-                return PLAINTEXT;
-            }
-            break;
+    uint32_t provide = peer_crypto_provide & (PLAINTEXT | RC4 | AES_CTR);
+    if (!crypto::AesCtrStream::hardwareAvailable()) {
+        provide &= ~static_cast<uint32_t>(AES_CTR);
     }
-
-    // Fallback
-    return (peer_crypto_provide & RC4) ? RC4 : PLAINTEXT;
+    return kSelect[static_cast<int>(mode_)][provide];
 }
 
 bool MSEHandshake::isMethodAcceptable(CryptoMethod method) const {
-    if (mode_ == Mode::REQUIRE_ENCRYPTED && method == PLAINTEXT) {
-        return false;
-    }
-    return true;
+    // The unmasked provide table doubles as the per-mode acceptance mask:
+    // REQUIRE_ENCRYPTED is the only row without the PLAINTEXT bit.
+    return (static_cast<uint32_t>(method) &
+            kProvideByMode[static_cast<int>(mode_)]) != 0;
 }
 
 bool MSEHandshake::readExactly(PeerConnection& conn, uint8_t* buffer, size_t length) {
@@ -605,15 +703,21 @@ EncryptedStream::~EncryptedStream() = default;
 
 void EncryptedStream::init(MSEHandshake::CryptoMethod method,
                            std::unique_ptr<crypto::RC4> outgoing_cipher,
-                           std::unique_ptr<crypto::RC4> incoming_cipher)
+                           std::unique_ptr<crypto::RC4> incoming_cipher,
+                           std::unique_ptr<crypto::AesCtrStream> aes_outgoing_cipher,
+                           std::unique_ptr<crypto::AesCtrStream> aes_incoming_cipher)
 {
     method_ = method;
     outgoing_cipher_ = std::move(outgoing_cipher);
     incoming_cipher_ = std::move(incoming_cipher);
+    aes_outgoing_cipher_ = std::move(aes_outgoing_cipher);
+    aes_incoming_cipher_ = std::move(aes_incoming_cipher);
 }
 
 void EncryptedStream::encrypt(uint8_t* data, size_t length) {
-    if (method_ == MSEHandshake::CryptoMethod::RC4 && outgoing_cipher_) {
+    if (method_ == MSEHandshake::CryptoMethod::AES_CTR && aes_outgoing_cipher_) {
+        aes_outgoing_cipher_->crypt(data, length);
+    } else if (method_ == MSEHandshake::CryptoMethod::RC4 && outgoing_cipher_) {
         outgoing_cipher_->crypt(data, length);
     }
 }
@@ -623,7 +727,9 @@ void EncryptedStream::encrypt(std::vector<uint8_t>& data) {
 }
 
 void EncryptedStream::decrypt(uint8_t* data, size_t length) {
-    if (method_ == MSEHandshake::CryptoMethod::RC4 && incoming_cipher_) {
+    if (method_ == MSEHandshake::CryptoMethod::AES_CTR && aes_incoming_cipher_) {
+        aes_incoming_cipher_->crypt(data, length);
+    } else if (method_ == MSEHandshake::CryptoMethod::RC4 && incoming_cipher_) {
         incoming_cipher_->crypt(data, length);
     }
 }
@@ -28,11 +28,17 @@ static void initWinsock() {
 #else
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <poll.h>
 #include <errno.h>
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
@@ -41,6 +47,47 @@ static void initWinsock() {
 
 namespace torrent {
 
+// Key for the in-flight block maps: piece index in the high word, byte
+// offset in the low word. Fits in a register; no string formatting on
+// the per-block path.
+static inline uint64_t blockKey(uint32_t piece_index, uint32_t offset) {
+    return (static_cast<uint64_t>(piece_index) << 32) | offset;
+}
+
+#ifndef _WIN32
+// Park the sender until the kernel can take more data. Replaces the
+// fixed 10 ms retry sleep on EAGAIN: a backpressured connection resumes
+// the instant the socket buffer drains instead of up to a tick later,
+// and a saturated uploader stops burning wakeups on a full buffer. The
+// timeout only bounds the wait; callers re-issue the send and handle
+// errors there.
+static void waitWritable(int fd) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    ::poll(&pfd, 1, 1000);
+}
+#endif
+
+namespace {
+
+// Read a big-endian uint32 from the wire: one unaligned load plus a bswap
+// instead of four byte loads and shift-ORs
+inline uint32_t readBE32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+}
+
+// Write a big-endian uint32: bswap plus one unaligned store
+inline void writeBE32(uint8_t* p, uint32_t v) {
+    v = __builtin_bswap32(v);
+    std::memcpy(p, &v, 4);
+}
+
+} // namespace
+
 PeerConnection::PeerConnection(const std::string& ip,
                               uint16_t port,
                               const std::vector<uint8_t>& info_hash,
@@ -198,8 +245,17 @@ void PeerConnection::disconnect() {
     connected_ = false;
     handshake_completed_ = false;
     remote_peer_id_.clear();
+    recv_buffer_.clear();
+    recv_buffer_pos_ = 0;
     clearPendingRequests();
     clearPendingUploads();
+
+    // Give back this peer's contribution to the piece availability counts.
+    // Resetting the bitfield afterwards keeps repeated disconnects harmless.
+    if (piece_manager_ && !peer_bitfield_.none()) {
+        piece_manager_->removePeerAvailability(peer_bitfield_);
+        peer_bitfield_.resetAll();
+    }
 }
 
 void PeerConnection::setUtpSocket(std::shared_ptr<utp::UtpSocket> utp_socket) {
@@ -244,50 +300,36 @@ bool PeerConnection::performHandshake() {
     // peer_id = 20 bytes
     // Total: 68 bytes
 
-    // Build handshake message
-    std::vector<uint8_t> handshake;
-    handshake.reserve(68);
-
-    // Protocol string length
-    handshake.push_back(19);
-
-    // Protocol string
-    std::string protocol = "BitTorrent protocol";
-    handshake.insert(handshake.end(), protocol.begin(), protocol.end());
-
-    // Reserved bytes (8 bytes)
-    // Byte 7, bit 0x04: Fast Extension (BEP 6)
-    // Byte 5, bit 0x10: Extension Protocol (BEP 10)
-    std::vector<uint8_t> reserved(8, 0);
-    if (supports_fast_extension_) {
-        reserved[7] |= 0x04;  // Fast Extension support
-    }
-    reserved[5] |= 0x10;  // Extension Protocol support
-    handshake.insert(handshake.end(), reserved.begin(), reserved.end());
-
-    // Info hash (20 bytes)
+    // Build handshake message on the stack: fixed 68-byte layout, no
+    // allocations
     if (info_hash_.size() != 20) {
         std::cerr << "ERROR: Invalid info_hash size: " << info_hash_.size() << " (expected 20)\n";
         return false;
     }
-    handshake.insert(handshake.end(), info_hash_.begin(), info_hash_.end());
-
-    // Peer ID (20 bytes)
     if (peer_id_.size() != 20) {
         std::cerr << "ERROR: Invalid peer_id size: " << peer_id_.size() << " (expected 20)\n";
         return false;
     }
-    handshake.insert(handshake.end(), peer_id_.begin(), peer_id_.end());
 
-    // Sanity check
-    if (handshake.size() != 68) {
-        std::cerr << "ERROR: Invalid handshake size: " << handshake.size() << " (expected 68)\n";
-        return false;
+    uint8_t handshake[68];
+    handshake[0] = 19;
+    std::memcpy(handshake + 1, "BitTorrent protocol", 19);
+
+    // Reserved bytes (8 bytes)
+    // Byte 7, bit 0x04: Fast Extension (BEP 6)
+    // Byte 5, bit 0x10: Extension Protocol (BEP 10)
+    std::memset(handshake + 20, 0, 8);
+    if (supports_fast_extension_) {
+        handshake[27] |= 0x04;  // Fast Extension support
     }
+    handshake[25] |= 0x10;  // Extension Protocol support
+
+    std::memcpy(handshake + 28, info_hash_.data(), 20);
+    std::memcpy(handshake + 48, peer_id_.data(), 20);
 
     // Send handshake
-    std::cout << "  Sending handshake (" << handshake.size() << " bytes)...\n";
-    if (!sendData(handshake.data(), handshake.size())) {
+    std::cout << "  Sending handshake (68 bytes)...\n";
+    if (!sendData(handshake, sizeof(handshake))) {
         std::cerr << "ERROR: Failed to send handshake\n";
         disconnect();
         return false;
@@ -338,15 +380,13 @@ bool PeerConnection::performHandshake() {
     std::vector<uint8_t> received_info_hash(response.begin() + 28, response.begin() + 48);
     if (received_info_hash != info_hash_) {
         std::cerr << "ERROR: Invalid handshake response - info_hash mismatch\n";
-        std::cerr << "  Expected: ";
-        for (size_t i = 0; i < std::min(info_hash_.size(), size_t(8)); ++i) {
-            std::cerr << std::hex << static_cast<int>(info_hash_[i]) << " ";
-        }
-        std::cerr << "...\n  Received: ";
-        for (size_t i = 0; i < std::min(received_info_hash.size(), size_t(8)); ++i) {
-            std::cerr << std::hex << static_cast<int>(received_info_hash[i]) << " ";
-        }
-        std::cerr << std::dec << "...\n";
+        std::cerr << "  Expected: "
+                  << utils::toHex(info_hash_.data(),
+                                  std::min(info_hash_.size(), size_t(8)))
+                  << "...\n  Received: "
+                  << utils::toHex(received_info_hash.data(),
+                                  std::min(received_info_hash.size(), size_t(8)))
+                  << "...\n";
         disconnect();
         return false;
     }
@@ -380,24 +420,36 @@ bool PeerConnection::performHandshake() {
     return true;
 }
 
-bool PeerConnection::performHandshake(const std::vector<bool>& our_bitfield) {
+bool PeerConnection::performHandshake(const Bitfield& our_bitfield) {
     // First, perform the standard handshake
     if (!performHandshake()) {
         return false;
     }
 
     // After successful handshake, send our bitfield if we have any pieces
-    bool has_any_piece = false;
-    for (bool piece : our_bitfield) {
-        if (piece) {
-            has_any_piece = true;
-            break;
+    if (!our_bitfield.none()) {
+        std::cout << "Sending our bitfield to peer...\n";
+        if (!sendBitfield(our_bitfield)) {
+            std::cerr << "WARNING: Failed to send bitfield, but handshake succeeded\n";
+            // Don't fail the handshake just because bitfield send failed
+        } else {
+            std::cout << "Successfully sent bitfield to peer\n";
         }
+    } else {
+        std::cout << "Not sending bitfield (no pieces downloaded yet)\n";
     }
 
-    if (has_any_piece) {
+    return true;
+}
+
+bool PeerConnection::performHandshake(const std::vector<uint8_t>& bitfield_frame) {
+    if (!performHandshake()) {
+        return false;
+    }
+
+    if (!bitfield_frame.empty()) {
         std::cout << "Sending our bitfield to peer...\n";
-        if (!sendBitfield(our_bitfield)) {
+        if (!sendSerializedMessage(bitfield_frame.data(), bitfield_frame.size())) {
             std::cerr << "WARNING: Failed to send bitfield, but handshake succeeded\n";
             // Don't fail the handshake just because bitfield send failed
         } else {
@@ -411,53 +463,111 @@ bool PeerConnection::performHandshake(const std::vector<bool>& our_bitfield) {
 }
 
 bool PeerConnection::sendMessage(const PeerMessage& message) {
-    std::vector<uint8_t> data = serializeMessage(message);
-    return sendData(data.data(), data.size());
+    // Message format: <length><id><payload>. The 5-byte frame header
+    // lives on the stack and the payload is sent from where it already
+    // is — no per-message heap frame, still one syscall.
+    uint8_t header[5];
+    writeBE32(header, static_cast<uint32_t>(1 + message.payload.size()));
+    header[4] = static_cast<uint8_t>(message.type);
+
+    return sendFrameVec(header, sizeof(header),
+                        message.payload.data(), message.payload.size());
 }
 
-std::vector<uint8_t> PeerConnection::serializeMessage(const PeerMessage& message) {
-    std::vector<uint8_t> result;
+bool PeerConnection::sendSerializedMessage(const uint8_t* frame, size_t length) {
+    return sendData(frame, length);
+}
 
-    // Message format: <length><id><payload>
-    uint32_t length = 1 + message.payload.size();
+void PeerConnection::corkOutput(bool enable) {
+#if defined(TCP_CORK)
+    if (transport_type_ == TransportType::UTP || socket_fd_ == INVALID_SOCKET) {
+        return;
+    }
+    int flag = enable ? 1 : 0;
+    setsockopt(socket_fd_, IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag));
+#else
+    (void)enable;
+#endif
+}
+
+bool PeerConnection::sendFrameVec(const uint8_t* header, size_t header_len,
+                                  const uint8_t* payload, size_t payload_len) {
+#ifndef _WIN32
+    // TCP: gather-write both pieces with a single writev
+    if (connected_ && transport_type_ == TransportType::TCP &&
+        socket_fd_ != INVALID_SOCKET) {
+        struct iovec iov[2] = {
+            {const_cast<uint8_t*>(header), header_len},
+            {const_cast<uint8_t*>(payload), payload_len}
+        };
+        struct iovec* cur = iov;
+        int iovcnt = payload_len > 0 ? 2 : 1;
+
+        while (iovcnt > 0) {
+            ssize_t sent = ::writev(socket_fd_, cur, iovcnt);
+
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    waitWritable(socket_fd_);
+                    continue;
+                }
 
-    // Length (big-endian)
-    result.push_back((length >> 24) & 0xFF);
-    result.push_back((length >> 16) & 0xFF);
-    result.push_back((length >> 8) & 0xFF);
-    result.push_back(length & 0xFF);
+                std::cerr << "Send failed\n";
+                disconnect();
+                return false;
+            }
 
-    // ID
-    result.push_back(static_cast<uint8_t>(message.type));
+            if (sent == 0) {
+                std::cerr << "Connection closed by peer\n";
+                disconnect();
+                return false;
+            }
+
+            // Advance past fully written iovecs, then trim the partial one
+            while (iovcnt > 0 && static_cast<size_t>(sent) >= cur->iov_len) {
+                sent -= cur->iov_len;
+                ++cur;
+                --iovcnt;
+            }
+            if (iovcnt > 0) {
+                cur->iov_base = static_cast<uint8_t*>(cur->iov_base) + sent;
+                cur->iov_len -= sent;
+            }
+        }
 
-    // Payload
-    result.insert(result.end(), message.payload.begin(), message.payload.end());
+        return true;
+    }
+#endif
 
-    return result;
+    // uTP (its send path coalesces internally) and Windows (no writev):
+    // sequential sends preserve the stream layout
+    if (!sendData(header, header_len)) {
+        return false;
+    }
+    return payload_len == 0 || sendData(payload, payload_len);
 }
 
-std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
+std::optional<PeerMessage> PeerConnection::receiveMessage() {
     if (!connected_) {
-        return nullptr;
+        return std::nullopt;
     }
 
     // Read message length (4 bytes, big-endian)
     uint8_t length_bytes[4];
     if (!receiveData(length_bytes, 4)) {
-        return nullptr;
+        return std::nullopt;
     }
 
-    uint32_t message_length = (static_cast<uint32_t>(length_bytes[0]) << 24) |
-                              (static_cast<uint32_t>(length_bytes[1]) << 16) |
-                              (static_cast<uint32_t>(length_bytes[2]) << 8) |
-                              static_cast<uint32_t>(length_bytes[3]);
+    uint32_t message_length = readBE32(length_bytes);
 
     // Keep-alive message (length = 0)
     if (message_length == 0) {
-        auto message = std::make_unique<PeerMessage>();
-        message->type = MessageType::KEEP_ALIVE;
+        PeerMessage message;
+        message.type = MessageType::KEEP_ALIVE;
         std::cout << "Received KEEP_ALIVE message\n";
-        message_queue_.push(std::move(message));
+        if (!message_queue_.push(std::move(message))) {
+            return message;  // Ring full (consumer stalled): deliver directly
+        }
         return popMessage();
     }
 
@@ -465,32 +575,82 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
     if (message_length > 262144 + 9) {
         std::cerr << "ERROR: Invalid message length: " << message_length << " (max 262153)\n";
         disconnect();
-        return nullptr;
+        return std::nullopt;
     }
 
     // Read message ID (1 byte)
     uint8_t message_id;
     if (!receiveData(&message_id, 1)) {
         std::cerr << "ERROR: Failed to read message ID\n";
-        return nullptr;
-    }
+        return std::nullopt;
+    }
+
+    // Read payload (if any); small ones stay inline in the message
+    SmallBuf payload;
+    uint32_t zero_copy_length = 0;
+    uint32_t zc_piece_index = 0;
+    uint32_t zc_block_offset = 0;
+    size_t payload_length = message_length - 1;
+
+    if (static_cast<MessageType>(message_id) == MessageType::PIECE &&
+        piece_manager_ != nullptr && payload_length >= 8) {
+        // Zero-copy receive: read the 8-byte index/offset header, then
+        // scatter the block data straight into the in-progress piece buffer
+        // instead of staging it in a payload vector.
+        uint8_t header[8];
+        if (!receiveData(header, 8)) {
+            std::cerr << "ERROR: Failed to read PIECE header\n";
+            return std::nullopt;
+        }
+
+        uint32_t piece_index = readBE32(header);
+        uint32_t block_offset = readBE32(header + 4);
+        uint32_t data_length = static_cast<uint32_t>(payload_length - 8);
 
-    // Read payload (if any)
-    std::vector<uint8_t> payload;
-    if (message_length > 1) {
-        payload.resize(message_length - 1);
+        uint8_t* dest = piece_manager_->blockReceiveBuffer(piece_index, block_offset, data_length);
+        if (dest != nullptr) {
+            if (!receiveData(dest, data_length)) {
+                std::cerr << "ERROR: Failed to read PIECE data (expected " << data_length << " bytes)\n";
+                return std::nullopt;
+            }
+            piece_manager_->commitReceivedBlock(piece_index, block_offset, data_length);
+            zc_piece_index = piece_index;
+            zc_block_offset = block_offset;
+            zero_copy_length = data_length;
+        } else {
+            // Duplicate or unwanted block: drain it into the reusable
+            // scratch buffer (it would be discarded downstream anyway) and
+            // deliver a header-only message, so the bytes still count
+            // against rate limits and stats without a per-message
+            // allocation or copy.
+            if (drain_buffer_.size() < data_length) {
+                drain_buffer_.resize(data_length);
+            }
+            if (!receiveData(drain_buffer_.data(), data_length)) {
+                std::cerr << "ERROR: Failed to read PIECE data (expected " << data_length << " bytes)\n";
+                return std::nullopt;
+            }
+            zc_piece_index = piece_index;
+            zc_block_offset = block_offset;
+            zero_copy_length = data_length;
+        }
+    } else if (message_length > 1) {
+        payload.resize(payload_length);
         if (!receiveData(payload.data(), payload.size())) {
             std::cerr << "ERROR: Failed to read message payload (expected " << (message_length - 1) << " bytes)\n";
-            return nullptr;
+            return std::nullopt;
         }
     }
 
-    auto message = std::make_unique<PeerMessage>();
-    message->type = static_cast<MessageType>(message_id);
-    message->payload = std::move(payload);
+    PeerMessage message;
+    message.type = static_cast<MessageType>(message_id);
+    message.payload = std::move(payload);
+    message.zero_copy_length = zero_copy_length;
+    message.piece_index = zc_piece_index;
+    message.block_offset = zc_block_offset;
 
     // Update peer state based on message type
-    switch (message->type) {
+    switch (message.type) {
         case MessageType::CHOKE:
             peer_choking_ = true;
             std::cout << "Received CHOKE message\n";
@@ -514,23 +674,32 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
             break;
         case MessageType::HAVE: {
             HaveMessage have_msg;
-            if (parseHave(*message, have_msg)) {
+            if (parseHave(message, have_msg)) {
                 // Update peer bitfield - mark the piece as available
-                if (have_msg.piece_index < peer_bitfield_.size()) {
-                    peer_bitfield_[have_msg.piece_index] = true;
-                } else {
+                if (have_msg.piece_index >= peer_bitfield_.size()) {
                     // Expand bitfield if needed
                     peer_bitfield_.resize(have_msg.piece_index + 1, false);
-                    peer_bitfield_[have_msg.piece_index] = true;
+                }
+                if (!peer_bitfield_.test(have_msg.piece_index)) {
+                    peer_bitfield_.set(have_msg.piece_index);
+                    if (piece_manager_) {
+                        piece_manager_->incrementPieceAvailability(have_msg.piece_index);
+                    }
                 }
             }
             break;
         }
         case MessageType::BITFIELD: {
             BitfieldMessage bitfield_msg;
-            if (parseBitfield(*message, bitfield_msg)) {
-                // Update peer bitfield
+            if (parseBitfield(message, bitfield_msg)) {
+                // Update peer bitfield, re-basing this peer's availability counts
+                if (piece_manager_) {
+                    piece_manager_->removePeerAvailability(peer_bitfield_);
+                }
                 peer_bitfield_ = std::move(bitfield_msg.bitfield);
+                if (piece_manager_) {
+                    piece_manager_->addPeerAvailability(peer_bitfield_);
+                }
 
                 // Log statistics
                 size_t piece_count = getPeerPieceCount();
@@ -551,10 +720,10 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
             std::cout << "Received REQUEST message\n";
             break;
         case MessageType::PIECE: {
-            std::cout << "Received PIECE message (" << message->payload.size() << " bytes payload)\n";
+            std::cout << "Received PIECE message (" << message.payload.size() << " bytes payload)\n";
             // Parse PIECE message to get piece_index and offset, then remove from pending
             PieceMessage piece_msg;
-            if (parsePiece(*message, piece_msg)) {
+            if (parsePiece(message, piece_msg)) {
                 removeRequest(piece_msg.piece_index, piece_msg.offset);
             }
             break;
@@ -565,7 +734,7 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
         case MessageType::SUGGEST_PIECE: {
             LOG_DEBUG("Received SUGGEST_PIECE message");
             SuggestPieceMessage suggest_msg;
-            if (parseSuggestPiece(*message, suggest_msg)) {
+            if (parseSuggestPiece(message, suggest_msg)) {
                 suggested_pieces_.push_back(suggest_msg.piece_index);
                 LOG_INFO("Peer suggests downloading piece {}", suggest_msg.piece_index);
             }
@@ -574,20 +743,25 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
         case MessageType::HAVE_ALL:
             LOG_INFO("Received HAVE_ALL message - peer is a seeder");
             // Mark all pieces as available
-            for (size_t i = 0; i < peer_bitfield_.size(); ++i) {
-                peer_bitfield_[i] = true;
+            if (piece_manager_) {
+                piece_manager_->removePeerAvailability(peer_bitfield_);
+            }
+            peer_bitfield_.setAll();
+            if (piece_manager_) {
+                piece_manager_->addPeerAvailability(peer_bitfield_);
             }
             break;
         case MessageType::HAVE_NONE:
             LOG_INFO("Received HAVE_NONE message - peer has no pieces");
             // Mark all pieces as unavailable
-            for (size_t i = 0; i < peer_bitfield_.size(); ++i) {
-                peer_bitfield_[i] = false;
+            if (piece_manager_) {
+                piece_manager_->removePeerAvailability(peer_bitfield_);
             }
+            peer_bitfield_.resetAll();
             break;
         case MessageType::REJECT_REQUEST: {
             RejectRequestMessage reject_msg;
-            if (parseRejectRequest(*message, reject_msg)) {
+            if (parseRejectRequest(message, reject_msg)) {
                 LOG_WARN("Request rejected: piece {} offset {} length {}",
                          reject_msg.piece_index, reject_msg.offset, reject_msg.length);
                 // Remove from pending requests
@@ -597,17 +771,17 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
         }
         case MessageType::ALLOWED_FAST: {
             AllowedFastMessage allowed_msg;
-            if (parseAllowedFast(*message, allowed_msg)) {
+            if (parseAllowedFast(message, allowed_msg)) {
                 allowed_fast_set_.insert(allowed_msg.piece_index);
                 LOG_INFO("Peer allows fast access to piece {}", allowed_msg.piece_index);
             }
             break;
         }
         case MessageType::EXTENDED: {
-            LOG_DEBUG("Received EXTENDED message ({} bytes payload)", message->payload.size());
-            if (extension_protocol_ && !message->payload.empty()) {
-                uint8_t ext_id = message->payload[0];
-                std::vector<uint8_t> ext_payload(message->payload.begin() + 1, message->payload.end());
+            LOG_DEBUG("Received EXTENDED message ({} bytes payload)", message.payload.size());
+            if (extension_protocol_ && !message.payload.empty()) {
+                uint8_t ext_id = message.payload[0];
+                std::vector<uint8_t> ext_payload(message.payload.begin() + 1, message.payload.end());
 
                 if (ext_id == 0) {
                     // Extended handshake
@@ -626,12 +800,14 @@ std::unique_ptr<PeerMessage> PeerConnection::receiveMessage() {
             break;
         }
         default:
-            std::cout << "Received unknown message type: " << static_cast<int>(message->type) << "\n";
+            std::cout << "Received unknown message type: " << static_cast<int>(message.type) << "\n";
             break;
     }
 
     // Add message to queue for processing
-    message_queue_.push(std::move(message));
+    if (!message_queue_.push(std::move(message))) {
+        return message;  // Ring full (consumer stalled): deliver directly
+    }
 
     // Return the message from queue
     return popMessage();
@@ -643,51 +819,51 @@ bool PeerConnection::sendKeepAlive() {
     return sendData(keep_alive, 4);
 }
 
+// Payload-less control messages are fixed 5-byte frames; serialize them
+// once at compile time and put the bytes straight on the wire
+static constexpr uint8_t kChokeFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::CHOKE)};
+static constexpr uint8_t kUnchokeFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::UNCHOKE)};
+static constexpr uint8_t kInterestedFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::INTERESTED)};
+static constexpr uint8_t kNotInterestedFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::NOT_INTERESTED)};
+static constexpr uint8_t kHaveAllFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::HAVE_ALL)};
+static constexpr uint8_t kHaveNoneFrame[5] = {0, 0, 0, 1,
+    static_cast<uint8_t>(MessageType::HAVE_NONE)};
+
 bool PeerConnection::sendChoke() {
-    PeerMessage msg{MessageType::CHOKE, {}};
     am_choking_ = true;
-    return sendMessage(msg);
+    return sendSerializedMessage(kChokeFrame, sizeof(kChokeFrame));
 }
 
 bool PeerConnection::sendUnchoke() {
-    PeerMessage msg{MessageType::UNCHOKE, {}};
     am_choking_ = false;
-    return sendMessage(msg);
+    return sendSerializedMessage(kUnchokeFrame, sizeof(kUnchokeFrame));
 }
 
 bool PeerConnection::sendInterested() {
-    PeerMessage msg{MessageType::INTERESTED, {}};
     am_interested_ = true;
-    return sendMessage(msg);
+    return sendSerializedMessage(kInterestedFrame, sizeof(kInterestedFrame));
 }
 
 bool PeerConnection::sendNotInterested() {
-    PeerMessage msg{MessageType::NOT_INTERESTED, {}};
     am_interested_ = false;
-    return sendMessage(msg);
+    return sendSerializedMessage(kNotInterestedFrame, sizeof(kNotInterestedFrame));
 }
 
 bool PeerConnection::sendHave(uint32_t piece_index) {
-    std::vector<uint8_t> payload(4);
-    payload[0] = (piece_index >> 24) & 0xFF;
-    payload[1] = (piece_index >> 16) & 0xFF;
-    payload[2] = (piece_index >> 8) & 0xFF;
-    payload[3] = piece_index & 0xFF;
-
-    PeerMessage msg{MessageType::HAVE, payload};
-    return sendMessage(msg);
+    // Fixed 9-byte frame, built on the stack
+    uint8_t frame[9] = {0, 0, 0, 5, static_cast<uint8_t>(MessageType::HAVE)};
+    writeBE32(frame + 5, piece_index);
+    return sendSerializedMessage(frame, sizeof(frame));
 }
 
-bool PeerConnection::sendBitfield(const std::vector<bool>& bitfield) {
-    std::vector<uint8_t> payload((bitfield.size() + 7) / 8, 0);
-
-    for (size_t i = 0; i < bitfield.size(); ++i) {
-        if (bitfield[i]) {
-            payload[i / 8] |= (1 << (7 - (i % 8)));
-        }
-    }
-
-    PeerMessage msg{MessageType::BITFIELD, payload};
+bool PeerConnection::sendBitfield(const Bitfield& bitfield) {
+    // Word-wise wire conversion, not a per-bit repack
+    PeerMessage msg{MessageType::BITFIELD, bitfield.toWire()};
     return sendMessage(msg);
 }
 
@@ -716,26 +892,147 @@ bool PeerConnection::sendRequest(uint32_t piece_index, uint32_t offset, uint32_t
     return sendMessage(msg);
 }
 
+bool PeerConnection::sendRequests(const BlockList& blocks) {
+    if (blocks.empty()) {
+        return false;
+    }
+
+    // 17 bytes per REQUEST: 4-byte length prefix (13), id (6), piece,
+    // offset, length
+    std::vector<uint8_t> buffer;
+    buffer.reserve(blocks.size() * 17);
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        uint32_t offset = blocks.offsets[i];
+        uint32_t length = blocks.lengths[i];
+        const uint8_t frame[17] = {
+            0x00, 0x00, 0x00, 0x0D,
+            static_cast<uint8_t>(MessageType::REQUEST),
+            static_cast<uint8_t>((blocks.piece_index >> 24) & 0xFF),
+            static_cast<uint8_t>((blocks.piece_index >> 16) & 0xFF),
+            static_cast<uint8_t>((blocks.piece_index >> 8) & 0xFF),
+            static_cast<uint8_t>(blocks.piece_index & 0xFF),
+            static_cast<uint8_t>((offset >> 24) & 0xFF),
+            static_cast<uint8_t>((offset >> 16) & 0xFF),
+            static_cast<uint8_t>((offset >> 8) & 0xFF),
+            static_cast<uint8_t>(offset & 0xFF),
+            static_cast<uint8_t>((length >> 24) & 0xFF),
+            static_cast<uint8_t>((length >> 16) & 0xFF),
+            static_cast<uint8_t>((length >> 8) & 0xFF),
+            static_cast<uint8_t>(length & 0xFF)
+        };
+        buffer.insert(buffer.end(), frame, frame + sizeof(frame));
+    }
+
+    return sendData(buffer.data(), buffer.size());
+}
+
 bool PeerConnection::sendPiece(uint32_t piece_index, uint32_t offset, const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> payload(8 + data.size());
+    // <len><id=7><index><begin> on the stack; the block itself is
+    // gathered straight from the caller's buffer, so a 16 KiB upload
+    // costs no copy
+    uint8_t header[13];
+    writeBE32(header, static_cast<uint32_t>(9 + data.size()));
+    header[4] = static_cast<uint8_t>(MessageType::PIECE);
+    writeBE32(header + 5, piece_index);
+    writeBE32(header + 9, offset);
+
+    return sendFrameVec(header, sizeof(header), data.data(), data.size());
+}
 
-    // Piece index
-    payload[0] = (piece_index >> 24) & 0xFF;
-    payload[1] = (piece_index >> 16) & 0xFF;
-    payload[2] = (piece_index >> 8) & 0xFF;
-    payload[3] = piece_index & 0xFF;
+bool PeerConnection::sendPiece(uint32_t piece_index, uint32_t offset,
+                               int fd, int64_t file_off, size_t length) {
+#if defined(__linux__)
+    if (connected_ && transport_type_ == TransportType::TCP &&
+        socket_fd_ != INVALID_SOCKET) {
+        // Header first with MSG_MORE so the kernel coalesces it with the
+        // payload; then sendfile moves the block page-cache-to-socket
+        // without it ever touching userspace. Note: if an encrypting
+        // stream wrapper is ever put in front of sendData, this path
+        // must be bypassed — the keystream XOR needs the bytes in
+        // userspace.
+        uint8_t header[13];
+        writeBE32(header, static_cast<uint32_t>(9 + length));
+        header[4] = static_cast<uint8_t>(MessageType::PIECE);
+        writeBE32(header + 5, piece_index);
+        writeBE32(header + 9, offset);
+
+        size_t header_sent = 0;
+        while (header_sent < sizeof(header)) {
+            ssize_t sent = ::send(socket_fd_, header + header_sent,
+                                  sizeof(header) - header_sent, MSG_MORE);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    waitWritable(socket_fd_);
+                    continue;
+                }
+                std::cerr << "Send failed\n";
+                disconnect();
+                return false;
+            }
+            if (sent == 0) {
+                std::cerr << "Connection closed by peer\n";
+                disconnect();
+                return false;
+            }
+            header_sent += static_cast<size_t>(sent);
+        }
 
-    // Offset
-    payload[4] = (offset >> 24) & 0xFF;
-    payload[5] = (offset >> 16) & 0xFF;
-    payload[6] = (offset >> 8) & 0xFF;
-    payload[7] = offset & 0xFF;
+        off_t off = static_cast<off_t>(file_off);
+        size_t remaining = length;
+        while (remaining > 0) {
+            ssize_t sent = ::sendfile(socket_fd_, fd, &off, remaining);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    waitWritable(socket_fd_);
+                    continue;
+                }
+                // The frame header is already on the wire, so the stream
+                // is desynced beyond repair — drop the connection
+                std::cerr << "sendfile failed mid-frame\n";
+                disconnect();
+                return false;
+            }
+            if (sent == 0) {
+                std::cerr << "Connection closed by peer\n";
+                disconnect();
+                return false;
+            }
+            remaining -= static_cast<size_t>(sent);
+        }
 
-    // Data
-    std::copy(data.begin(), data.end(), payload.begin() + 8);
+        return true;
+    }
+#endif
 
-    PeerMessage msg{MessageType::PIECE, payload};
-    return sendMessage(msg);
+#ifndef _WIN32
+    // uTP (and non-Linux): read the block into a buffer and take the
+    // normal gather-write path
+    std::vector<uint8_t> data(length);
+    size_t bytes_read = 0;
+    while (bytes_read < length) {
+        ssize_t n = ::pread(fd, data.data() + bytes_read,
+                            length - bytes_read,
+                            static_cast<off_t>(file_off) + bytes_read);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Failed to read block for upload\n";
+            return false;
+        }
+        if (n == 0) {
+            break;  // Short file (sparse/unwritten region stays zeroed)
+        }
+        bytes_read += static_cast<size_t>(n);
+    }
+    return sendPiece(piece_index, offset, data);
+#else
+    // No positioned-read fallback on Windows; FileManager never hands
+    // out descriptors there
+    (void)piece_index; (void)offset; (void)fd; (void)file_off; (void)length;
+    return false;
+#endif
 }
 
 bool PeerConnection::sendCancel(uint32_t piece_index, uint32_t offset, uint32_t length) {
@@ -771,9 +1068,8 @@ bool PeerConnection::sendHaveAll() {
         return false;
     }
 
-    PeerMessage msg{MessageType::HAVE_ALL, {}};
     LOG_DEBUG("Sending HAVE_ALL message");
-    return sendMessage(msg);
+    return sendSerializedMessage(kHaveAllFrame, sizeof(kHaveAllFrame));
 }
 
 bool PeerConnection::sendHaveNone() {
@@ -782,9 +1078,8 @@ bool PeerConnection::sendHaveNone() {
         return false;
     }
 
-    PeerMessage msg{MessageType::HAVE_NONE, {}};
     LOG_DEBUG("Sending HAVE_NONE message");
-    return sendMessage(msg);
+    return sendSerializedMessage(kHaveNoneFrame, sizeof(kHaveNoneFrame));
 }
 
 bool PeerConnection::sendSuggestPiece(uint32_t piece_index) {
@@ -858,13 +1153,15 @@ bool PeerConnection::sendExtendedMessage(uint8_t ext_id, const std::vector<uint8
         return false;
     }
 
-    // Extended message format: <msg_id=20><ext_id><payload>
-    std::vector<uint8_t> full_payload;
-    full_payload.push_back(ext_id);
-    full_payload.insert(full_payload.end(), payload.begin(), payload.end());
+    // Extended message format: <len><msg_id=20><ext_id><payload>. The
+    // 6-byte header goes on the stack and the payload is gathered from
+    // where it is — no concatenated temporary.
+    uint8_t header[6];
+    writeBE32(header, static_cast<uint32_t>(2 + payload.size()));
+    header[4] = static_cast<uint8_t>(MessageType::EXTENDED);
+    header[5] = ext_id;
 
-    PeerMessage msg{MessageType::EXTENDED, full_payload};
-    return sendMessage(msg);
+    return sendFrameVec(header, sizeof(header), payload.data(), payload.size());
 }
 
 bool PeerConnection::sendExtendedHandshake() {
@@ -969,13 +1266,16 @@ bool PeerConnection::sendData(const void* data, size_t length) {
 #ifdef _WIN32
             int error = WSAGetLastError();
             if (error == WSAEWOULDBLOCK || error == WSAEINTR) {
-#else
-            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-#endif
                 // Retry
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 continue;
             }
+#else
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                waitWritable(socket_fd_);
+                continue;
+            }
+#endif
 
             std::cerr << "Send failed\n";
             disconnect();
@@ -994,6 +1294,35 @@ bool PeerConnection::sendData(const void* data, size_t length) {
     return true;
 }
 
+bool PeerConnection::waitForMessage(int timeout_ms) {
+    if (!connected_) {
+        return false;
+    }
+
+    // Work already on hand needs no kernel trip
+    if (!message_queue_.empty() || recv_buffer_pos_ < recv_buffer_.size()) {
+        return true;
+    }
+
+    // uTP delivers via callbacks; fall through to receiveMessage, which
+    // reports the unsupported transport itself
+    if (transport_type_ == TransportType::UTP || socket_fd_ == INVALID_SOCKET) {
+        return true;
+    }
+
+#ifdef _WIN32
+    WSAPOLLFD pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    return WSAPoll(&pfd, 1, timeout_ms) > 0;
+#else
+    struct pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, timeout_ms) > 0;
+#endif
+}
+
 bool PeerConnection::receiveData(void* buffer, size_t length) {
     if (!connected_) {
         std::cerr << "Cannot receive: not connected\n";
@@ -1018,8 +1347,42 @@ bool PeerConnection::receiveData(void* buffer, size_t length) {
     size_t total_received = 0;
     uint8_t* ptr = static_cast<uint8_t*>(buffer);
 
+    // Serve whatever the last bulk recv() left over before touching the
+    // socket again: a 64KB drain typically covers several PIECE frames plus
+    // their 4-byte length prefixes, so most calls never reach recv() at all
+    if (recv_buffer_pos_ < recv_buffer_.size()) {
+        size_t n = std::min(length, recv_buffer_.size() - recv_buffer_pos_);
+        std::memcpy(ptr, recv_buffer_.data() + recv_buffer_pos_, n);
+        recv_buffer_pos_ += n;
+        total_received += n;
+        if (recv_buffer_pos_ == recv_buffer_.size()) {
+            recv_buffer_.clear();
+            recv_buffer_pos_ = 0;
+        }
+    }
+
+    const size_t bulk_recv_size = 65536;
+
     while (total_received < length) {
-        int received = recv(socket_fd_, (char*)(ptr + total_received), length - total_received, 0);
+        size_t remaining = length - total_received;
+
+        // Reads at least as large as the drain size (block payloads) go
+        // straight into the caller's buffer; smaller ones pull everything
+        // the kernel has (up to 64KB) into recv_buffer_ for later calls
+        bool direct = remaining >= bulk_recv_size;
+        uint8_t* dst;
+        size_t want;
+        if (direct) {
+            dst = ptr + total_received;
+            want = remaining;
+        } else {
+            recv_buffer_.resize(bulk_recv_size);
+            recv_buffer_pos_ = 0;
+            dst = recv_buffer_.data();
+            want = bulk_recv_size;
+        }
+
+        int received = recv(socket_fd_, (char*)dst, want, 0);
 
         if (received == SOCKET_ERROR) {
 #ifdef _WIN32
@@ -1028,23 +1391,54 @@ bool PeerConnection::receiveData(void* buffer, size_t length) {
 #else
             if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
 #endif
-                // Retry
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                // Wait for readability instead of sleep-polling: the kernel
+                // wakes us the moment data lands rather than on the next
+                // 10ms tick, and an idle socket burns no CPU
+#ifdef _WIN32
+                WSAPOLLFD pfd;
+                pfd.fd = socket_fd_;
+                pfd.events = POLLIN;
+                WSAPoll(&pfd, 1, 100);
+#else
+                struct pollfd pfd;
+                pfd.fd = socket_fd_;
+                pfd.events = POLLIN;
+                poll(&pfd, 1, 100);
+#endif
+                if (!direct) {
+                    recv_buffer_.clear();
+                }
                 continue;
             }
 
+            recv_buffer_.clear();
+            recv_buffer_pos_ = 0;
             std::cerr << "Receive failed\n";
             disconnect();
             return false;
         }
 
         if (received == 0) {
+            recv_buffer_.clear();
+            recv_buffer_pos_ = 0;
             std::cerr << "Connection closed by peer\n";
             disconnect();
             return false;
         }
 
-        total_received += received;
+        if (direct) {
+            total_received += received;
+        } else {
+            recv_buffer_.resize(static_cast<size_t>(received));
+            size_t n = std::min(static_cast<size_t>(received), remaining);
+            std::memcpy(ptr + total_received, recv_buffer_.data(), n);
+            recv_buffer_pos_ = n;
+            total_received += n;
+            if (recv_buffer_pos_ == recv_buffer_.size()) {
+                recv_buffer_.clear();
+                recv_buffer_pos_ = 0;
+            }
+        }
     }
 
     return true;
@@ -1055,6 +1449,12 @@ bool PeerConnection::receiveDataWithTimeout(void* buffer, size_t length, int tim
         return false;
     }
 
+    // Buffered bytes from a previous bulk recv() satisfy the read without
+    // waiting on the socket
+    if (recv_buffer_pos_ < recv_buffer_.size()) {
+        return receiveData(buffer, length);
+    }
+
     // Use select to wait for data with timeout
     fd_set read_fds;
     FD_ZERO(&read_fds);
@@ -1073,13 +1473,11 @@ bool PeerConnection::receiveDataWithTimeout(void* buffer, size_t length, int tim
     return receiveData(buffer, length);
 }
 
-std::unique_ptr<PeerMessage> PeerConnection::popMessage() {
-    if (message_queue_.empty()) {
-        return nullptr;
+std::optional<PeerMessage> PeerConnection::popMessage() {
+    PeerMessage message;
+    if (!message_queue_.pop(message)) {
+        return std::nullopt;
     }
-
-    auto message = std::move(message_queue_.front());
-    message_queue_.pop();
     return message;
 }
 
@@ -1094,16 +1492,10 @@ bool PeerConnection::parseBitfield(const PeerMessage& message, BitfieldMessage&
         return false;
     }
 
-    // Convert byte array to vector<bool>
-    result.bitfield.clear();
-    result.bitfield.reserve(message.payload.size() * 8);
-
-    for (size_t i = 0; i < message.payload.size(); ++i) {
-        uint8_t byte = message.payload[i];
-        for (int bit = 7; bit >= 0; --bit) {
-            result.bitfield.push_back((byte & (1 << bit)) != 0);
-        }
-    }
+    // Unpack straight into the 64-bit-word form, eight wire bytes per
+    // iteration; no vector<bool> intermediate
+    result.bitfield =
+        Bitfield::fromWire(message.payload.data(), message.payload.size());
 
     // Note: The bitfield may have extra bits due to byte padding
     // The caller should trim it to the actual number of pieces if needed
@@ -1123,10 +1515,7 @@ bool PeerConnection::parseHave(const PeerMessage& message, HaveMessage& result)
     }
 
     // Parse piece index (big-endian)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     std::cout << "Parsed HAVE message: piece_index=" << result.piece_index << "\n";
     return true;
@@ -1138,29 +1527,34 @@ bool PeerConnection::parsePiece(const PeerMessage& message, PieceMessage& result
         return false;
     }
 
+    if (message.zero_copy_length > 0) {
+        // Data already landed in the piece buffer (or the drain scratch);
+        // the parsed header rides in the message fields, no payload vector
+        result.piece_index = message.piece_index;
+        result.offset = message.block_offset;
+        result.data.clear();
+        result.length = message.zero_copy_length;
+        return true;
+    }
+
     if (message.payload.size() < 8) {
         std::cerr << "ERROR: PIECE message payload must be at least 8 bytes, got " << message.payload.size() << "\n";
         return false;
     }
 
     // Parse piece index (big-endian, bytes 0-3)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     // Parse offset (big-endian, bytes 4-7)
-    result.offset = (static_cast<uint32_t>(message.payload[4]) << 24) |
-                    (static_cast<uint32_t>(message.payload[5]) << 16) |
-                    (static_cast<uint32_t>(message.payload[6]) << 8) |
-                    static_cast<uint32_t>(message.payload[7]);
+    result.offset = readBE32(message.payload.data() + 4);
 
     // Extract data (remaining bytes)
     result.data.assign(message.payload.begin() + 8, message.payload.end());
+    result.length = static_cast<uint32_t>(result.data.size());
 
     std::cout << "Parsed PIECE message: piece_index=" << result.piece_index
               << ", offset=" << result.offset
-              << ", data_size=" << result.data.size() << " bytes\n";
+              << ", data_size=" << result.length << " bytes\n";
     return true;
 }
 
@@ -1176,22 +1570,13 @@ bool PeerConnection::parseRequest(const PeerMessage& message, RequestMessage& re
     }
 
     // Parse piece index (big-endian, bytes 0-3)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     // Parse offset (big-endian, bytes 4-7)
-    result.offset = (static_cast<uint32_t>(message.payload[4]) << 24) |
-                    (static_cast<uint32_t>(message.payload[5]) << 16) |
-                    (static_cast<uint32_t>(message.payload[6]) << 8) |
-                    static_cast<uint32_t>(message.payload[7]);
+    result.offset = readBE32(message.payload.data() + 4);
 
     // Parse length (big-endian, bytes 8-11)
-    result.length = (static_cast<uint32_t>(message.payload[8]) << 24) |
-                    (static_cast<uint32_t>(message.payload[9]) << 16) |
-                    (static_cast<uint32_t>(message.payload[10]) << 8) |
-                    static_cast<uint32_t>(message.payload[11]);
+    result.length = readBE32(message.payload.data() + 8);
 
     std::cout << "Parsed REQUEST message: piece_index=" << result.piece_index
               << ", offset=" << result.offset
@@ -1211,22 +1596,13 @@ bool PeerConnection::parseCancel(const PeerMessage& message, CancelMessage& resu
     }
 
     // Parse piece index (big-endian, bytes 0-3)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     // Parse offset (big-endian, bytes 4-7)
-    result.offset = (static_cast<uint32_t>(message.payload[4]) << 24) |
-                    (static_cast<uint32_t>(message.payload[5]) << 16) |
-                    (static_cast<uint32_t>(message.payload[6]) << 8) |
-                    static_cast<uint32_t>(message.payload[7]);
+    result.offset = readBE32(message.payload.data() + 4);
 
     // Parse length (big-endian, bytes 8-11)
-    result.length = (static_cast<uint32_t>(message.payload[8]) << 24) |
-                    (static_cast<uint32_t>(message.payload[9]) << 16) |
-                    (static_cast<uint32_t>(message.payload[10]) << 8) |
-                    static_cast<uint32_t>(message.payload[11]);
+    result.length = readBE32(message.payload.data() + 8);
 
     std::cout << "Parsed CANCEL message: piece_index=" << result.piece_index
               << ", offset=" << result.offset
@@ -1250,10 +1626,7 @@ bool PeerConnection::parseSuggestPiece(const PeerMessage& message, SuggestPieceM
     }
 
     // Parse piece index (big-endian)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     LOG_DEBUG("Parsed SUGGEST_PIECE message: piece_index={}", result.piece_index);
     return true;
@@ -1271,22 +1644,13 @@ bool PeerConnection::parseRejectRequest(const PeerMessage& message, RejectReques
     }
 
     // Parse piece index (big-endian, bytes 0-3)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     // Parse offset (big-endian, bytes 4-7)
-    result.offset = (static_cast<uint32_t>(message.payload[4]) << 24) |
-                    (static_cast<uint32_t>(message.payload[5]) << 16) |
-                    (static_cast<uint32_t>(message.payload[6]) << 8) |
-                    static_cast<uint32_t>(message.payload[7]);
+    result.offset = readBE32(message.payload.data() + 4);
 
     // Parse length (big-endian, bytes 8-11)
-    result.length = (static_cast<uint32_t>(message.payload[8]) << 24) |
-                    (static_cast<uint32_t>(message.payload[9]) << 16) |
-                    (static_cast<uint32_t>(message.payload[10]) << 8) |
-                    static_cast<uint32_t>(message.payload[11]);
+    result.length = readBE32(message.payload.data() + 8);
 
     LOG_DEBUG("Parsed REJECT_REQUEST message: piece_index={}, offset={}, length={}",
               result.piece_index, result.offset, result.length);
@@ -1305,10 +1669,7 @@ bool PeerConnection::parseAllowedFast(const PeerMessage& message, AllowedFastMes
     }
 
     // Parse piece index (big-endian)
-    result.piece_index = (static_cast<uint32_t>(message.payload[0]) << 24) |
-                         (static_cast<uint32_t>(message.payload[1]) << 16) |
-                         (static_cast<uint32_t>(message.payload[2]) << 8) |
-                         static_cast<uint32_t>(message.payload[3]);
+    result.piece_index = readBE32(message.payload.data());
 
     LOG_DEBUG("Parsed ALLOWED_FAST message: piece_index={}", result.piece_index);
     return true;
@@ -1323,39 +1684,22 @@ void PeerConnection::initializePeerBitfield(size_t num_pieces) {
 }
 
 bool PeerConnection::peerHasPiece(uint32_t piece_index) const {
-    if (piece_index >= peer_bitfield_.size()) {
-        return false;
-    }
-    return peer_bitfield_[piece_index];
+    return peer_bitfield_.test(piece_index);
 }
 
 size_t PeerConnection::getPeerPieceCount() const {
-    size_t count = 0;
-    for (bool has_piece : peer_bitfield_) {
-        if (has_piece) {
-            count++;
-        }
-    }
-    return count;
+    // One popcount per 64-bit word instead of a branchy per-bit loop
+    return peer_bitfield_.count();
 }
 
 bool PeerConnection::isPeerSeeder() const {
-    if (peer_bitfield_.empty()) {
-        return false;
-    }
-
-    // A peer is a seeder if it has all pieces
-    for (bool has_piece : peer_bitfield_) {
-        if (!has_piece) {
-            return false;
-        }
-    }
-    return true;
+    // A peer is a seeder if it has all pieces (all-ones words)
+    return peer_bitfield_.all();
 }
 
 // Piece request management methods
 
-bool PeerConnection::requestPiece(uint32_t piece_index, const std::vector<Block>& blocks) {
+bool PeerConnection::requestPiece(uint32_t piece_index, const BlockList& blocks) {
     if (!isReadyForRequests()) {
         std::cerr << "Cannot request piece: not ready (choked=" << peer_choking_
                   << ", interested=" << am_interested_ << ")\n";
@@ -1369,16 +1713,37 @@ bool PeerConnection::requestPiece(uint32_t piece_index, const std::vector<Block>
 
     std::cout << "Requesting piece #" << piece_index << " (" << blocks.size() << " blocks)\n";
 
-    // Request all blocks for this piece
-    int requested = 0;
-    for (const auto& block : blocks) {
-        if (requestBlock(block.piece_index, block.offset, block.length)) {
-            requested++;
+    // Batch all not-yet-pending blocks into one wire write
+    BlockList to_request;
+    to_request.piece_index = blocks.piece_index;
+    to_request.offsets.reserve(blocks.size());
+    to_request.lengths.reserve(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!isPendingRequest(blocks.piece_index, blocks.offsets[i])) {
+            to_request.offsets.push_back(blocks.offsets[i]);
+            to_request.lengths.push_back(blocks.lengths[i]);
         }
     }
 
-    std::cout << "Successfully requested " << requested << "/" << blocks.size() << " blocks\n";
-    return requested > 0;
+    if (to_request.empty()) {
+        return false;
+    }
+
+    if (!sendRequests(to_request)) {
+        std::cerr << "Failed to send batched REQUEST messages for piece #" << piece_index << "\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < to_request.size(); ++i) {
+        pending_requests_.emplace(blockKey(to_request.piece_index,
+                                           to_request.offsets[i]),
+                                  to_request.piece_index,
+                                  to_request.offsets[i],
+                                  to_request.lengths[i]);
+    }
+
+    std::cout << "Successfully requested " << to_request.size() << "/" << blocks.size() << " blocks\n";
+    return true;
 }
 
 bool PeerConnection::requestBlock(uint32_t piece_index, uint32_t offset, uint32_t length) {
@@ -1395,23 +1760,22 @@ bool PeerConnection::requestBlock(uint32_t piece_index, uint32_t offset, uint32_
     }
 
     // Check if already requested
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    std::string key_str = key.str();
-
-    if (pending_requests_.find(key_str) != pending_requests_.end()) {
-        std::cerr << "Block " << key_str << " already requested\n";
+    uint64_t key = blockKey(piece_index, offset);
+    if (pending_requests_.contains(key)) {
+        std::cerr << "Block " << piece_index << ":" << offset
+                  << " already requested\n";
         return false;
     }
 
     // Send REQUEST message
     if (!sendRequest(piece_index, offset, length)) {
-        std::cerr << "Failed to send REQUEST message for block " << key_str << "\n";
+        std::cerr << "Failed to send REQUEST message for block " << piece_index
+                  << ":" << offset << "\n";
         return false;
     }
 
     // Track the request
-    pending_requests_.emplace(key_str, PendingRequest(piece_index, offset, length));
+    pending_requests_.emplace(key, piece_index, offset, length);
 
     std::cout << "Requested block: piece=" << piece_index
               << " offset=" << offset
@@ -1430,73 +1794,56 @@ void PeerConnection::clearPendingRequests() {
 }
 
 bool PeerConnection::isPendingRequest(uint32_t piece_index, uint32_t offset) const {
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    return pending_requests_.find(key.str()) != pending_requests_.end();
+    return pending_requests_.contains(blockKey(piece_index, offset));
 }
 
 std::vector<PendingRequest> PeerConnection::getTimedOutRequests(int timeout_seconds) {
     std::vector<PendingRequest> timed_out;
     auto now = std::chrono::steady_clock::now();
 
-    for (auto it = pending_requests_.begin(); it != pending_requests_.end(); ) {
+    pending_requests_.eraseIf([&](PendingRequest& request) {
         auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - it->second.request_time
+            now - request.request_time
         ).count();
 
-        if (elapsed >= timeout_seconds) {
-            std::cout << "Request timed out: piece=" << it->second.piece_index
-                      << " offset=" << it->second.offset
-                      << " (waited " << elapsed << "s)\n";
-            timed_out.push_back(it->second);
-            it = pending_requests_.erase(it);
-        } else {
-            ++it;
+        if (elapsed < timeout_seconds) {
+            return false;
         }
-    }
+        std::cout << "Request timed out: piece=" << request.piece_index
+                  << " offset=" << request.offset
+                  << " (waited " << elapsed << "s)\n";
+        timed_out.push_back(request);
+        return true;
+    });
 
     return timed_out;
 }
 
 void PeerConnection::removeRequest(uint32_t piece_index, uint32_t offset) {
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    std::string key_str = key.str();
-
-    auto it = pending_requests_.find(key_str);
-    if (it != pending_requests_.end()) {
+    uint64_t key = blockKey(piece_index, offset);
+    if (const PendingRequest* request = pending_requests_.find(key)) {
         auto now = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - it->second.request_time
+            now - request->request_time
         ).count();
 
         std::cout << "Completed request: piece=" << piece_index
                   << " offset=" << offset
                   << " (took " << elapsed << "ms)\n";
 
-        pending_requests_.erase(it);
+        pending_requests_.erase(key);
     }
 }
 
 // Upload tracking methods
 
 bool PeerConnection::addPendingUpload(uint32_t piece_index, uint32_t offset, uint32_t length) {
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    std::string key_str = key.str();
-
-    if (pending_uploads_.find(key_str) != pending_uploads_.end()) {
-        return false; // Already pending
-    }
-
-    pending_uploads_.emplace(key_str, PendingUpload(piece_index, offset, length));
-    return true;
+    return pending_uploads_.emplace(blockKey(piece_index, offset),
+                                    piece_index, offset, length);
 }
 
 void PeerConnection::removePendingUpload(uint32_t piece_index, uint32_t offset) {
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    pending_uploads_.erase(key.str());
+    pending_uploads_.erase(blockKey(piece_index, offset));
 }
 
 void PeerConnection::clearPendingUploads() {
@@ -1504,9 +1851,7 @@ void PeerConnection::clearPendingUploads() {
 }
 
 bool PeerConnection::isPendingUpload(uint32_t piece_index, uint32_t offset) const {
-    std::stringstream key;
-    key << piece_index << ":" << offset;
-    return pending_uploads_.find(key.str()) != pending_uploads_.end();
+    return pending_uploads_.contains(blockKey(piece_index, offset));
 }
 
 // ============================================================================
@@ -1536,10 +1881,13 @@ bool PeerConnection::performMSEHandshake(bool is_initiator, const std::vector<ui
     encrypted_stream_->init(
         result.selected_method,
         std::move(mse.outgoing_cipher_),
-        std::move(mse.incoming_cipher_)
+        std::move(mse.incoming_cipher_),
+        std::move(mse.aes_outgoing_cipher_),
+        std::move(mse.aes_incoming_cipher_)
     );
 
     LOG_INFO("PeerConnection: MSE handshake successful, method: {}",
+            result.selected_method == MSEHandshake::CryptoMethod::AES_CTR ? "AES-CTR" :
             result.selected_method == MSEHandshake::CryptoMethod::RC4 ? "RC4" : "plaintext");
 
     return true;
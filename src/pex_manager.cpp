@@ -1,8 +1,10 @@
 #include "pex_manager.h"
 #include "logger.h"
+#include "utils.h"
 #include <sstream>
 #include <algorithm>
 #include <cstring>
+#include <string_view>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -44,18 +46,11 @@ std::vector<uint8_t> PexPeer::toCompact() const {
 }
 
 PexPeer PexPeer::fromCompact(const uint8_t* data) {
-    // Extract IP (4 bytes)
-    struct in_addr addr;
-    std::memcpy(&addr.s_addr, data, 4);
-
-    char ip_str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
-
     // Extract port (big-endian)
     uint16_t port = (static_cast<uint16_t>(data[4]) << 8) |
                      static_cast<uint16_t>(data[5]);
 
-    return PexPeer(ip_str, port);
+    return PexPeer(utils::ipv4ToString(data), port);
 }
 
 // ============================================================================
@@ -67,41 +62,67 @@ PexManager::PexManager()
 }
 
 bool PexManager::addPeer(const std::string& ip, uint16_t port, uint8_t flags) {
-    PexPeer peer(ip, port, flags);
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        LOG_DEBUG("PEX: Ignoring non-IPv4 peer {}:{}", ip, port);
+        return false;
+    }
+    return addPeerPacked(addr.s_addr, port, flags);
+}
 
-    // Check if peer already exists
-    if (known_peers_.find(peer) != known_peers_.end()) {
+bool PexManager::addPeerPacked(uint32_t ip_be, uint16_t port, uint8_t flags) {
+    uint32_t slot = static_cast<uint32_t>(ips_.size());
+    if (!index_.emplace(endpointKey(ip_be, port), slot)) {
         return false; // Already known
     }
 
-    // Add to known peers
-    known_peers_.insert(peer);
-
-    // Add to added_peers for next PEX message
-    added_peers_.insert(peer);
+    ips_.push_back(ip_be);
+    ports_.push_back(port);
+    flags_.push_back(flags);
 
-    LOG_DEBUG("PEX: Added peer {}:{} (flags: 0x{:02x})", ip, port, flags);
+    // Log for next PEX message
+    added_peers_.push_back({ip_be, port, flags});
     return true;
 }
 
 bool PexManager::removePeer(const std::string& ip, uint16_t port) {
-    PexPeer peer(ip, port);
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        return false;
+    }
+    return removePeerPacked(addr.s_addr, port);
+}
 
-    auto it = known_peers_.find(peer);
-    if (it == known_peers_.end()) {
+bool PexManager::removePeerPacked(uint32_t ip_be, uint16_t port) {
+    uint64_t key = endpointKey(ip_be, port);
+    const uint32_t* slot_ptr = index_.find(key);
+    if (!slot_ptr) {
         return false; // Not found
     }
 
-    // Remove from known peers
-    known_peers_.erase(it);
-
-    // Remove from added_peers if it was there
-    added_peers_.erase(peer);
-
-    // Add to dropped_peers for next PEX message
-    dropped_peers_.insert(peer);
+    // Swap-pop the SoA slot and patch the moved peer's index
+    uint32_t slot = *slot_ptr;
+    uint32_t last = static_cast<uint32_t>(ips_.size()) - 1;
+    if (slot != last) {
+        ips_[slot] = ips_[last];
+        ports_[slot] = ports_[last];
+        flags_[slot] = flags_[last];
+        *index_.find(endpointKey(ips_[slot], ports_[slot])) = slot;
+    }
+    ips_.pop_back();
+    ports_.pop_back();
+    flags_.pop_back();
+    index_.erase(key);
+
+    // Retract from the pending added list if it never went out
+    for (auto it = added_peers_.begin(); it != added_peers_.end(); ++it) {
+        if (it->ip_be == ip_be && it->port == port) {
+            added_peers_.erase(it);
+            break;
+        }
+    }
 
-    LOG_DEBUG("PEX: Removed peer {}:{}", ip, port);
+    dropped_peers_.push_back({ip_be, port, 0});
     return true;
 }
 
@@ -109,32 +130,48 @@ void PexManager::markPeerDropped(const std::string& ip, uint16_t port) {
     removePeer(ip, port);
 }
 
-bencode::BencodeValue PexManager::buildPexMessage() {
-    bencode::BencodeDict dict;
+std::vector<PexPeer> PexManager::getKnownPeers() const {
+    std::vector<PexPeer> peers;
+    peers.reserve(ips_.size());
+    for (size_t i = 0; i < ips_.size(); ++i) {
+        uint8_t octets[4];
+        std::memcpy(octets, &ips_[i], 4);
+        peers.emplace_back(utils::ipv4ToString(octets), ports_[i], flags_[i]);
+    }
+    return peers;
+}
 
-    // Limit the number of peers we send
-    std::set<PexPeer> peers_to_add;
-    size_t count = 0;
-    for (const auto& peer : added_peers_) {
-        if (count >= MAX_PEERS_PER_MESSAGE) break;
-        peers_to_add.insert(peer);
-        count++;
+
+std::string PexManager::changesToCompact(const std::vector<PendingChange>& changes,
+                                         size_t limit) {
+    size_t n = changes.size() < limit ? changes.size() : limit;
+    std::string compact(n * 6, '\0');
+    for (size_t i = 0; i < n; ++i) {
+        char* out = compact.data() + i * 6;
+        std::memcpy(out, &changes[i].ip_be, 4);
+        out[4] = static_cast<char>((changes[i].port >> 8) & 0xFF);
+        out[5] = static_cast<char>(changes[i].port & 0xFF);
     }
+    return compact;
+}
 
-    // Build "added" field (compact peer list)
-    if (!peers_to_add.empty()) {
-        std::vector<uint8_t> added_compact = peersToCompact(peers_to_add);
+bencode::BencodeValue PexManager::buildPexMessage() {
+    bencode::BencodeDict dict;
+
+    // Build "added" / "added.f": straight pack from the change log, no
+    // intermediate peer set
+    if (!added_peers_.empty()) {
         dict["added"] = bencode::BencodeValue(
-            std::string(added_compact.begin(), added_compact.end())
-        );
+            changesToCompact(added_peers_, MAX_PEERS_PER_MESSAGE));
 
-        // Build "added.f" field (flags for each peer)
-        std::vector<uint8_t> added_flags = peersToFlags(peers_to_add);
-        dict["added.f"] = bencode::BencodeValue(
-            std::string(added_flags.begin(), added_flags.end())
-        );
+        size_t n = std::min(added_peers_.size(), MAX_PEERS_PER_MESSAGE);
+        std::string added_flags(n, '\0');
+        for (size_t i = 0; i < n; ++i) {
+            added_flags[i] = static_cast<char>(added_peers_[i].flags);
+        }
+        dict["added.f"] = bencode::BencodeValue(std::move(added_flags));
 
-        LOG_DEBUG("PEX: Building message with {} added peers", peers_to_add.size());
+        LOG_DEBUG("PEX: Building message with {} added peers", n);
     } else {
         // Empty strings for no peers
         dict["added"] = bencode::BencodeValue(std::string(""));
@@ -143,10 +180,8 @@ bencode::BencodeValue PexManager::buildPexMessage() {
 
     // Build "dropped" field (compact peer list)
     if (!dropped_peers_.empty()) {
-        std::vector<uint8_t> dropped_compact = peersToCompact(dropped_peers_);
         dict["dropped"] = bencode::BencodeValue(
-            std::string(dropped_compact.begin(), dropped_compact.end())
-        );
+            changesToCompact(dropped_peers_, dropped_peers_.size()));
 
         LOG_DEBUG("PEX: Building message with {} dropped peers", dropped_peers_.size());
     } else {
@@ -170,47 +205,61 @@ int PexManager::parsePexMessage(const bencode::BencodeValue& data,
     const auto& dict = data.asDict();
     int new_peer_count = 0;
 
-    // Parse "added" peers
+    // Parse "added" peers straight off the compact wire bytes; only
+    // genuinely new peers get a PexPeer (and its IP string) built
     if (dict.find("added") != dict.end() && dict.at("added").isString()) {
         const std::string& added_str = dict.at("added").asString();
-        std::vector<uint8_t> added_compact(added_str.begin(), added_str.end());
+        if (added_str.size() % 6 != 0) {
+            LOG_WARN("PEX: Invalid compact peer format (size not multiple of 6)");
+            return 0;
+        }
 
         // Parse "added.f" flags
-        std::vector<uint8_t> added_flags;
+        std::string_view added_flags;
         if (dict.find("added.f") != dict.end() && dict.at("added.f").isString()) {
-            const std::string& flags_str = dict.at("added.f").asString();
-            added_flags.assign(flags_str.begin(), flags_str.end());
+            added_flags = dict.at("added.f").asString();
         }
 
-        // Convert compact format to peer list
-        std::vector<PexPeer> added_peers = compactToPeers(added_compact, added_flags);
-
-        for (const auto& peer : added_peers) {
-            if (addPeer(peer.ip, peer.port, peer.flags)) {
-                new_peers_out.push_back(peer);
+        size_t peer_count = added_str.size() / 6;
+        for (size_t i = 0; i < peer_count; ++i) {
+            const uint8_t* data =
+                reinterpret_cast<const uint8_t*>(added_str.data()) + i * 6;
+            uint32_t ip_be;
+            std::memcpy(&ip_be, data, 4);
+            uint16_t port = (static_cast<uint16_t>(data[4]) << 8) |
+                             static_cast<uint16_t>(data[5]);
+            uint8_t flags = i < added_flags.size()
+                                ? static_cast<uint8_t>(added_flags[i]) : 0;
+
+            if (addPeerPacked(ip_be, port, flags)) {
+                new_peers_out.emplace_back(utils::ipv4ToString(data), port, flags);
                 new_peer_count++;
             }
         }
 
-        if (!added_peers.empty()) {
+        if (peer_count > 0) {
             LOG_INFO("PEX: Received {} added peers ({} new)",
-                     added_peers.size(), new_peer_count);
+                     peer_count, new_peer_count);
         }
     }
 
     // Parse "dropped" peers
     if (dict.find("dropped") != dict.end() && dict.at("dropped").isString()) {
         const std::string& dropped_str = dict.at("dropped").asString();
-        std::vector<uint8_t> dropped_compact(dropped_str.begin(), dropped_str.end());
-
-        std::vector<PexPeer> dropped_peers = compactToPeers(dropped_compact, {});
-
-        for (const auto& peer : dropped_peers) {
-            removePeer(peer.ip, peer.port);
+        size_t peer_count = dropped_str.size() / 6;
+
+        for (size_t i = 0; i < peer_count; ++i) {
+            const uint8_t* data =
+                reinterpret_cast<const uint8_t*>(dropped_str.data()) + i * 6;
+            uint32_t ip_be;
+            std::memcpy(&ip_be, data, 4);
+            uint16_t port = (static_cast<uint16_t>(data[4]) << 8) |
+                             static_cast<uint16_t>(data[5]);
+            removePeerPacked(ip_be, port);
         }
 
-        if (!dropped_peers.empty()) {
-            LOG_DEBUG("PEX: Received {} dropped peers", dropped_peers.size());
+        if (peer_count > 0) {
+            LOG_DEBUG("PEX: Received {} dropped peers", peer_count);
         }
     }
 
@@ -223,7 +272,10 @@ int PexManager::parsePexMessage(const bencode::BencodeValue& data,
 }
 
 void PexManager::clear() {
-    known_peers_.clear();
+    ips_.clear();
+    ports_.clear();
+    flags_.clear();
+    index_.clear();
     added_peers_.clear();
     dropped_peers_.clear();
     last_pex_sent_ = std::chrono::steady_clock::now();
@@ -246,63 +298,4 @@ void PexManager::markUpdateSent() {
     last_pex_sent_ = std::chrono::steady_clock::now();
 }
 
-// ============================================================================
-// Private Helper Methods
-// ============================================================================
-
-std::vector<uint8_t> PexManager::peersToCompact(const std::set<PexPeer>& peers) const {
-    std::vector<uint8_t> result;
-    result.reserve(peers.size() * 6);
-
-    for (const auto& peer : peers) {
-        std::vector<uint8_t> compact = peer.toCompact();
-        if (!compact.empty()) {
-            result.insert(result.end(), compact.begin(), compact.end());
-        }
-    }
-
-    return result;
-}
-
-std::vector<uint8_t> PexManager::peersToFlags(const std::set<PexPeer>& peers) const {
-    std::vector<uint8_t> result;
-    result.reserve(peers.size());
-
-    for (const auto& peer : peers) {
-        result.push_back(peer.flags);
-    }
-
-    return result;
-}
-
-std::vector<PexPeer> PexManager::compactToPeers(
-    const std::vector<uint8_t>& compact,
-    const std::vector<uint8_t>& flags) const {
-
-    std::vector<PexPeer> result;
-
-    // Each peer is 6 bytes (4 IP + 2 port)
-    if (compact.size() % 6 != 0) {
-        LOG_WARN("PEX: Invalid compact peer format (size not multiple of 6)");
-        return result;
-    }
-
-    size_t peer_count = compact.size() / 6;
-    result.reserve(peer_count);
-
-    for (size_t i = 0; i < peer_count; ++i) {
-        const uint8_t* data = compact.data() + (i * 6);
-        PexPeer peer = PexPeer::fromCompact(data);
-
-        // Apply flags if available
-        if (i < flags.size()) {
-            peer.flags = flags[i];
-        }
-
-        result.push_back(peer);
-    }
-
-    return result;
-}
-
 } // namespace torrent
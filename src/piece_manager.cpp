@@ -1,12 +1,32 @@
 #include "piece_manager.h"
 #include "utils.h"
+#include "sha1_hw.h"
 #include "logger.h"
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace torrent {
 
+namespace {
+
+// Pack the legacy std::set view of in-flight pieces into bitfield words
+// so the selection cores can fuse it straight into their candidate masks
+Bitfield packInDownload(const std::set<uint32_t>& in_download, size_t num_pieces) {
+    Bitfield bits(num_pieces);
+    for (uint32_t piece : in_download) {
+        bits.set(piece);
+    }
+    return bits;
+}
+
+} // namespace
+
 PieceManager::PieceManager(size_t num_pieces,
                           size_t piece_length,
                           size_t total_length,
@@ -15,8 +35,11 @@ PieceManager::PieceManager(size_t num_pieces,
     , piece_length_(piece_length)
     , total_length_(total_length)
     , piece_hashes_(piece_hashes)
-    , bitfield_(num_pieces, false)
-    , pieces_downloaded_(0) {
+    , bitfield_(num_pieces)
+    , pieces_downloaded_(0)
+    , piece_availability_(num_pieces, 0)
+    , pieces_in_progress_(num_pieces) {
+    rebuildBitfieldMessageLocked();
 }
 
 bool PieceManager::hasPiece(uint32_t piece_index) const {
@@ -24,39 +47,132 @@ bool PieceManager::hasPiece(uint32_t piece_index) const {
     if (piece_index >= num_pieces_) {
         return false;
     }
-    return bitfield_[piece_index];
+    return bitfield_.test(piece_index);
 }
 
 void PieceManager::markPieceComplete(uint32_t piece_index) {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (piece_index < num_pieces_ && !bitfield_[piece_index]) {
-        bitfield_[piece_index] = true;
+    if (piece_index < num_pieces_ && !bitfield_.test(piece_index)) {
+        bitfield_.set(piece_index);
         pieces_downloaded_++;
+        patchBitfieldMessageLocked(piece_index);
         LOG_INFO("Piece {} marked complete. Progress: {}/{} ({:.2f}%)",
-                 piece_index, pieces_downloaded_, num_pieces_, percentComplete());
+                 piece_index, pieces_downloaded_, num_pieces_, percentCompleteLocked());
     }
 }
 
 int32_t PieceManager::getNextPiece(const std::vector<bool>& peer_has_pieces) {
+    // Thin compatibility wrapper: pack once, then run the word-wise scan
+    return getNextPiece(Bitfield::fromBools(peer_has_pieces));
+}
+
+int32_t PieceManager::getNextPiece(const Bitfield& peer_has_pieces) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    // Simple strategy: sequential download
-    // TODO: Implement rarest-first or random-first strategies
-    for (size_t i = 0; i < num_pieces_; ++i) {
-        if (!bitfield_[i] && i < peer_has_pieces.size() && peer_has_pieces[i]) {
-            return static_cast<int32_t>(i);
+    const std::vector<uint64_t>& ours = bitfield_.words();
+    const std::vector<uint64_t>& peer = peer_has_pieces.words();
+    const size_t num_words = std::min(ours.size(), peer.size());
+
+    // Candidates are (~ours & peer); among them prefer the rarest piece
+    // according to piece_availability_. With no availability data every
+    // count is 0 and this degenerates to first-fit, matching the old loop.
+    int32_t best_piece = -1;
+    uint32_t best_availability = UINT32_MAX;
+
+    size_t w = 0;
+
+#if defined(__AVX2__)
+    // AND-NOT 256 bits per iteration and skip chunks with no candidate bits
+    for (; w + 4 <= num_words; w += 4) {
+        __m256i our_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&ours[w]));
+        __m256i peer_words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&peer[w]));
+        __m256i wanted = _mm256_andnot_si256(our_words, peer_words);
+
+        if (_mm256_testz_si256(wanted, wanted)) {
+            continue;
+        }
+
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), wanted);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            scanWantedWord(w + lane, lanes[lane], best_piece, best_availability);
+        }
+
+        if (best_piece >= 0 && best_availability <= 1) {
+            return best_piece;  // Cannot get rarer than a single holder
+        }
+    }
+#endif
+
+    for (; w < num_words; ++w) {
+        scanWantedWord(w, ~ours[w] & peer[w], best_piece, best_availability);
+        if (best_piece >= 0 && best_availability <= 1) {
+            return best_piece;
+        }
+    }
+
+    return best_piece;  // -1 if no piece to download
+}
+
+void PieceManager::scanWantedWord(size_t word_index, uint64_t wanted,
+                                  int32_t& best_piece, uint32_t& best_availability) const {
+    while (wanted != 0) {
+        size_t piece = (word_index << 6) + popNextBit(wanted);
+
+        if (piece >= num_pieces_) {
+            break;  // Stray bits past the last piece
+        }
+
+        uint32_t availability = piece_availability_[piece];
+        if (availability < best_availability) {
+            best_availability = availability;
+            best_piece = static_cast<int32_t>(piece);
+        }
+    }
+}
+
+void PieceManager::addPeerAvailability(const Bitfield& peer_has_pieces) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& words = peer_has_pieces.words();
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t bits = words[w];
+        while (bits != 0) {
+            size_t piece = (w << 6) + popNextBit(bits);
+            if (piece < num_pieces_ && piece_availability_[piece] != UINT16_MAX) {
+                ++piece_availability_[piece];
+            }
+        }
+    }
+}
+
+void PieceManager::removePeerAvailability(const Bitfield& peer_has_pieces) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& words = peer_has_pieces.words();
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t bits = words[w];
+        while (bits != 0) {
+            size_t piece = (w << 6) + popNextBit(bits);
+            if (piece < num_pieces_ && piece_availability_[piece] > 0) {
+                --piece_availability_[piece];
+            }
         }
     }
+}
 
-    return -1;  // No piece to download
+void PieceManager::incrementPieceAvailability(uint32_t piece_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (piece_index < num_pieces_ && piece_availability_[piece_index] != UINT16_MAX) {
+        ++piece_availability_[piece_index];
+    }
 }
 
-std::vector<Block> PieceManager::getBlocksForPiece(uint32_t piece_index) {
-    std::vector<Block> blocks;
+BlockList PieceManager::getBlocksForPiece(uint32_t piece_index) {
+    BlockList blocks;
 
     if (piece_index >= num_pieces_) {
         return blocks;
     }
+    blocks.piece_index = piece_index;
 
     // Calculate piece size (last piece might be smaller)
     size_t piece_size = piece_length_;
@@ -68,10 +184,14 @@ std::vector<Block> PieceManager::getBlocksForPiece(uint32_t piece_index) {
     }
 
     // Split piece into blocks
+    size_t num_blocks = (piece_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blocks.offsets.reserve(num_blocks);
+    blocks.lengths.reserve(num_blocks);
     size_t offset = 0;
     while (offset < piece_size) {
         size_t block_size = std::min(BLOCK_SIZE, piece_size - offset);
-        blocks.emplace_back(piece_index, offset, block_size);
+        blocks.offsets.push_back(static_cast<uint32_t>(offset));
+        blocks.lengths.push_back(static_cast<uint32_t>(block_size));
         offset += block_size;
     }
 
@@ -87,14 +207,53 @@ bool PieceManager::addBlock(uint32_t piece_index, uint32_t offset, const std::ve
     }
 
     // Check if already have this piece
-    if (bitfield_[piece_index]) {
+    if (bitfield_.test(piece_index)) {
         std::cout << "Piece " << piece_index << " already completed, ignoring block\n";
         return true;
     }
 
     // Get or create PieceInProgress
-    auto it = pieces_in_progress_.find(piece_index);
-    if (it == pieces_in_progress_.end()) {
+    PieceInProgress* piece = getOrCreatePieceLocked(piece_index);
+
+
+    // Calculate block index
+    size_t block_index = offset / BLOCK_SIZE;
+    if (block_index >= piece->total_blocks) {
+        std::cerr << "Invalid block index " << block_index
+                  << " for piece " << piece_index << "\n";
+        return false;
+    }
+
+    // Check if already have this block
+    if (piece->blocks_received.test(block_index)) {
+        std::cout << "Block already received: piece=" << piece_index
+                  << " offset=" << offset << "\n";
+        return true;
+    }
+
+    // Copy block data into piece buffer
+    if (offset + data.size() > piece->piece_size) {
+        std::cerr << "Block data exceeds piece size\n";
+        return false;
+    }
+
+    std::memcpy(piece->data.get() + offset, data.data(), data.size());
+    piece->blocks_received.set(block_index);
+    piece->blocks_downloaded++;
+    advancePieceHashLocked(piece);
+
+    std::cout << "Block received: piece=" << piece_index
+              << " offset=" << offset
+              << " size=" << data.size()
+              << " (" << piece->blocks_downloaded << "/"
+              << piece->total_blocks << " blocks, "
+              << static_cast<int>(piece->progress() * 100) << "%)\n";
+
+    return true;
+}
+
+PieceInProgress* PieceManager::getOrCreatePieceLocked(uint32_t piece_index) {
+    if (!pieces_in_progress_[piece_index]) {
         // Create new piece in progress
         size_t piece_size = piece_length_;
         if (piece_index == num_pieces_ - 1) {
@@ -105,44 +264,73 @@ bool PieceManager::addBlock(uint32_t piece_index, uint32_t offset, const std::ve
         }
 
         size_t num_blocks = (piece_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
-        auto piece = std::make_unique<PieceInProgress>(piece_index, piece_size, num_blocks);
-        it = pieces_in_progress_.emplace(piece_index, std::move(piece)).first;
+        pieces_in_progress_[piece_index] =
+            std::make_unique<PieceInProgress>(piece_index, piece_size, num_blocks);
+        num_in_progress_++;
 
         std::cout << "Started assembling piece " << piece_index
                   << " (size=" << piece_size << " bytes, "
                   << num_blocks << " blocks)\n";
     }
 
-    PieceInProgress* piece = it->second.get();
+    return pieces_in_progress_[piece_index].get();
+}
+
+uint8_t* PieceManager::blockReceiveBuffer(uint32_t piece_index, uint32_t offset, uint32_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (piece_index >= num_pieces_ || bitfield_.test(piece_index)) {
+        return nullptr;  // Bad index or piece already complete
+    }
+
+    PieceInProgress* piece = getOrCreatePieceLocked(piece_index);
 
-    // Calculate block index
     size_t block_index = offset / BLOCK_SIZE;
-    if (block_index >= piece->total_blocks) {
-        std::cerr << "Invalid block index " << block_index
-                  << " for piece " << piece_index << "\n";
-        return false;
+    if (block_index >= piece->total_blocks ||
+        piece->blocks_received.test(block_index) ||
+        offset + length > piece->piece_size) {
+        return nullptr;  // Invalid or duplicate block
     }
 
-    // Check if already have this block
-    if (piece->blocks_received[block_index]) {
-        std::cout << "Block already received: piece=" << piece_index
-                  << " offset=" << offset << "\n";
-        return true;
+    return piece->data.get() + offset;
+}
+
+// Fold newly contiguous blocks into the piece's streaming SHA-1 state.
+// Called right after a block commit, while its bytes are still hot in
+// cache; stops at the first gap, so out-of-order blocks are picked up
+// once the block filling the gap arrives.
+void PieceManager::advancePieceHashLocked(PieceInProgress* piece) {
+    while (piece->hashed_bytes < piece->piece_size) {
+        size_t block_index = piece->hashed_bytes / BLOCK_SIZE;
+        if (!piece->blocks_received.test(block_index)) {
+            break;
+        }
+        size_t len = std::min(BLOCK_SIZE, piece->piece_size - piece->hashed_bytes);
+        piece->hash.update(piece->data.get() + piece->hashed_bytes, len);
+        piece->hashed_bytes += len;
     }
+}
 
-    // Copy block data into piece buffer
-    if (offset + data.size() > piece->piece_size) {
-        std::cerr << "Block data exceeds piece size\n";
+bool PieceManager::commitReceivedBlock(uint32_t piece_index, uint32_t offset, uint32_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (piece_index >= num_pieces_ || !pieces_in_progress_[piece_index]) {
         return false;
     }
 
-    std::copy(data.begin(), data.end(), piece->data.begin() + offset);
-    piece->blocks_received[block_index] = true;
+    PieceInProgress* piece = pieces_in_progress_[piece_index].get();
+    size_t block_index = offset / BLOCK_SIZE;
+    if (block_index >= piece->total_blocks || piece->blocks_received.test(block_index)) {
+        return false;
+    }
+
+    piece->blocks_received.set(block_index);
     piece->blocks_downloaded++;
+    advancePieceHashLocked(piece);
 
     std::cout << "Block received: piece=" << piece_index
               << " offset=" << offset
-              << " size=" << data.size()
+              << " size=" << length
               << " (" << piece->blocks_downloaded << "/"
               << piece->total_blocks << " blocks, "
               << static_cast<int>(piece->progress() * 100) << "%)\n";
@@ -151,6 +339,10 @@ bool PieceManager::addBlock(uint32_t piece_index, uint32_t offset, const std::ve
 }
 
 bool PieceManager::verifyPiece(uint32_t piece_index, const std::vector<uint8_t>& data) const {
+    return verifyPiece(piece_index, data.data(), data.size());
+}
+
+bool PieceManager::verifyPiece(uint32_t piece_index, const uint8_t* data, size_t length) const {
     if (piece_index >= num_pieces_) {
         return false;
     }
@@ -161,20 +353,21 @@ bool PieceManager::verifyPiece(uint32_t piece_index, const std::vector<uint8_t>&
         return false;
     }
 
-    std::vector<uint8_t> expected_hash(
-        piece_hashes_.begin() + hash_offset,
-        piece_hashes_.begin() + hash_offset + 20
-    );
-
-    // Calculate actual hash
-    std::vector<uint8_t> actual_hash = utils::sha1(data);
+    // Calculate actual hash over the piece buffer in place — no
+    // temporary copy of the (up to multi-MB) piece, digest on the stack
+    uint8_t actual_hash[20];
+    utils::sha1Into(actual_hash, data, length);
 
     // Compare
-    return expected_hash == actual_hash;
+    return std::memcmp(actual_hash, piece_hashes_.data() + hash_offset, 20) == 0;
 }
 
 double PieceManager::percentComplete() const {
     std::lock_guard<std::mutex> lock(mutex_);
+    return percentCompleteLocked();
+}
+
+double PieceManager::percentCompleteLocked() const {
     if (num_pieces_ == 0) {
         return 0.0;
     }
@@ -182,32 +375,35 @@ double PieceManager::percentComplete() const {
 }
 
 std::vector<bool> PieceManager::getBitfield() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bitfield_.toBools();
+}
+
+Bitfield PieceManager::getBitfieldPacked() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return bitfield_;
 }
 
 bool PieceManager::isPieceInProgress(uint32_t piece_index) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return pieces_in_progress_.find(piece_index) != pieces_in_progress_.end();
+    return piece_index < num_pieces_ && pieces_in_progress_[piece_index] != nullptr;
 }
 
 PieceInProgress* PieceManager::getPieceInProgress(uint32_t piece_index) {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = pieces_in_progress_.find(piece_index);
-    return (it != pieces_in_progress_.end()) ? it->second.get() : nullptr;
+    return (piece_index < num_pieces_) ? pieces_in_progress_[piece_index].get() : nullptr;
 }
 
 bool PieceManager::completePiece(uint32_t piece_index, FileManager* file_manager) {
     std::lock_guard<std::mutex> lock(mutex_);
 
     // Check if piece is in progress
-    auto it = pieces_in_progress_.find(piece_index);
-    if (it == pieces_in_progress_.end()) {
+    if (piece_index >= num_pieces_ || !pieces_in_progress_[piece_index]) {
         std::cerr << "Piece " << piece_index << " is not in progress\n";
         return false;
     }
 
-    PieceInProgress* piece = it->second.get();
+    PieceInProgress* piece = pieces_in_progress_[piece_index].get();
 
     // Check if all blocks received
     if (!piece->isComplete()) {
@@ -218,45 +414,87 @@ bool PieceManager::completePiece(uint32_t piece_index, FileManager* file_manager
 
     std::cout << "Piece " << piece_index << " assembly complete, verifying hash...\n";
 
-    // Verify hash
-    if (!verifyPiece(piece_index, piece->data)) {
+    // The digest was accumulated block-by-block as the piece assembled
+    // (advancePieceHashLocked), while each block was still hot from the
+    // socket read — completion only finalizes it, sparing a full pass
+    // over the by-now cache-cold piece buffer. The watermark can lag the
+    // received bitmap only if a caller bypassed the commit path, so top
+    // up any remainder before finalizing.
+    size_t hash_offset = static_cast<size_t>(piece_index) * 20;
+    if (hash_offset + 20 > piece_hashes_.size()) {
+        std::cerr << "ERROR: No stored hash for piece " << piece_index << "\n";
+        pieces_in_progress_[piece_index].reset();
+        num_in_progress_--;
+        return false;
+    }
+
+    advancePieceHashLocked(piece);
+
+    uint8_t digest[20];
+    piece->hash.finish(digest);
+    if (std::memcmp(digest, piece_hashes_.data() + hash_offset, 20) != 0) {
         std::cerr << "ERROR: Piece " << piece_index << " hash verification FAILED!\n";
         std::cerr << "  Discarding piece and will re-request\n";
 
         // Remove from in-progress
-        pieces_in_progress_.erase(it);
+        pieces_in_progress_[piece_index].reset();
+        num_in_progress_--;
         return false;
     }
 
     std::cout << "Piece " << piece_index << " hash verification SUCCESS\n";
 
-    // Write to disk
-    if (file_manager && !file_manager->writePiece(piece_index, piece->data)) {
+    // Write only after the digest matches, so a corrupt piece never
+    // touches the disk
+    bool write_ok = true;
+    if (file_manager) {
+        write_ok = file_manager->writePieceRange(piece_index, 0,
+                                                 piece->data.get(), piece->piece_size);
+    }
+
+    if (!write_ok) {
         std::cerr << "ERROR: Failed to write piece " << piece_index << " to disk\n";
-        pieces_in_progress_.erase(it);
+        pieces_in_progress_[piece_index].reset();
+        num_in_progress_--;
         return false;
     }
 
     std::cout << "Piece " << piece_index << " written to disk successfully\n";
 
     // Mark as complete
-    if (!bitfield_[piece_index]) {
-        bitfield_[piece_index] = true;
+    if (!bitfield_.test(piece_index)) {
+        bitfield_.set(piece_index);
         pieces_downloaded_++;
+        patchBitfieldMessageLocked(piece_index);
     }
 
     // Remove from in-progress
-    pieces_in_progress_.erase(it);
+    pieces_in_progress_[piece_index].reset();
+    num_in_progress_--;
 
     std::cout << "✓ Piece " << piece_index << " COMPLETED! Progress: "
-              << percentComplete() << "%\n";
+              << percentCompleteLocked() << "%\n";
 
     return true;
 }
 
 size_t PieceManager::numPiecesInProgress() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return pieces_in_progress_.size();
+    return num_in_progress_;
+}
+
+BloomBitfield PieceManager::getBloomSummary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    BloomBitfield summary;
+    const auto& words = bitfield_.words();
+    for (size_t wi = 0; wi < words.size(); ++wi) {
+        uint64_t w = words[wi];
+        while (w != 0) {
+            summary.insert(static_cast<uint32_t>((wi << 6) + popNextBit(w)));
+        }
+    }
+    return summary;
 }
 
 // Piece selection strategies
@@ -278,29 +516,207 @@ std::vector<int> PieceManager::calculatePieceRarity(
     return rarity;
 }
 
+std::vector<int> PieceManager::calculatePieceRarity(
+    const PeerBitfieldMatrix& all_peers) const {
+
+    std::vector<int> rarity(num_pieces_, 0);
+
+    // One positional popcount per 64-piece column turns the contiguous
+    // peer words into all 64 availability counts at once — no per-bit,
+    // per-peer extraction.
+    size_t num_words = std::min((num_pieces_ + 63) / 64, all_peers.wordsPerPeer());
+    uint32_t counts[64];
+    for (size_t w = 0; w < num_words; ++w) {
+        cpu::bitmapPositionalCount(all_peers.column(w), all_peers.numPeers(), counts);
+        size_t base = w << 6;
+        size_t n = std::min<size_t>(64, num_pieces_ - base);
+        for (size_t b = 0; b < n; ++b) {
+            rarity[base + b] = static_cast<int>(counts[b]);
+        }
+    }
+
+    return rarity;
+}
+
 int32_t PieceManager::getNextPieceRarestFirst(
     const std::vector<std::vector<bool>>& all_peer_bitfields,
     const std::vector<bool>& peer_has_pieces,
     const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the word-wise scan
+    return getNextPieceRarestFirst(all_peer_bitfields,
+                                   Bitfield::fromBools(peer_has_pieces), in_download);
+}
+
+int32_t PieceManager::getNextPieceRarestFirst(
+    const std::vector<std::vector<bool>>& all_peer_bitfields,
+    const Bitfield& peer_has_pieces,
+    const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the fused scan
+    return getNextPieceRarestFirst(all_peer_bitfields, peer_has_pieces,
+                                   packInDownload(in_download, num_pieces_));
+}
+
+int32_t PieceManager::getNextPieceRarestFirst(
+    const std::vector<std::vector<bool>>& all_peer_bitfields,
+    const Bitfield& peer_has_pieces,
+    const Bitfield& in_download) {
 
     std::lock_guard<std::mutex> lock(mutex_);
 
     // Calculate rarity
     std::vector<int> rarity = calculatePieceRarity(all_peer_bitfields);
 
-    // Find rarest piece that this peer has and we need
+    // Candidate enumeration is word-wise over (~ours & peer & ~indl):
+    // only set bits are touched, and whole words of unwanted or
+    // in-flight pieces are skipped
+    const auto& ours = bitfield_.words();
+    const auto& peer = peer_has_pieces.words();
+    const auto& indl = in_download.words();
+    size_t num_words = std::min(ours.size(), peer.size());
+
     int32_t best_piece = -1;
     int min_rarity = INT_MAX;
 
-    for (size_t i = 0; i < num_pieces_; ++i) {
-        if (!bitfield_[i] &&  // We don't have it
-            pieces_in_progress_.find(i) == pieces_in_progress_.end() &&  // Not in assembly
-            in_download.find(i) == in_download.end() &&  // Not being downloaded
-            i < peer_has_pieces.size() && peer_has_pieces[i] &&  // Peer has it
-            rarity[i] < min_rarity && rarity[i] > 0) {  // Rarer than current best
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t wanted = ~ours[w] & peer[w];
+        if (w < indl.size()) {
+            wanted &= ~indl[w];
+        }
+        while (wanted != 0) {
+            size_t i = (w << 6) + popNextBit(wanted);
+            if (i >= num_pieces_) {
+                break;
+            }
+            if (!pieces_in_progress_[i] &&
+                rarity[i] < min_rarity && rarity[i] > 0) {
+                min_rarity = rarity[i];
+                best_piece = static_cast<int32_t>(i);
+            }
+        }
+    }
 
-            min_rarity = rarity[i];
-            best_piece = static_cast<int32_t>(i);
+    if (best_piece >= 0) {
+        std::cout << "Selected piece #" << best_piece << " (rarity: " << min_rarity << ")\n";
+    }
+
+    return best_piece;
+}
+
+int32_t PieceManager::getNextPieceRarestFirst(
+    const PeerBitfieldMatrix& all_peers,
+    const Bitfield& peer_has_pieces,
+    const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the fused scan
+    return getNextPieceRarestFirst(all_peers, peer_has_pieces,
+                                   packInDownload(in_download, num_pieces_));
+}
+
+int32_t PieceManager::getNextPieceRarestFirst(
+    const PeerBitfieldMatrix& all_peers,
+    const Bitfield& peer_has_pieces,
+    const Bitfield& in_download) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto& ours = bitfield_.words();
+    const auto& peer = peer_has_pieces.words();
+    const auto& indl = in_download.words();
+    size_t num_words = std::min({ours.size(), peer.size(), all_peers.wordsPerPeer()});
+    size_t num_peers = all_peers.numPeers();
+
+    int32_t best_piece = -1;
+    uint32_t min_rarity = UINT32_MAX;
+
+    // Rarity is only computed for wanted pieces: skip whole words where
+    // (~ours & peer & ~indl) is zero, and for each candidate bit sum
+    // that bit across the contiguous peer column — sequential loads, no
+    // per-peer pointer chase.
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t wanted = ~ours[w] & peer[w];
+        if (w < indl.size()) {
+            wanted &= ~indl[w];
+        }
+        if (wanted == 0) {
+            continue;
+        }
+        const uint64_t* column = all_peers.column(w);
+
+        // The positional popcount tallies all 64 bit positions in ~8 ops
+        // per peer word; the scalar sum costs one pass per candidate bit.
+        // Use the kernel once the column has enough candidates to amortize
+        // it, otherwise sum the few bits directly.
+        uint32_t col_rarity[64];
+        bool use_counts = __builtin_popcountll(wanted) > 8;
+        if (use_counts) {
+            cpu::bitmapPositionalCount(column, num_peers, col_rarity);
+        }
+        while (wanted != 0) {
+            unsigned bit = popNextBit(wanted);
+            size_t i = (w << 6) + bit;
+            if (i >= num_pieces_) {
+                break;
+            }
+            if (pieces_in_progress_[i]) {
+                continue;
+            }
+            uint32_t rarity;
+            if (use_counts) {
+                rarity = col_rarity[bit];
+            } else {
+                rarity = 0;
+                for (size_t p = 0; p < num_peers; ++p) {
+                    rarity += static_cast<uint32_t>((column[p] >> bit) & 1);
+                }
+            }
+            if (rarity > 0 && rarity < min_rarity) {
+                min_rarity = rarity;
+                best_piece = static_cast<int32_t>(i);
+            }
+        }
+    }
+
+    if (best_piece >= 0) {
+        std::cout << "Selected piece #" << best_piece << " (rarity: " << min_rarity << ")\n";
+    }
+
+    return best_piece;
+}
+
+int32_t PieceManager::getNextPieceRarestFirst(
+    const Bitfield& peer_has_pieces,
+    const Bitfield& in_download) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto& ours = bitfield_.words();
+    const auto& peer = peer_has_pieces.words();
+    const auto& indl = in_download.words();
+    size_t num_words = std::min(ours.size(), peer.size());
+
+    int32_t best_piece = -1;
+    uint32_t min_rarity = UINT32_MAX;
+
+    // piece_availability_ is kept current by the HAVE/BITFIELD/disconnect
+    // bookkeeping, so rarity per candidate is one table load — the outer
+    // loop over every peer's bitfield is gone entirely
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t wanted = ~ours[w] & peer[w];
+        if (w < indl.size()) {
+            wanted &= ~indl[w];
+        }
+        while (wanted != 0) {
+            size_t i = (w << 6) + popNextBit(wanted);
+            if (i >= num_pieces_) {
+                break;
+            }
+            uint32_t rarity = piece_availability_[i];
+            if (!pieces_in_progress_[i] && rarity > 0 && rarity < min_rarity) {
+                min_rarity = rarity;
+                best_piece = static_cast<int32_t>(i);
+            }
+        }
+        if (min_rarity == 1) {
+            break;  // Cannot get rarer than a single holder
         }
     }
 
@@ -314,6 +730,21 @@ int32_t PieceManager::getNextPieceRarestFirst(
 int32_t PieceManager::getNextPieceRandomFirst(
     const std::vector<bool>& peer_has_pieces,
     const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the word-wise scan
+    return getNextPieceRandomFirst(Bitfield::fromBools(peer_has_pieces), in_download);
+}
+
+int32_t PieceManager::getNextPieceRandomFirst(
+    const Bitfield& peer_has_pieces,
+    const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the fused scan
+    return getNextPieceRandomFirst(peer_has_pieces,
+                                   packInDownload(in_download, num_pieces_));
+}
+
+int32_t PieceManager::getNextPieceRandomFirst(
+    const Bitfield& peer_has_pieces,
+    const Bitfield& in_download) {
 
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -322,25 +753,39 @@ int32_t PieceManager::getNextPieceRandomFirst(
         return -1;  // Switch to rarest-first
     }
 
-    // Collect available pieces
-    std::vector<uint32_t> available;
-    for (size_t i = 0; i < num_pieces_; ++i) {
-        if (!bitfield_[i] &&
-            pieces_in_progress_.find(i) == pieces_in_progress_.end() &&
-            in_download.find(i) == in_download.end() &&
-            i < peer_has_pieces.size() && peer_has_pieces[i]) {
-            available.push_back(i);
+    // Reservoir-sample while scanning ~ours & peer & ~indl: the k-th
+    // eligible piece replaces the pick with probability 1/k, giving a
+    // uniform choice without materializing a candidate vector
+    const auto& ours = bitfield_.words();
+    const auto& peer = peer_has_pieces.words();
+    const auto& indl = in_download.words();
+    size_t num_words = std::min(ours.size(), peer.size());
+
+    int32_t selected = -1;
+    uint32_t seen = 0;
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t wanted = ~ours[w] & peer[w];
+        if (w < indl.size()) {
+            wanted &= ~indl[w];
+        }
+        while (wanted != 0) {
+            size_t i = (w << 6) + popNextBit(wanted);
+            if (i >= num_pieces_) {
+                break;
+            }
+            if (!pieces_in_progress_[i]) {
+                ++seen;
+                if (rand() % seen == 0) {
+                    selected = static_cast<int32_t>(i);
+                }
+            }
         }
     }
 
-    if (available.empty()) {
+    if (selected < 0) {
         return -1;
     }
 
-    // Select random piece
-    size_t random_idx = rand() % available.size();
-    int32_t selected = available[random_idx];
-
     std::cout << "Selected piece #" << selected << " (random-first mode)\n";
     return selected;
 }
@@ -348,16 +793,44 @@ int32_t PieceManager::getNextPieceRandomFirst(
 int32_t PieceManager::getNextPieceSequential(
     const std::vector<bool>& peer_has_pieces,
     const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the word-wise scan
+    return getNextPieceSequential(Bitfield::fromBools(peer_has_pieces), in_download);
+}
+
+int32_t PieceManager::getNextPieceSequential(
+    const Bitfield& peer_has_pieces,
+    const std::set<uint32_t>& in_download) {
+    // Thin compatibility wrapper: pack once, then run the fused scan
+    return getNextPieceSequential(peer_has_pieces,
+                                  packInDownload(in_download, num_pieces_));
+}
+
+int32_t PieceManager::getNextPieceSequential(
+    const Bitfield& peer_has_pieces,
+    const Bitfield& in_download) {
 
     std::lock_guard<std::mutex> lock(mutex_);
 
-    // Select first piece that we need and peer has
-    for (size_t i = 0; i < num_pieces_; ++i) {
-        if (!bitfield_[i] &&
-            pieces_in_progress_.find(i) == pieces_in_progress_.end() &&
-            in_download.find(i) == in_download.end() &&
-            i < peer_has_pieces.size() && peer_has_pieces[i]) {
-            return static_cast<int32_t>(i);
+    // Select first piece that we need and peer has: skip 64 pieces per
+    // zero word, then walk set bits in index order
+    const auto& ours = bitfield_.words();
+    const auto& peer = peer_has_pieces.words();
+    const auto& indl = in_download.words();
+    size_t num_words = std::min(ours.size(), peer.size());
+
+    for (size_t w = 0; w < num_words; ++w) {
+        uint64_t wanted = ~ours[w] & peer[w];
+        if (w < indl.size()) {
+            wanted &= ~indl[w];
+        }
+        while (wanted != 0) {
+            size_t i = (w << 6) + popNextBit(wanted);
+            if (i >= num_pieces_) {
+                break;
+            }
+            if (!pieces_in_progress_[i]) {
+                return static_cast<int32_t>(i);
+            }
         }
     }
 
@@ -392,7 +865,7 @@ bool PieceManager::saveStateToDisk(const std::string& resume_file_path) const {
         std::vector<uint8_t> packed_bitfield(bitfield_bytes, 0);
 
         for (size_t i = 0; i < num_pieces_; ++i) {
-            if (bitfield_[i]) {
+            if (bitfield_.test(i)) {
                 packed_bitfield[i / 8] |= (1 << (7 - (i % 8)));
             }
         }
@@ -462,12 +935,16 @@ bool PieceManager::loadStateFromDisk(const std::string& resume_file_path) {
         for (size_t i = 0; i < num_pieces_; ++i) {
             uint8_t byte = packed_bitfield[i / 8];
             bool has_piece = (byte & (1 << (7 - (i % 8)))) != 0;
-            bitfield_[i] = has_piece;
             if (has_piece) {
+                bitfield_.set(i);
                 pieces_downloaded_++;
+            } else {
+                bitfield_.reset(i);
             }
         }
 
+        rebuildBitfieldMessageLocked();
+
         // Read timestamp (informational only)
         int64_t timestamp;
         file.read(reinterpret_cast<char*>(&timestamp), 8);
@@ -475,7 +952,7 @@ bool PieceManager::loadStateFromDisk(const std::string& resume_file_path) {
         file.close();
 
         std::cout << "Resume state loaded: " << pieces_downloaded_ << "/" << num_pieces_
-                  << " pieces completed (" << percentComplete() << "%)\n";
+                  << " pieces completed (" << percentCompleteLocked() << "%)\n";
 
         return true;
 
@@ -494,15 +971,63 @@ void PieceManager::setBitfield(const std::vector<bool>& bitfield) {
         return;
     }
 
+    bitfield_ = Bitfield::fromBools(bitfield);
+
+    // Recalculate pieces_downloaded_ with one popcount per word
+    pieces_downloaded_ = bitfield_.count();
+    rebuildBitfieldMessageLocked();
+}
+
+void PieceManager::setBitfield(const Bitfield& bitfield) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (bitfield.size() != num_pieces_) {
+        std::cerr << "Bitfield size mismatch: expected " << num_pieces_
+                  << ", got " << bitfield.size() << "\n";
+        return;
+    }
+
     bitfield_ = bitfield;
+    pieces_downloaded_ = bitfield_.count();
+    rebuildBitfieldMessageLocked();
+}
+
+std::vector<uint8_t> PieceManager::getBitfieldWire() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Skip the 5 framing bytes (length prefix + message id)
+    return std::vector<uint8_t>(bitfield_msg_cache_.begin() + 5,
+                                bitfield_msg_cache_.end());
+}
 
-    // Recalculate pieces_downloaded_
-    pieces_downloaded_ = 0;
-    for (bool piece : bitfield_) {
-        if (piece) {
-            pieces_downloaded_++;
+std::vector<uint8_t> PieceManager::bitfieldMessage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pieces_downloaded_ == 0) {
+        return {};
+    }
+    return bitfield_msg_cache_;
+}
+
+void PieceManager::rebuildBitfieldMessageLocked() {
+    size_t payload_bytes = (num_pieces_ + 7) / 8;
+    uint32_t frame_length = static_cast<uint32_t>(1 + payload_bytes);
+
+    bitfield_msg_cache_.assign(5 + payload_bytes, 0);
+    bitfield_msg_cache_[0] = static_cast<uint8_t>((frame_length >> 24) & 0xFF);
+    bitfield_msg_cache_[1] = static_cast<uint8_t>((frame_length >> 16) & 0xFF);
+    bitfield_msg_cache_[2] = static_cast<uint8_t>((frame_length >> 8) & 0xFF);
+    bitfield_msg_cache_[3] = static_cast<uint8_t>(frame_length & 0xFF);
+    bitfield_msg_cache_[4] = 5;  // BITFIELD
+
+    for (size_t i = 0; i < num_pieces_; ++i) {
+        if (bitfield_.test(i)) {
+            bitfield_msg_cache_[5 + i / 8] |= static_cast<uint8_t>(0x80 >> (i % 8));
         }
     }
 }
 
+void PieceManager::patchBitfieldMessageLocked(uint32_t piece_index) {
+    // Single-bit flip: the length header and every other byte are unchanged
+    bitfield_msg_cache_[5 + piece_index / 8] |= static_cast<uint8_t>(0x80 >> (piece_index % 8));
+}
+
 } // namespace torrent
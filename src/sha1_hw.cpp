@@ -0,0 +1,599 @@
+#include "sha1_hw.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TORRENT_SHA1_NI 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#define TORRENT_SHA1_CE 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+namespace torrent {
+namespace utils {
+
+#ifdef TORRENT_SHA1_NI
+
+namespace {
+
+// Process `blocks` 64-byte blocks with the SHA-NI round instructions.
+// Standard schedule: sha1msg1/sha1msg2 expand the message, sha1rnds4 runs
+// four rounds at a time with the round function selected by the immediate
+// (0: rounds 0-19, 1: 20-39, 2: 40-59, 3: 60-79).
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha1NiTransform(uint32_t state[5], const uint8_t* data, size_t blocks) {
+    const __m128i byteswap_mask =
+        _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    abcd = _mm_shuffle_epi32(abcd, 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+    __m128i e1;
+
+    while (blocks-- > 0) {
+        const __m128i abcd_save = abcd;
+        const __m128i e_save = e0;
+
+        __m128i msg0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i msg1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+        __m128i msg2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+        __m128i msg3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+        msg0 = _mm_shuffle_epi8(msg0, byteswap_mask);
+        msg1 = _mm_shuffle_epi8(msg1, byteswap_mask);
+        msg2 = _mm_shuffle_epi8(msg2, byteswap_mask);
+        msg3 = _mm_shuffle_epi8(msg3, byteswap_mask);
+
+        // Rounds 0-3
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        // Rounds 4-7
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        // Rounds 8-11
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // Rounds 12-15
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+
+        // Rounds 16-19
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+
+        // Rounds 20-23
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+
+        // Rounds 24-27
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+
+        // Rounds 28-31
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+
+        // Rounds 32-35
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+
+        // Rounds 36-39
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+
+        // Rounds 40-43
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+
+        // Rounds 44-47
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+
+        // Rounds 48-51
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+
+        // Rounds 52-55
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+
+        // Rounds 56-59
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+
+        // Rounds 60-63
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+
+        // Rounds 64-67
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+
+        // Rounds 68-71
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg3 = _mm_xor_si128(msg3, msg1);
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+
+        // Rounds 72-75
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+
+        // Rounds 76-79
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        // Fold back into the running state
+        e0 = _mm_sha1nexte_epu32(e0, e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+
+        data += 64;
+    }
+
+    abcd = _mm_shuffle_epi32(abcd, 0x1B);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+} // namespace
+
+bool sha1HardwareAvailable() {
+    static const bool available = __builtin_cpu_supports("sha") != 0;
+    return available;
+}
+
+void sha1Hardware(const uint8_t* data, size_t length, uint8_t digest[20]) {
+    uint32_t state[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    // Bulk of the message: whole 64-byte blocks straight from the input
+    size_t full_blocks = length / 64;
+    sha1NiTransform(state, data, full_blocks);
+
+    // Final block(s): remaining bytes + 0x80 pad + 64-bit bit length
+    uint8_t tail[128];
+    size_t rem = length - full_blocks * 64;
+    std::memcpy(tail, data + full_blocks * 64, rem);
+    tail[rem] = 0x80;
+    size_t tail_len = (rem + 1 + 8 <= 64) ? 64 : 128;
+    std::memset(tail + rem + 1, 0, tail_len - rem - 1 - 8);
+
+    uint64_t bit_length = static_cast<uint64_t>(length) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tail_len - 1 - i] = static_cast<uint8_t>(bit_length >> (i * 8));
+    }
+    sha1NiTransform(state, tail, tail_len / 64);
+
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+#elif defined(TORRENT_SHA1_CE)
+
+namespace {
+
+// Process `blocks` 64-byte blocks with the ARMv8 Crypto Extension SHA-1
+// instructions. Same four-rounds-at-a-time shape as the SHA-NI path:
+// vsha1su0/vsha1su1 expand the message, vsha1c/vsha1p/vsha1m run the
+// choose/parity/majority round groups, vsha1h supplies the rotated E.
+void sha1CeTransform(uint32_t state[5], const uint8_t* data, size_t blocks) {
+    uint32x4_t abcd = vld1q_u32(state);
+    uint32_t e0 = state[4];
+    uint32_t e1;
+
+    while (blocks-- > 0) {
+        const uint32x4_t abcd_save = abcd;
+        const uint32_t e_save = e0;
+
+        uint32x4_t msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+        uint32x4_t msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+        uint32x4_t msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+        uint32x4_t msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+        uint32x4_t tmp0 = vaddq_u32(msg0, vdupq_n_u32(0x5A827999));
+        uint32x4_t tmp1 = vaddq_u32(msg1, vdupq_n_u32(0x5A827999));
+
+        // Rounds 0-3
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1cq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg2, vdupq_n_u32(0x5A827999));
+        msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+        // Rounds 4-7
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1cq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg3, vdupq_n_u32(0x5A827999));
+        msg0 = vsha1su1q_u32(msg0, msg3);
+        msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+        // Rounds 8-11
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1cq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg0, vdupq_n_u32(0x5A827999));
+        msg1 = vsha1su1q_u32(msg1, msg0);
+        msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+        // Rounds 12-15
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1cq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg1, vdupq_n_u32(0x6ED9EBA1));
+        msg2 = vsha1su1q_u32(msg2, msg1);
+        msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+        // Rounds 16-19
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1cq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg2, vdupq_n_u32(0x6ED9EBA1));
+        msg3 = vsha1su1q_u32(msg3, msg2);
+        msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+        // Rounds 20-23
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg3, vdupq_n_u32(0x6ED9EBA1));
+        msg0 = vsha1su1q_u32(msg0, msg3);
+        msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+        // Rounds 24-27
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg0, vdupq_n_u32(0x6ED9EBA1));
+        msg1 = vsha1su1q_u32(msg1, msg0);
+        msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+        // Rounds 28-31
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg1, vdupq_n_u32(0x6ED9EBA1));
+        msg2 = vsha1su1q_u32(msg2, msg1);
+        msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+        // Rounds 32-35
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg2, vdupq_n_u32(0x8F1BBCDC));
+        msg3 = vsha1su1q_u32(msg3, msg2);
+        msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+        // Rounds 36-39
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg3, vdupq_n_u32(0x8F1BBCDC));
+        msg0 = vsha1su1q_u32(msg0, msg3);
+        msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+        // Rounds 40-43
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1mq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg0, vdupq_n_u32(0x8F1BBCDC));
+        msg1 = vsha1su1q_u32(msg1, msg0);
+        msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+        // Rounds 44-47
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1mq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg1, vdupq_n_u32(0x8F1BBCDC));
+        msg2 = vsha1su1q_u32(msg2, msg1);
+        msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+        // Rounds 48-51
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1mq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg2, vdupq_n_u32(0x8F1BBCDC));
+        msg3 = vsha1su1q_u32(msg3, msg2);
+        msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+        // Rounds 52-55
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1mq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg3, vdupq_n_u32(0xCA62C1D6));
+        msg0 = vsha1su1q_u32(msg0, msg3);
+        msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+        // Rounds 56-59
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1mq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg0, vdupq_n_u32(0xCA62C1D6));
+        msg1 = vsha1su1q_u32(msg1, msg0);
+        msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+        // Rounds 60-63
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg1, vdupq_n_u32(0xCA62C1D6));
+        msg2 = vsha1su1q_u32(msg2, msg1);
+        msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+        // Rounds 64-67
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e0, tmp0);
+        tmp0 = vaddq_u32(msg2, vdupq_n_u32(0xCA62C1D6));
+        msg3 = vsha1su1q_u32(msg3, msg2);
+
+        // Rounds 68-71
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+        tmp1 = vaddq_u32(msg3, vdupq_n_u32(0xCA62C1D6));
+
+        // Rounds 72-75
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e0, tmp0);
+
+        // Rounds 76-79
+        e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        abcd = vsha1pq_u32(abcd, e1, tmp1);
+
+        abcd = vaddq_u32(abcd, abcd_save);
+        e0 += e_save;
+
+        data += 64;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e0;
+}
+
+} // namespace
+
+bool sha1HardwareAvailable() {
+#if defined(__linux__)
+    static const bool available = (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+    return available;
+#else
+    // __ARM_FEATURE_CRYPTO is part of the build baseline here
+    // (e.g. Apple Silicon), so the instructions are guaranteed present
+    return true;
+#endif
+}
+
+void sha1Hardware(const uint8_t* data, size_t length, uint8_t digest[20]) {
+    uint32_t state[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    // Bulk of the message: whole 64-byte blocks straight from the input
+    size_t full_blocks = length / 64;
+    sha1CeTransform(state, data, full_blocks);
+
+    // Final block(s): remaining bytes + 0x80 pad + 64-bit bit length
+    uint8_t tail[128];
+    size_t rem = length - full_blocks * 64;
+    std::memcpy(tail, data + full_blocks * 64, rem);
+    tail[rem] = 0x80;
+    size_t tail_len = (rem + 1 + 8 <= 64) ? 64 : 128;
+    std::memset(tail + rem + 1, 0, tail_len - rem - 1 - 8);
+
+    uint64_t bit_length = static_cast<uint64_t>(length) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tail_len - 1 - i] = static_cast<uint8_t>(bit_length >> (i * 8));
+    }
+    sha1CeTransform(state, tail, tail_len / 64);
+
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+#else  // !TORRENT_SHA1_NI && !TORRENT_SHA1_CE
+
+// Remaining targets (non-GNU compilers, ARM builds without the crypto
+// baseline) use the OpenSSL fallback in utils::sha1.
+bool sha1HardwareAvailable() {
+    return false;
+}
+
+void sha1Hardware(const uint8_t*, size_t, uint8_t*) {
+}
+
+#endif  // TORRENT_SHA1_NI
+
+namespace {
+
+// Portable block transform backing Sha1Stream when SHA-NI is absent
+void sha1ScalarTransform(uint32_t state[5], const uint8_t* data, size_t blocks) {
+    while (blocks-- > 0) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<uint32_t>(data[i * 4]) << 24) |
+                   (static_cast<uint32_t>(data[i * 4 + 1]) << 16) |
+                   (static_cast<uint32_t>(data[i * 4 + 2]) << 8) |
+                   static_cast<uint32_t>(data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            uint32_t v = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (v << 1) | (v >> 31);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t tmp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = tmp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        data += 64;
+    }
+}
+
+void sha1StreamTransform(uint32_t state[5], const uint8_t* data, size_t blocks) {
+#if defined(TORRENT_SHA1_NI)
+    if (sha1HardwareAvailable()) {
+        sha1NiTransform(state, data, blocks);
+        return;
+    }
+#elif defined(TORRENT_SHA1_CE)
+    if (sha1HardwareAvailable()) {
+        sha1CeTransform(state, data, blocks);
+        return;
+    }
+#endif
+    sha1ScalarTransform(state, data, blocks);
+}
+
+} // namespace
+
+Sha1Stream::Sha1Stream()
+    : state_{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0},
+      buffered_(0), total_(0) {
+}
+
+void Sha1Stream::update(const uint8_t* data, size_t length) {
+    total_ += length;
+
+    // Top up a partial block left over from the previous update
+    if (buffered_ != 0) {
+        size_t take = 64 - buffered_;
+        if (take > length) {
+            take = length;
+        }
+        std::memcpy(buffer_ + buffered_, data, take);
+        buffered_ += take;
+        data += take;
+        length -= take;
+        if (buffered_ < 64) {
+            return;
+        }
+        sha1StreamTransform(state_, buffer_, 1);
+        buffered_ = 0;
+    }
+
+    size_t blocks = length / 64;
+    if (blocks != 0) {
+        sha1StreamTransform(state_, data, blocks);
+        data += blocks * 64;
+        length -= blocks * 64;
+    }
+
+    if (length != 0) {
+        std::memcpy(buffer_, data, length);
+        buffered_ = length;
+    }
+}
+
+void Sha1Stream::finish(uint8_t digest[20]) {
+    // Final block(s): buffered bytes + 0x80 pad + 64-bit bit length
+    uint8_t tail[128];
+    std::memcpy(tail, buffer_, buffered_);
+    tail[buffered_] = 0x80;
+    size_t tail_len = (buffered_ + 1 + 8 <= 64) ? 64 : 128;
+    std::memset(tail + buffered_ + 1, 0, tail_len - buffered_ - 1 - 8);
+
+    uint64_t bit_length = total_ * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tail_len - 1 - i] = static_cast<uint8_t>(bit_length >> (i * 8));
+    }
+    sha1StreamTransform(state_, tail, tail_len / 64);
+
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4 + 0] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+}
+
+} // namespace utils
+} // namespace torrent
@@ -95,7 +95,7 @@ void TorrentFile::parse(const BencodeValue& root) {
             if (tier.isList()) {
                 for (const auto& url : tier.getList()) {
                     if (url.isString()) {
-                        announce_list_.push_back(url.getString());
+                        announce_list_.push_back(url.getString().toOwned());
                     }
                 }
             }
@@ -129,12 +129,12 @@ void TorrentFile::parse(const BencodeValue& root) {
             // url-list is a list of URLs
             for (const auto& url : it->second.getList()) {
                 if (url.isString()) {
-                    web_seeds_.push_back(url.getString());
+                    web_seeds_.push_back(url.getString().toOwned());
                 }
             }
         } else if (it->second.isString()) {
             // Single URL (some clients use string instead of list)
-            web_seeds_.push_back(it->second.getString());
+            web_seeds_.push_back(it->second.getString().toOwned());
         }
     }
 
@@ -169,7 +169,7 @@ void TorrentFile::parseInfo(const BencodeValue& info) {
     // Pieces (required) - concatenated SHA1 hashes
     it = dict.find("pieces");
     if (it != dict.end() && it->second.isString()) {
-        const std::string& pieces_str = it->second.getString();
+        std::string_view pieces_str = it->second.getString();
         pieces_.assign(pieces_str.begin(), pieces_str.end());
 
         if (pieces_.size() % 20 != 0) {
@@ -216,7 +216,8 @@ void TorrentFile::parseInfo(const BencodeValue& info) {
             std::string path = name_;
             for (const auto& path_component : path_it->second.getList()) {
                 if (path_component.isString()) {
-                    path += "/" + path_component.getString();
+                    path += '/';
+                    path += std::string_view(path_component.getString());
                 }
             }
 
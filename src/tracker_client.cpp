@@ -3,6 +3,7 @@
 #include "bencode.h"
 #include "utils.h"
 #include "logger.h"
+#include <charconv>
 #include <sstream>
 #include <stdexcept>
 #include <cstring>
@@ -28,16 +29,10 @@ namespace torrent {
 
 Peer Peer::fromCompactIPv4(const uint8_t* data) {
     // IPv4 compact format: 4 bytes IP + 2 bytes port
-    struct in_addr addr;
-    std::memcpy(&addr.s_addr, data, 4);
-
-    char ip_str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
-
     uint16_t port = (static_cast<uint16_t>(data[4]) << 8) |
                      static_cast<uint16_t>(data[5]);
 
-    return Peer(ip_str, port);
+    return Peer(utils::ipv4ToString(data), port, /*is_ipv6=*/false);
 }
 
 Peer Peer::fromCompactIPv6(const uint8_t* data) {
@@ -47,7 +42,7 @@ Peer Peer::fromCompactIPv6(const uint8_t* data) {
     uint16_t port = (static_cast<uint16_t>(data[16]) << 8) |
                      static_cast<uint16_t>(data[17]);
 
-    return Peer(ipv6, port);
+    return Peer(std::move(ipv6), port, /*is_ipv6=*/true);
 }
 
 std::vector<uint8_t> Peer::toCompact() const {
@@ -171,6 +166,15 @@ TrackerClient::TrackerClient(const std::string& announce_url,
         LOG_INFO("Tracker type: UDP");
     } else {
         LOG_INFO("Tracker type: HTTP");
+
+        // Pre-encode the constant query prefix once
+        announce_base_ = announce_url_;
+        announce_base_ += announce_url_.find('?') != std::string::npos ? '&' : '?';
+        announce_base_ += "info_hash=";
+        announce_base_ += utils::urlEncode(info_hash_);
+        announce_base_ += "&peer_id=";
+        announce_base_ += utils::urlEncode(peer_id_);
+        announce_base_ += "&port=";
     }
 }
 
@@ -179,26 +183,33 @@ std::string TrackerClient::buildAnnounceUrl(int64_t uploaded,
                                             int64_t left,
                                             uint16_t port,
                                             const std::string& event) {
-    std::ostringstream url;
-    url << announce_url_;
-
-    // Add separator
-    url << (announce_url_.find('?') != std::string::npos ? "&" : "?");
-
-    // Required parameters
-    url << "info_hash=" << utils::urlEncode(info_hash_);
-    url << "&peer_id=" << utils::urlEncode(peer_id_);
-    url << "&port=" << port;
-    url << "&uploaded=" << uploaded;
-    url << "&downloaded=" << downloaded;
-    url << "&left=" << left;
-    url << "&compact=1";  // Request compact peer list
+    // Only the counters vary per announce; append them to the
+    // pre-encoded prefix with to_chars
+    std::string url = announce_base_;
+    url.reserve(url.size() + 96 + event.size());
+
+    char buf[24];
+    auto appendNumber = [&](int64_t value) {
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        (void)ec; // 24 bytes always fit an int64_t
+        url.append(buf, ptr);
+    };
+
+    appendNumber(port);
+    url += "&uploaded=";
+    appendNumber(uploaded);
+    url += "&downloaded=";
+    appendNumber(downloaded);
+    url += "&left=";
+    appendNumber(left);
+    url += "&compact=1";  // Request compact peer list
 
     if (!event.empty()) {
-        url << "&event=" << event;
+        url += "&event=";
+        url += event;
     }
 
-    return url.str();
+    return url;
 }
 
 bool TrackerClient::isUDP() const {
@@ -311,23 +322,11 @@ TrackerResponse TrackerClient::parseResponse(const std::string& response) {
         if (it != dict.end()) {
             if (it->second.isString()) {
                 // Compact format: 6 bytes per peer (4 for IP, 2 for port)
-                const std::string& peers_data = it->second.getString();
+                std::string_view peers_data = it->second.getString();
+                result.peers.reserve(result.peers.size() + peers_data.size() / 6);
                 for (size_t i = 0; i + 6 <= peers_data.size(); i += 6) {
-                    uint8_t ip1 = static_cast<uint8_t>(peers_data[i]);
-                    uint8_t ip2 = static_cast<uint8_t>(peers_data[i + 1]);
-                    uint8_t ip3 = static_cast<uint8_t>(peers_data[i + 2]);
-                    uint8_t ip4 = static_cast<uint8_t>(peers_data[i + 3]);
-
-                    std::ostringstream ip_oss;
-                    ip_oss << static_cast<int>(ip1) << "."
-                          << static_cast<int>(ip2) << "."
-                          << static_cast<int>(ip3) << "."
-                          << static_cast<int>(ip4);
-
-                    uint16_t port = (static_cast<uint8_t>(peers_data[i + 4]) << 8) |
-                                   static_cast<uint8_t>(peers_data[i + 5]);
-
-                    result.peers.emplace_back(ip_oss.str(), port);
+                    result.peers.push_back(Peer::fromCompactIPv4(
+                        reinterpret_cast<const uint8_t*>(peers_data.data() + i)));
                 }
             } else if (it->second.isList()) {
                 // Dictionary format
@@ -344,7 +343,7 @@ TrackerResponse TrackerClient::parseResponse(const std::string& response) {
                     if (ip_it != peer_dict.end() && ip_it->second.isString() &&
                         port_it != peer_dict.end() && port_it->second.isInteger()) {
 
-                        std::string ip = ip_it->second.getString();
+                        std::string ip = ip_it->second.getString().toOwned();
                         uint16_t port = static_cast<uint16_t>(port_it->second.getInteger());
 
                         result.peers.emplace_back(ip, port);
@@ -1,5 +1,7 @@
 #include "udp_tracker.h"
 #include "logger.h"
+#include "utils.h"
+#include <charconv>
 #include <cstring>
 #include <sstream>
 #include <chrono>
@@ -26,34 +28,27 @@
 namespace torrent {
 
 // Helper functions for network byte order conversion
-static void writeInt64(std::vector<uint8_t>& buffer, int64_t value) {
-    buffer.push_back((value >> 56) & 0xFF);
-    buffer.push_back((value >> 48) & 0xFF);
-    buffer.push_back((value >> 40) & 0xFF);
-    buffer.push_back((value >> 32) & 0xFF);
-    buffer.push_back((value >> 24) & 0xFF);
-    buffer.push_back((value >> 16) & 0xFF);
-    buffer.push_back((value >> 8) & 0xFF);
-    buffer.push_back(value & 0xFF);
+static void storeInt64(uint8_t* out, int64_t value) {
+    out[0] = (value >> 56) & 0xFF;
+    out[1] = (value >> 48) & 0xFF;
+    out[2] = (value >> 40) & 0xFF;
+    out[3] = (value >> 32) & 0xFF;
+    out[4] = (value >> 24) & 0xFF;
+    out[5] = (value >> 16) & 0xFF;
+    out[6] = (value >> 8) & 0xFF;
+    out[7] = value & 0xFF;
 }
 
-static void writeInt32(std::vector<uint8_t>& buffer, int32_t value) {
-    buffer.push_back((value >> 24) & 0xFF);
-    buffer.push_back((value >> 16) & 0xFF);
-    buffer.push_back((value >> 8) & 0xFF);
-    buffer.push_back(value & 0xFF);
+static void storeInt32(uint8_t* out, uint32_t value) {
+    out[0] = (value >> 24) & 0xFF;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
 }
 
-static void writeUInt32(std::vector<uint8_t>& buffer, uint32_t value) {
-    buffer.push_back((value >> 24) & 0xFF);
-    buffer.push_back((value >> 16) & 0xFF);
-    buffer.push_back((value >> 8) & 0xFF);
-    buffer.push_back(value & 0xFF);
-}
-
-static void writeUInt16(std::vector<uint8_t>& buffer, uint16_t value) {
-    buffer.push_back((value >> 8) & 0xFF);
-    buffer.push_back(value & 0xFF);
+static void storeInt16(uint8_t* out, uint16_t value) {
+    out[0] = (value >> 8) & 0xFF;
+    out[1] = value & 0xFF;
 }
 
 static int64_t readInt64(const uint8_t* data) {
@@ -74,38 +69,23 @@ static int32_t readInt32(const uint8_t* data) {
            static_cast<int32_t>(data[3]);
 }
 
-static uint32_t readUInt32(const uint8_t* data) {
-    return (static_cast<uint32_t>(data[0]) << 24) |
-           (static_cast<uint32_t>(data[1]) << 16) |
-           (static_cast<uint32_t>(data[2]) << 8) |
-           static_cast<uint32_t>(data[3]);
-}
-
-static uint16_t readUInt16(const uint8_t* data) {
-    return (static_cast<uint16_t>(data[0]) << 8) |
-           static_cast<uint16_t>(data[1]);
-}
-
 // ==================== Connect Request/Response ====================
 
-std::vector<uint8_t> UDPConnectRequest::serialize() const {
-    std::vector<uint8_t> buffer;
-    buffer.reserve(16);
-    writeInt64(buffer, protocol_id);
-    writeInt32(buffer, action);
-    writeInt32(buffer, transaction_id);
-    return buffer;
+void UDPConnectRequest::serialize(uint8_t out[SIZE]) const {
+    storeInt64(out, protocol_id);
+    storeInt32(out + 8, static_cast<uint32_t>(action));
+    storeInt32(out + 12, static_cast<uint32_t>(transaction_id));
 }
 
-UDPConnectResponse UDPConnectResponse::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 16) {
+UDPConnectResponse UDPConnectResponse::deserialize(const uint8_t* data, size_t length) {
+    if (length < 16) {
         throw std::runtime_error("Invalid UDP connect response size");
     }
 
     UDPConnectResponse response;
-    response.action = readInt32(&data[0]);
-    response.transaction_id = readInt32(&data[4]);
-    response.connection_id = readInt64(&data[8]);
+    response.action = readInt32(data);
+    response.transaction_id = readInt32(data + 4);
+    response.connection_id = readInt64(data + 8);
 
     return response;
 }
@@ -124,76 +104,60 @@ UDPAnnounceRequest::UDPAnnounceRequest(int64_t conn_id,
     : connection_id(conn_id)
     , action(UDP_ACTION_ANNOUNCE)
     , transaction_id(tid)
-    , info_hash(hash)
     , downloaded(dl)
     , left(lft)
     , uploaded(ul)
     , event(static_cast<int32_t>(evt))
     , ip(0)  // 0 = use default
-    , key(std::random_device{}())
+    , key(utils::fastRand32())
     , num_want(-1)  // -1 = default
     , port(prt) {
 
-    // Convert peer_id string to bytes
-    peer_id.assign(peer_id_str.begin(), peer_id_str.end());
-    peer_id.resize(20, 0);  // Ensure 20 bytes
+    // Copy into the inline fields, zero-padded if the source is short
+    info_hash.fill(0);
+    std::memcpy(info_hash.data(), hash.data(),
+                std::min<size_t>(hash.size(), info_hash.size()));
+    peer_id.fill(0);
+    std::memcpy(peer_id.data(), peer_id_str.data(),
+                std::min<size_t>(peer_id_str.size(), peer_id.size()));
 }
 
-std::vector<uint8_t> UDPAnnounceRequest::serialize() const {
-    std::vector<uint8_t> buffer;
-    buffer.reserve(98);
-
-    writeInt64(buffer, connection_id);
-    writeInt32(buffer, action);
-    writeInt32(buffer, transaction_id);
-
-    // info_hash (20 bytes)
-    for (size_t i = 0; i < 20; ++i) {
-        buffer.push_back(i < info_hash.size() ? info_hash[i] : 0);
-    }
-
-    // peer_id (20 bytes)
-    for (size_t i = 0; i < 20; ++i) {
-        buffer.push_back(i < peer_id.size() ? peer_id[i] : 0);
-    }
-
-    writeInt64(buffer, downloaded);
-    writeInt64(buffer, left);
-    writeInt64(buffer, uploaded);
-    writeInt32(buffer, event);
-    writeUInt32(buffer, ip);
-    writeUInt32(buffer, key);
-    writeInt32(buffer, num_want);
-    writeUInt16(buffer, port);
-
-    return buffer;
+void UDPAnnounceRequest::serialize(uint8_t out[SIZE]) const {
+    storeInt64(out, connection_id);
+    storeInt32(out + 8, static_cast<uint32_t>(action));
+    storeInt32(out + 12, static_cast<uint32_t>(transaction_id));
+
+    // info_hash and peer_id are exactly 20 bytes each
+    std::memcpy(out + 16, info_hash.data(), 20);
+    std::memcpy(out + 36, peer_id.data(), 20);
+
+    storeInt64(out + 56, downloaded);
+    storeInt64(out + 64, left);
+    storeInt64(out + 72, uploaded);
+    storeInt32(out + 80, static_cast<uint32_t>(event));
+    storeInt32(out + 84, ip);
+    storeInt32(out + 88, key);
+    storeInt32(out + 92, static_cast<uint32_t>(num_want));
+    storeInt16(out + 96, port);
 }
 
-UDPAnnounceResponse UDPAnnounceResponse::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 20) {
+UDPAnnounceResponse UDPAnnounceResponse::deserialize(const uint8_t* data, size_t length) {
+    if (length < 20) {
         throw std::runtime_error("Invalid UDP announce response size");
     }
 
     UDPAnnounceResponse response;
-    response.action = readInt32(&data[0]);
-    response.transaction_id = readInt32(&data[4]);
-    response.interval = readInt32(&data[8]);
-    response.leechers = readInt32(&data[12]);
-    response.seeders = readInt32(&data[16]);
+    response.action = readInt32(data);
+    response.transaction_id = readInt32(data + 4);
+    response.interval = readInt32(data + 8);
+    response.leechers = readInt32(data + 12);
+    response.seeders = readInt32(data + 16);
 
     // Parse peers (6 bytes each: 4 bytes IP + 2 bytes port)
     size_t offset = 20;
-    while (offset + 6 <= data.size()) {
-        uint32_t ip = readUInt32(&data[offset]);
-        uint16_t port = readUInt16(&data[offset + 4]);
-
-        std::ostringstream ip_str;
-        ip_str << ((ip >> 24) & 0xFF) << "."
-               << ((ip >> 16) & 0xFF) << "."
-               << ((ip >> 8) & 0xFF) << "."
-               << (ip & 0xFF);
-
-        response.peers.emplace_back(ip_str.str(), port);
+    response.peers.reserve((length - offset) / 6);
+    while (offset + 6 <= length) {
+        response.peers.push_back(Peer::fromCompactIPv4(data + offset));
         offset += 6;
     }
 
@@ -202,17 +166,18 @@ UDPAnnounceResponse UDPAnnounceResponse::deserialize(const std::vector<uint8_t>&
 
 // ==================== Error Response ====================
 
-UDPErrorResponse UDPErrorResponse::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < 8) {
+UDPErrorResponse UDPErrorResponse::deserialize(const uint8_t* data, size_t length) {
+    if (length < 8) {
         throw std::runtime_error("Invalid UDP error response size");
     }
 
     UDPErrorResponse response;
-    response.action = readInt32(&data[0]);
-    response.transaction_id = readInt32(&data[4]);
+    response.action = readInt32(data);
+    response.transaction_id = readInt32(data + 4);
 
-    if (data.size() > 8) {
-        response.message = std::string(data.begin() + 8, data.end());
+    if (length > 8) {
+        response.message = std::string(reinterpret_cast<const char*>(data) + 8,
+                                       length - 8);
     }
 
     return response;
@@ -227,9 +192,9 @@ UDPTrackerClient::UDPTrackerClient(const std::string& tracker_url,
     , info_hash_(info_hash)
     , peer_id_(peer_id)
     , socket_fd_(INVALID_SOCKET)
+    , socket_timeout_seconds_(-1)
     , connection_id_(0)
-    , connected_(false)
-    , rng_(rd_()) {
+    , connected_(false) {
 
 #ifdef _WIN32
     WSADATA wsa_data;
@@ -245,44 +210,60 @@ UDPTrackerClient::~UDPTrackerClient() {
 
 bool UDPTrackerClient::parseURL(const std::string& url, std::string& host, uint16_t& port) {
     // Expected format: udp://tracker.example.com:8080/announce
-    if (url.substr(0, 6) != "udp://") {
+    if (url.size() < 6 || std::memcmp(url.data(), "udp://", 6) != 0) {
         LOG_ERROR("Invalid UDP tracker URL: {}", url);
         return false;
     }
 
-    size_t start = 6;  // After "udp://"
-    size_t end = url.find(':', start);
-    if (end == std::string::npos) {
-        LOG_ERROR("No port found in UDP tracker URL: {}", url);
-        return false;
+    // Single pass over the authority: the host ends at the last ':'
+    // before the path (or end of string), the port runs from there
+    const char* begin = url.data() + 6;
+    const char* end = url.data() + url.size();
+    const char* colon = nullptr;
+    const char* p = begin;
+    while (p != end && *p != '/') {
+        if (*p == ':') {
+            colon = p;
+        }
+        ++p;
     }
 
-    host = url.substr(start, end - start);
-
-    size_t port_end = url.find('/', end);
-    if (port_end == std::string::npos) {
-        port_end = url.length();
+    if (colon == nullptr || colon == begin) {
+        LOG_ERROR("No port found in UDP tracker URL: {}", url);
+        return false;
     }
 
-    try {
-        port = static_cast<uint16_t>(std::stoi(url.substr(end + 1, port_end - end - 1)));
-    } catch (...) {
+    unsigned port_value = 0;
+    auto [ptr, ec] = std::from_chars(colon + 1, p, port_value);
+    if (ec != std::errc() || ptr != p || port_value == 0 || port_value > 65535) {
         LOG_ERROR("Invalid port in UDP tracker URL: {}", url);
         return false;
     }
 
+    host.assign(begin, colon);
+    port = static_cast<uint16_t>(port_value);
+
     LOG_DEBUG("Parsed UDP tracker URL: host={}, port={}", host, port);
     return true;
 }
 
 int32_t UDPTrackerClient::generateTransactionId() {
-    std::uniform_int_distribution<int32_t> dist;
-    return dist(rng_);
+    return static_cast<int32_t>(utils::fastRand32());
 }
 
-bool UDPTrackerClient::sendRequest(const std::vector<uint8_t>& request,
-                                  std::vector<uint8_t>& response,
-                                  int timeout_seconds) {
+bool UDPTrackerClient::ensureSocket(int timeout_seconds) {
+    if (socket_fd_ != INVALID_SOCKET) {
+        // Only the timeout can differ between calls
+        if (timeout_seconds != socket_timeout_seconds_) {
+            struct timeval tv;
+            tv.tv_sec = timeout_seconds;
+            tv.tv_usec = 0;
+            setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+            socket_timeout_seconds_ = timeout_seconds;
+        }
+        return true;
+    }
+
     // Parse tracker URL
     std::string host;
     uint16_t port;
@@ -309,58 +290,82 @@ bool UDPTrackerClient::sendRequest(const std::vector<uint8_t>& request,
         return false;
     }
 
+    // Connect the socket: the kernel pins the destination so later
+    // exchanges are bare send/recv, and stray datagrams from other
+    // sources are filtered before they reach us
+    if (::connect(sock, result->ai_addr, result->ai_addrlen) != 0) {
+        LOG_ERROR("Failed to connect UDP socket to tracker");
+        closesocket(sock);
+        freeaddrinfo(result);
+        return false;
+    }
+    freeaddrinfo(result);
+
     // Set socket timeout
     struct timeval tv;
     tv.tv_sec = timeout_seconds;
     tv.tv_usec = 0;
     setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
 
-    // Send request
-    ssize_t sent = sendto(sock, reinterpret_cast<const char*>(request.data()),
-                         request.size(), 0, result->ai_addr, result->ai_addrlen);
+    socket_fd_ = sock;
+    socket_timeout_seconds_ = timeout_seconds;
+    return true;
+}
 
-    if (sent != static_cast<ssize_t>(request.size())) {
-        LOG_ERROR("Failed to send UDP request");
-        closesocket(sock);
-        freeaddrinfo(result);
-        return false;
+long UDPTrackerClient::sendRequest(const uint8_t* request, size_t request_length,
+                                   uint8_t* response, size_t response_capacity,
+                                   int timeout_seconds) {
+    // Resolution, socket setup and the receive timeout are all cached on
+    // the connected socket, so the steady-state cost of a round trip is
+    // one send and one recv
+    if (!ensureSocket(timeout_seconds)) {
+        return -1;
     }
 
-    LOG_DEBUG("Sent UDP request: {} bytes", sent);
+    ssize_t sent = send(socket_fd_, reinterpret_cast<const char*>(request),
+                        request_length, 0);
 
-    // Receive response
-    uint8_t buffer[2048];
-    struct sockaddr_in from_addr;
-    socklen_t from_len = sizeof(from_addr);
+    if (sent != static_cast<ssize_t>(request_length)) {
+        LOG_ERROR("Failed to send UDP request");
+        // Drop the socket so the next attempt re-resolves the tracker
+        closesocket(socket_fd_);
+        socket_fd_ = INVALID_SOCKET;
+        return -1;
+    }
 
-    ssize_t received = recvfrom(sock, reinterpret_cast<char*>(buffer), sizeof(buffer),
-                               0, (struct sockaddr*)&from_addr, &from_len);
+    LOG_DEBUG("Sent UDP request: {} bytes", sent);
 
-    closesocket(sock);
-    freeaddrinfo(result);
+    // Receive response straight into the caller's buffer
+    ssize_t received = recv(socket_fd_, reinterpret_cast<char*>(response),
+                            response_capacity, 0);
 
     if (received <= 0) {
         LOG_WARN("UDP receive timeout or error");
-        return false;
+        return -1;
     }
 
     LOG_DEBUG("Received UDP response: {} bytes", received);
-    response.assign(buffer, buffer + received);
-    return true;
+    return static_cast<long>(received);
 }
 
 bool UDPTrackerClient::connect() {
     int32_t transaction_id = generateTransactionId();
     UDPConnectRequest request(transaction_id);
 
-    std::vector<uint8_t> response_data;
-    if (!sendRequest(request.serialize(), response_data, 15)) {
+    uint8_t request_buf[UDPConnectRequest::SIZE];
+    request.serialize(request_buf);
+
+    uint8_t response_buf[2048];
+    long received = sendRequest(request_buf, sizeof(request_buf),
+                                response_buf, sizeof(response_buf), 15);
+    if (received < 0) {
         LOG_ERROR("UDP tracker connect failed");
         return false;
     }
 
     try {
-        UDPConnectResponse response = UDPConnectResponse::deserialize(response_data);
+        UDPConnectResponse response = UDPConnectResponse::deserialize(
+            response_buf, static_cast<size_t>(received));
 
         if (response.transaction_id != transaction_id) {
             LOG_ERROR("UDP tracker connect: transaction ID mismatch");
@@ -412,8 +417,13 @@ TrackerResponse UDPTrackerClient::announce(int64_t uploaded,
                               peer_id_, downloaded, left, uploaded,
                               udp_event, port);
 
-    std::vector<uint8_t> response_data;
-    if (!sendRequest(request.serialize(), response_data, 15)) {
+    uint8_t request_buf[UDPAnnounceRequest::SIZE];
+    request.serialize(request_buf);
+
+    uint8_t response_buf[2048];
+    long received = sendRequest(request_buf, sizeof(request_buf),
+                                response_buf, sizeof(response_buf), 15);
+    if (received < 0) {
         result.failure_reason = "UDP tracker announce failed";
         LOG_ERROR("UDP tracker announce failed");
         return result;
@@ -421,18 +431,20 @@ TrackerResponse UDPTrackerClient::announce(int64_t uploaded,
 
     try {
         // Check if it's an error response
-        if (response_data.size() >= 8) {
-            int32_t action = readInt32(&response_data[0]);
+        if (received >= 8) {
+            int32_t action = readInt32(response_buf);
 
             if (action == UDP_ACTION_ERROR) {
-                UDPErrorResponse error_resp = UDPErrorResponse::deserialize(response_data);
+                UDPErrorResponse error_resp = UDPErrorResponse::deserialize(
+                    response_buf, static_cast<size_t>(received));
                 result.failure_reason = "Tracker error: " + error_resp.message;
                 LOG_ERROR("UDP tracker error: {}", error_resp.message);
                 return result;
             }
         }
 
-        UDPAnnounceResponse response = UDPAnnounceResponse::deserialize(response_data);
+        UDPAnnounceResponse response = UDPAnnounceResponse::deserialize(
+            response_buf, static_cast<size_t>(received));
 
         if (response.transaction_id != transaction_id) {
             result.failure_reason = "Transaction ID mismatch";
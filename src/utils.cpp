@@ -1,10 +1,12 @@
 #include "utils.h"
+#include "sha1_hw.h"
 #include <openssl/sha.h>
 #include <random>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
 #include <cstring>
 
 #ifdef _WIN32
@@ -20,53 +22,127 @@ namespace utils {
 
 // SHA1 hash
 std::vector<uint8_t> sha1(const std::string& data) {
-    return sha1(std::vector<uint8_t>(data.begin(), data.end()));
+    return sha1(reinterpret_cast<const uint8_t*>(data.data()), data.size());
 }
 
 std::vector<uint8_t> sha1(const std::vector<uint8_t>& data) {
+    return sha1(data.data(), data.size());
+}
+
+std::vector<uint8_t> sha1(const uint8_t* data, size_t length) {
     std::vector<uint8_t> hash(SHA_DIGEST_LENGTH);
-    SHA1(data.data(), data.size(), hash.data());
+    sha1Into(hash.data(), data, length);
     return hash;
 }
 
-// URL encoding
-std::string urlEncode(const std::string& str) {
-    return urlEncode(std::vector<uint8_t>(str.begin(), str.end()));
+void sha1Into(uint8_t out[20], const uint8_t* data, size_t length) {
+    if (sha1HardwareAvailable()) {
+        // SHA-NI round instructions: ~1 cycle/byte vs ~5 scalar
+        sha1Hardware(data, length, out);
+    } else {
+        SHA1(data, length, out);
+    }
 }
 
-std::string urlEncode(const std::vector<uint8_t>& data) {
-    std::ostringstream encoded;
-    encoded.fill('0');
-    encoded << std::hex;
-
-    for (uint8_t byte : data) {
-        // Keep alphanumeric and some safe characters
-        if (std::isalnum(byte) || byte == '-' || byte == '_' || byte == '.' || byte == '~') {
-            encoded << static_cast<char>(byte);
+std::string ipv4ToString(const uint8_t* octets) {
+    char buf[16];
+    char* p = buf;
+    for (int i = 0; i < 4; ++i) {
+        if (i != 0) {
+            *p++ = '.';
+        }
+        uint8_t v = octets[i];
+        if (v >= 100) {
+            *p++ = static_cast<char>('0' + v / 100);
+            *p++ = static_cast<char>('0' + (v / 10) % 10);
+            *p++ = static_cast<char>('0' + v % 10);
+        } else if (v >= 10) {
+            *p++ = static_cast<char>('0' + v / 10);
+            *p++ = static_cast<char>('0' + v % 10);
         } else {
-            encoded << '%' << std::setw(2) << static_cast<int>(byte);
+            *p++ = static_cast<char>('0' + v);
         }
     }
+    return std::string(buf, static_cast<size_t>(p - buf));
+}
 
-    return encoded.str();
+// URL encoding
+// RFC 3986 unreserved characters pass through; everything else is
+// percent-encoded
+static bool urlSafe(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') || (byte >= 'a' && byte <= 'z') ||
+           (byte >= '0' && byte <= '9') ||
+           byte == '-' || byte == '_' || byte == '.' || byte == '~';
+}
+
+static std::string urlEncodeBytes(const uint8_t* data, size_t length) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+
+    std::string encoded;
+    encoded.reserve(length * 3);  // Worst case: every byte escapes
+
+    size_t i = 0;
+    while (i < length) {
+        // Append runs of safe bytes in one go (text inputs are mostly
+        // safe; binary info_hash/peer_id fall through to the escapes)
+        size_t run = i;
+        while (run < length && urlSafe(data[run])) {
+            ++run;
+        }
+        encoded.append(reinterpret_cast<const char*>(data) + i, run - i);
+        i = run;
+
+        while (i < length && !urlSafe(data[i])) {
+            uint8_t byte = data[i++];
+            encoded += '%';
+            encoded += kDigits[byte >> 4];
+            encoded += kDigits[byte & 0x0F];
+        }
+    }
+
+    return encoded;
 }
 
-// Hex conversion
-std::string toHex(const std::vector<uint8_t>& data) {
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (uint8_t byte : data) {
-        oss << std::setw(2) << static_cast<int>(byte);
+std::string urlEncode(const std::string& str) {
+    return urlEncodeBytes(reinterpret_cast<const uint8_t*>(str.data()),
+                          str.size());
+}
+
+std::string urlEncode(const std::vector<uint8_t>& data) {
+    return urlEncodeBytes(data.data(), data.size());
+}
+
+// Hex conversion: table lookups into a pre-sized buffer. The old
+// ostringstream formatting spent far longer in stream machinery than in
+// the conversion itself.
+static constexpr char kHexDigits[] = "0123456789abcdef";
+
+std::string toHex(const uint8_t* data, size_t length) {
+    std::string result(length * 2, '\0');
+    char* out = result.data();
+    for (size_t i = 0; i < length; ++i) {
+        *out++ = kHexDigits[data[i] >> 4];
+        *out++ = kHexDigits[data[i] & 0x0F];
     }
-    return oss.str();
+    return result;
+}
+
+std::string toHex(const std::vector<uint8_t>& data) {
+    return toHex(data.data(), data.size());
+}
+
+static uint8_t hexNibble(char c) {
+    if (c >= '0' && c <= '9') return static_cast<uint8_t>(c - '0');
+    if (c >= 'a' && c <= 'f') return static_cast<uint8_t>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return static_cast<uint8_t>(c - 'A' + 10);
+    return 0;
 }
 
 std::vector<uint8_t> fromHex(const std::string& hex) {
-    std::vector<uint8_t> data;
-    for (size_t i = 0; i < hex.length(); i += 2) {
-        std::string byte_str = hex.substr(i, 2);
-        uint8_t byte = static_cast<uint8_t>(std::stoi(byte_str, nullptr, 16));
-        data.push_back(byte);
+    std::vector<uint8_t> data(hex.length() / 2);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>((hexNibble(hex[i * 2]) << 4) |
+                                       hexNibble(hex[i * 2 + 1]));
     }
     return data;
 }
@@ -75,52 +151,51 @@ std::vector<uint8_t> fromHex(const std::string& hex) {
 std::string generatePeerId() {
     static const char* chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 61);
-
+    // Draws from the shared xoshiro state instead of seeding a fresh
+    // mt19937 per call; a peer id is a protocol nonce, not a secret
     std::string peer_id = "-TC0100-";  // Client ID: TC (TorrentClient) version 01.00
     for (int i = 0; i < 12; ++i) {
-        peer_id += chars[dis(gen)];
+        peer_id += chars[fastRand32() % 62];
     }
     return peer_id;
 }
 
-// Network byte order (these might be redundant on some platforms)
-#ifdef _WIN32
-uint32_t htonl(uint32_t hostlong) {
-    return ::htonl(hostlong);
-}
-
-uint16_t htons(uint16_t hostshort) {
-    return ::htons(hostshort);
+// xoshiro256** (Blackman/Vigna). One thread-local state replaces the
+// per-client mt19937 (~5KB each) the UDP tracker used to carry just to
+// draw 32-bit transaction ids and announce keys.
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
 }
 
-uint32_t ntohl(uint32_t netlong) {
-    return ::ntohl(netlong);
-}
-
-uint16_t ntohs(uint16_t netshort) {
-    return ::ntohs(netshort);
-}
-#else
-uint32_t htonl(uint32_t hostlong) {
-    return ::htonl(hostlong);
-}
+uint32_t fastRand32() {
+    struct XoshiroState {
+        uint64_t s[4];
+        XoshiroState() {
+            std::random_device rd;
+            for (uint64_t& word : s) {
+                word = (static_cast<uint64_t>(rd()) << 32) | rd();
+            }
+            // The all-zero state is the one fixed point; nudge away
+            if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+                s[0] = 1;
+            }
+        }
+    };
+    static thread_local XoshiroState state;
+    uint64_t* s = state.s;
 
-uint16_t htons(uint16_t hostshort) {
-    return ::htons(hostshort);
-}
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
 
-uint32_t ntohl(uint32_t netlong) {
-    return ::ntohl(netlong);
+    return static_cast<uint32_t>(result >> 32);
 }
 
-uint16_t ntohs(uint16_t netshort) {
-    return ::ntohs(netshort);
-}
-#endif
-
 // Formatting helpers
 std::string formatBytes(int64_t bytes) {
     const char* units[] = {"B", "KB", "MB", "GB", "TB"};
@@ -132,9 +207,11 @@ std::string formatBytes(int64_t bytes) {
         unit_index++;
     }
 
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(2) << size << " " << units[unit_index];
-    return oss.str();
+    // snprintf, not ostringstream: this runs every second from the
+    // status line and the stream machinery costs more than the format
+    char buf[32];
+    int len = std::snprintf(buf, sizeof(buf), "%.2f %s", size, units[unit_index]);
+    return std::string(buf, static_cast<size_t>(len));
 }
 
 std::string formatSpeed(double bytesPerSec) {
@@ -160,80 +237,95 @@ int calculateBackoffDelay(int attempt, int base_delay_ms, int max_delay_ms) {
 
 // TokenBucket implementation
 TokenBucket::TokenBucket(int64_t rate_bytes_per_sec)
-    : rate_(rate_bytes_per_sec)
-    , tokens_(rate_bytes_per_sec)
-    , capacity_(rate_bytes_per_sec * 2)  // Allow burst up to 2 seconds worth
-    , last_update_(std::chrono::steady_clock::now()) {
-    if (rate_ <= 0) {
-        rate_ = 0;  // 0 means unlimited
-        capacity_ = 0;
-    }
+    : rate_(rate_bytes_per_sec > 0 ? rate_bytes_per_sec : 0)
+    // Start with one second's worth; burst capacity is two seconds' worth
+    , tokens_scaled_(rate_bytes_per_sec > 0 ? rate_bytes_per_sec * kTokenScale : 0)
+    , last_refill_ns_(nowNs()) {
 }
 
-void TokenBucket::refill() {
-    if (rate_ <= 0) return;  // Unlimited
+int64_t TokenBucket::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_).count() / 1000.0;
+void TokenBucket::refill(int64_t rate) {
+    int64_t now = nowNs();
+    int64_t last = last_refill_ns_.load(std::memory_order_relaxed);
+    int64_t elapsed = now - last;
+    if (elapsed <= 0) {
+        return;
+    }
 
-    // Add tokens based on elapsed time
-    tokens_ += elapsed * rate_;
+    // Tokens earned over the interval; double avoids overflow on large
+    // rate * elapsed products and truncation only loses sub-1/1024-byte
+    // amounts per refill
+    int64_t add = static_cast<int64_t>(static_cast<double>(elapsed) * 1e-9 *
+                                       static_cast<double>(rate) * kTokenScale);
+    if (add <= 0) {
+        return;  // Interval too short to credit; leave it for later
+    }
 
-    // Cap at capacity
-    if (tokens_ > capacity_) {
-        tokens_ = capacity_;
+    // One thread claims the interval; if another won the race, its
+    // credit covers it
+    if (!last_refill_ns_.compare_exchange_strong(last, now,
+                                                 std::memory_order_relaxed)) {
+        return;
     }
 
-    last_update_ = now;
+    int64_t capacity = rate * 2 * kTokenScale;
+    int64_t current = tokens_scaled_.load(std::memory_order_relaxed);
+    int64_t desired;
+    do {
+        desired = current + add;
+        if (desired > capacity) {
+            desired = capacity;
+        }
+    } while (!tokens_scaled_.compare_exchange_weak(current, desired,
+                                                   std::memory_order_relaxed));
 }
 
 bool TokenBucket::tryConsume(size_t bytes) {
-    if (rate_ <= 0) return true;  // Unlimited
+    int64_t rate = rate_.load(std::memory_order_relaxed);
+    if (rate <= 0) return true;  // Unlimited
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    refill();
+    refill(rate);
 
-    if (tokens_ >= static_cast<double>(bytes)) {
-        tokens_ -= bytes;
-        return true;
-    }
-
-    return false;
+    int64_t want = static_cast<int64_t>(bytes) * kTokenScale;
+    int64_t current = tokens_scaled_.load(std::memory_order_relaxed);
+    do {
+        if (current < want) {
+            return false;
+        }
+    } while (!tokens_scaled_.compare_exchange_weak(current, current - want,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed));
+    return true;
 }
 
 void TokenBucket::waitAndConsume(size_t bytes) {
-    if (rate_ <= 0) return;  // Unlimited
-
-    while (true) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            refill();
-
-            if (tokens_ >= static_cast<double>(bytes)) {
-                tokens_ -= bytes;
-                return;
-            }
-        }
-
-        // Sleep for a short time before retry
+    // tryConsume short-circuits to true when unlimited
+    while (!tryConsume(bytes)) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 }
 
 void TokenBucket::setRate(int64_t rate_bytes_per_sec) {
     std::lock_guard<std::mutex> lock(mutex_);
-    rate_ = rate_bytes_per_sec;
+    int64_t rate = rate_bytes_per_sec > 0 ? rate_bytes_per_sec : 0;
+    rate_.store(rate, std::memory_order_relaxed);
 
-    if (rate_ <= 0) {
-        rate_ = 0;  // 0 means unlimited
-        capacity_ = 0;
-        tokens_ = 0;
+    if (rate == 0) {
+        tokens_scaled_.store(0, std::memory_order_relaxed);
     } else {
-        capacity_ = rate_ * 2;
-        tokens_ = std::min(tokens_, static_cast<double>(capacity_));
+        // Clamp accumulated tokens against the new burst capacity
+        int64_t capacity = rate * 2 * kTokenScale;
+        int64_t current = tokens_scaled_.load(std::memory_order_relaxed);
+        if (current > capacity) {
+            tokens_scaled_.store(capacity, std::memory_order_relaxed);
+        }
     }
 
-    last_update_ = std::chrono::steady_clock::now();
+    last_refill_ns_.store(nowNs(), std::memory_order_relaxed);
 }
 
 // SpeedTracker implementation
@@ -241,56 +333,63 @@ SpeedTracker::SpeedTracker(int window_seconds)
     : window_seconds_(window_seconds) {
 }
 
+int64_t SpeedTracker::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void SpeedTracker::addBytes(int64_t bytes) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    Sample sample;
-    sample.timestamp = std::chrono::steady_clock::now();
-    sample.bytes = bytes;
-
-    samples_.push_back(sample);
-    removeOldSamples();
+    int64_t now_ns = nowNs();
+    ts_ns_.push_back(now_ns);
+    bytes_.push_back(bytes);
+    removeOldSamples(now_ns);
 }
 
-void SpeedTracker::removeOldSamples() {
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - std::chrono::seconds(window_seconds_);
+void SpeedTracker::removeOldSamples(int64_t now_ns) {
+    int64_t cutoff = now_ns - window_seconds_ * 1000000000LL;
 
-    while (!samples_.empty() && samples_.front().timestamp < cutoff) {
-        samples_.pop_front();
+    while (head_ < ts_ns_.size() && ts_ns_[head_] < cutoff) {
+        ++head_;
+    }
+
+    // Drop the dead prefix once it dominates the arrays, keeping
+    // appends amortized O(1) without a ring's wraparound bookkeeping
+    if (head_ > 64 && head_ * 2 > ts_ns_.size()) {
+        ts_ns_.erase(ts_ns_.begin(), ts_ns_.begin() + head_);
+        bytes_.erase(bytes_.begin(), bytes_.begin() + head_);
+        head_ = 0;
     }
 }
 
 double SpeedTracker::getSpeed() const {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (samples_.empty()) {
+    int64_t now_ns = nowNs();
+    int64_t cutoff = now_ns - window_seconds_ * 1000000000LL;
+
+    // Timestamps are appended in order, so the live range is the tail
+    // starting at the first sample inside the window
+    size_t i = head_;
+    while (i < ts_ns_.size() && ts_ns_[i] < cutoff) {
+        ++i;
+    }
+    if (i == ts_ns_.size()) {
         return 0.0;
     }
 
-    // Remove old samples
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - std::chrono::seconds(window_seconds_);
-
+    int64_t oldest_ns = ts_ns_[i];
     int64_t total_bytes = 0;
-    auto oldest_timestamp = now;
-
-    for (const auto& sample : samples_) {
-        if (sample.timestamp >= cutoff) {
-            total_bytes += sample.bytes;
-            if (sample.timestamp < oldest_timestamp) {
-                oldest_timestamp = sample.timestamp;
-            }
-        }
+    for (size_t j = i; j < bytes_.size(); ++j) {
+        total_bytes += bytes_[j];
     }
 
     if (total_bytes == 0) {
         return 0.0;
     }
 
-    // Calculate elapsed time
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - oldest_timestamp).count() / 1000.0;
-
+    double elapsed = static_cast<double>(now_ns - oldest_ns) / 1e9;
     if (elapsed <= 0.0) {
         return 0.0;
     }
@@ -300,7 +399,9 @@ double SpeedTracker::getSpeed() const {
 
 void SpeedTracker::reset() {
     std::lock_guard<std::mutex> lock(mutex_);
-    samples_.clear();
+    ts_ns_.clear();
+    bytes_.clear();
+    head_ = 0;
 }
 
 // ============================================================================
@@ -322,8 +423,40 @@ IPVersion detectIPVersion(const std::string& ip) {
 }
 
 bool isValidIPv4(const std::string& ip) {
-    struct in_addr addr;
-    return inet_pton(AF_INET, ip.c_str(), &addr) == 1;
+    // Strict dotted-quad walk with the same acceptance as
+    // inet_pton(AF_INET): four decimal octets 0-255, no leading zeros,
+    // nothing before or after. Validating in place skips the libc call
+    // when peer lists arrive as thousands of address strings.
+    const char* p = ip.data();
+    const char* end = p + ip.size();
+
+    for (int octet = 0; octet < 4; ++octet) {
+        if (octet != 0) {
+            if (p == end || *p != '.') {
+                return false;
+            }
+            ++p;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return false;
+        }
+        unsigned value = static_cast<unsigned>(*p++ - '0');
+        if (value == 0) {
+            // "0" is fine, "01" is not
+            if (p != end && *p >= '0' && *p <= '9') {
+                return false;
+            }
+        } else {
+            while (p != end && *p >= '0' && *p <= '9') {
+                value = value * 10 + static_cast<unsigned>(*p++ - '0');
+                if (value > 255) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return p == end;
 }
 
 bool isValidIPv6(const std::string& ipv6) {
@@ -332,18 +465,16 @@ bool isValidIPv6(const std::string& ipv6) {
 }
 
 std::vector<uint8_t> ipv6ToCompact(const std::string& ipv6) {
-    std::vector<uint8_t> result(16);
-
     struct in6_addr addr;
     if (inet_pton(AF_INET6, ipv6.c_str(), &addr) != 1) {
         // Invalid IPv6 address
         return {};
     }
 
-    // Copy the 16 bytes
-    std::memcpy(result.data(), &addr, 16);
-
-    return result;
+    // Construct straight from the parsed bytes — no zero-filled
+    // allocation on the failure path and no double write on success
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&addr);
+    return std::vector<uint8_t>(bytes, bytes + 16);
 }
 
 std::string compactToIPv6(const uint8_t* data) {
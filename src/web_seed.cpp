@@ -23,6 +23,55 @@ static size_t curlWriteCallback(void* contents, size_t size, size_t nmemb, void*
     return total_size;
 }
 
+// ============================================================================
+// Buffer pool for range-request downloads
+// ============================================================================
+//
+// Every download used to allocate a fresh piece-sized vector (256KB-16MB)
+// and free it after the callback consumed it. With many pieces in flight
+// that churns the allocator and fragments the heap, so instead buffers are
+// recycled through a small freelist: acquire() hands back a cleared vector
+// that keeps its old capacity, and once the vector is reserved to the
+// piece size curl's write callback appends land in pooled storage with no
+// further growth copies.
+
+class PieceBufferPool {
+public:
+    std::vector<uint8_t> acquire(size_t expected_size) {
+        std::vector<uint8_t> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_buffers_.empty()) {
+                buffer = std::move(free_buffers_.back());
+                free_buffers_.pop_back();
+            }
+        }
+        buffer.clear();
+        buffer.reserve(expected_size);
+        return buffer;
+    }
+
+    void release(std::vector<uint8_t>&& buffer) {
+        if (buffer.capacity() == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_buffers_.size() < MAX_POOLED_BUFFERS) {
+            free_buffers_.push_back(std::move(buffer));
+        }
+    }
+
+private:
+    // Bounds idle memory: pieces beyond the usual number of concurrent
+    // downloads are simply freed instead of pooled
+    static constexpr size_t MAX_POOLED_BUFFERS = 8;
+
+    std::mutex mutex_;
+    std::vector<std::vector<uint8_t>> free_buffers_;
+};
+
+static PieceBufferPool piece_buffer_pool;
+
 // ============================================================================
 // WebSeed Implementation
 // ============================================================================
@@ -179,6 +228,9 @@ void WebSeed::downloadPieceAsync(uint32_t piece_index, uint32_t offset, uint32_t
         }
     }
 
+    // The callback has consumed the block; recycle its storage
+    piece_buffer_pool.release(std::move(download.data));
+
     active_downloads_--;
 }
 
@@ -230,7 +282,10 @@ std::vector<uint8_t> WebSeed::performHttpRangeRequest(const std::string& url,
                                                        int64_t start_byte,
                                                        int64_t end_byte,
                                                        std::string& error_msg) {
-    std::vector<uint8_t> response_data;
+    // Pooled buffer, pre-sized to the whole range so curl's appends
+    // never trigger a reallocation mid-transfer
+    std::vector<uint8_t> response_data =
+        piece_buffer_pool.acquire(static_cast<size_t>(end_byte - start_byte + 1));
 
     CURL* curl = curl_easy_init();
     if (!curl) {
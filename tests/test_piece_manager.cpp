@@ -116,11 +116,10 @@ TEST_F(PieceManagerTest, GetBlocksForPiece) {
     size_t expected_blocks = piece_length_ / BLOCK_SIZE;
     EXPECT_EQ(blocks.size(), expected_blocks);
 
+    EXPECT_EQ(blocks.piece_index, 0u);
     for (size_t i = 0; i < blocks.size(); ++i) {
-        EXPECT_EQ(blocks[i].piece_index, 0);
-        EXPECT_EQ(blocks[i].offset, i * BLOCK_SIZE);
-        EXPECT_EQ(blocks[i].length, BLOCK_SIZE);
-        EXPECT_FALSE(blocks[i].downloaded);
+        EXPECT_EQ(blocks.offsets[i], i * BLOCK_SIZE);
+        EXPECT_EQ(blocks.lengths[i], BLOCK_SIZE);
     }
 }
 
@@ -130,10 +129,10 @@ TEST_F(PieceManagerTest, GetBlocksForLastPiece) {
 
     EXPECT_GT(blocks.size(), 0);
 
+    EXPECT_EQ(blocks.piece_index, last_piece_index);
     size_t total_size = 0;
-    for (const auto& block : blocks) {
-        EXPECT_EQ(block.piece_index, last_piece_index);
-        total_size += block.length;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        total_size += blocks.lengths[i];
     }
 
     size_t expected_last_piece_size = total_length_ % piece_length_;